@@ -0,0 +1,60 @@
+//
+// Benchmark.cpp
+//
+
+#include "Benchmark.h"
+
+#include "DetourAlloc.h"
+
+#include <atomic>
+#include <cstdlib>
+
+namespace {
+
+std::atomic<int> s_detourAllocs{ 0 };
+
+void* CountingAlloc(int size, dtAllocHint)
+{
+	s_detourAllocs++;
+	return malloc(size);
+}
+
+void CountingFree(void* ptr)
+{
+	free(ptr);
+}
+
+} // namespace
+
+double Milliseconds(Clock::duration duration)
+{
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+double Microseconds(Clock::duration duration)
+{
+	return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+//----------------------------------------------------------------------------
+
+DetourAllocCounter::DetourAllocCounter()
+{
+	s_detourAllocs = 0;
+	dtAllocSetCustom(CountingAlloc, CountingFree);
+}
+
+DetourAllocCounter::~DetourAllocCounter()
+{
+	dtAllocSetCustom(nullptr, nullptr);
+}
+
+int DetourAllocCounter::GetCount() const
+{
+	return s_detourAllocs;
+}
+
+void DetourAllocCounter::Reset()
+{
+	s_detourAllocs = 0;
+}
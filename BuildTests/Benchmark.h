@@ -0,0 +1,30 @@
+//
+// Benchmark.h
+//
+// Timing and counting for the benchmarks.
+//
+
+#pragma once
+
+#include <chrono>
+
+typedef std::chrono::steady_clock Clock;
+
+double Milliseconds(Clock::duration duration);
+double Microseconds(Clock::duration duration);
+
+// Counts Detour's allocations (dtAlloc) while it's in scope, from every
+// thread. Detour goes back to plain malloc and free afterwards, so don't
+// make one while tiles are being built.
+class DetourAllocCounter
+{
+public:
+	DetourAllocCounter();
+	~DetourAllocCounter();
+
+	DetourAllocCounter(const DetourAllocCounter&) = delete;
+	DetourAllocCounter& operator=(const DetourAllocCounter&) = delete;
+
+	int GetCount() const;
+	void Reset();
+};
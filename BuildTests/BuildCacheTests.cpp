@@ -0,0 +1,228 @@
+//
+// BuildCacheTests.cpp
+//
+// Tests for the build cache, which lets building all tiles again skip the
+// ones whose inputs haven't changed, and a benchmark of baking a large zone
+// again after a small edit.
+//
+
+#include "Benchmark.h"
+#include "Test.h"
+#include "TestZone.h"
+
+#include "BuildContext.h"
+#include "InputGeom.h"
+#include "Sample_TileMesh.h"
+
+#include "DetourNavMesh.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Set the mesh up to build geom with the build cache kept in cachePath.
+void PrepareMesh(Sample_TileMesh& mesh, InputGeom& geom, BuildContext& context, const std::string& cachePath)
+{
+	mesh.setContext(&context);
+	mesh.setBuildThreads(0);
+	mesh.handleMeshChanged(&geom);
+	mesh.setReuseTiles(true);
+	mesh.setBuildCachePath(cachePath);
+}
+
+bool BuildAndSave(Sample_TileMesh& mesh, const std::string& filename, std::vector<char>& saved)
+{
+	bool built = mesh.handleBuild();
+	mesh.waitForBuildAllTiles();
+
+	return built && mesh.getNavMesh() != nullptr
+		&& mesh.SaveMesh(filename)
+		&& ReadFileBytes(filename, saved);
+}
+
+int GetTileCount(const Sample_TileMesh& mesh)
+{
+	int width = 0, height = 0, maxTiles = 0;
+	mesh.getTileStatistics(width, height, maxTiles);
+	return width * height;
+}
+
+// A small volume of water in the middle of tile x, y, well away from the
+// edges of the tiles next to it.
+void AddVolumeInTile(InputGeom& geom, int x, int y)
+{
+	const float TILE_SIZE = 76.8f;
+	const float HALF_SIZE = 5.0f;
+
+	const float cx = geom.getMeshBoundsMin()[0] + (x + 0.5f) * TILE_SIZE;
+	const float cz = geom.getMeshBoundsMin()[2] + (y + 0.5f) * TILE_SIZE;
+
+	const float verts[] = {
+		cx - HALF_SIZE, 0, cz - HALF_SIZE,
+		cx + HALF_SIZE, 0, cz - HALF_SIZE,
+		cx + HALF_SIZE, 0, cz + HALF_SIZE,
+		cx - HALF_SIZE, 0, cz + HALF_SIZE,
+	};
+	geom.addConvexVolume(verts, 4, -100.0f, 100.0f, SAMPLE_POLYAREA_WATER);
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+// A second bake of the same zone, in a new session that reads the cache
+// file, takes every tile from the cache and saves exactly the same mesh.
+TEST(BuildCacheHitsMatch)
+{
+	BuildContext context;
+	context.enableLog(false);
+
+	InputGeom geom("test", std::string(), std::string());
+	CHECK(LoadTestZone(TestZoneDesc(), context, geom));
+
+	const std::string cachePath = GetTestFilePath("cache_hits.buildcache");
+	const std::string filename = GetTestFilePath("cache_hits.bin");
+	remove(cachePath.c_str());
+
+	std::vector<char> built;
+	int tileCount = 0;
+	{
+		Sample_TileMesh mesh;
+		PrepareMesh(mesh, geom, context, cachePath);
+		CHECK(BuildAndSave(mesh, filename, built));
+
+		tileCount = GetTileCount(mesh);
+		CHECK(mesh.getTilesBuilt() == tileCount);
+		CHECK(mesh.getTilesReused() == 0);
+	}
+
+	std::vector<char> reused;
+	{
+		Sample_TileMesh mesh;
+		PrepareMesh(mesh, geom, context, cachePath);
+		CHECK(BuildAndSave(mesh, filename, reused));
+
+		CHECK(mesh.getTilesBuilt() == 0);
+		CHECK(mesh.getTilesReused() == tileCount);
+	}
+
+	CHECK(!built.empty());
+	CHECK(reused == built);
+
+	remove(cachePath.c_str());
+	remove(filename.c_str());
+}
+
+// Adding a convex volume in the middle of one tile only builds that tile
+// again, and the mesh comes out the same as a bake with no cache at all.
+// Taking the volume out again builds the tile once more, since its old
+// entry was dropped when nothing used it.
+TEST(BuildCacheRebuildsEditedTiles)
+{
+	BuildContext context;
+	context.enableLog(false);
+
+	InputGeom geom("test", std::string(), std::string());
+	CHECK(LoadTestZone(TestZoneDesc(), context, geom));
+
+	const std::string filename = GetTestFilePath("cache_edit.bin");
+
+	Sample_TileMesh mesh;
+	PrepareMesh(mesh, geom, context, std::string());
+
+	std::vector<char> original;
+	CHECK(BuildAndSave(mesh, filename, original));
+
+	AddVolumeInTile(geom, 5, 6);
+
+	std::vector<char> edited;
+	CHECK(BuildAndSave(mesh, filename, edited));
+	CHECK(mesh.getTilesBuilt() == 1);
+	CHECK(mesh.getTilesReused() == GetTileCount(mesh) - 1);
+	CHECK(edited != original);
+
+	std::vector<char> expected;
+	{
+		Sample_TileMesh fresh;
+		CHECK(BuildTestMesh(fresh, geom, context, 0));
+		CHECK(fresh.SaveMesh(filename));
+		CHECK(ReadFileBytes(filename, expected));
+	}
+	CHECK(edited == expected);
+
+	geom.deleteConvexVolume(geom.getConvexVolumeCount() - 1);
+
+	std::vector<char> restored;
+	CHECK(BuildAndSave(mesh, filename, restored));
+	CHECK(mesh.getTilesBuilt() == 1);
+	CHECK(restored == original);
+
+	remove(filename.c_str());
+}
+
+//----------------------------------------------------------------------------
+
+// Bake a zone four times the size of the test zone, then bake it again with
+// nothing changed, with one convex volume added, and with one moved. Reports
+// the time each took and how many tiles were built, along with the size of
+// the cache file and the time to load it.
+BENCHMARK(BuildCacheRebake)
+{
+	BuildContext context;
+	context.enableLog(false);
+
+	TestZoneDesc desc;
+	desc.size *= 2;
+
+	InputGeom geom("test", std::string(), std::string());
+	if (!LoadTestZone(desc, context, geom))
+	{
+		printf("  couldn't load the zone\n");
+		return;
+	}
+
+	const std::string cachePath = GetTestFilePath("rebake.buildcache");
+	remove(cachePath.c_str());
+
+	Sample_TileMesh mesh;
+	PrepareMesh(mesh, geom, context, cachePath);
+
+	auto bake = [&](const char* name)
+	{
+		Clock::time_point start = Clock::now();
+		bool built = mesh.handleBuild();
+		mesh.waitForBuildAllTiles();
+		Clock::duration elapsed = Clock::now() - start;
+
+		if (!built)
+		{
+			printf("  %s: couldn't build the zone\n", name);
+			return;
+		}
+
+		printf("  %-14s: %8.1f ms, %3d tiles built, %3d reused\n", name, Milliseconds(elapsed),
+			mesh.getTilesBuilt(), mesh.getTilesReused());
+	};
+
+	bake("first bake");
+	bake("no change");
+
+	AddVolumeInTile(geom, 10, 12);
+	bake("volume added");
+
+	geom.deleteConvexVolume(geom.getConvexVolumeCount() - 1);
+	AddVolumeInTile(geom, 11, 12);
+	bake("volume moved");
+
+	std::vector<char> cacheFile;
+	ReadFileBytes(cachePath, cacheFile);
+
+	Clock::time_point start = Clock::now();
+	mesh.setBuildCachePath(cachePath);
+	printf("  cache file %.0f KB, loaded in %.1f ms\n", cacheFile.size() / 1024.0,
+		Milliseconds(Clock::now() - start));
+
+	remove(cachePath.c_str());
+}
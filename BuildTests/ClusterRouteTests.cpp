@@ -0,0 +1,189 @@
+//
+// ClusterRouteTests.cpp
+//
+// Tests for planning long routes over the cluster graph before searching
+// the polys along them, and a benchmark of what that saves against one
+// search over the whole mesh.
+//
+
+#include "Benchmark.h"
+#include "Test.h"
+#include "TestPath.h"
+#include "TestZone.h"
+
+#include "NavMeshClusterGraph.h"
+#include "NavMeshQueryPool.h"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+// a node pool that is too small for a search through the maze
+const int SMALL_POOL_NODES = 512;
+
+bool EndsAt(const NavMeshPath& path, const float* pos)
+{
+	return path.GetPathSize() > 0
+		&& dtVdistSqr(path.GetRawPosition(path.GetPathSize() - 1), pos) < 0.01f;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+// Long routes across the zone are planned over the graph, and still go all
+// the way to the destination, not much further than a flat search does.
+// Neither search finds the shortest straight path, so the one over the graph
+// can come out a little shorter too.
+TEST(ClusterRouteReachesDestination)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	NavMeshQueryPool pool(navMesh);
+	NavMeshClusterGraph graph(navMesh);
+	CHECK(graph.GetStats().clusters > 0);
+
+	std::vector<TestRoute> routes = GetTestRoutes(navMesh, 6, 600.0f, 21);
+	CHECK(routes.size() == 6);
+
+	for (const TestRoute& route : routes)
+	{
+		TestPath flat(&pool);
+		flat.SetStart(route.start);
+		CHECK(flat.FindPath(GamePosition(route.end)));
+
+		TestPath clustered(&pool);
+		clustered.SetClusterGraph(&graph);
+		clustered.SetStart(route.start);
+		CHECK(clustered.FindPath(GamePosition(route.end)));
+
+		CHECK(clustered.GetStats().lastRouteSize >= NavMeshPath::HIERARCHICAL_MIN_CROSSINGS);
+		CHECK(!clustered.IsPartialPath());
+		CHECK(EndsAt(clustered, route.end.pos));
+		CHECK(clustered.GetPathLength() < flat.GetPathLength() * 1.25f);
+	}
+}
+
+// With a node pool too small to search the maze in one go, a flat search
+// runs out of nodes and stops partway, while one segment of the route at a
+// time fits.
+TEST(ClusterRouteFitsSmallNodePool)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	NavMeshQueryPool pool(navMesh, SMALL_POOL_NODES);
+	NavMeshClusterGraph graph(navMesh);
+
+	TestRoute route;
+	const bool found = GetMazeRoute(navMesh, route);
+	CHECK(found);
+	if (!found)
+		return;
+
+	TestPath flat(&pool);
+	flat.SetStart(route.start);
+	flat.FindPath(GamePosition(route.end));
+	CHECK(flat.IsPartialPath());
+
+	TestPath clustered(&pool);
+	clustered.SetClusterGraph(&graph);
+	clustered.SetStart(route.start);
+	CHECK(clustered.FindPath(GamePosition(route.end)));
+	CHECK(!clustered.IsPartialPath());
+	CHECK(EndsAt(clustered, route.end.pos));
+}
+
+//----------------------------------------------------------------------------
+
+// Random long routes, searched over the whole mesh and over the cluster
+// graph. Reports the nodes the searches expanded, the time they took, and
+// how much longer (or shorter) the paths over the graph came out.
+BENCHMARK(ClusterRoutes)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	if (!navMesh)
+	{
+		printf("  couldn't build the test zone\n");
+		return;
+	}
+
+	NavMeshQueryPool pool(navMesh);
+
+	Clock::time_point start = Clock::now();
+	NavMeshClusterGraph graph(navMesh);
+	printf("  graph: %d clusters, %d portals, %d edges, built in %.1f ms\n",
+		graph.GetStats().clusters, graph.GetStats().portals, graph.GetStats().edges,
+		Milliseconds(Clock::now() - start));
+
+	std::vector<TestRoute> routes = GetTestRoutes(navMesh, 63, 500.0f, 23);
+
+	TestRoute maze;
+	if (GetMazeRoute(navMesh, maze))
+		routes.push_back(maze);
+
+	std::vector<float> flatLengths;
+
+	for (int mode = 0; mode < 2; ++mode)
+	{
+		const bool clustered = mode == 1;
+
+		Clock::duration elapsed = Clock::duration::zero();
+		Clock::duration worst = Clock::duration::zero();
+		long long expansions = 0;
+		int graphExpansions = 0;
+		int partial = 0;
+		double gap = 0;
+		double worstGap = 0;
+
+		for (size_t i = 0; i < routes.size(); ++i)
+		{
+			TestPath path(&pool);
+			if (clustered)
+				path.SetClusterGraph(&graph);
+			path.SetStart(routes[i].start);
+
+			start = Clock::now();
+			path.FindPath(GamePosition(routes[i].end));
+			Clock::duration taken = Clock::now() - start;
+
+			elapsed += taken;
+			worst = std::max(worst, taken);
+			expansions += path.GetStats().lastSearchIterations;
+			if (path.IsPartialPath())
+				partial++;
+
+			if (!clustered)
+			{
+				flatLengths.push_back(path.GetPathLength());
+				continue;
+			}
+
+			graphExpansions += graph.GetStats().lastExpansions;
+
+			if (flatLengths[i] > 0)
+			{
+				double extra = path.GetPathLength() / flatLengths[i] - 1.0;
+				gap += extra;
+				worstGap = std::max(worstGap, extra);
+			}
+		}
+
+		const double count = static_cast<double>(routes.size());
+		printf("  %s: %.0f nodes expanded, %.3f ms per search (worst %.3f ms), %d partial\n",
+			clustered ? "cluster graph" : "flat search ", expansions / count,
+			Milliseconds(elapsed) / count, Milliseconds(worst), partial);
+
+		if (clustered)
+		{
+			printf("  cluster graph: %.0f graph nodes expanded, paths %+.1f%% longer on average (worst %+.1f%%)\n",
+				graphExpansions / count, gap / count * 100, worstGap * 100);
+		}
+	}
+}
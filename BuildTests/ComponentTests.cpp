@@ -0,0 +1,286 @@
+//
+// ComponentTests.cpp
+//
+// Tests for the connected components of the cluster graph, which rule out
+// paths that can't exist without searching, and a benchmark of asking for
+// unreachable points with and without them.
+//
+
+#include "Benchmark.h"
+#include "Test.h"
+#include "TestPath.h"
+#include "TestZone.h"
+
+#include "NavigationPathCache.h"
+#include "NavMeshClusterGraph.h"
+#include "NavMeshQueryPool.h"
+
+#include "DetourAlloc.h"
+#include "DetourNavMesh.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// A tile taken out of the mesh, with a copy of its data to put it back.
+struct RemovedTile
+{
+	std::vector<unsigned char> data;
+};
+
+void RemoveTile(dtNavMesh* navMesh, const dtMeshTile* tile, std::vector<RemovedTile>& removed)
+{
+	RemovedTile copy;
+	copy.data.assign(tile->data, tile->data + tile->dataSize);
+	removed.push_back(std::move(copy));
+
+	navMesh->removeTile(navMesh->getTileRef(tile), nullptr, nullptr);
+}
+
+// Take out the tiles around the one at x, y, and leave that one by itself.
+void RemoveNeighbors(dtNavMesh* navMesh, int x, int y, std::vector<RemovedTile>& removed)
+{
+	const int MAX_LAYERS = 32;
+	const dtMeshTile* tiles[MAX_LAYERS];
+
+	for (int dy = -1; dy <= 1; ++dy)
+	{
+		for (int dx = -1; dx <= 1; ++dx)
+		{
+			if (dx == 0 && dy == 0)
+				continue;
+
+			int count = navMesh->getTilesAt(x + dx, y + dy, tiles, MAX_LAYERS);
+			for (int i = 0; i < count; ++i)
+				RemoveTile(navMesh, tiles[i], removed);
+		}
+	}
+}
+
+void RestoreTiles(dtNavMesh* navMesh, std::vector<RemovedTile>& removed)
+{
+	for (RemovedTile& tile : removed)
+	{
+		int size = static_cast<int>(tile.data.size());
+		unsigned char* data = static_cast<unsigned char*>(dtAlloc(size, DT_ALLOC_PERM));
+		memcpy(data, tile.data.data(), size);
+
+		if (dtStatusFailed(navMesh->addTile(data, size, DT_TILE_FREE_DATA, 0, nullptr)))
+			dtFree(data);
+	}
+
+	removed.clear();
+}
+
+// A point on a tile in the middle of the zone, where it has neighbors on
+// every side, and one a long way from it.
+bool GetIsolatedPair(const dtNavMesh* navMesh, const NavMeshClusterGraph& graph,
+	TestPoint& middle, TestPoint& far)
+{
+	std::vector<TestPoint> points = GetTestPoints(navMesh, 400, 61);
+
+	const dtMeshTile* center = nullptr;
+	const dtPoly* poly = nullptr;
+
+	for (const TestPoint& point : points)
+	{
+		const dtMeshTile* tile = nullptr;
+		navMesh->getTileAndPolyByRefUnsafe(point.ref, &tile, &poly);
+
+		if (tile->header->x > 2 && tile->header->x < 9 && tile->header->y > 2 && tile->header->y < 9)
+		{
+			middle = point;
+			center = tile;
+			break;
+		}
+	}
+
+	if (!center)
+		return false;
+
+	for (const TestPoint& point : points)
+	{
+		const dtMeshTile* tile = nullptr;
+		navMesh->getTileAndPolyByRefUnsafe(point.ref, &tile, &poly);
+
+		if (abs(tile->header->x - center->header->x) > 2
+			&& abs(tile->header->y - center->header->y) > 2
+			&& graph.GetComponent(point.ref) == graph.GetComponent(middle.ref))
+		{
+			far = point;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+// Whenever a search gets all the way to a point, the graph says it might be
+// connected, and when the graph says it isn't, a search doesn't get there.
+TEST(ComponentsAgreeWithSearches)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	NavMeshQueryPool pool(navMesh);
+	NavMeshClusterGraph graph(navMesh);
+	CHECK(graph.GetStats().components > 1);
+
+	std::vector<TestPoint> points = GetTestPoints(navMesh, 120, 63);
+
+	int connected = 0;
+	int unreachable = 0;
+
+	for (size_t s = 0; s < 4; ++s)
+	{
+		for (size_t i = 4; i < points.size(); ++i)
+		{
+			TestPath path(&pool);
+			path.SetStart(points[s]);
+			bool reached = path.FindPath(GamePosition(points[i])) && !path.IsPartialPath();
+
+			if (graph.MayBeConnected(points[s].ref, points[i].ref))
+			{
+				connected++;
+			}
+			else
+			{
+				CHECK(!reached);
+				unreachable++;
+			}
+		}
+	}
+
+	CHECK(connected > 0);
+	CHECK(unreachable > 0);
+}
+
+// When tiles go away and come back, only the tiles that changed are built
+// again, and the components end up the same as a graph built from scratch.
+TEST(ComponentsFollowTiles)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	NavMeshClusterGraph graph(navMesh);
+	const NavMeshClusterGraph::Stats whole = graph.GetStats();
+
+	TestPoint middle, far;
+	bool found = GetIsolatedPair(navMesh, graph, middle, far);
+	CHECK(found);
+	if (!found)
+		return;
+
+	const dtMeshTile* tile = nullptr;
+	const dtPoly* poly = nullptr;
+	navMesh->getTileAndPolyByRefUnsafe(middle.ref, &tile, &poly);
+
+	std::vector<RemovedTile> removed;
+	RemoveNeighbors(navMesh, tile->header->x, tile->header->y, removed);
+	CHECK(removed.size() == 8);
+
+	graph.Update();
+	CHECK(graph.GetStats().tilesUpdated == 0);
+	CHECK(!graph.MayBeConnected(middle.ref, far.ref));
+
+	RestoreTiles(navMesh, removed);
+
+	graph.Update();
+	CHECK(graph.GetStats().tilesUpdated == 8);
+	CHECK(graph.MayBeConnected(middle.ref, far.ref));
+
+	NavMeshClusterGraph rebuilt(navMesh);
+	CHECK(graph.GetStats().clusters == rebuilt.GetStats().clusters);
+	CHECK(graph.GetStats().portals == rebuilt.GetStats().portals);
+	CHECK(graph.GetStats().components == rebuilt.GetStats().components);
+	CHECK(graph.GetStats().components == whole.components);
+}
+
+//----------------------------------------------------------------------------
+
+// Ask whether points that can't be walked to (roofs and the tops of walls)
+// can be navigated to, by searching, and through the path cache the way the
+// TLO does, which asks the components first. Also reports how long it takes
+// to bring the components up to date after one tile changes.
+BENCHMARK(UnreachablePaths)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	if (!navMesh)
+	{
+		printf("  couldn't build the test zone\n");
+		return;
+	}
+
+	NavMeshQueryPool pool(navMesh);
+
+	Clock::time_point start = Clock::now();
+	NavMeshClusterGraph graph(navMesh);
+	printf("  graph: %d components, built in %.1f ms\n", graph.GetStats().components,
+		Milliseconds(Clock::now() - start));
+
+	std::vector<TestPoint> points = GetTestPoints(navMesh, 400, 65);
+	std::vector<TestRoute> routes;
+	for (size_t i = 1; i < points.size() && routes.size() < 32; ++i)
+	{
+		if (!graph.MayBeConnected(points[0].ref, points[i].ref))
+			routes.push_back({ points[0], points[i] });
+	}
+
+	printf("  %d unreachable points\n", static_cast<int>(routes.size()));
+	if (routes.empty())
+		return;
+
+	for (int mode = 0; mode < 2; ++mode)
+	{
+		const bool components = mode == 1;
+
+		Clock::duration elapsed = Clock::duration::zero();
+		long long expansions = 0;
+
+		for (const TestRoute& route : routes)
+		{
+			NavigationPathCache cache;
+
+			TestPath path(&pool);
+			if (components)
+				path.SetClusterGraph(&graph);
+			path.SetStart(route.start);
+
+			start = Clock::now();
+			float length;
+			cache.FindPath(path, GamePosition(route.end), length);
+			elapsed += Clock::now() - start;
+
+			expansions += path.GetStats().lastSearchIterations;
+		}
+
+		const double count = static_cast<double>(routes.size());
+		printf("  %s: %8.2f us per query, %.0f nodes expanded\n",
+			components ? "components" : "searching ", Microseconds(elapsed) / count, expansions / count);
+	}
+
+	// one tile changing, against building the whole graph again
+	const dtMeshTile* tile = nullptr;
+	const dtPoly* poly = nullptr;
+	navMesh->getTileAndPolyByRefUnsafe(points[0].ref, &tile, &poly);
+
+	std::vector<RemovedTile> removed;
+	RemoveTile(navMesh, tile, removed);
+	RestoreTiles(navMesh, removed);
+
+	start = Clock::now();
+	graph.Update();
+	Clock::duration update = Clock::now() - start;
+
+	start = Clock::now();
+	graph.SetNavMesh(navMesh);
+	printf("  one tile changed: %.2f ms to update, %.2f ms to build it all again\n",
+		Milliseconds(update), Milliseconds(Clock::now() - start));
+}
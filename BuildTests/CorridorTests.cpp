@@ -0,0 +1,192 @@
+//
+// CorridorTests.cpp
+//
+// Tests for following a path's corridor as we move along it, instead of
+// searching again on every update, and a benchmark of what each costs per
+// second of movement.
+//
+
+#include "Benchmark.h"
+#include "Test.h"
+#include "TestPath.h"
+#include "TestZone.h"
+
+#include "NavMeshQueryPool.h"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+// how often the plugin updates the path (PATHFINDING_DELAY_MS), and how far
+// we move between updates
+const int UPDATE_MS = 200;
+const float RUN_SPEED = 30.0f;
+const float STEP = RUN_SPEED * UPDATE_MS / 1000.0f;
+
+// more than enough updates to walk across the test zone
+const int MAX_UPDATES = 2000;
+
+bool EndsAt(const NavMeshPath& path, const float* pos)
+{
+	return path.GetPathSize() > 0
+		&& dtVdistSqr(path.GetRawPosition(path.GetPathSize() - 1), pos) < 0.01f;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+// Walking along the path only moves the corridor. It's searched for once,
+// at the start, and still goes all the way to the destination after every
+// update.
+TEST(CorridorFollowsWithoutSearching)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	NavMeshQueryPool pool(navMesh);
+
+	std::vector<TestRoute> routes = GetTestRoutes(navMesh, 4, 400.0f);
+	CHECK(routes.size() == 4);
+
+	for (const TestRoute& route : routes)
+	{
+		TestPath path(&pool);
+		path.SetStart(route.start);
+		CHECK(path.FindPath(GamePosition(route.end)));
+		CHECK(!path.IsPartialPath());
+
+		float pos[3];
+		dtVcopy(pos, route.start.pos);
+
+		int updates = 0;
+		bool followed = true;
+
+		while (updates < MAX_UPDATES && MoveAlongPath(path, pos, STEP))
+		{
+			path.SetStart(GamePosition(pos));
+			path.AdvanceTime(UPDATE_MS);
+			path.UpdatePath();
+			updates++;
+
+			if (!EndsAt(path, route.end.pos) || path.IsSearching())
+				followed = false;
+		}
+
+		CHECK(followed);
+		CHECK(updates > 10 && updates < MAX_UPDATES);
+		CHECK(dtVdist(pos, route.end.pos) < 0.01f);
+
+		const NavMeshPath::Stats& stats = path.GetStats();
+		CHECK(stats.replans == 1);
+		CHECK(stats.corridorUpdates == updates);
+	}
+}
+
+// Getting moved somewhere the corridor doesn't go (knocked back, summoned,
+// fell off a ledge) means searching again from there.
+TEST(CorridorReplansWhenMovedAway)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	NavMeshQueryPool pool(navMesh);
+
+	std::vector<TestRoute> routes = GetTestRoutes(navMesh, 2, 400.0f, 7);
+	CHECK(routes.size() == 2);
+	if (routes.size() < 2)
+		return;
+
+	const TestRoute& route = routes[0];
+
+	TestPath path(&pool);
+	path.SetStart(route.start);
+	CHECK(path.FindPath(GamePosition(route.end)));
+
+	float pos[3];
+	dtVcopy(pos, route.start.pos);
+	for (int i = 0; i < 5; ++i)
+	{
+		MoveAlongPath(path, pos, STEP);
+		path.SetStart(GamePosition(pos));
+		path.AdvanceTime(UPDATE_MS);
+		path.UpdatePath();
+	}
+
+	CHECK(path.GetStats().replans == 1);
+
+	// somewhere else entirely, that can still get to the destination
+	path.SetStart(routes[1].start);
+	path.AdvanceTime(UPDATE_MS);
+	path.UpdatePath();
+
+	CHECK(path.GetStats().replans == 2);
+	CHECK(path.GetPathSize() > 0);
+	CHECK(path.GetPathSize() > 0 && dtVdist2DSqr(path.GetRawPosition(0), routes[1].start.pos) < 0.01f);
+}
+
+//----------------------------------------------------------------------------
+
+// Walk long routes across the zone, updating the path every 200 ms. Once
+// following the corridor, and once searching the whole way again on every
+// update like paths used to.
+BENCHMARK(CorridorFollowing)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	if (!navMesh)
+	{
+		printf("  couldn't build the test zone\n");
+		return;
+	}
+
+	NavMeshQueryPool pool(navMesh);
+	std::vector<TestRoute> routes = GetTestRoutes(navMesh, 8, 600.0f, 3);
+
+	for (int mode = 0; mode < 2; ++mode)
+	{
+		const bool corridor = mode == 0;
+
+		Clock::duration elapsed = Clock::duration::zero();
+		int updates = 0;
+		int searches = 0;
+
+		for (const TestRoute& route : routes)
+		{
+			TestPath path(&pool);
+			path.SetStart(route.start);
+
+			Clock::time_point start = Clock::now();
+			path.FindPath(GamePosition(route.end));
+			elapsed += Clock::now() - start;
+
+			float pos[3];
+			dtVcopy(pos, route.start.pos);
+
+			while (updates < MAX_UPDATES * 8 && MoveAlongPath(path, pos, STEP))
+			{
+				path.SetStart(GamePosition(pos));
+				path.AdvanceTime(UPDATE_MS);
+
+				start = Clock::now();
+				if (corridor)
+					path.UpdatePath();
+				else
+					path.FindPath(GamePosition(route.end));
+				elapsed += Clock::now() - start;
+
+				updates++;
+			}
+
+			searches += path.GetStats().replans;
+		}
+
+		const double seconds = updates * UPDATE_MS / 1000.0;
+		printf("  %s: %.0f s of movement, %d searches, %.3f ms of CPU per second of movement\n",
+			corridor ? "following the corridor" : "searching every update",
+			seconds, searches, Milliseconds(elapsed) / seconds);
+	}
+}
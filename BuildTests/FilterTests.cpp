@@ -0,0 +1,228 @@
+//
+// FilterTests.cpp
+//
+// Tests for the area costs and flags that a navigation can be given, and a
+// benchmark of searches across a river under different cost profiles.
+//
+
+#include "Benchmark.h"
+#include "Test.h"
+#include "TestPath.h"
+#include "TestZone.h"
+
+#include "NavigationFilter.h"
+#include "NavigationPathCache.h"
+#include "NavMeshQueryPool.h"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+
+#include <cstdio>
+#include <initializer_list>
+#include <vector>
+
+namespace {
+
+NavigationFilter MakeFilter(std::initializer_list<const char*> options)
+{
+	NavigationFilter filter;
+	for (const char* option : options)
+		filter.ParseOption(option);
+	return filter;
+}
+
+// how many of the path's polys are in the area
+int CountAreaPolys(const dtNavMesh* navMesh, const NavMeshPath& path, NavigationArea area)
+{
+	int count = 0;
+	for (dtPolyRef ref : path.GetPlannedPolys())
+	{
+		const dtMeshTile* tile = nullptr;
+		const dtPoly* poly = nullptr;
+		navMesh->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+
+		if (poly->getArea() == area)
+			count++;
+	}
+
+	return count;
+}
+
+bool EndsAt(const NavMeshPath& path, const float* pos)
+{
+	return path.GetPathSize() > 0 && !path.IsPartialPath()
+		&& dtVdist(path.GetRawPosition(path.GetPathSize() - 1), pos) < 0.1f;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+// Options parse into flags and costs, and anything else is turned down.
+TEST(FilterParsesOptions)
+{
+	NavigationFilter filter;
+	CHECK(filter.ParseOption("include=walk,swim"));
+	CHECK(filter.includeFlags == (NavFlag_Walk | NavFlag_Swim));
+	CHECK(filter.ParseOption("exclude=door"));
+	CHECK(filter.excludeFlags == NavFlag_Door);
+	CHECK(filter.ParseOption("water=10"));
+	CHECK(filter.areaCosts[NavArea_Water] == 10.0f);
+
+	CHECK(!filter.ParseOption("water=0.5"));
+	CHECK(!filter.ParseOption("lava=3"));
+	CHECK(!filter.ParseOption("include=fly"));
+	CHECK(!filter.ParseOption("water"));
+	CHECK(filter.areaCosts[NavArea_Water] == 10.0f);
+
+	CHECK(FormatFlags(filter.includeFlags) == "walk,swim");
+	CHECK(filter != NavigationFilter());
+	CHECK(filter.Hash() != NavigationFilter().Hash());
+	CHECK(MakeFilter({ "include=walk,swim", "exclude=door", "water=10" }) == filter);
+}
+
+// The default filter only walks, so it goes over the bridge, which is the
+// only road. Letting it swim goes straight across, until the water costs
+// more than the way around.
+TEST(FilterChoosesRoute)
+{
+	dtNavMesh* navMesh = GetRiverZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	TestRoute route;
+	bool found = GetRiverRoute(navMesh, route, GetRiverZoneDesc());
+	CHECK(found);
+	if (!found)
+		return;
+
+	NavMeshQueryPool pool(navMesh);
+
+	TestPath walk(&pool);
+	walk.SetStart(route.start);
+	CHECK(walk.FindPath(GamePosition(route.end)));
+	CHECK(EndsAt(walk, route.end.pos));
+	CHECK(CountAreaPolys(navMesh, walk, NavArea_Water) == 0);
+	CHECK(CountAreaPolys(navMesh, walk, NavArea_Road) > 0);
+
+	TestPath swim(&pool);
+	swim.SetFilter(MakeFilter({ "include=walk,swim" }));
+	swim.SetStart(route.start);
+	CHECK(swim.FindPath(GamePosition(route.end)));
+	CHECK(EndsAt(swim, route.end.pos));
+	CHECK(CountAreaPolys(navMesh, swim, NavArea_Water) > 0);
+	CHECK(swim.GetPathLength() < walk.GetPathLength() * 0.5f);
+
+	TestPath slowSwim(&pool);
+	slowSwim.SetFilter(MakeFilter({ "include=walk,swim", "water=20" }));
+	slowSwim.SetStart(route.start);
+	CHECK(slowSwim.FindPath(GamePosition(route.end)));
+	CHECK(EndsAt(slowSwim, route.end.pos));
+	CHECK(CountAreaPolys(navMesh, slowSwim, NavArea_Water) == 0);
+	CHECK(CountAreaPolys(navMesh, slowSwim, NavArea_Road) > 0);
+}
+
+// The path cache keeps paths with different filters apart.
+TEST(FilterKeepsCachedPathsApart)
+{
+	dtNavMesh* navMesh = GetRiverZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	TestRoute route;
+	bool found = GetRiverRoute(navMesh, route, GetRiverZoneDesc());
+	CHECK(found);
+	if (!found)
+		return;
+
+	NavMeshQueryPool pool(navMesh);
+	NavigationPathCache cache;
+
+	float lengths[2];
+	for (int i = 0; i < 2; ++i)
+	{
+		TestPath path(&pool);
+		if (i == 1)
+			path.SetFilter(MakeFilter({ "include=walk,swim" }));
+		path.SetStart(route.start);
+
+		CHECK(cache.FindPath(path, GamePosition(route.end), lengths[i]));
+	}
+
+	CHECK(cache.GetStats().misses == 2);
+	CHECK(cache.GetStats().hits == 0);
+	CHECK(lengths[1] < lengths[0] * 0.5f);
+}
+
+//----------------------------------------------------------------------------
+
+// Search random routes over the river zone with different cost profiles.
+// Reports the time per search, the nodes expanded, how long the paths came
+// out against the ones that swim wherever they like, and how many of them
+// went through the water.
+BENCHMARK(FilterProfiles)
+{
+	dtNavMesh* navMesh = GetRiverZoneMesh();
+	if (!navMesh)
+	{
+		printf("  couldn't build the river zone\n");
+		return;
+	}
+
+	NavMeshQueryPool pool(navMesh);
+	std::vector<TestRoute> routes = GetTestRoutes(navMesh, 48, 200.0f, 91);
+
+	struct Profile
+	{
+		const char* name;
+		NavigationFilter filter;
+	};
+	Profile profiles[] = {
+		{ "swim anywhere", MakeFilter({ "include=walk,swim" }) },
+		{ "default (walk)", NavigationFilter() },
+		{ "water=3", MakeFilter({ "include=walk,swim", "water=3" }) },
+		{ "water=20", MakeFilter({ "include=walk,swim", "water=20" }) },
+		{ "ground=2", MakeFilter({ "include=walk,swim", "ground=2" }) },
+	};
+
+	std::vector<float> baseline;
+
+	for (const Profile& profile : profiles)
+	{
+		Clock::duration elapsed = Clock::duration::zero();
+		long long expansions = 0;
+		int reached = 0;
+		int wet = 0;
+		double stretch = 0;
+
+		for (size_t i = 0; i < routes.size(); ++i)
+		{
+			TestPath path(&pool);
+			path.SetFilter(profile.filter);
+			path.SetStart(routes[i].start);
+
+			Clock::time_point start = Clock::now();
+			path.FindPath(GamePosition(routes[i].end));
+			elapsed += Clock::now() - start;
+
+			expansions += path.GetStats().lastSearchIterations;
+
+			bool ends = EndsAt(path, routes[i].end.pos);
+			float length = ends ? path.GetPathLength() : -1.0f;
+			if (&profile == &profiles[0])
+				baseline.push_back(length);
+
+			if (!ends)
+				continue;
+
+			reached++;
+			if (CountAreaPolys(navMesh, path, NavArea_Water) > 0)
+				wet++;
+			if (baseline[i] > 0)
+				stretch += length / baseline[i] - 1.0;
+		}
+
+		const double count = static_cast<double>(routes.size());
+		printf("  %-14s: %.3f ms per search, %5.0f nodes expanded, %2d of %d reached, %2d through water, %+.1f%% longer\n",
+			profile.name, Milliseconds(elapsed) / count, expansions / count, reached,
+			static_cast<int>(routes.size()), wet, reached ? stretch / reached * 100 : 0.0);
+	}
+}
@@ -0,0 +1,278 @@
+//
+// LandmarkTests.cpp
+//
+// Tests for the landmark (ALT) heuristic, which has to stay admissible so
+// searches still find the cheapest path, and a benchmark of the nodes it
+// saves expanding against the straight line heuristic.
+//
+
+#include "Benchmark.h"
+#include "Test.h"
+#include "TestPath.h"
+#include "TestZone.h"
+
+#include "NavMeshLandmarks.h"
+#include "NavMeshQueryPool.h"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNode.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace {
+
+const int MAX_POLYS = 4096;
+
+// The search puts a node at the middle of the edge it first reached a poly
+// through, so a different heuristic can leave it somewhere else and the
+// cost comes out a little different.
+const float MAX_COST_ERROR = 0.01f;
+
+std::shared_ptr<NavMeshLandmarks> BuildLandmarks(const dtNavMesh* navMesh)
+{
+	auto landmarks = std::make_shared<NavMeshLandmarks>();
+	if (!landmarks->Build(navMesh))
+		return nullptr;
+
+	return landmarks;
+}
+
+// The node the search finished on. There is one for each side of a tile
+// that a poly was reached from, and the search stops at the first of them
+// that it closes.
+const dtNode* FindEndNode(dtNodePool* pool, dtPolyRef ref)
+{
+	dtNode* nodes[DT_MAX_STATES_PER_NODE];
+	unsigned int count = pool->findNodes(ref, nodes, DT_MAX_STATES_PER_NODE);
+
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		if (nodes[i]->flags & DT_NODE_CLOSED)
+			return nodes[i];
+	}
+
+	return nullptr;
+}
+
+// Search the route with whatever heuristic the query has. Returns what the
+// path costs, or -1 if it doesn't get there.
+float SearchCost(dtNavMeshQuery& query, const TestRoute& route)
+{
+	dtQueryFilter filter;
+	std::vector<dtPolyRef> polys(MAX_POLYS);
+	int numPolys = 0;
+
+	dtStatus status = query.findPath(route.start.ref, route.end.ref, route.start.pos, route.end.pos,
+		&filter, polys.data(), &numPolys, MAX_POLYS);
+	if (dtStatusFailed(status) || (status & DT_PARTIAL_RESULT))
+		return -1.0f;
+
+	const dtNode* node = FindEndNode(query.getNodePool(), route.end.ref);
+	return node ? node->cost : -1.0f;
+}
+
+std::vector<TestRoute> GetRoutes(const dtNavMesh* navMesh, int count, unsigned int seed)
+{
+	std::vector<TestRoute> routes = GetTestRoutes(navMesh, count, 300.0f, seed);
+
+	TestRoute maze;
+	if (GetMazeRoute(navMesh, maze))
+		routes.push_back(maze);
+
+	return routes;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+// Along the cheapest path, the heuristic from each node is never more than
+// what is left of the path from there.
+TEST(LandmarksAreAdmissible)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	std::shared_ptr<NavMeshLandmarks> landmarks = BuildLandmarks(navMesh);
+	CHECK(landmarks != nullptr);
+	if (!landmarks)
+		return;
+
+	NavMeshLandmarkHeuristic heuristic(landmarks.get(), navMesh);
+
+	dtNavMeshQuery query;
+	CHECK(dtStatusSucceed(query.init(navMesh, 65535)));
+
+	int nodes = 0;
+	int overestimates = 0;
+	int better = 0;
+
+	for (const TestRoute& route : GetRoutes(navMesh, 24, 71))
+	{
+		float cost = SearchCost(query, route);
+		CHECK(cost >= 0);
+		if (cost < 0)
+			continue;
+
+		// findPath turns the parents around to store the path, so they lead
+		// from the start node to the end node now.
+		dtNodePool* pool = query.getNodePool();
+		const dtNode* end = FindEndNode(pool, route.end.ref);
+
+		for (const dtNode* node = pool->findNode(route.start.ref, 0); node && node != end;
+			node = pool->getNodeAtIdx(node->pidx))
+		{
+			float remaining = cost - node->cost;
+			float estimate = heuristic.getCost(node->id, node->pos, route.end.ref, route.end.pos);
+
+			if (estimate > remaining + 0.01f)
+				overestimates++;
+			if (estimate > dtVdist(node->pos, route.end.pos) + 0.01f)
+				better++;
+			nodes++;
+		}
+	}
+
+	printf("  %d nodes, %d with a better estimate than the straight line\n", nodes, better);
+
+	CHECK(nodes > 0);
+	CHECK(overestimates == 0);
+	CHECK(better > nodes / 4);
+}
+
+// Searches with the landmarks find paths that cost the same as searches
+// without them, while expanding fewer nodes through the maze.
+TEST(LandmarksFindCheapestPaths)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	std::shared_ptr<NavMeshLandmarks> landmarks = BuildLandmarks(navMesh);
+	CHECK(landmarks != nullptr);
+	if (!landmarks)
+		return;
+
+	NavMeshLandmarkHeuristic heuristic(landmarks.get(), navMesh);
+
+	dtNavMeshQuery stock;
+	CHECK(dtStatusSucceed(stock.init(navMesh, 65535)));
+
+	dtNavMeshQuery alt;
+	CHECK(dtStatusSucceed(alt.init(navMesh, 65535)));
+	alt.setHeuristic(&heuristic);
+
+	std::vector<TestRoute> routes = GetRoutes(navMesh, 24, 73);
+	for (const TestRoute& route : routes)
+	{
+		float expected = SearchCost(stock, route);
+		float actual = SearchCost(alt, route);
+
+		CHECK(actual >= 0);
+		CHECK(std::fabs(actual - expected) <= expected * MAX_COST_ERROR);
+	}
+
+	// the maze route is the last one
+	NavMeshQueryPool pool(navMesh);
+
+	TestPath plain(&pool);
+	plain.SetStart(routes.back().start);
+	CHECK(plain.FindPath(GamePosition(routes.back().end)));
+
+	TestPath guided(&pool);
+	guided.SetLandmarks(landmarks);
+	guided.SetStart(routes.back().start);
+	CHECK(guided.FindPath(GamePosition(routes.back().end)));
+
+	CHECK(guided.GetStats().lastSearchIterations < plain.GetStats().lastSearchIterations);
+	CHECK(std::fabs(guided.GetPathLength() - plain.GetPathLength()) <= plain.GetPathLength() * MAX_COST_ERROR);
+}
+
+//----------------------------------------------------------------------------
+
+// Search random routes across the zone and the route through the maze, with
+// the straight line heuristic and with the landmarks. Reports the nodes the
+// searches expanded and the time they took.
+BENCHMARK(LandmarkSearches)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	if (!navMesh)
+	{
+		printf("  couldn't build the test zone\n");
+		return;
+	}
+
+	Clock::time_point start = Clock::now();
+	std::shared_ptr<NavMeshLandmarks> landmarks = BuildLandmarks(navMesh);
+	if (!landmarks)
+	{
+		printf("  couldn't build the landmarks\n");
+		return;
+	}
+
+	std::vector<char> buffer;
+	landmarks->Write(buffer);
+	printf("  %d landmarks, built in %.1f ms, %.1f KB in the mesh file\n", landmarks->GetLandmarkCount(),
+		Milliseconds(Clock::now() - start), buffer.size() / 1024.0);
+
+	NavMeshQueryPool pool(navMesh);
+
+	TestRoute maze;
+	std::vector<TestRoute> mazeRoutes;
+	if (GetMazeRoute(navMesh, maze))
+		mazeRoutes.push_back(maze);
+
+	struct RouteSet
+	{
+		const char* name;
+		std::vector<TestRoute> routes;
+	};
+	RouteSet sets[] = {
+		{ "open ground", GetTestRoutes(navMesh, 32, 300.0f, 75) },
+		{ "maze", mazeRoutes },
+	};
+
+	for (const RouteSet& set : sets)
+	{
+		if (set.routes.empty())
+			continue;
+
+		printf("  %s, %d routes:\n", set.name, static_cast<int>(set.routes.size()));
+
+		for (int mode = 0; mode < 2; ++mode)
+		{
+			const bool guided = mode == 1;
+
+			// the maze is only one route, so search it a few times
+			const int repeats = std::max<int>(1, 32 / static_cast<int>(set.routes.size()));
+			Clock::duration elapsed = Clock::duration::zero();
+			long long expansions = 0;
+
+			for (int r = 0; r < repeats; ++r)
+			{
+				for (const TestRoute& route : set.routes)
+				{
+					TestPath path(&pool);
+					if (guided)
+						path.SetLandmarks(landmarks);
+					path.SetStart(route.start);
+
+					start = Clock::now();
+					path.FindPath(GamePosition(route.end));
+					elapsed += Clock::now() - start;
+
+					expansions += path.GetStats().lastSearchIterations;
+				}
+			}
+
+			const double count = static_cast<double>(set.routes.size() * repeats);
+			printf("    %s: %6.0f nodes expanded, %.3f ms per search\n",
+				guided ? "landmarks    " : "straight line", expansions / count, Milliseconds(elapsed) / count);
+		}
+	}
+}
@@ -0,0 +1,380 @@
+//
+// ObstacleTests.cpp
+//
+// Tests for cutting dynamic obstacles out of a mesh built from tile cache
+// layers, and a benchmark of how long the tiles take to catch up. The tile
+// cache is driven the way NavMeshObstacles drives it in the plugin, from
+// layers that went through the mesh file's section.
+//
+
+#include "Benchmark.h"
+#include "Test.h"
+#include "TestPath.h"
+#include "TestZone.h"
+
+#include "NavMeshQueryPool.h"
+#include "NavMeshTileCache.h"
+
+#include "BuildContext.h"
+#include "InputGeom.h"
+#include "Sample_TileMesh.h"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace {
+
+// the same limits as NavMeshObstacles, which needs the plugin's mesh loader
+const int MAX_OBSTACLES = 1024;
+const int MAX_TILE_UPDATES_PER_PULSE = 4;
+const int REQUESTS_PER_BATCH = 64 / DT_MAX_TOUCHED_TILES;
+
+// A mesh built out of tile cache layers, and a tile cache for it set up from
+// the layers the way the plugin sets one up from the mesh file.
+struct LayeredZone
+{
+	BuildContext context;
+	InputGeom geom{ "test", std::string(), std::string() };
+	Sample_TileMesh mesh;
+
+	NavMeshTileCacheData layers;
+	dtTileCacheAlloc alloc;
+	NavMeshTileCacheCompressor compressor;
+	NavMeshTileCacheMeshProcess meshProcess;
+	std::unique_ptr<dtTileCache, std::function<void(dtTileCache*)>> tileCache;
+
+	dtNavMesh* GetNavMesh() { return mesh.getNavMesh(); }
+};
+
+std::unique_ptr<LayeredZone> BuildLayeredZone()
+{
+	std::unique_ptr<LayeredZone> zone(new LayeredZone);
+	zone->context.enableLog(false);
+
+	TestZoneDesc desc;
+	desc.size = 460.0f;
+
+	zone->mesh.setBuildTileCache(true);
+	if (!LoadTestZone(desc, zone->context, zone->geom)
+		|| !BuildTestMesh(zone->mesh, zone->geom, zone->context, 0)
+		|| !zone->mesh.getTileCache())
+	{
+		return nullptr;
+	}
+
+	NavMeshTileCacheData built;
+	built.Build(zone->mesh.getTileCache());
+
+	std::vector<char> buffer;
+	built.Write(buffer);
+	if (!zone->layers.Read(buffer.data(), buffer.size()))
+		return nullptr;
+
+	zone->tileCache = std::unique_ptr<dtTileCache, std::function<void(dtTileCache*)>>(
+		dtAllocTileCache(), [](dtTileCache* tc) { dtFreeTileCache(tc); });
+
+	dtStatus status = zone->layers.InitTileCache(zone->tileCache.get(), MAX_OBSTACLES,
+		&zone->alloc, &zone->compressor, &zone->meshProcess);
+	if (dtStatusFailed(status))
+		return nullptr;
+
+	return zone;
+}
+
+struct PulseStats
+{
+	int pulses = 0;
+	int updates = 0;
+	Clock::duration total = Clock::duration::zero();
+	Clock::duration worst = Clock::duration::zero();
+};
+
+// Hand count requests to the tile cache a batch at a time, and run pulses of
+// tile rebuilds until the mesh has caught up with all of them. submit makes
+// the request with the index given.
+void RunPulses(dtTileCache* tileCache, dtNavMesh* navMesh, int count,
+	const std::function<bool(int)>& submit, PulseStats& stats)
+{
+	int next = 0;
+	bool updating = false;
+
+	for (;;)
+	{
+		if (!updating)
+		{
+			int requests = 0;
+			while (next < count && requests < REQUESTS_PER_BATCH && submit(next))
+			{
+				next++;
+				requests++;
+			}
+
+			updating = requests > 0;
+			if (!updating)
+				break;
+		}
+
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < MAX_TILE_UPDATES_PER_PULSE && updating; ++i)
+		{
+			bool upToDate = false;
+			tileCache->update(0, navMesh, &upToDate);
+			stats.updates++;
+			updating = !upToDate;
+		}
+
+		Clock::duration elapsed = Clock::now() - start;
+		stats.total += elapsed;
+		stats.worst = std::max(stats.worst, elapsed);
+		stats.pulses++;
+	}
+}
+
+// the polys of every tile, to tell if they come back the same
+struct TileShape
+{
+	int x, y, layer;
+	int polyCount;
+	std::vector<float> verts;
+
+	bool operator==(const TileShape& other) const
+	{
+		return x == other.x && y == other.y && layer == other.layer
+			&& polyCount == other.polyCount && verts == other.verts;
+	}
+};
+
+std::vector<TileShape> GetTileShapes(const dtNavMesh* navMesh)
+{
+	std::vector<TileShape> shapes;
+	for (int i = 0; i < navMesh->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = navMesh->getTile(i);
+		if (!tile->header)
+			continue;
+
+		TileShape shape;
+		shape.x = tile->header->x;
+		shape.y = tile->header->y;
+		shape.layer = tile->header->layer;
+		shape.polyCount = tile->header->polyCount;
+		shape.verts.assign(tile->verts, tile->verts + tile->header->vertCount * 3);
+		shapes.push_back(std::move(shape));
+	}
+
+	std::sort(shapes.begin(), shapes.end(), [](const TileShape& a, const TileShape& b)
+	{
+		return a.y != b.y ? a.y < b.y : a.x != b.x ? a.x < b.x : a.layer < b.layer;
+	});
+
+	return shapes;
+}
+
+size_t GetTileBytes(const dtNavMesh* navMesh)
+{
+	size_t bytes = 0;
+	for (int i = 0; i < navMesh->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = navMesh->getTile(i);
+		if (tile->header)
+			bytes += tile->dataSize;
+	}
+
+	return bytes;
+}
+
+float PathLength(NavMeshQueryPool& pool, const TestRoute& route)
+{
+	TestPath path(&pool);
+	path.SetStart(route.start);
+	if (!path.FindPath(GamePosition(route.end)) || path.IsPartialPath())
+		return -1.0f;
+
+	return path.GetPathLength();
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+// A box dropped across a path cuts a hole in the mesh that the path goes
+// around, and taking it away puts the tiles back the way they were.
+TEST(ObstacleCutsPath)
+{
+	std::unique_ptr<LayeredZone> zone = BuildLayeredZone();
+	CHECK(zone != nullptr);
+	if (!zone)
+		return;
+
+	dtNavMesh* navMesh = zone->GetNavMesh();
+	const std::vector<TileShape> before = GetTileShapes(navMesh);
+
+	NavMeshQueryPool pool(navMesh);
+
+	// a route over open ground, where there is room to go around the box,
+	// rather than one that winds through the maze or the town
+	TestRoute route;
+	float length = -1.0f;
+	for (const TestRoute& candidate : GetTestRoutes(navMesh, 32, 150.0f, 101))
+	{
+		float candidateLength = PathLength(pool, candidate);
+		if (candidateLength > 0 && candidateLength < dtVdist(candidate.start.pos, candidate.end.pos) * 1.05f)
+		{
+			route = candidate;
+			length = candidateLength;
+			break;
+		}
+	}
+	CHECK(length > 0);
+	if (length < 0)
+		return;
+
+	// across the path, halfway along it
+	float center[3];
+	{
+		TestPath path(&pool);
+		path.SetStart(route.start);
+		path.FindPath(GamePosition(route.end));
+		dtVcopy(center, route.start.pos);
+		MoveAlongPath(path, center, length / 2);
+	}
+
+	const float bmin[3] = { center[0] - 12.0f, center[1] - 10.0f, center[2] - 12.0f };
+	const float bmax[3] = { center[0] + 12.0f, center[1] + 10.0f, center[2] + 12.0f };
+
+	dtObstacleRef ref = 0;
+	PulseStats stats;
+	RunPulses(zone->tileCache.get(), navMesh, 1,
+		[&](int) { return dtStatusSucceed(zone->tileCache->addBoxObstacle(bmin, bmax, &ref)); }, stats);
+	CHECK(ref != 0);
+	CHECK(stats.updates > 0);
+
+	// nothing to stand on in the middle of the box any more. The polys around
+	// the hole can still overlap the middle, so look at how far they are.
+	dtNavMeshQuery query;
+	query.init(navMesh, 256);
+	dtQueryFilter filter;
+	const float extents[3] = { 4.0f, 10.0f, 4.0f };
+	dtPolyRef inside = 0;
+	float nearest[3];
+	query.findNearestPoly(center, extents, &filter, &inside, nearest);
+	CHECK(inside == 0 || dtVdist2D(nearest, center) > 8.0f);
+
+	const float around = PathLength(pool, route);
+	CHECK(around > length);
+
+	RunPulses(zone->tileCache.get(), navMesh, 1,
+		[&](int) { return dtStatusSucceed(zone->tileCache->removeObstacle(ref)); }, stats);
+
+	CHECK(GetTileShapes(navMesh) == before);
+	CHECK(std::fabs(PathLength(pool, route) - length) < 0.01f);
+}
+
+// Toggling a lot of obstacles on and off at once rebuilds the tiles a few
+// per pulse, and leaves the mesh as it was. Reports how long it took and
+// how much memory the layers and tiles need.
+TEST(ObstaclesToggleMany)
+{
+	std::unique_ptr<LayeredZone> zone = BuildLayeredZone();
+	CHECK(zone != nullptr);
+	if (!zone)
+		return;
+
+	dtNavMesh* navMesh = zone->GetNavMesh();
+	dtTileCache* tileCache = zone->tileCache.get();
+	const std::vector<TileShape> before = GetTileShapes(navMesh);
+	const size_t bytesBefore = GetTileBytes(navMesh);
+
+	std::vector<TestPoint> points = GetTestPoints(navMesh, 128, 103);
+	std::vector<dtObstacleRef> refs(points.size(), 0);
+
+	PulseStats adding;
+	RunPulses(tileCache, navMesh, static_cast<int>(points.size()), [&](int i)
+	{
+		return dtStatusSucceed(tileCache->addObstacle(points[i].pos, 3.0f, 6.0f, &refs[i]));
+	}, adding);
+
+	int processed = 0;
+	for (dtObstacleRef ref : refs)
+	{
+		const dtTileCacheObstacle* obstacle = tileCache->getObstacleByRef(ref);
+		if (obstacle && obstacle->state == DT_OBSTACLE_PROCESSED)
+			processed++;
+	}
+	CHECK(processed == static_cast<int>(points.size()));
+
+	const size_t bytesWith = GetTileBytes(navMesh);
+	CHECK(GetTileShapes(navMesh) != before);
+
+	PulseStats removing;
+	RunPulses(tileCache, navMesh, static_cast<int>(refs.size()), [&](int i)
+	{
+		return dtStatusSucceed(tileCache->removeObstacle(refs[i]));
+	}, removing);
+
+	CHECK(GetTileShapes(navMesh) == before);
+	CHECK(GetTileBytes(navMesh) == bytesBefore);
+
+	for (const PulseStats* stats : { &adding, &removing })
+	{
+		printf("  %s %d obstacles: %d pulses, %d tile updates, %.2f ms per update, worst pulse %.2f ms\n",
+			stats == &adding ? "adding" : "removing", static_cast<int>(points.size()), stats->pulses,
+			stats->updates, Milliseconds(stats->total) / stats->updates, Milliseconds(stats->worst));
+	}
+	printf("  %d layers, %.0f KB compressed; tiles %.0f KB, %.0f KB with the obstacles\n",
+		zone->layers.GetLayerCount(), zone->layers.GetDataSize() / 1024.0,
+		bytesBefore / 1024.0, bytesWith / 1024.0);
+}
+
+//----------------------------------------------------------------------------
+
+// Add more and more obstacles at once, and take them away again. Reports the
+// pulses it takes for the tiles to catch up, the time per tile rebuild and
+// the longest pulse, which is what the game would notice.
+BENCHMARK(ObstacleRebuilds)
+{
+	std::unique_ptr<LayeredZone> zone = BuildLayeredZone();
+	if (!zone)
+	{
+		printf("  couldn't build the test zone with layers\n");
+		return;
+	}
+
+	dtNavMesh* navMesh = zone->GetNavMesh();
+	dtTileCache* tileCache = zone->tileCache.get();
+
+	const int counts[] = { 1, 16, 64, 256 };
+	for (int count : counts)
+	{
+		std::vector<TestPoint> points = GetTestPoints(navMesh, count, 105);
+		std::vector<dtObstacleRef> refs(points.size(), 0);
+
+		PulseStats adding;
+		RunPulses(tileCache, navMesh, count, [&](int i)
+		{
+			return dtStatusSucceed(tileCache->addObstacle(points[i].pos, 3.0f, 6.0f, &refs[i]));
+		}, adding);
+
+		PulseStats removing;
+		RunPulses(tileCache, navMesh, count, [&](int i)
+		{
+			return dtStatusSucceed(tileCache->removeObstacle(refs[i]));
+		}, removing);
+
+		for (const PulseStats* stats : { &adding, &removing })
+		{
+			printf("  %s %3d: %4d pulses, %.2f ms per tile, worst pulse %.2f ms\n",
+				stats == &adding ? "add   " : "remove", count, stats->pulses,
+				Milliseconds(stats->total) / stats->updates, Milliseconds(stats->worst));
+		}
+	}
+}
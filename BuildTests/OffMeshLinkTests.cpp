@@ -0,0 +1,395 @@
+//
+// OffMeshLinkTests.cpp
+//
+// Tests for the off-mesh links saved with the mesh, and for paths that cross
+// them, and a benchmark of what a lot of links cost the bake and searches.
+//
+
+#include "Benchmark.h"
+#include "Test.h"
+#include "TestPath.h"
+#include "TestZone.h"
+
+#include "NavigationFilter.h"
+#include "NavMeshOffMeshLinks.h"
+#include "NavMeshQueryPool.h"
+
+#include "BuildContext.h"
+#include "InputGeom.h"
+#include "Sample_TileMesh.h"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+const float LINK_RADIUS = 2.0f;
+
+// A zone that links are added to before it's built.
+struct LinkedZone
+{
+	BuildContext context;
+	InputGeom geom{ "test", std::string(), std::string() };
+	Sample_TileMesh mesh;
+
+	NavMeshOffMeshLinks& GetLinks() { return geom.getOffMeshLinks(); }
+	dtNavMesh* GetNavMesh() { return mesh.getNavMesh(); }
+
+	bool Load(const TestZoneDesc& desc)
+	{
+		context.enableLog(false);
+		return LoadTestZone(desc, context, geom);
+	}
+
+	bool Build() { return BuildTestMesh(mesh, geom, context, 0); }
+};
+
+uint32_t AddLink(NavMeshOffMeshLinks& links, const float* start, const float* end, bool bidirectional,
+	NavMeshLinkAction action = NavLinkAction_Walk, const std::string& actionData = std::string())
+{
+	return links.Add(start, end, LINK_RADIUS, bidirectional, NavArea_Jump, NavFlag_Walk | NavFlag_Jump,
+		action, actionData);
+}
+
+bool FindPoint(const dtNavMeshQuery& query, float x, float z, TestPoint& point)
+{
+	const float center[3] = { x, 0.0f, z };
+	const float extents[3] = { 2.0f, 20.0f, 2.0f };
+	dtQueryFilter filter;
+
+	return dtStatusSucceed(query.findNearestPoly(center, extents, &filter, &point.ref, point.pos))
+		&& point.ref != 0;
+}
+
+// A bank of the river on each side, across from each other near the route
+// that GetRiverRoute gives, which is a long way from the bridge.
+bool GetRiverBanks(TestPoint& west, TestPoint& east)
+{
+	const TestZoneDesc& desc = GetRiverZoneDesc();
+	const float riverMin = (desc.size - desc.riverWidth) / 2;
+	const float riverMax = riverMin + desc.riverWidth;
+	const float z = desc.size * 0.2f;
+
+	dtNavMeshQuery query;
+	return dtStatusSucceed(query.init(GetRiverZoneMesh(), 64))
+		&& FindPoint(query, riverMin - 6.0f, z, west)
+		&& FindPoint(query, riverMax + 6.0f, z, east);
+}
+
+// the off-mesh connection the path crosses, if it crosses one
+const dtOffMeshConnection* FindCrossedLink(const dtNavMesh* navMesh, const NavMeshPath& path)
+{
+	for (dtPolyRef ref : path.GetPlannedPolys())
+	{
+		const dtOffMeshConnection* con = navMesh->getOffMeshConnectionByRef(ref);
+		if (con)
+			return con;
+	}
+
+	return nullptr;
+}
+
+bool HasLinkCorner(const NavMeshPath& path)
+{
+	for (int i = 0; i < path.GetPathSize(); ++i)
+	{
+		if (path.GetFlags(i) & DT_STRAIGHTPATH_OFFMESH_CONNECTION)
+			return true;
+	}
+
+	return false;
+}
+
+float WalkLength(NavMeshQueryPool& pool, const TestPoint& from, const TestPoint& to)
+{
+	TestPath path(&pool);
+	path.SetStart(from);
+	if (!path.FindPath(GamePosition(to)) || path.IsPartialPath())
+		return -1.0f;
+
+	return path.GetPathLength();
+}
+
+// Short hops between random points near each other, like ledges and small
+// teleporters scattered around a zone.
+void AddRandomLinks(const dtNavMesh* navMesh, NavMeshOffMeshLinks& links, int count, unsigned int seed)
+{
+	dtNavMeshQuery query;
+	if (dtStatusFailed(query.init(navMesh, 64)))
+		return;
+
+	std::minstd_rand random(seed);
+	std::uniform_real_distribution<float> offset(-20.0f, 20.0f);
+
+	for (const TestPoint& start : GetTestPoints(navMesh, count * 2, seed))
+	{
+		if (links.GetCount() >= count)
+			break;
+
+		TestPoint end;
+		if (FindPoint(query, start.pos[0] + offset(random), start.pos[2] + offset(random), end)
+			&& dtVdist(start.pos, end.pos) > LINK_RADIUS * 2)
+		{
+			AddLink(links, start.pos, end.pos, (links.GetCount() & 1) == 0);
+		}
+	}
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+// Links keep everything about them through the mesh file's section, and
+// their ids aren't handed out again once they're removed.
+TEST(OffMeshLinksSaveAndLoad)
+{
+	const float a[3] = { 1, 2, 3 };
+	const float b[3] = { 40, 5, 60 };
+
+	NavMeshOffMeshLinks links;
+	uint32_t walk = AddLink(links, a, b, true);
+	uint32_t door = AddLink(links, b, a, false, NavLinkAction_Door, "PORTAL_TO_POK");
+	uint32_t command = AddLink(links, a, a, false, NavLinkAction_Command, "/useitem Drunkard's Stein");
+
+	CHECK(walk == NavMeshOffMeshLinks::FIRST_LINK_ID);
+	CHECK(door != walk && command != door);
+	CHECK(links.Remove(door));
+	CHECK(!links.Remove(door));
+
+	uint32_t next = AddLink(links, a, b, false);
+	CHECK(next > command);
+
+	std::vector<char> buffer;
+	links.Write(buffer);
+
+	NavMeshOffMeshLinks loaded;
+	CHECK(loaded.Read(buffer.data(), buffer.size()));
+	CHECK(loaded.GetCount() == 3);
+	CHECK(loaded.FindLink(door) == nullptr);
+
+	const NavMeshOffMeshLink* link = loaded.FindLink(command);
+	CHECK(link != nullptr);
+	if (link)
+	{
+		CHECK(link->action == NavLinkAction_Command);
+		CHECK(link->actionData == "/useitem Drunkard's Stein");
+		CHECK(!link->bidirectional);
+	}
+
+	link = loaded.FindLink(walk);
+	CHECK(link != nullptr);
+	if (link)
+	{
+		CHECK(dtVequal(link->start, a) && dtVequal(link->end, b));
+		CHECK(link->bidirectional);
+		CHECK(link->radius == LINK_RADIUS);
+		CHECK(link->area == NavArea_Jump);
+		CHECK(link->flags == (NavFlag_Walk | NavFlag_Jump));
+	}
+
+	// ids carry on from where they were
+	CHECK(loaded.Add(a, b, LINK_RADIUS, false, 0, 0) > next);
+
+	CHECK(!loaded.Read(buffer.data(), buffer.size() / 2));
+}
+
+// The links gathered for a tile are the ones that start or end in it, each
+// of them once, the same as looking at every link.
+TEST(OffMeshLinksInBounds)
+{
+	std::minstd_rand random(111);
+	std::uniform_real_distribution<float> coord(0.0f, 1000.0f);
+
+	NavMeshOffMeshLinks links;
+	for (int i = 0; i < 2000; ++i)
+	{
+		const float start[3] = { coord(random), 0, coord(random) };
+		const float end[3] = { start[0] + coord(random) / 20, 0, start[2] - coord(random) / 20 };
+		AddLink(links, start, end, false);
+	}
+
+	const float TILE_SIZE = 76.8f;
+	int total = 0;
+
+	for (float x = 0; x < 1000.0f; x += TILE_SIZE)
+	{
+		for (float z = 0; z < 1000.0f; z += TILE_SIZE)
+		{
+			const float bmin[3] = { x, -100.0f, z };
+			const float bmax[3] = { x + TILE_SIZE, 100.0f, z + TILE_SIZE };
+
+			NavMeshOffMeshLinkSet set;
+			links.GetLinksInBounds(bmin, bmax, set);
+
+			std::vector<unsigned int> expected;
+			for (int i = 0; i < links.GetCount(); ++i)
+			{
+				const NavMeshOffMeshLink& link = links.GetLink(i);
+				auto inBounds = [&](const float* pos)
+				{
+					return pos[0] >= bmin[0] && pos[0] <= bmax[0] && pos[2] >= bmin[2] && pos[2] <= bmax[2];
+				};
+
+				if (inBounds(link.start) || inBounds(link.end))
+					expected.push_back(link.id);
+			}
+
+			std::vector<unsigned int> ids = set.ids;
+			std::sort(ids.begin(), ids.end());
+			CHECK(ids == expected);
+			CHECK(set.verts.size() == ids.size() * 6);
+			total += set.GetCount();
+		}
+	}
+
+	CHECK(total >= links.GetCount());
+}
+
+// A walk link across the river takes the path straight over it instead of
+// around by the bridge, both ways if it goes both ways, and the connection
+// in the mesh leads back to the link and its action.
+TEST(OffMeshLinkCrossesRiver)
+{
+	TestRoute route;
+	TestPoint west, east;
+	bool found = GetRiverRoute(GetRiverZoneMesh(), route, GetRiverZoneDesc()) && GetRiverBanks(west, east);
+	CHECK(found);
+	if (!found)
+		return;
+
+	NavMeshQueryPool plainPool(GetRiverZoneMesh());
+	const float bridge = WalkLength(plainPool, route.start, route.end);
+	CHECK(bridge > 0);
+
+	for (int mode = 0; mode < 2; ++mode)
+	{
+		const bool bidirectional = mode == 1;
+
+		LinkedZone zone;
+		CHECK(zone.Load(GetRiverZoneDesc()));
+		uint32_t id = AddLink(zone.GetLinks(), west.pos, east.pos, bidirectional, NavLinkAction_Door, "BOAT");
+		CHECK(zone.Build());
+
+		dtNavMesh* navMesh = zone.GetNavMesh();
+		if (!navMesh)
+			continue;
+
+		NavMeshQueryPool pool(navMesh);
+
+		TestPath over(&pool);
+		over.SetStart(route.start);
+		CHECK(over.FindPath(GamePosition(route.end)));
+		CHECK(!over.IsPartialPath());
+		CHECK(over.GetPathLength() < bridge * 0.5f);
+		CHECK(HasLinkCorner(over));
+
+		const dtOffMeshConnection* con = FindCrossedLink(navMesh, over);
+		CHECK(con != nullptr);
+		if (con)
+		{
+			CHECK(con->userId == id);
+
+			const NavMeshOffMeshLink* link = zone.GetLinks().FindLink(con->userId);
+			CHECK(link != nullptr);
+			CHECK(link && link->action == NavLinkAction_Door && link->actionData == "BOAT");
+		}
+
+		TestPath back(&pool);
+		back.SetStart(route.end);
+		CHECK(back.FindPath(GamePosition(route.start)));
+		CHECK(!back.IsPartialPath());
+		CHECK((FindCrossedLink(navMesh, back) != nullptr) == bidirectional);
+		if (!bidirectional)
+			CHECK(back.GetPathLength() > bridge * 0.9f);
+	}
+}
+
+//----------------------------------------------------------------------------
+
+// Bake the river zone with more and more short links scattered over it, and
+// search random routes across it. Reports what gathering the links for the
+// tiles and the bake cost, the size of the tiles, and the time and nodes
+// expanded per search.
+BENCHMARK(OffMeshLinkQueries)
+{
+	dtNavMesh* plain = GetRiverZoneMesh();
+	if (!plain)
+	{
+		printf("  couldn't build the river zone\n");
+		return;
+	}
+
+	std::vector<TestRoute> routes = GetTestRoutes(plain, 48, 200.0f, 113);
+	NavigationFilter filter;
+
+	for (int count : { 0, 1000, 4000, 16000 })
+	{
+		LinkedZone zone;
+		if (!zone.Load(GetRiverZoneDesc()))
+			return;
+
+		AddRandomLinks(plain, zone.GetLinks(), count, 115);
+
+		Clock::time_point start = Clock::now();
+		if (!zone.Build())
+		{
+			printf("  couldn't build the zone with %d links\n", count);
+			return;
+		}
+		Clock::duration build = Clock::now() - start;
+
+		dtNavMesh* navMesh = zone.GetNavMesh();
+		const dtNavMesh* constMesh = navMesh;
+
+		// the links for every tile, the way the bake gathers them
+		start = Clock::now();
+		int gathered = 0;
+		size_t tileBytes = 0;
+		for (int i = 0; i < constMesh->getMaxTiles(); ++i)
+		{
+			const dtMeshTile* tile = constMesh->getTile(i);
+			if (!tile->header)
+				continue;
+
+			NavMeshOffMeshLinkSet set;
+			zone.GetLinks().GetLinksInBounds(tile->header->bmin, tile->header->bmax, set);
+			gathered += set.GetCount();
+			tileBytes += tile->dataSize;
+		}
+		Clock::duration gathering = Clock::now() - start;
+
+		NavMeshQueryPool pool(navMesh);
+		Clock::duration elapsed = Clock::duration::zero();
+		long long expansions = 0;
+		int crossing = 0;
+
+		for (const TestRoute& route : routes)
+		{
+			TestPath path(&pool);
+			path.SetFilter(filter);
+			path.SetStart(route.start);
+
+			start = Clock::now();
+			path.FindPath(GamePosition(route.end));
+			elapsed += Clock::now() - start;
+
+			expansions += path.GetStats().lastSearchIterations;
+			if (HasLinkCorner(path))
+				crossing++;
+		}
+
+		const double searches = static_cast<double>(routes.size());
+		printf("  %5d links: bake %.0f ms, gather %.2f ms (%d for all tiles), tiles %.0f KB; "
+			"%.3f ms per search, %5.0f nodes expanded, %d of %d paths use links\n",
+			zone.GetLinks().GetCount(), Milliseconds(build), Milliseconds(gathering), gathered,
+			tileBytes / 1024.0, Milliseconds(elapsed) / searches, expansions / searches, crossing,
+			static_cast<int>(routes.size()));
+	}
+}
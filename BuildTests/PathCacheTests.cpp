@@ -0,0 +1,264 @@
+//
+// PathCacheTests.cpp
+//
+// Tests for the cache in front of the Navigation TLO's path queries, and a
+// benchmark that replays the way a macro polls them.
+//
+
+#include "Benchmark.h"
+#include "Test.h"
+#include "TestPath.h"
+#include "TestZone.h"
+
+#include "NavigationPathCache.h"
+#include "NavMeshClusterGraph.h"
+#include "NavMeshQueryPool.h"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+NavigationPathCache::Key MakeKey(dtPolyRef startRef, dtPolyRef endRef)
+{
+	NavigationPathCache::Key key;
+	key.startRef = startRef;
+	key.endRef = endRef;
+	return key;
+}
+
+NavigationPathCache::Result MakeResult(dtPolyRef ref)
+{
+	NavigationPathCache::Result result;
+	result.exists = true;
+	result.polys.push_back(ref);
+	return result;
+}
+
+// how often the macro polls, and how fast we move between polls
+const int POLL_MS = 100;
+const float RUN_SPEED = 30.0f;
+
+// move along the path for one poll, and keep the path up to date
+bool Walk(TestPath& walker, float* pos)
+{
+	if (!MoveAlongPath(walker, pos, RUN_SPEED * POLL_MS / 1000.0f))
+		return false;
+
+	walker.SetStart(GamePosition(pos));
+	walker.AdvanceTime(POLL_MS);
+	walker.UpdatePath();
+	return true;
+}
+
+// how far a length from the cache can be from a search's, as a fraction
+const float MAX_LENGTH_ERROR = 0.03f;
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+// The cache holds on to the most recently used results, and lookups count as
+// using them.
+TEST(PathCacheEvictsLeastRecent)
+{
+	NavigationPathCache cache(2);
+
+	cache.Insert(MakeKey(1, 2), MakeResult(1));
+	cache.Insert(MakeKey(3, 4), MakeResult(3));
+	CHECK(cache.Lookup(MakeKey(1, 2)) != nullptr);
+
+	// 3, 4 is the least recently used now
+	cache.Insert(MakeKey(5, 6), MakeResult(5));
+	CHECK(cache.GetSize() == 2);
+	CHECK(cache.Lookup(MakeKey(3, 4)) == nullptr);
+	CHECK(cache.Lookup(MakeKey(1, 2)) != nullptr);
+	CHECK(cache.Lookup(MakeKey(5, 6)) != nullptr);
+
+	// a different filter is a different query
+	NavigationPathCache::Key key = MakeKey(1, 2);
+	key.filter.ParseOption("water=10");
+	CHECK(cache.Lookup(key) == nullptr);
+
+	const NavigationPathCache::Stats& stats = cache.GetStats();
+	CHECK(stats.hits == 3);
+	CHECK(stats.misses == 2);
+
+	cache.Clear();
+	CHECK(cache.GetSize() == 0);
+	CHECK(cache.Lookup(MakeKey(5, 6)) == nullptr);
+	CHECK(cache.GetStats().invalidations == 1);
+}
+
+// Polling while we move along the path mostly hits the cache, and every
+// length is close to what a search from where we are would give. A search
+// from further along the start poly can pick slightly different polys.
+TEST(PathCacheLengthsMatchSearch)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	NavMeshQueryPool pool(navMesh);
+	NavigationPathCache cache;
+
+	std::vector<TestRoute> routes = GetTestRoutes(navMesh, 3, 400.0f, 31);
+	CHECK(routes.size() == 3);
+
+	for (const TestRoute& route : routes)
+	{
+		TestPath walker(&pool);
+		walker.SetStart(route.start);
+		CHECK(walker.FindPath(GamePosition(route.end)));
+
+		float pos[3];
+		dtVcopy(pos, route.start.pos);
+
+		int polls = 0;
+		bool matched = true;
+
+		do
+		{
+			TestPath cached(&pool);
+			cached.SetStart(GamePosition(pos));
+			float length = -1.f;
+			CHECK(cache.FindPath(cached, GamePosition(route.end), length));
+
+			TestPath searched(&pool);
+			searched.SetStart(GamePosition(pos));
+			searched.FindPath(GamePosition(route.end));
+
+			if (std::fabs(length - searched.GetPathLength()) > searched.GetPathLength() * MAX_LENGTH_ERROR)
+				matched = false;
+
+			polls++;
+		} while (polls < 1000 && Walk(walker, pos));
+
+		CHECK(matched);
+		CHECK(cache.GetStats().hits > 0);
+	}
+
+	const NavigationPathCache::Stats& stats = cache.GetStats();
+	CHECK(stats.hits > stats.misses);
+}
+
+// A destination that the cluster graph says can't be reached is answered
+// without a search, and remembered.
+TEST(PathCacheRemembersUnreachable)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	NavMeshQueryPool pool(navMesh);
+	NavMeshClusterGraph graph(navMesh);
+	NavigationPathCache cache;
+
+	std::vector<TestPoint> points = GetTestPoints(navMesh, 200, 33);
+
+	// find a point somewhere that can't be walked to from the first one, like
+	// the top of a wall
+	const TestPoint* unreachable = nullptr;
+	for (const TestPoint& point : points)
+	{
+		if (!graph.MayBeConnected(points[0].ref, point.ref))
+		{
+			unreachable = &point;
+			break;
+		}
+	}
+
+	CHECK(unreachable != nullptr);
+	if (!unreachable)
+		return;
+
+	for (int i = 0; i < 2; ++i)
+	{
+		TestPath path(&pool);
+		path.SetClusterGraph(&graph);
+		path.SetStart(points[0]);
+
+		float length = 0;
+		CHECK(!cache.FindPath(path, GamePosition(*unreachable), length));
+		CHECK(length == -1.f);
+		CHECK(path.GetStats().replans == 0);
+	}
+
+	CHECK(cache.GetStats().hits == 1);
+}
+
+//----------------------------------------------------------------------------
+
+// A macro that checks PathLength to a handful of spawns every 100 ms while
+// we run toward the first of them. Each poll is a new path, the way the TLO
+// makes one, and goes through the cache or straight to a search.
+BENCHMARK(PathCachePolling)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	if (!navMesh)
+	{
+		printf("  couldn't build the test zone\n");
+		return;
+	}
+
+	NavMeshQueryPool pool(navMesh);
+	std::vector<TestRoute> routes = GetTestRoutes(navMesh, 8, 400.0f, 37);
+	std::vector<TestPoint> targets = GetTestPoints(navMesh, 4, 39);
+
+	for (int mode = 0; mode < 2; ++mode)
+	{
+		const bool cached = mode == 0;
+
+		NavigationPathCache cache;
+		Clock::duration elapsed = Clock::duration::zero();
+		int polls = 0;
+
+		for (const TestRoute& route : routes)
+		{
+			TestPath walker(&pool);
+			walker.SetStart(route.start);
+			walker.FindPath(GamePosition(route.end));
+
+			float pos[3];
+			dtVcopy(pos, route.start.pos);
+
+			do
+			{
+				for (int i = 0; i < 1 + static_cast<int>(targets.size()); ++i)
+				{
+					const glm::vec3 target = GamePosition(i == 0 ? route.end : targets[i - 1]);
+
+					Clock::time_point start = Clock::now();
+
+					TestPath path(&pool);
+					path.SetStart(GamePosition(pos));
+					float length;
+					if (cached)
+						cache.FindPath(path, target, length);
+					else
+						path.FindPath(target);
+
+					elapsed += Clock::now() - start;
+					polls++;
+				}
+			} while (Walk(walker, pos));
+		}
+
+		const NavigationPathCache::Stats& stats = cache.GetStats();
+		if (cached)
+		{
+			printf("  cached:   %d polls, %.1f us per poll, %.1f%% hit rate\n",
+				polls, Microseconds(elapsed) / polls,
+				100.0 * stats.hits / std::max<uint32_t>(1, stats.hits + stats.misses));
+		}
+		else
+		{
+			printf("  searched: %d polls, %.1f us per poll\n",
+				polls, Microseconds(elapsed) / polls);
+		}
+	}
+}
@@ -0,0 +1,189 @@
+//
+// PathLengthsTests.cpp
+//
+// Tests for finding the path lengths to many destinations with one search,
+// and a benchmark of that against a search for each destination.
+//
+
+#include "Benchmark.h"
+#include "Test.h"
+#include "TestPath.h"
+#include "TestZone.h"
+
+#include "NavMeshClusterGraph.h"
+#include "NavMeshQueryPool.h"
+
+#include "DetourNavMesh.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+// Both searches measure costs between edge midpoints, which isn't quite the
+// length of the straight path. Across the zone, A* and the batch's search
+// can settle on different polys that cost the same, and the straight paths
+// through them come out a little different.
+const float MAX_LENGTH_ERROR = 0.01f;
+
+std::vector<glm::vec3> GetDestinations(const std::vector<TestPoint>& points)
+{
+	std::vector<glm::vec3> destinations;
+	for (const TestPoint& point : points)
+		destinations.push_back(GamePosition(point));
+	return destinations;
+}
+
+// the length a search to the destination gives, or -1 if it doesn't get there
+float SearchLength(NavMeshQueryPool& pool, const TestPoint& start, const glm::vec3& destination)
+{
+	TestPath path(&pool);
+	path.SetStart(start);
+
+	if (!path.FindPath(destination) || path.IsPartialPath())
+		return -1.0f;
+
+	return path.GetPathLength();
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+// Each length from the batch is the length of the path that a search to
+// that destination finds, or close to it.
+TEST(PathLengthsMatchSearches)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	NavMeshQueryPool pool(navMesh);
+
+	std::vector<TestRoute> routes = GetTestRoutes(navMesh, 33, 100.0f, 41);
+	CHECK(routes.size() == 33);
+	if (routes.empty())
+		return;
+
+	// from the start of the first route to the ends of all of them
+	std::vector<TestPoint> ends;
+	for (const TestRoute& route : routes)
+		ends.push_back(route.end);
+	std::vector<glm::vec3> destinations = GetDestinations(ends);
+
+	TestPath path(&pool);
+	path.SetStart(routes[0].start);
+
+	std::vector<float> lengths(destinations.size());
+	int reached = path.FindPathLengths(destinations.data(), static_cast<int>(destinations.size()),
+		lengths.data());
+
+	int matched = 0;
+	for (size_t i = 0; i < destinations.size(); ++i)
+	{
+		float length = SearchLength(pool, routes[0].start, destinations[i]);
+		if (length < 0 || lengths[i] < 0)
+			continue;
+
+		CHECK(std::fabs(lengths[i] - length) < length * MAX_LENGTH_ERROR);
+		if (std::fabs(lengths[i] - length) < 0.01f)
+			matched++;
+	}
+
+	CHECK(reached == static_cast<int>(destinations.size()));
+	CHECK(matched > 0);
+}
+
+// Destinations the cluster graph says can't be reached, and ones that cost
+// more than the limit, get -1. The others are still answered.
+TEST(PathLengthsSkipUnreachable)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	NavMeshQueryPool pool(navMesh);
+	NavMeshClusterGraph graph(navMesh);
+
+	std::vector<TestPoint> points = GetTestPoints(navMesh, 200, 43);
+	const TestPoint& start = points[0];
+
+	std::vector<TestPoint> reachable;
+	std::vector<TestPoint> unreachable;
+	for (size_t i = 1; i < points.size(); ++i)
+	{
+		if (graph.MayBeConnected(start.ref, points[i].ref))
+			reachable.push_back(points[i]);
+		else
+			unreachable.push_back(points[i]);
+	}
+
+	CHECK(!reachable.empty() && !unreachable.empty());
+	if (reachable.empty() || unreachable.empty())
+		return;
+
+	std::vector<TestPoint> mixed = { reachable[0], unreachable[0] };
+	std::vector<glm::vec3> destinations = GetDestinations(mixed);
+
+	TestPath path(&pool);
+	path.SetClusterGraph(&graph);
+	path.SetStart(start);
+
+	float lengths[2];
+	CHECK(path.FindPathLengths(destinations.data(), 2, lengths) == 1);
+	CHECK(lengths[0] > 0);
+	CHECK(lengths[1] == -1.0f);
+
+	// with a limit below what it costs to get to the first one
+	CHECK(path.FindPathLengths(destinations.data(), 1, lengths, lengths[0] * 0.5f) == 0);
+	CHECK(lengths[0] == -1.0f);
+}
+
+//----------------------------------------------------------------------------
+
+// Path lengths from one place to more and more spawns, with one batch and
+// with a search to each of them the way separate TLO calls do.
+BENCHMARK(BatchPathLengths)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	if (!navMesh)
+	{
+		printf("  couldn't build the test zone\n");
+		return;
+	}
+
+	NavMeshQueryPool pool(navMesh);
+	std::vector<TestPoint> starts = GetTestPoints(navMesh, 8, 45);
+
+	const int counts[] = { 1, 4, 16, 64 };
+	for (int count : counts)
+	{
+		Clock::duration batched = Clock::duration::zero();
+		Clock::duration separate = Clock::duration::zero();
+
+		for (size_t s = 0; s < starts.size(); ++s)
+		{
+			std::vector<glm::vec3> destinations = GetDestinations(
+				GetTestPoints(navMesh, count, 47 + static_cast<unsigned int>(s)));
+			std::vector<float> lengths(destinations.size());
+
+			Clock::time_point start = Clock::now();
+			TestPath path(&pool);
+			path.SetStart(starts[s]);
+			path.FindPathLengths(destinations.data(), static_cast<int>(destinations.size()), lengths.data());
+			batched += Clock::now() - start;
+
+			start = Clock::now();
+			for (const glm::vec3& destination : destinations)
+			{
+				TestPath single(&pool);
+				single.SetStart(starts[s]);
+				single.FindPath(destination);
+			}
+			separate += Clock::now() - start;
+		}
+
+		const double runs = static_cast<double>(starts.size());
+		printf("  %2d destinations: %8.1f us batched, %8.1f us searching each\n",
+			count, Microseconds(batched) / runs, Microseconds(separate) / runs);
+	}
+}
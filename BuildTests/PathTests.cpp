@@ -0,0 +1,167 @@
+//
+// PathTests.cpp
+//
+// Tests for the storage behind NavMeshPath: the path holds only the corners
+// it has, and the big search buffers are per-thread scratch that every path
+// on the thread shares. The benchmark polls path lengths the way a macro
+// polls the Navigation TLO.
+//
+
+#include "Benchmark.h"
+#include "Test.h"
+#include "TestPath.h"
+#include "TestZone.h"
+
+#include "NavMeshQueryPool.h"
+
+#include "DetourNavMesh.h"
+
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::vector<float> Corners;
+
+Corners FindCorners(TestPath& path, const TestPoint& start, const TestPoint& end)
+{
+	path.SetStart(start);
+	path.FindPath(GamePosition(end));
+
+	return Corners(path.GetCurrentPath(), path.GetCurrentPath() + path.GetPathSize() * 3);
+}
+
+// what the path used to keep inline, whatever its size: the straight path
+// and a flag for each corner
+const size_t INLINE_PATH_BYTES = NavMeshPath::MAX_POLYS * (3 * sizeof(float) + 1);
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+// A path is cheap to put on the stack, the way the TLO does for every call.
+TEST(PathStorageIsSmall)
+{
+	printf("  path object: %d bytes\n", static_cast<int>(sizeof(TestPath)));
+
+	CHECK(sizeof(TestPath) < 4096);
+	CHECK(sizeof(TestPath) < INLINE_PATH_BYTES / 16);
+}
+
+// The scratch buffers are reused from one search to the next, and by every
+// path on the thread. None of that should leak from one search into another.
+TEST(PathScratchSharedBetweenSearches)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	NavMeshQueryPool pool(navMesh);
+
+	std::vector<TestPoint> points = GetTestPoints(navMesh, 33);
+	CHECK(points.size() == 33);
+
+	// a new path for each search
+	std::vector<Corners> expected;
+	int found = 0;
+	for (size_t i = 0; i + 1 < points.size(); ++i)
+	{
+		TestPath path(&pool);
+		expected.push_back(FindCorners(path, points[i], points[i + 1]));
+
+		if (!expected.back().empty())
+			found++;
+	}
+
+	// most of the points can reach each other, or this isn't testing much
+	CHECK(found > static_cast<int>(expected.size()) / 2);
+
+	// one path for all of them
+	{
+		TestPath path(&pool);
+		for (size_t i = 0; i < expected.size(); ++i)
+			CHECK(FindCorners(path, points[i], points[i + 1]) == expected[i]);
+	}
+
+	// several threads, each with its own scratch, at the same time
+	const int THREADS = 4;
+	std::vector<int> mismatches(THREADS, 0);
+	std::vector<std::thread> threads;
+
+	for (int t = 0; t < THREADS; ++t)
+	{
+		threads.emplace_back([&, t]()
+		{
+			TestPath path(&pool);
+			for (size_t i = t; i < expected.size(); i += THREADS)
+			{
+				if (FindCorners(path, points[i], points[i + 1]) != expected[i])
+					mismatches[t]++;
+			}
+		});
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	for (int t = 0; t < THREADS; ++t)
+		CHECK(mismatches[t] == 0);
+}
+
+//----------------------------------------------------------------------------
+
+// A macro polling ${Navigation.PathLength[...]} for a few spawns every few
+// frames. Each call makes a path on the stack and searches, like the TLO does
+// when the path cache doesn't have the answer.
+BENCHMARK(PathLengthPolling)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	if (!navMesh)
+	{
+		printf("  couldn't build the test zone\n");
+		return;
+	}
+
+	const int DESTINATIONS = 8;
+	const int ROUNDS = 200;
+
+	std::vector<TestPoint> points = GetTestPoints(navMesh, DESTINATIONS + 1, 2);
+	NavMeshQueryPool pool(navMesh);
+
+	// warm up the pool and this thread's scratch
+	{
+		TestPath path(&pool);
+		FindCorners(path, points[0], points[1]);
+	}
+
+	DetourAllocCounter allocs;
+	size_t pathBytes = 0;
+	int calls = 0;
+
+	Clock::time_point start = Clock::now();
+	for (int round = 0; round < ROUNDS; ++round)
+	{
+		for (int i = 1; i <= DESTINATIONS; ++i)
+		{
+			TestPath path(&pool);
+			path.SetStart(points[0]);
+			path.FindPath(GamePosition(points[i]));
+			path.GetPathLength();
+
+			pathBytes += path.GetPathSize() * (3 * sizeof(float) + 1 + sizeof(dtPolyRef))
+				+ path.GetPlannedPolys().capacity() * sizeof(dtPolyRef);
+			calls++;
+		}
+	}
+	Clock::duration elapsed = Clock::now() - start;
+
+	const size_t scratchBytes = NavMeshPath::MAX_POLYS * (2 * sizeof(dtPolyRef) + 3 * sizeof(float) + 1);
+
+	printf("  %d calls: %.1f us each, %.1f Detour allocations each\n",
+		calls, Microseconds(elapsed) / calls, allocs.GetCount() / static_cast<double>(calls));
+	printf("  on the stack: %d bytes per call (was %d KB, plus %d KB for each search)\n",
+		static_cast<int>(sizeof(TestPath)), static_cast<int>(INLINE_PATH_BYTES / 1024),
+		static_cast<int>(NavMeshPath::MAX_POLYS * sizeof(dtPolyRef) / 1024));
+	printf("  path storage: %d bytes per call on average, thread scratch: %d KB once\n",
+		static_cast<int>(pathBytes / calls), static_cast<int>(scratchBytes / 1024));
+}
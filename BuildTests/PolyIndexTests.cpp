@@ -0,0 +1,319 @@
+//
+// PolyIndexTests.cpp
+//
+// Tests for finding the nearest poly with the poly index, which has to give
+// the same answers as findNearestPoly, and a benchmark of both on a zone
+// with a lot of floors stacked on top of each other.
+//
+
+#include "Benchmark.h"
+#include "Test.h"
+#include "TestPath.h"
+#include "TestZone.h"
+
+#include "NavMeshPolyIndex.h"
+#include "NavMeshQueryPool.h"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+// the extents that paths search with (NavMeshPath::m_extents)
+const float EXTENTS[3] = { 50, 400, 50 };
+
+// somewhere in the zone, from under the ground to over the top of the tower
+std::vector<float> GetQueryPoints(const TestZoneDesc& desc, int count, unsigned int seed)
+{
+	std::minstd_rand random(seed);
+	std::uniform_real_distribution<float> xz(0.0f, desc.size);
+	std::uniform_real_distribution<float> y(-10.0f, 20.0f + (desc.floors + 1) * desc.floorHeight);
+
+	std::vector<float> points;
+	for (int i = 0; i < count; ++i)
+	{
+		points.push_back(xz(random));
+		points.push_back(y(random));
+		points.push_back(xz(random));
+	}
+
+	return points;
+}
+
+bool InBox(const float* pos, const float* center, const float* extents)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		if (pos[i] < center[i] - extents[i] || pos[i] > center[i] + extents[i])
+			return false;
+	}
+
+	return true;
+}
+
+// How far a poly is from pos, the way findNearestPoly decides which one is
+// nearest: standing over a poly within climb height counts as on it.
+float NearestDistanceSqr(const dtNavMesh* navMesh, const dtNavMeshQuery& query, dtPolyRef ref,
+	const float* pos)
+{
+	const dtMeshTile* tile = nullptr;
+	const dtPoly* poly = nullptr;
+	navMesh->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+
+	float closest[3];
+	bool posOverPoly = false;
+	query.closestPointOnPoly(ref, pos, closest, &posOverPoly);
+
+	float diff[3];
+	dtVsub(diff, pos, closest);
+
+	if (posOverPoly)
+	{
+		float d = dtAbs(diff[1]) - tile->header->walkableClimb;
+		return d > 0 ? d * d : 0;
+	}
+
+	return dtVlenSqr(diff);
+}
+
+// Points every few steps along paths between random places, where each
+// update of a path would look for the poly we're on.
+std::vector<float> GetWalkingPoints(NavMeshQueryPool& pool, const dtNavMesh* navMesh, int routeCount)
+{
+	const int MAX_STEPS = 2000;
+	std::vector<float> points;
+
+	for (const TestRoute& route : GetTestRoutes(navMesh, routeCount, 100.0f, 55))
+	{
+		TestPath path(&pool);
+		path.SetStart(route.start);
+		if (!path.FindPath(GamePosition(route.end)))
+			continue;
+
+		float pos[3];
+		dtVcopy(pos, route.start.pos);
+		int steps = 0;
+
+		do
+		{
+			points.insert(points.end(), pos, pos + 3);
+
+			path.SetStart(GamePosition(pos));
+			path.AdvanceTime(100);
+			path.UpdatePath();
+		} while (++steps < MAX_STEPS && MoveAlongPath(path, pos, 3.0f));
+	}
+
+	return points;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+// Wherever we ask from, the index finds a poly that is as near as the one
+// findNearestPoly finds, and with the last poly as a hint it still does.
+// Where findNearestPoly runs out of room for polys, the index can find a
+// nearer one than it does.
+TEST(PolyIndexMatchesFindNearestPoly)
+{
+	dtNavMesh* navMesh = GetTowerZoneMesh();
+	CHECK(navMesh != nullptr);
+	if (!navMesh)
+		return;
+
+	dtNavMeshQuery query;
+	CHECK(dtStatusSucceed(query.init(navMesh, 2048)));
+	dtQueryFilter filter;
+
+	NavMeshPolyIndex index(navMesh);
+	CHECK(index.IsValid());
+
+	std::vector<float> points = GetQueryPoints(GetTowerZoneDesc(), 2000, 51);
+
+	int found = 0;
+	int same = 0;
+	int nearer = 0;
+	int worse = 0;
+	int outside = 0;
+	int worseWithHint = 0;
+	dtPolyRef hint = 0;
+
+	for (size_t i = 0; i < points.size(); i += 3)
+	{
+		const float* pos = &points[i];
+
+		dtPolyRef expectedRef = 0;
+		float expectedPt[3];
+		query.findNearestPoly(pos, EXTENTS, &filter, &expectedRef, expectedPt);
+
+		float nearestPt[3];
+		dtPolyRef ref = index.FindNearestPoly(&query, pos, EXTENTS, filter, nearestPt);
+
+		// a point a little way off from the last one, with its poly
+		float nearby[3] = { pos[0] + 1.0f, pos[1], pos[2] + 1.0f };
+		dtPolyRef hinted = index.FindNearestPoly(&query, nearby, EXTENTS, filter, nullptr, hint);
+		dtPolyRef unhinted = index.FindNearestPoly(&query, nearby, EXTENTS, filter, nullptr);
+		hint = hinted;
+
+		if ((hinted != 0) != (unhinted != 0)
+			|| (hinted && NearestDistanceSqr(navMesh, query, hinted, nearby)
+				> NearestDistanceSqr(navMesh, query, unhinted, nearby) + 0.001f))
+		{
+			worseWithHint++;
+		}
+
+		if (!expectedRef)
+		{
+			if (ref)
+				nearer++;
+			continue;
+		}
+
+		found++;
+		if (!ref)
+		{
+			worse++;
+			continue;
+		}
+
+		float expected = NearestDistanceSqr(navMesh, query, expectedRef, pos);
+		float actual = NearestDistanceSqr(navMesh, query, ref, pos);
+
+		if (actual > expected + 0.001f)
+		{
+			// findNearestPoly goes by the tiles' quantized bounds, and can
+			// return a poly that's just outside of the search box. We don't.
+			if (InBox(expectedPt, pos, EXTENTS))
+				worse++;
+			else
+				outside++;
+		}
+		else if (actual < expected - 0.001f)
+			nearer++;
+		else
+			same++;
+	}
+
+	printf("  %d found, %d as near, %d nearer than findNearestPoly, %d outside of the box\n",
+		found, same, nearer, outside);
+
+	CHECK(found > 1000);
+	CHECK(worse == 0);
+	CHECK(worseWithHint == 0);
+	CHECK(same > found / 2);
+	CHECK(outside * 50 < found);
+}
+
+// Tiles that go away take their polys out of the index when it's rebuilt.
+TEST(PolyIndexFollowsTiles)
+{
+	dtNavMesh* navMesh = GetTowerZoneMesh();
+	CHECK(navMesh != nullptr);
+	if (!navMesh)
+		return;
+
+	dtNavMeshQuery query;
+	CHECK(dtStatusSucceed(query.init(navMesh, 2048)));
+	dtQueryFilter filter;
+
+	NavMeshPolyIndex index(navMesh);
+	const int entries = index.GetStats().entries;
+	CHECK(entries > 0);
+
+	index.SetNavMesh(nullptr);
+	CHECK(!index.IsValid());
+
+	const float center[3] = { 230, 20, 230 };
+	CHECK(index.FindNearestPoly(&query, center, EXTENTS, filter, nullptr) == 0);
+
+	index.SetNavMesh(navMesh);
+	CHECK(index.GetStats().entries == entries);
+	CHECK(index.FindNearestPoly(&query, center, EXTENTS, filter, nullptr) != 0);
+}
+
+//----------------------------------------------------------------------------
+
+// Find the nearest poly with findNearestPoly and with the index, on the
+// tower zone and on the default zone. Once for points along paths, the way
+// each update of a path looks for the poly we're on (with the last one as a
+// hint), and once for points anywhere in the zone, like a destination.
+BENCHMARK(NearestPolyLatency)
+{
+	struct Zone
+	{
+		const char* name;
+		dtNavMesh* navMesh;
+		TestZoneDesc desc;
+	};
+	Zone zones[] = {
+		{ "tower zone", GetTowerZoneMesh(), GetTowerZoneDesc() },
+		{ "test zone", GetTestZoneMesh(), TestZoneDesc() },
+	};
+
+	for (const Zone& zone : zones)
+	{
+		if (!zone.navMesh)
+		{
+			printf("  couldn't build the %s\n", zone.name);
+			continue;
+		}
+
+		dtNavMeshQuery query;
+		query.init(zone.navMesh, 2048);
+		dtQueryFilter filter;
+
+		Clock::time_point start = Clock::now();
+		NavMeshPolyIndex index(zone.navMesh);
+		printf("  %s: %d entries in %d cells, built in %.1f ms\n", zone.name,
+			index.GetStats().entries, index.GetStats().cells, Milliseconds(Clock::now() - start));
+
+		NavMeshQueryPool pool(zone.navMesh);
+		std::vector<float> walking = GetWalkingPoints(pool, zone.navMesh, 16);
+		std::vector<float> anywhere = GetQueryPoints(zone.desc, 4000, 53);
+
+		for (int set = 0; set < 2; ++set)
+		{
+			const std::vector<float>& points = set == 0 ? walking : anywhere;
+			const int count = static_cast<int>(points.size() / 3);
+			printf("    %s, %d points:\n", set == 0 ? "along paths" : "anywhere", count);
+
+			for (int mode = 0; mode < 3; ++mode)
+			{
+				dtPolyRef hint = 0;
+				const NavMeshPolyIndex::Stats before = index.GetStats();
+
+				start = Clock::now();
+				for (int i = 0; i < count; ++i)
+				{
+					dtPolyRef ref = 0;
+					if (mode == 0)
+						query.findNearestPoly(&points[i * 3], EXTENTS, &filter, &ref, nullptr);
+					else
+						ref = index.FindNearestPoly(&query, &points[i * 3], EXTENTS, filter, nullptr,
+							mode == 2 ? hint : 0);
+					hint = ref;
+				}
+				Clock::duration elapsed = Clock::now() - start;
+
+				const char* names[] = { "findNearestPoly", "index", "index with hint" };
+				printf("      %-16s %6.2f us per query", names[mode], Microseconds(elapsed) / count);
+
+				if (mode > 0)
+				{
+					const NavMeshPolyIndex::Stats& after = index.GetStats();
+					printf(", %.1f entries scanned, %.1f polys checked, %.0f%% answered by the hint",
+						(after.entriesScanned - before.entriesScanned) / static_cast<double>(count),
+						(after.polysChecked - before.polysChecked) / static_cast<double>(count),
+						100.0 * (after.hintHits - before.hintHits) / count);
+				}
+				printf("\n");
+			}
+		}
+	}
+}
@@ -0,0 +1,197 @@
+//
+// QueryPoolTests.cpp
+//
+// Tests for NavMeshQueryPool, and a benchmark of searching with a query from
+// the pool against making a new query for every search like paths used to.
+//
+
+#include "Benchmark.h"
+#include "Test.h"
+#include "TestZone.h"
+
+#include "NavMeshQueryPool.h"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int MAX_NODES = 10000;
+const int MAX_POLYS = 1024;
+
+typedef std::vector<dtPolyRef> PolyPath;
+
+PolyPath FindPolyPath(dtNavMeshQuery& query, const TestPoint& start, const TestPoint& end)
+{
+	dtQueryFilter filter;
+	PolyPath path(MAX_POLYS);
+	int count = 0;
+
+	query.findPath(start.ref, end.ref, start.pos, end.pos, &filter, path.data(), &count, MAX_POLYS);
+	path.resize(count);
+
+	return path;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+// One search after another only ever needs the one query.
+TEST(QueryPoolReusesQueries)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	NavMeshQueryPool pool(navMesh, MAX_NODES);
+
+	for (int i = 0; i < 100; ++i)
+	{
+		std::shared_ptr<dtNavMeshQuery> query = pool.Acquire();
+		CHECK(query != nullptr);
+		CHECK(query && query->getAttachedNavMesh() == navMesh);
+	}
+
+	NavMeshQueryPool::Stats stats = pool.GetStats();
+	CHECK(stats.acquired == 100);
+	CHECK(stats.created == 1);
+	CHECK(stats.reinitialized == 0);
+}
+
+// Searches on several threads at once each get their own query, and find
+// the same paths as a query of their own would.
+TEST(QueryPoolSharedBetweenThreads)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	std::vector<TestPoint> points = GetTestPoints(navMesh, 64);
+	CHECK(points.size() == 64);
+
+	dtNavMeshQuery query;
+	CHECK(dtStatusSucceed(query.init(navMesh, MAX_NODES)));
+
+	std::vector<PolyPath> expected;
+	for (size_t i = 0; i + 1 < points.size(); ++i)
+		expected.push_back(FindPolyPath(query, points[i], points[i + 1]));
+
+	NavMeshQueryPool pool(navMesh, MAX_NODES);
+
+	const int THREADS = 4;
+	const int ROUNDS = 10;
+	std::vector<int> mismatches(THREADS, 0);
+	std::vector<std::thread> threads;
+
+	for (int t = 0; t < THREADS; ++t)
+	{
+		threads.emplace_back([&, t]()
+		{
+			for (int round = 0; round < ROUNDS; ++round)
+			{
+				for (size_t i = t; i < expected.size(); i += THREADS)
+				{
+					std::shared_ptr<dtNavMeshQuery> pooled = pool.Acquire();
+					if (!pooled || FindPolyPath(*pooled, points[i], points[i + 1]) != expected[i])
+						mismatches[t]++;
+				}
+			}
+		});
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	for (int t = 0; t < THREADS; ++t)
+		CHECK(mismatches[t] == 0);
+
+	NavMeshQueryPool::Stats stats = pool.GetStats();
+	CHECK(stats.acquired == expected.size() * ROUNDS);
+	CHECK(stats.created <= THREADS);
+}
+
+// A new mesh moves the pooled queries over, and the ones that were out when
+// it changed are moved when they come back.
+TEST(QueryPoolFollowsNavMesh)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	dtNavMesh otherMesh;
+	CHECK(dtStatusSucceed(otherMesh.init(navMesh->getParams())));
+
+	NavMeshQueryPool pool(navMesh, MAX_NODES);
+
+	std::shared_ptr<dtNavMeshQuery> held = pool.Acquire();
+	pool.Acquire();
+
+	// none while there's no mesh
+	pool.SetNavMesh(nullptr);
+	CHECK(pool.Acquire() == nullptr);
+
+	pool.SetNavMesh(&otherMesh);
+
+	std::shared_ptr<dtNavMeshQuery> query = pool.Acquire();
+	CHECK(query && query->getAttachedNavMesh() == &otherMesh);
+	query.reset();
+
+	CHECK(held->getAttachedNavMesh() == navMesh);
+	held.reset();
+
+	for (int i = 0; i < NavMeshQueryPool::MAX_POOLED_QUERIES; ++i)
+	{
+		query = pool.Acquire();
+		CHECK(query && query->getAttachedNavMesh() == &otherMesh);
+	}
+
+	CHECK(pool.GetStats().created == 2);
+}
+
+//----------------------------------------------------------------------------
+
+// Search between random points on the test zone with a new query for each
+// search, and then with queries from the pool.
+BENCHMARK(QueryPoolSearches)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	if (!navMesh)
+	{
+		printf("  couldn't build the test zone\n");
+		return;
+	}
+
+	const int SEARCHES = 2000;
+	std::vector<TestPoint> points = GetTestPoints(navMesh, SEARCHES + 1);
+
+	DetourAllocCounter allocs;
+
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < SEARCHES; ++i)
+	{
+		std::unique_ptr<dtNavMeshQuery> query(new dtNavMeshQuery);
+		query->init(navMesh, MAX_NODES);
+		FindPolyPath(*query, points[i], points[i + 1]);
+	}
+	Clock::duration elapsed = Clock::now() - start;
+
+	printf("  new query each time: %.0f searches/s, %.1f allocations each\n",
+		SEARCHES / (Milliseconds(elapsed) / 1000.0), allocs.GetCount() / static_cast<double>(SEARCHES));
+
+	NavMeshQueryPool pool(navMesh, MAX_NODES);
+	allocs.Reset();
+
+	start = Clock::now();
+	for (int i = 0; i < SEARCHES; ++i)
+	{
+		std::shared_ptr<dtNavMeshQuery> query = pool.Acquire();
+		FindPolyPath(*query, points[i], points[i + 1]);
+	}
+	elapsed = Clock::now() - start;
+
+	printf("  pooled queries:      %.0f searches/s, %.1f allocations each\n",
+		SEARCHES / (Milliseconds(elapsed) / 1000.0), allocs.GetCount() / static_cast<double>(SEARCHES));
+}
@@ -0,0 +1,249 @@
+//
+// ShortcutTests.cpp
+//
+// Tests for dropping the corners of a path that can be walked past in a
+// straight line, and a benchmark that replays walking routes with and
+// without them.
+//
+
+#include "Benchmark.h"
+#include "Test.h"
+#include "TestPath.h"
+#include "TestZone.h"
+
+#include "NavMeshQueryPool.h"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+
+#include <cfloat>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+// how often the path is updated while walking, and how fast we move
+const int UPDATE_MS = 100;
+const float RUN_SPEED = 30.0f;
+
+int FindCorner(const NavMeshPath& path, const float* pos)
+{
+	for (int i = 0; i < path.GetPathSize(); ++i)
+	{
+		if (dtVequal(path.GetRawPosition(i), pos))
+			return i;
+	}
+
+	return -1;
+}
+
+// Nothing is in the way from one point to the other, and the ray ends up on
+// the same level as the point it was aimed at.
+bool IsClear(const dtNavMeshQuery& query, dtPolyRef startRef, const float* start, const float* end)
+{
+	dtQueryFilter filter;
+	float t = 0;
+	float hitNormal[3];
+	dtPolyRef visited[256];
+	int numVisited = 0;
+
+	dtStatus status = query.raycast(startRef, start, end, &filter, &t, hitNormal, visited, &numVisited, 256);
+	if (dtStatusFailed(status) || t != FLT_MAX || numVisited == 0)
+		return false;
+
+	float closest[3];
+	query.closestPointOnPoly(visited[numVisited - 1], end, closest, nullptr);
+	return dtVdist(closest, end) < 1.0f;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+// Paths with shortcuts start and end in the same places as the ones without,
+// with fewer corners and no longer. Every corner that was dropped is replaced
+// by a straight line that a raycast gets through.
+TEST(ShortcutPathsAreClear)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	NavMeshQueryPool pool(navMesh);
+
+	dtNavMeshQuery query;
+	CHECK(dtStatusSucceed(query.init(navMesh, 2048)));
+
+	int corners = 0;
+	int dropped = 0;
+
+	for (const TestRoute& route : GetTestRoutes(navMesh, 24, 200.0f, 81))
+	{
+		TestPath plain(&pool);
+		plain.SetStart(route.start);
+		CHECK(plain.FindPath(GamePosition(route.end)));
+
+		TestPath shortcut(&pool);
+		shortcut.SetShortcutPaths(true);
+		shortcut.SetStart(route.start);
+		CHECK(shortcut.FindPath(GamePosition(route.end)));
+
+		const int size = shortcut.GetPathSize();
+		CHECK(size >= 2 && size <= plain.GetPathSize());
+		if (size < 2)
+			continue;
+
+		CHECK(dtVequal(shortcut.GetRawPosition(0), plain.GetRawPosition(0)));
+		CHECK(dtVequal(shortcut.GetRawPosition(size - 1), plain.GetRawPosition(plain.GetPathSize() - 1)));
+		CHECK(shortcut.GetPathLength() <= plain.GetPathLength() + 0.01f);
+		CHECK(shortcut.GetStats().shortcutCorners == plain.GetPathSize() - size);
+
+		for (int i = 0; i + 1 < size; ++i)
+		{
+			// corners of the shortcut path are corners of the plain one too
+			int from = FindCorner(plain, shortcut.GetRawPosition(i));
+			int to = FindCorner(plain, shortcut.GetRawPosition(i + 1));
+			CHECK(from >= 0 && to > from);
+
+			if (to > from + 1)
+			{
+				CHECK(IsClear(query, shortcut.GetPolyRef(i), shortcut.GetRawPosition(i),
+					shortcut.GetRawPosition(i + 1)));
+			}
+		}
+
+		corners += plain.GetPathSize();
+		dropped += plain.GetPathSize() - size;
+	}
+
+	printf("  %d of %d corners dropped\n", dropped, corners);
+	CHECK(dropped > 0);
+}
+
+// The corners that were dropped stay dropped as we walk along the path and
+// it is rebuilt from the corridor, without any more raycasts.
+TEST(ShortcutPathsStayShort)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	NavMeshQueryPool pool(navMesh);
+	int droppedTotal = 0;
+
+	for (const TestRoute& route : GetTestRoutes(navMesh, 8, 300.0f, 83))
+	{
+		TestPath plain(&pool);
+		plain.SetStart(route.start);
+		CHECK(plain.FindPath(GamePosition(route.end)));
+
+		TestPath path(&pool);
+		path.SetShortcutPaths(true);
+		path.SetStart(route.start);
+		CHECK(path.FindPath(GamePosition(route.end)));
+
+		const int planned = path.GetPathSize();
+		const int dropped = path.GetStats().shortcutCorners;
+
+		std::vector<const float*> droppedCorners;
+		for (int i = 0; i < plain.GetPathSize(); ++i)
+		{
+			if (FindCorner(path, plain.GetRawPosition(i)) == -1)
+				droppedCorners.push_back(plain.GetRawPosition(i));
+		}
+		CHECK(static_cast<int>(droppedCorners.size()) == dropped);
+		droppedTotal += dropped;
+
+		float pos[3];
+		dtVcopy(pos, route.start.pos);
+
+		// partway along the first leg, so no corners have been passed
+		MoveAlongPath(path, pos, dtVdist(pos, path.GetRawPosition(1)) / 2);
+		path.SetStart(GamePosition(pos));
+		path.AdvanceTime(UPDATE_MS);
+		path.UpdatePath();
+
+		// following the corridor can find shortcuts of its own, but none of
+		// the dropped corners come back.
+		CHECK(path.GetStats().replans == 1);
+		CHECK(path.GetPathSize() <= planned);
+
+		for (const float* corner : droppedCorners)
+			CHECK(FindCorner(path, corner) == -1);
+	}
+
+	CHECK(droppedTotal > 0);
+}
+
+//----------------------------------------------------------------------------
+
+// Walk routes across the zone, updating the path every 100 ms like the
+// plugin does, with and without shortcuts. Reports how many corners the
+// paths have, how often the next waypoint changes and how often we replan,
+// per minute of walking, and what the updates cost.
+BENCHMARK(ShortcutWalking)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	if (!navMesh)
+	{
+		printf("  couldn't build the test zone\n");
+		return;
+	}
+
+	NavMeshQueryPool pool(navMesh);
+	std::vector<TestRoute> routes = GetTestRoutes(navMesh, 32, 400.0f, 85);
+
+	for (int mode = 0; mode < 2; ++mode)
+	{
+		const bool shortcuts = mode == 1;
+
+		Clock::duration planning = Clock::duration::zero();
+		Clock::duration updating = Clock::duration::zero();
+		int corners = 0;
+		int updates = 0;
+		int switches = 0;
+		int replans = 0;
+
+		for (const TestRoute& route : routes)
+		{
+			TestPath path(&pool);
+			path.SetShortcutPaths(shortcuts);
+			path.SetStart(route.start);
+
+			Clock::time_point start = Clock::now();
+			path.FindPath(GamePosition(route.end));
+			planning += Clock::now() - start;
+			corners += path.GetPathSize();
+
+			float pos[3];
+			dtVcopy(pos, route.start.pos);
+			float waypoint[3] = { 0, 0, 0 };
+
+			while (updates < 100000 && MoveAlongPath(path, pos, RUN_SPEED * UPDATE_MS / 1000.0f))
+			{
+				path.SetStart(GamePosition(pos));
+				path.AdvanceTime(UPDATE_MS);
+
+				start = Clock::now();
+				path.UpdatePath();
+				updating += Clock::now() - start;
+				updates++;
+
+				if (path.GetPathSize() > 1 && !dtVequal(path.GetRawPosition(1), waypoint))
+				{
+					dtVcopy(waypoint, path.GetRawPosition(1));
+					switches++;
+				}
+			}
+
+			replans += path.GetStats().replans - 1;
+		}
+
+		const double minutes = updates * UPDATE_MS / 60000.0;
+		const double count = static_cast<double>(routes.size());
+		printf("  %s: %.1f corners per path, %.3f ms to plan, %.1f us per update\n",
+			shortcuts ? "shortcuts" : "corners  ", corners / count, Milliseconds(planning) / count,
+			Microseconds(updating) / updates);
+		printf("  %s: %.1f waypoint changes and %.2f replans per minute\n",
+			shortcuts ? "shortcuts" : "corners  ", switches / minutes, replans / minutes);
+	}
+}
@@ -0,0 +1,200 @@
+//
+// SlicedSearchTests.cpp
+//
+// Tests for running path searches a slice at a time with a time budget for
+// each pulse, and a benchmark of the longest pulse for different budgets.
+//
+
+#include "Benchmark.h"
+#include "Test.h"
+#include "TestPath.h"
+#include "TestZone.h"
+
+#include "NavMeshQueryPool.h"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+typedef std::vector<float> Corners;
+
+Corners GetCorners(const NavMeshPath& path)
+{
+	return Corners(path.GetCurrentPath(), path.GetCurrentPath() + path.GetPathSize() * 3);
+}
+
+// Start a search with the path's budget and run it to the end, one pulse at
+// a time. Returns the most iterations that were run in one pulse.
+int RunSlicedSearch(TestPath& path, const TestPoint& end, Clock::duration* worstPulse = nullptr)
+{
+	int mostIterations = 0;
+	int iterations = 0;
+
+	Clock::time_point start = Clock::now();
+	path.FindPath(GamePosition(end));
+
+	for (;;)
+	{
+		Clock::duration pulse = Clock::now() - start;
+		if (worstPulse)
+			*worstPulse = std::max(*worstPulse, pulse);
+
+		const NavMeshPath::Stats& stats = path.GetStats();
+		int total = path.IsSearching() ? stats.searchIterations : stats.lastSearchIterations;
+		mostIterations = std::max(mostIterations, total - iterations);
+		iterations = total;
+
+		if (!path.IsSearching())
+			break;
+
+		start = Clock::now();
+		path.ContinueSearch();
+	}
+
+	return mostIterations;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+// A search with a budget is spread over several pulses, none of which run
+// the whole search, and finds the same path as one that runs all at once.
+// Through the maze the search is long enough to need plenty of pulses.
+TEST(SlicedSearchKeepsToBudget)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	NavMeshQueryPool pool(navMesh);
+
+	TestRoute maze;
+	CHECK(GetMazeRoute(navMesh, maze));
+
+	std::vector<TestRoute> routes = GetTestRoutes(navMesh, 6, 600.0f, 11);
+	CHECK(routes.size() == 6);
+	routes.insert(routes.begin(), maze);
+
+	for (const TestRoute& route : routes)
+	{
+		TestPath whole(&pool);
+		whole.SetStart(route.start);
+		CHECK(whole.FindPath(GamePosition(route.end)));
+		CHECK(whole.GetStats().lastSearchPulses == 1);
+
+		TestPath sliced(&pool);
+		sliced.SetStart(route.start);
+		sliced.SetSearchBudget(10);
+
+		int mostIterations = RunSlicedSearch(sliced, route.end);
+
+		const NavMeshPath::Stats& stats = sliced.GetStats();
+		CHECK(stats.lastSearchIterations == whole.GetStats().lastSearchIterations);
+		CHECK(GetCorners(sliced) == GetCorners(whole));
+
+		if (&route == &routes[0])
+		{
+			CHECK(stats.lastSearchPulses > 10);
+			CHECK(mostIterations * 10 < stats.lastSearchIterations);
+		}
+		else if (stats.lastSearchPulses > 1)
+		{
+			CHECK(mostIterations < stats.lastSearchIterations);
+		}
+	}
+}
+
+// While a new search runs, we keep following the path we had.
+TEST(SlicedSearchKeepsOldPath)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	CHECK(navMesh != nullptr);
+
+	NavMeshQueryPool pool(navMesh);
+
+	TestRoute route;
+	const bool found = GetMazeRoute(navMesh, route);
+	CHECK(found);
+	if (!found)
+		return;
+
+	TestPath path(&pool);
+	path.SetStart(route.start);
+	path.SetSearchBudget(10);
+	RunSlicedSearch(path, route.end);
+	CHECK(path.GetPathSize() > 0);
+
+	float pos[3];
+	dtVcopy(pos, route.start.pos);
+	MoveAlongPath(path, pos, 20.0f);
+	path.SetStart(GamePosition(pos));
+
+	// setting the filter means searching again
+	path.SetFilter(path.GetNavigationFilter());
+	path.UpdatePath();
+
+	CHECK(path.IsSearching());
+	CHECK(path.GetPathSize() > 0);
+	CHECK(path.GetPathSize() > 0
+		&& dtVdistSqr(path.GetRawPosition(path.GetPathSize() - 1), route.end.pos) < 0.01f);
+
+	int pulses = 0;
+	while (path.IsSearching() && pulses < 10000)
+	{
+		path.ContinueSearch();
+		pulses++;
+	}
+
+	CHECK(!path.IsSearching());
+	CHECK(path.GetStats().replans == 2);
+	CHECK(path.GetPathSize() > 0 && dtVdist2DSqr(path.GetRawPosition(0), pos) < 0.01f);
+}
+
+//----------------------------------------------------------------------------
+
+// Search long routes with different budgets, and report the longest time
+// spent in one pulse and how many pulses the searches took. The maze route
+// is the worst case, the others are across open ground.
+BENCHMARK(SlicedSearchLatency)
+{
+	dtNavMesh* navMesh = GetTestZoneMesh();
+	if (!navMesh)
+	{
+		printf("  couldn't build the test zone\n");
+		return;
+	}
+
+	NavMeshQueryPool pool(navMesh);
+	std::vector<TestRoute> routes = GetTestRoutes(navMesh, 31, 600.0f, 17);
+
+	TestRoute maze;
+	if (GetMazeRoute(navMesh, maze))
+		routes.push_back(maze);
+
+	const int budgets[] = { 0, 1000, 200, 50, 10 };
+	for (int budget : budgets)
+	{
+		Clock::duration worstPulse = Clock::duration::zero();
+		int pulses = 0;
+		int mostPulses = 0;
+
+		for (const TestRoute& route : routes)
+		{
+			TestPath path(&pool);
+			path.SetStart(route.start);
+			path.SetSearchBudget(budget);
+			RunSlicedSearch(path, route.end, &worstPulse);
+
+			pulses += path.GetStats().lastSearchPulses;
+			mostPulses = std::max(mostPulses, path.GetStats().lastSearchPulses);
+		}
+
+		printf("  budget %4d us: worst pulse %7.1f us, %.1f pulses per search (at most %d)\n",
+			budget, Microseconds(worstPulse), pulses / static_cast<double>(routes.size()), mostPulses);
+	}
+}
@@ -0,0 +1,27 @@
+//
+// TestPath.cpp
+//
+
+#include "TestPath.h"
+
+#include "DetourCommon.h"
+
+bool MoveAlongPath(const NavMeshPath& path, float* pos, float distance)
+{
+	for (int i = 1; i < path.GetPathSize(); ++i)
+	{
+		const float* corner = path.GetRawPosition(i);
+		float toCorner = dtVdist(pos, corner);
+
+		if (toCorner > distance)
+		{
+			dtVlerp(pos, pos, corner, distance / toCorner);
+			return true;
+		}
+
+		dtVcopy(pos, corner);
+		distance -= toCorner;
+	}
+
+	return false;
+}
@@ -0,0 +1,55 @@
+//
+// TestPath.h
+//
+// A NavMeshPath that starts wherever the test puts it, instead of at the
+// character, and runs on a clock that only moves when the test says so.
+//
+
+#pragma once
+
+#include "TestZone.h"
+
+#include "NavMeshPath.h"
+
+// game coordinates (z up) of a point on the mesh, the way destinations and
+// start positions are given to a path
+inline glm::vec3 GamePosition(const float* pos)
+{
+	return glm::vec3(pos[0], pos[2], pos[1]);
+}
+
+inline glm::vec3 GamePosition(const TestPoint& point)
+{
+	return GamePosition(point.pos);
+}
+
+class TestPath : public NavMeshPath
+{
+public:
+	explicit TestPath(NavMeshQueryPool* queryPool)
+		: NavMeshPath(queryPool)
+	{
+	}
+
+	void SetStart(const glm::vec3& pos) { m_start = pos; }
+	void SetStart(const TestPoint& point) { m_start = GamePosition(point); }
+
+	void AdvanceTime(int milliseconds) { m_time += std::chrono::milliseconds(milliseconds); }
+
+protected:
+	virtual bool GetStartPosition(glm::vec3& pos) const override
+	{
+		pos = m_start;
+		return true;
+	}
+
+	virtual clock::time_point GetTime() const override { return m_time; }
+
+private:
+	glm::vec3 m_start;
+	clock::time_point m_time;
+};
+
+// Move pos (in recast coordinates) up to distance along the straight path,
+// which starts where pos is. Returns false once it gets to the end.
+bool MoveAlongPath(const NavMeshPath& path, float* pos, float distance);
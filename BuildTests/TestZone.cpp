@@ -0,0 +1,458 @@
+//
+// TestZone.cpp
+//
+
+#include "TestZone.h"
+
+#include "BuildContext.h"
+#include "InputGeom.h"
+#include "Sample_TileMesh.h"
+
+#include "DetourCommon.h"
+#include "DetourNavMeshQuery.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+
+//----------------------------------------------------------------------------
+
+namespace {
+
+class ZoneBuilder
+{
+public:
+	ZoneBuilder(std::vector<float>& verts, std::vector<int>& tris)
+		: m_verts(verts)
+		, m_tris(tris)
+	{
+	}
+
+	int AddVertex(float x, float y, float z)
+	{
+		m_verts.push_back(x);
+		m_verts.push_back(y);
+		m_verts.push_back(z);
+		return static_cast<int>(m_verts.size() / 3) - 1;
+	}
+
+	// a, b, c, d go around the quad counterclockwise seen from above. This
+	// is the winding that recast treats as facing up.
+	void AddQuad(int a, int b, int c, int d)
+	{
+		AddTriangle(a, c, b);
+		AddTriangle(c, a, d);
+	}
+
+	// a closed box, walkable on top
+	void AddBox(float minX, float minY, float minZ, float maxX, float maxY, float maxZ)
+	{
+		int v[8];
+		for (int i = 0; i < 8; ++i)
+		{
+			v[i] = AddVertex(i & 1 ? maxX : minX, i & 4 ? maxY : minY, i & 2 ? maxZ : minZ);
+		}
+
+		AddQuad(v[4], v[5], v[7], v[6]); // top
+		AddQuad(v[0], v[2], v[3], v[1]); // bottom
+		AddQuad(v[0], v[1], v[5], v[4]);
+		AddQuad(v[1], v[3], v[7], v[5]);
+		AddQuad(v[3], v[2], v[6], v[7]);
+		AddQuad(v[2], v[0], v[4], v[6]);
+	}
+
+private:
+	void AddTriangle(int a, int b, int c)
+	{
+		m_tris.push_back(a);
+		m_tris.push_back(b);
+		m_tris.push_back(c);
+	}
+
+	std::vector<float>& m_verts;
+	std::vector<int>& m_tris;
+};
+
+float GroundHeight(float x, float z)
+{
+	return 6.0f * sinf(x * 0.02f) * cosf(z * 0.015f) + 2.0f * sinf((x + z) * 0.07f);
+}
+
+// the maze covers mazeMin to mazeMax on both x and z, with a row every spacing
+void GetMazeBounds(const TestZoneDesc& desc, float& mazeMin, float& mazeMax, float& spacing)
+{
+	mazeMin = desc.size * 0.55f;
+	mazeMax = desc.size * 0.95f;
+	spacing = (mazeMax - mazeMin) / desc.mazeRows;
+}
+
+// the river covers riverMin to riverMax on x, and the bridge bridgeMin to
+// bridgeMax on z
+void GetRiverBounds(const TestZoneDesc& desc, float& riverMin, float& riverMax,
+	float& bridgeMin, float& bridgeMax)
+{
+	riverMin = (desc.size - desc.riverWidth) / 2;
+	riverMax = riverMin + desc.riverWidth;
+	bridgeMin = desc.size * 0.8f;
+	bridgeMax = desc.size * 0.85f;
+}
+
+void MarkArea(InputGeom& geom, float minX, float minZ, float maxX, float maxZ, unsigned char area)
+{
+	const float verts[] = {
+		minX, 0, minZ,
+		maxX, 0, minZ,
+		maxX, 0, maxZ,
+		minX, 0, maxZ,
+	};
+	geom.addConvexVolume(verts, 4, -100.0f, 100.0f, area);
+}
+
+bool FindGroundPoint(const dtNavMeshQuery& query, float x, float z, TestPoint& point)
+{
+	const float center[3] = { x, GroundHeight(x, z), z };
+	const float extents[3] = { 2.0f, 20.0f, 2.0f };
+	dtQueryFilter filter;
+
+	return dtStatusSucceed(query.findNearestPoly(center, extents, &filter, &point.ref, point.pos))
+		&& point.ref != 0;
+}
+
+struct TestZoneMesh
+{
+	BuildContext context;
+	InputGeom geom{ "test", std::string(), std::string() };
+	Sample_TileMesh mesh;
+};
+
+// findRandomPoint takes a plain function
+std::minstd_rand s_random;
+
+float RandomFloat()
+{
+	return std::uniform_real_distribution<float>(0.0f, 1.0f)(s_random);
+}
+
+// build the zone the first time it is asked for
+dtNavMesh* GetZoneMesh(std::unique_ptr<TestZoneMesh>& zone, const TestZoneDesc& desc)
+{
+	if (!zone)
+	{
+		zone.reset(new TestZoneMesh);
+		zone->context.enableLog(false);
+
+		if (!LoadTestZone(desc, zone->context, zone->geom)
+			|| !BuildTestMesh(zone->mesh, zone->geom, zone->context, 0))
+		{
+			return nullptr;
+		}
+	}
+
+	return zone->mesh.getNavMesh();
+}
+
+TestZoneDesc MakeTowerZoneDesc()
+{
+	TestZoneDesc desc;
+	desc.size = 460.0f;
+	desc.buildingsPerSide = 0;
+	desc.mazeRows = 0;
+	desc.floors = 24;
+	return desc;
+}
+
+TestZoneDesc MakeRiverZoneDesc()
+{
+	TestZoneDesc desc;
+	desc.size = 460.0f;
+	desc.buildingsPerSide = 0;
+	desc.mazeRows = 0;
+	desc.riverWidth = 40.0f;
+	return desc;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+void MakeTestZone(const TestZoneDesc& desc, std::vector<float>& verts, std::vector<int>& tris)
+{
+	verts.clear();
+	tris.clear();
+
+	ZoneBuilder builder(verts, tris);
+
+	// the ground
+	const int quads = static_cast<int>(desc.size / desc.quadSize);
+	const int first = static_cast<int>(verts.size() / 3);
+
+	for (int z = 0; z <= quads; ++z)
+	{
+		for (int x = 0; x <= quads; ++x)
+		{
+			const float px = x * desc.quadSize;
+			const float pz = z * desc.quadSize;
+			builder.AddVertex(px, GroundHeight(px, pz), pz);
+		}
+	}
+
+	for (int z = 0; z < quads; ++z)
+	{
+		for (int x = 0; x < quads; ++x)
+		{
+			const int a = first + z * (quads + 1) + x;
+			builder.AddQuad(a, a + 1, a + quads + 2, a + quads + 1);
+		}
+	}
+
+	// The town, in a quarter of the zone. Each building is four walls with
+	// a gap for a door and a pillar in the middle, which makes a lot of
+	// small regions and corners for the tiles there to deal with.
+	const float lot = desc.size * 0.25f / desc.buildingsPerSide;
+	const float wall = 1.0f;
+	const float height = 12.0f;
+
+	for (int bz = 0; bz < desc.buildingsPerSide; ++bz)
+	{
+		for (int bx = 0; bx < desc.buildingsPerSide; ++bx)
+		{
+			const float minX = 40.0f + bx * lot + 2.0f;
+			const float minZ = 40.0f + bz * lot + 2.0f;
+			const float maxX = minX + lot - 4.0f;
+			const float maxZ = minZ + lot - 4.0f;
+			const float door = (maxX - minX) * 0.3f;
+
+			const float y = GroundHeight((minX + maxX) / 2, (minZ + maxZ) / 2) - 8.0f;
+			const float top = y + 8.0f + height;
+
+			builder.AddBox(minX, y, minZ, maxX, top, minZ + wall);
+			builder.AddBox(minX, y, maxZ - wall, minX + door, top, maxZ);
+			builder.AddBox(maxX - door, y, maxZ - wall, maxX, top, maxZ);
+			builder.AddBox(minX, y, minZ, minX + wall, top, maxZ);
+			builder.AddBox(maxX - wall, y, minZ, maxX, top, maxZ);
+
+			const float cx = (minX + maxX) / 2;
+			const float cz = (minZ + maxZ) / 2;
+			builder.AddBox(cx - 1.5f, y, cz - 1.5f, cx + 1.5f, top, cz + 1.5f);
+		}
+	}
+
+	// The maze, in the opposite corner. The way in is near one end of the
+	// first row, and each row has its way out at the other end from the one
+	// before it.
+	if (desc.mazeRows > 0)
+	{
+		float mazeMin, mazeMax, spacing;
+		GetMazeBounds(desc, mazeMin, mazeMax, spacing);
+
+		const float bottom = -12.0f;
+		const float top = 24.0f;
+		const float gap = 14.0f;
+
+		builder.AddBox(mazeMin, bottom, mazeMin, mazeMin + 4.0f, top, mazeMin + wall);
+		builder.AddBox(mazeMin + 4.0f + gap, bottom, mazeMin, mazeMax, top, mazeMin + wall);
+		builder.AddBox(mazeMin, bottom, mazeMax - wall, mazeMax, top, mazeMax);
+		builder.AddBox(mazeMin, bottom, mazeMin, mazeMin + wall, top, mazeMax);
+		builder.AddBox(mazeMax - wall, bottom, mazeMin, mazeMax, top, mazeMax);
+
+		for (int row = 1; row < desc.mazeRows; ++row)
+		{
+			const float z = mazeMin + row * spacing;
+			if (row % 2)
+				builder.AddBox(mazeMin, bottom, z, mazeMax - gap, top, z + wall);
+			else
+				builder.AddBox(mazeMin + gap, bottom, z, mazeMax, top, z + wall);
+		}
+	}
+
+	// The tower, over the middle of the zone. Each floor is a slab that
+	// covers the whole of it, high enough above the ground's hills that the
+	// first one doesn't touch them.
+	for (int floor = 1; floor <= desc.floors; ++floor)
+	{
+		const float minXZ = desc.size * 0.3f;
+		const float maxXZ = desc.size * 0.7f;
+		const float y = 8.0f + floor * desc.floorHeight;
+
+		builder.AddBox(minXZ, y - wall, minXZ, maxXZ, y, maxXZ);
+	}
+}
+
+bool LoadTestZone(const TestZoneDesc& desc, BuildContext& context, InputGeom& geom)
+{
+	std::vector<float> verts;
+	std::vector<int> tris;
+	MakeTestZone(desc, verts, tris);
+
+	if (!geom.loadMesh(&context, verts, tris))
+		return false;
+
+	if (desc.riverWidth > 0)
+	{
+		float riverMin, riverMax, bridgeMin, bridgeMax;
+		GetRiverBounds(desc, riverMin, riverMax, bridgeMin, bridgeMax);
+
+		MarkArea(geom, riverMin, 0, riverMax, bridgeMin, SAMPLE_POLYAREA_WATER);
+		MarkArea(geom, riverMin, bridgeMin, riverMax, bridgeMax, SAMPLE_POLYAREA_ROAD);
+		MarkArea(geom, riverMin, bridgeMax, riverMax, desc.size, SAMPLE_POLYAREA_WATER);
+	}
+
+	return true;
+}
+
+bool BuildTestMesh(Sample_TileMesh& mesh, InputGeom& geom, BuildContext& context, int threads)
+{
+	mesh.setContext(&context);
+	mesh.setBuildThreads(threads);
+	mesh.setReuseTiles(false);
+	mesh.handleMeshChanged(&geom);
+
+	bool built = mesh.handleBuild();
+	mesh.waitForBuildAllTiles();
+
+	return built && mesh.getNavMesh() != nullptr;
+}
+
+dtNavMesh* GetTestZoneMesh()
+{
+	static std::unique_ptr<TestZoneMesh> zone;
+	return GetZoneMesh(zone, TestZoneDesc());
+}
+
+const TestZoneDesc& GetTowerZoneDesc()
+{
+	static const TestZoneDesc desc = MakeTowerZoneDesc();
+	return desc;
+}
+
+dtNavMesh* GetTowerZoneMesh()
+{
+	static std::unique_ptr<TestZoneMesh> zone;
+	return GetZoneMesh(zone, GetTowerZoneDesc());
+}
+
+const TestZoneDesc& GetRiverZoneDesc()
+{
+	static const TestZoneDesc desc = MakeRiverZoneDesc();
+	return desc;
+}
+
+dtNavMesh* GetRiverZoneMesh()
+{
+	static std::unique_ptr<TestZoneMesh> zone;
+	return GetZoneMesh(zone, GetRiverZoneDesc());
+}
+
+std::vector<TestPoint> GetTestPoints(const dtNavMesh* navMesh, int count, unsigned int seed)
+{
+	std::vector<TestPoint> points;
+
+	dtNavMeshQuery query;
+	if (!navMesh || dtStatusFailed(query.init(navMesh, 2048)))
+		return points;
+
+	s_random.seed(seed);
+	dtQueryFilter filter;
+
+	while (static_cast<int>(points.size()) < count)
+	{
+		TestPoint point;
+		if (dtStatusFailed(query.findRandomPoint(&filter, RandomFloat, &point.ref, point.pos)))
+			break;
+
+		points.push_back(point);
+	}
+
+	return points;
+}
+
+bool GetMazeRoute(const dtNavMesh* navMesh, TestRoute& route, const TestZoneDesc& desc)
+{
+	dtNavMeshQuery query;
+	if (!navMesh || desc.mazeRows < 2 || dtStatusFailed(query.init(navMesh, 64)))
+		return false;
+
+	float mazeMin, mazeMax, spacing;
+	GetMazeBounds(desc, mazeMin, mazeMax, spacing);
+
+	return FindGroundPoint(query, mazeMin + 11.0f, mazeMin - 15.0f, route.start)
+		&& FindGroundPoint(query, (mazeMin + mazeMax) / 2, mazeMax - spacing / 2, route.end);
+}
+
+bool GetRiverRoute(const dtNavMesh* navMesh, TestRoute& route, const TestZoneDesc& desc)
+{
+	dtNavMeshQuery query;
+	if (!navMesh || desc.riverWidth <= 0 || dtStatusFailed(query.init(navMesh, 64)))
+		return false;
+
+	float riverMin, riverMax, bridgeMin, bridgeMax;
+	GetRiverBounds(desc, riverMin, riverMax, bridgeMin, bridgeMax);
+
+	const float z = desc.size * 0.2f;
+	return FindGroundPoint(query, riverMin - 40.0f, z, route.start)
+		&& FindGroundPoint(query, riverMax + 40.0f, z, route.end);
+}
+
+std::vector<TestRoute> GetTestRoutes(const dtNavMesh* navMesh, int count, float minDistance,
+	unsigned int seed)
+{
+	std::vector<TestRoute> routes;
+
+	// enough nodes to search the whole zone
+	dtNavMeshQuery query;
+	if (!navMesh || dtStatusFailed(query.init(navMesh, 65535)))
+		return routes;
+
+	const int MAX_POLYS = 4096;
+	std::vector<dtPolyRef> polys(MAX_POLYS);
+	dtQueryFilter filter;
+
+	// give up eventually if the mesh doesn't have enough of them
+	for (int attempt = 0; attempt < count * 50 && static_cast<int>(routes.size()) < count; ++attempt)
+	{
+		std::vector<TestPoint> points = GetTestPoints(navMesh, 2, seed++);
+		if (points.size() < 2 || dtVdist2D(points[0].pos, points[1].pos) < minDistance)
+			continue;
+
+		int numPolys = 0;
+		dtStatus status = query.findPath(points[0].ref, points[1].ref, points[0].pos, points[1].pos,
+			&filter, polys.data(), &numPolys, MAX_POLYS);
+		if (dtStatusFailed(status) || (status & DT_PARTIAL_RESULT) || numPolys == 0
+			|| polys[numPolys - 1] != points[1].ref)
+		{
+			continue;
+		}
+
+		routes.push_back(TestRoute{ points[0], points[1] });
+	}
+
+	return routes;
+}
+
+bool ReadFileBytes(const std::string& filename, std::vector<char>& data)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return !file.bad();
+}
+
+std::string GetTestFilePath(const std::string& name)
+{
+#if defined(_WIN32)
+	const char* directory = getenv("TEMP");
+	if (!directory || !*directory)
+		directory = ".";
+#else
+	const char* directory = getenv("TMPDIR");
+	if (!directory || !*directory)
+		directory = "/tmp";
+#endif
+
+	return std::string(directory) + "/MQ2Nav_" + name;
+}
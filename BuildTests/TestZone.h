@@ -0,0 +1,103 @@
+//
+// TestZone.h
+//
+// Geometry for the build tests to build meshes out of, instead of a zone
+// from the game. It is rolling ground with a walled town in one corner, so
+// some tiles take much longer to build than others, the way they do in a
+// real zone. The opposite corner is a maze, for searches that have to wind
+// back and forth like they do in a dungeon. Other zones can have a tower
+// of floors or a river across them instead.
+//
+
+#pragma once
+
+#include "DetourNavMesh.h"
+
+#include <string>
+#include <vector>
+
+class BuildContext;
+class InputGeom;
+class Sample_TileMesh;
+
+struct TestZoneDesc
+{
+	// size of the ground, in world units. At the default cell and tile
+	// sizes a tile is 76.8 units across.
+	float size = 920.0f;
+
+	// size of the ground quads
+	float quadSize = 8.0f;
+
+	// the town: a grid of walled buildings in the corner
+	int buildingsPerSide = 10;
+
+	// the maze: rows of walls with a gap at alternating ends
+	int mazeRows = 16;
+
+	// the tower: floors stacked over the middle of the zone, each this far
+	// above the one below, like a city with a lot of levels
+	int floors = 0;
+	float floorHeight = 12.0f;
+
+	// the river: a strip of water this wide across the middle of the zone,
+	// with a road bridge over it near the far end. The ground there is only
+	// marked as water and road, the way convex volumes mark it in a zone.
+	float riverWidth = 0.0f;
+};
+
+// recast coordinates (y up), three vert indices per triangle
+void MakeTestZone(const TestZoneDesc& desc, std::vector<float>& verts, std::vector<int>& tris);
+
+// Load the test zone into geom.
+bool LoadTestZone(const TestZoneDesc& desc, BuildContext& context, InputGeom& geom);
+
+// Build every tile of the mesh for geom, on threads workers, and wait for it.
+bool BuildTestMesh(Sample_TileMesh& mesh, InputGeom& geom, BuildContext& context, int threads);
+
+// The mesh of the default test zone, for the tests that search a mesh rather
+// than build one. It's built the first time it's asked for, and kept for the
+// rest of the run.
+dtNavMesh* GetTestZoneMesh();
+
+// The same for a smaller zone that is mostly the tower, for the tests of
+// finding polys where a lot of them are stacked up.
+dtNavMesh* GetTowerZoneMesh();
+const TestZoneDesc& GetTowerZoneDesc();
+
+// The same for a zone with a river across it, for the tests of area costs.
+dtNavMesh* GetRiverZoneMesh();
+const TestZoneDesc& GetRiverZoneDesc();
+
+struct TestPoint
+{
+	dtPolyRef ref;
+	float pos[3];
+};
+
+// Random points on the mesh, the same ones every time for the same seed.
+// Some of them are on the roofs, which can't be walked to.
+std::vector<TestPoint> GetTestPoints(const dtNavMesh* navMesh, int count, unsigned int seed = 1);
+
+struct TestRoute
+{
+	TestPoint start;
+	TestPoint end;
+};
+
+// From just outside the maze to the last row of it, the long way around.
+bool GetMazeRoute(const dtNavMesh* navMesh, TestRoute& route,
+	const TestZoneDesc& desc = TestZoneDesc());
+
+// From one bank of the river to the other, far from the bridge.
+bool GetRiverRoute(const dtNavMesh* navMesh, TestRoute& route, const TestZoneDesc& desc);
+
+// Random pairs of points at least minDistance apart that a search joins all
+// the way, for the tests that walk or compare whole paths.
+std::vector<TestRoute> GetTestRoutes(const dtNavMesh* navMesh, int count, float minDistance,
+	unsigned int seed = 1);
+
+bool ReadFileBytes(const std::string& filename, std::vector<char>& data);
+
+// somewhere in the temp directory
+std::string GetTestFilePath(const std::string& name);
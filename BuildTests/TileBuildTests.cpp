@@ -0,0 +1,308 @@
+//
+// TileBuildTests.cpp
+//
+// Tests for building all of the tiles of a mesh on several threads: however
+// the workers split the tiles up and whatever order they finish them in, the
+// saved mesh has to come out the same. Also benchmarks of how the builds
+// scale with the number of workers, and of what the scratch arenas save.
+//
+
+#include "Benchmark.h"
+#include "Test.h"
+#include "TestZone.h"
+
+#include "BuildContext.h"
+#include "InputGeom.h"
+#include "Sample_TileMesh.h"
+#include "TileBuildArena.h"
+#include "TileBuildScheduler.h"
+
+#include "DetourNavMesh.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// builds of the test zone to compare, each on a different number of threads
+const int BUILDS = 8;
+const int THREADS[BUILDS] = { 2, 3, 4, 8, 16, 5, 7, 12 };
+
+// Build the test zone once on one thread, and then BUILDS more times on
+// several, and check that every one of them saves the same file.
+void CheckBuildsMatch(bool tileCache, const char* name)
+{
+	BuildContext context;
+	context.enableLog(false);
+
+	InputGeom geom("test", std::string(), std::string());
+	CHECK(LoadTestZone(TestZoneDesc(), context, geom));
+
+	std::string filename = GetTestFilePath(name);
+	std::vector<char> expected;
+	int tileCount = 0;
+
+	{
+		Sample_TileMesh mesh;
+		mesh.setBuildTileCache(tileCache);
+		CHECK(BuildTestMesh(mesh, geom, context, 1));
+		CHECK(mesh.SaveMesh(filename));
+		CHECK(ReadFileBytes(filename, expected));
+
+		const dtNavMesh* navMesh = mesh.getNavMesh();
+		for (int i = 0; navMesh && i < navMesh->getMaxTiles(); ++i)
+		{
+			const dtMeshTile* tile = navMesh->getTile(i);
+			if (tile->header && tile->header->polyCount > 0)
+				tileCount++;
+		}
+	}
+
+	// make sure there's enough here for the threads to race each other on
+	CHECK(tileCount > 100);
+	CHECK(!expected.empty());
+
+	for (int build = 0; build < BUILDS; ++build)
+	{
+		Sample_TileMesh mesh;
+		mesh.setBuildTileCache(tileCache);
+		CHECK(BuildTestMesh(mesh, geom, context, THREADS[build]));
+		CHECK(mesh.SaveMesh(filename));
+
+		std::vector<char> data;
+		CHECK(ReadFileBytes(filename, data));
+
+		const bool same = data == expected;
+		printf("  %d threads: %s\n", THREADS[build], same ? "same" : "DIFFERENT");
+		CHECK(same);
+	}
+
+	remove(filename.c_str());
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+TEST(ParallelBuildsMatch)
+{
+	CheckBuildsMatch(false, "parallel.bin");
+}
+
+// The tile cache puts the navmesh tiles it builds from the layers in the
+// next free slot, so these go through a different path.
+TEST(ParallelLayerBuildsMatch)
+{
+	CheckBuildsMatch(true, "parallel_layers.bin");
+}
+
+// Every task runs once, on however many workers, and the workers finish by
+// telling us so once. Setting cancel skips the tasks that haven't started.
+TEST(SchedulerRunsEveryTask)
+{
+	const int TASKS = 2000;
+
+	for (int workers : { 1, 3, 8 })
+	{
+		std::vector<std::atomic<int>> runs(TASKS);
+		std::atomic<int> done{ 0 };
+		std::atomic<bool> cancel{ false };
+
+		TileBuildScheduler scheduler(workers, false);
+		scheduler.Run(TASKS, [&](int task) { runs[task]++; }, cancel, [&]() { done++; });
+		scheduler.Wait();
+
+		int once = 0;
+		for (const std::atomic<int>& count : runs)
+		{
+			if (count == 1)
+				once++;
+		}
+
+		CHECK(once == TASKS);
+		CHECK(done == 1);
+	}
+
+	std::atomic<int> started{ 0 };
+	std::atomic<int> done{ 0 };
+	std::atomic<bool> cancel{ false };
+
+	TileBuildScheduler scheduler(4, false);
+	scheduler.Run(TASKS, [&](int)
+	{
+		if (++started == 100)
+			cancel = true;
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}, cancel, [&]() { done++; });
+	scheduler.Wait();
+
+	// the ones already running when it was set still finish
+	CHECK(started >= 100 && started < 100 + scheduler.GetWorkerCount());
+	CHECK(done == 1);
+}
+
+// Building out of the scratch arenas saves the same mesh as building out of
+// the heap, and takes (nearly) every allocation of the tile builds off it.
+TEST(ArenaBuildsMatchHeap)
+{
+	BuildContext context;
+	context.enableLog(false);
+
+	InputGeom geom("test", std::string(), std::string());
+	CHECK(LoadTestZone(TestZoneDesc(), context, geom));
+
+	std::string filename = GetTestFilePath("arenas.bin");
+	std::vector<char> saved[2];
+	TileBuildArena::Counts counts[2];
+
+	for (int mode = 0; mode < 2; ++mode)
+	{
+		TileBuildArena::SetEnabled(mode == 1);
+		TileBuildArena::ResetCounts();
+
+		Sample_TileMesh mesh;
+		CHECK(BuildTestMesh(mesh, geom, context, 4));
+		counts[mode] = TileBuildArena::GetCounts();
+
+		CHECK(mesh.SaveMesh(filename));
+		CHECK(ReadFileBytes(filename, saved[mode]));
+	}
+
+	TileBuildArena::SetEnabled(true);
+	remove(filename.c_str());
+
+	CHECK(!saved[0].empty());
+	CHECK(saved[0] == saved[1]);
+
+	CHECK(counts[0].arena == 0);
+	CHECK(counts[0].heap > 1000);
+	CHECK(counts[1].arena == counts[0].heap);
+	CHECK(counts[1].heap == 0);
+}
+
+// The bounded queue hands everything over in order, and never holds more
+// than it has room for.
+TEST(BoundedQueueKeepsOrder)
+{
+	const int ITEMS = 10000;
+
+	BoundedQueue<int> queue(4);
+	std::thread producer([&]()
+	{
+		for (int i = 0; i < ITEMS; ++i)
+			queue.Push(i);
+		queue.Close();
+	});
+
+	int expected = 0;
+	int item = 0;
+	bool ordered = true;
+	while (queue.Pop(item))
+	{
+		if (item != expected++)
+			ordered = false;
+	}
+
+	producer.join();
+
+	CHECK(ordered);
+	CHECK(expected == ITEMS);
+	CHECK(!queue.Pop(item));
+}
+
+//----------------------------------------------------------------------------
+
+// Build every tile of a zone four times the size of the test zone on more
+// and more workers. Reports the tiles built per second and the speedup over
+// one worker. Past the number of cores there is nothing more to gain.
+BENCHMARK(TileBuildScaling)
+{
+	BuildContext context;
+	context.enableLog(false);
+
+	TestZoneDesc desc;
+	desc.size *= 2;
+
+	InputGeom geom("test", std::string(), std::string());
+	if (!LoadTestZone(desc, context, geom))
+	{
+		printf("  couldn't load the zone\n");
+		return;
+	}
+
+	const int cores = TileBuildScheduler::GetCoreCount();
+	printf("  %d cores\n", cores);
+
+	std::vector<int> threadCounts = { 1, 2, 4, 8 };
+	if (cores > 8)
+		threadCounts.push_back(cores);
+
+	double baseline = 0;
+	for (int threads : threadCounts)
+	{
+		Sample_TileMesh mesh;
+
+		Clock::time_point start = Clock::now();
+		if (!BuildTestMesh(mesh, geom, context, threads))
+		{
+			printf("  couldn't build the zone on %d threads\n", threads);
+			return;
+		}
+		const double seconds = Milliseconds(Clock::now() - start) / 1000.0;
+
+		const double tilesPerSecond = mesh.getTilesBuilt() / seconds;
+		if (threads == 1)
+			baseline = tilesPerSecond;
+
+		printf("  %2d threads: %d tiles in %.2f s, %6.1f tiles/s, %.2fx\n", threads, mesh.getTilesBuilt(),
+			seconds, tilesPerSecond, tilesPerSecond / baseline);
+	}
+}
+
+// Build every tile of the test zone on different numbers of workers, with
+// the tile builds allocating out of the heap and out of the scratch arenas.
+// Reports the wall time and how many allocations per tile each went to.
+BENCHMARK(TileBuildArenas)
+{
+	BuildContext context;
+	context.enableLog(false);
+
+	InputGeom geom("test", std::string(), std::string());
+	if (!LoadTestZone(TestZoneDesc(), context, geom))
+	{
+		printf("  couldn't load the zone\n");
+		return;
+	}
+
+	for (int threads : { 1, 2, 4, 8 })
+	{
+		for (int mode = 0; mode < 2; ++mode)
+		{
+			const bool arenas = mode == 1;
+			TileBuildArena::SetEnabled(arenas);
+			TileBuildArena::ResetCounts();
+
+			Sample_TileMesh mesh;
+			Clock::time_point start = Clock::now();
+			bool built = BuildTestMesh(mesh, geom, context, threads);
+			Clock::duration elapsed = Clock::now() - start;
+
+			if (!built)
+			{
+				printf("  couldn't build the zone on %d threads\n", threads);
+				break;
+			}
+
+			const TileBuildArena::Counts counts = TileBuildArena::GetCounts();
+			const double tiles = mesh.getTilesBuilt();
+			printf("  %d threads, %s: %7.0f ms, %6.0f heap and %6.0f arena allocations per tile\n",
+				threads, arenas ? "arenas" : "heap  ", Milliseconds(elapsed), counts.heap / tiles,
+				counts.arena / tiles);
+		}
+	}
+
+	TileBuildArena::SetEnabled(true);
+}
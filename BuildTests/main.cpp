@@ -0,0 +1,68 @@
+//
+// main.cpp
+//
+// Runs the mesh build tests. Pass test names to run just those, or --bench
+// to run the benchmarks instead (all of them, or the ones named after it).
+//
+
+#include "Test.h"
+
+#include <cstdio>
+#include <cstring>
+
+static int s_failures = 0;
+
+std::vector<TestCase>& GetTests()
+{
+	static std::vector<TestCase> tests;
+	return tests;
+}
+
+std::vector<TestCase>& GetBenchmarks()
+{
+	static std::vector<TestCase> benchmarks;
+	return benchmarks;
+}
+
+void ReportFailure(const char* file, int line, const char* expression)
+{
+	printf("  %s(%d): CHECK(%s) failed\n", file, line, expression);
+	s_failures++;
+}
+
+int main(int argc, char* argv[])
+{
+	const std::vector<TestCase>* cases = &GetTests();
+	int first = 1;
+
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+	{
+		cases = &GetBenchmarks();
+		first = 2;
+	}
+
+	int failedTests = 0;
+	int ranTests = 0;
+
+	for (const TestCase& test : *cases)
+	{
+		bool selected = argc <= first;
+		for (int i = first; i < argc && !selected; ++i)
+			selected = strcmp(argv[i], test.name) == 0;
+		if (!selected)
+			continue;
+
+		printf("%s\n", test.name);
+
+		int failuresBefore = s_failures;
+		test.run();
+		ranTests++;
+
+		if (s_failures != failuresBefore)
+			failedTests++;
+	}
+
+	if (cases == &GetTests())
+		printf("%d of %d tests passed\n", ranTests - failedTests, ranTests);
+	return failedTests == 0 ? 0 : 1;
+}
@@ -0,0 +1,495 @@
+//
+// FileWatcher.cpp
+//
+
+#include "FileWatcher.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <cerrno>
+#include <sys/inotify.h>
+#endif
+
+#include <cstring>
+
+//----------------------------------------------------------------------------
+
+namespace
+{
+	std::string GetDirectory(const std::string& filename)
+	{
+		size_t pos = filename.find_last_of("\\/");
+		return pos == std::string::npos ? "." : filename.substr(0, pos);
+	}
+
+	std::string GetLeafName(const std::string& filename)
+	{
+		size_t pos = filename.find_last_of("\\/");
+		return pos == std::string::npos ? filename : filename.substr(pos + 1);
+	}
+
+#if defined(_WIN32)
+	FileWriteTime ToWriteTime(const FILETIME& fileTime)
+	{
+		return static_cast<FileWriteTime>(fileTime.dwHighDateTime) << 32 | fileTime.dwLowDateTime;
+	}
+#else
+	FileWriteTime ToWriteTime(const struct stat& info)
+	{
+		return static_cast<FileWriteTime>(info.st_mtim.tv_sec) * 1000000000
+			+ static_cast<FileWriteTime>(info.st_mtim.tv_nsec);
+	}
+#endif
+}
+
+bool GetFileWriteTime(const std::string& filename, FileWriteTime& writeTime)
+{
+#if defined(_WIN32)
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(filename.c_str(), GetFileExInfoStandard, &data))
+		return false;
+
+	writeTime = ToWriteTime(data.ftLastWriteTime);
+	return true;
+#else
+	struct stat info;
+	if (stat(filename.c_str(), &info) != 0)
+		return false;
+
+	writeTime = ToWriteTime(info);
+	return true;
+#endif
+}
+
+//----------------------------------------------------------------------------
+
+namespace
+{
+
+#if defined(_WIN32)
+
+// ReadDirectoryChangesW on the file's directory
+class DirectoryChangesBackend : public FileWatchBackend
+{
+public:
+	DirectoryChangesBackend()
+	{
+		memset(&m_overlapped, 0, sizeof(m_overlapped));
+	}
+
+	~DirectoryChangesBackend()
+	{
+		Stop();
+	}
+
+	virtual bool Start(const std::string& filename) override
+	{
+		Stop();
+
+		// notifications report names relative to the directory, in utf-16
+		std::string leafName = GetLeafName(filename);
+
+		int length = MultiByteToWideChar(CP_ACP, 0, leafName.c_str(), -1, nullptr, 0);
+		if (length <= 0)
+			return false;
+
+		m_leafName.resize(length);
+		MultiByteToWideChar(CP_ACP, 0, leafName.c_str(), -1, &m_leafName[0], length);
+		m_leafName.resize(length - 1);
+
+		m_directory = CreateFileA(GetDirectory(filename).c_str(), FILE_LIST_DIRECTORY,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+			FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+		if (m_directory == INVALID_HANDLE_VALUE)
+			return false;
+
+		if (!m_buffer)
+			m_buffer.reset(new DWORD[NotifyBufferSize / sizeof(DWORD)]);
+
+		return StartRead();
+	}
+
+	virtual void Stop() override
+	{
+		if (m_directory != INVALID_HANDLE_VALUE)
+		{
+			// wait for the cancelled read to finish before the buffer can go away
+			CancelIo(m_directory);
+
+			DWORD bytes = 0;
+			GetOverlappedResult(m_directory, &m_overlapped, &bytes, TRUE);
+
+			CloseHandle(m_directory);
+			m_directory = INVALID_HANDLE_VALUE;
+		}
+	}
+
+	virtual bool CheckForChanges() override
+	{
+		if (m_directory == INVALID_HANDLE_VALUE)
+			return false;
+
+		// checking the overlapped result doesn't make a system call, so this
+		// is cheap to do every pulse.
+		if (!HasOverlappedIoCompleted(&m_overlapped))
+			return false;
+
+		bool changed = ReadNotifications();
+
+		// if it can't be restarted, we won't hear about anything else
+		if (!StartRead())
+			Stop();
+
+		return changed;
+	}
+
+	virtual bool IsNative() const override { return true; }
+
+private:
+	static const DWORD NotifyBufferSize = 16 * 1024;
+
+	static const DWORD NotifyFilter = FILE_NOTIFY_CHANGE_FILE_NAME
+		| FILE_NOTIFY_CHANGE_LAST_WRITE
+		| FILE_NOTIFY_CHANGE_SIZE;
+
+	bool StartRead()
+	{
+		memset(&m_overlapped, 0, sizeof(m_overlapped));
+
+		return ReadDirectoryChangesW(m_directory, m_buffer.get(), NotifyBufferSize, FALSE,
+			NotifyFilter, NULL, &m_overlapped, NULL) != FALSE;
+	}
+
+	bool ReadNotifications()
+	{
+		DWORD bytes = 0;
+
+		// If the read failed, or there were more changes than fit in the
+		// buffer, we don't know what changed. Assume it was our file.
+		if (!GetOverlappedResult(m_directory, &m_overlapped, &bytes, FALSE) || bytes == 0)
+			return true;
+
+		const BYTE* data = reinterpret_cast<const BYTE*>(m_buffer.get());
+
+		for (;;)
+		{
+			const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(data);
+			size_t length = info->FileNameLength / sizeof(WCHAR);
+
+			if (length == m_leafName.length()
+				&& _wcsnicmp(info->FileName, m_leafName.c_str(), length) == 0)
+			{
+				return true;
+			}
+
+			if (info->NextEntryOffset == 0)
+				break;
+			data += info->NextEntryOffset;
+		}
+
+		return false;
+	}
+
+	std::wstring m_leafName;
+	HANDLE m_directory = INVALID_HANDLE_VALUE;
+	OVERLAPPED m_overlapped;
+	std::unique_ptr<DWORD[]> m_buffer;
+};
+
+#elif defined(__linux__)
+
+// inotify on the file's directory. Watching the directory rather than the
+// file keeps the watch working when the file is replaced by a rename.
+class InotifyBackend : public FileWatchBackend
+{
+public:
+	~InotifyBackend()
+	{
+		Stop();
+	}
+
+	virtual bool Start(const std::string& filename) override
+	{
+		Stop();
+
+		m_leafName = GetLeafName(filename);
+
+		m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (m_fd < 0)
+			return false;
+
+		if (inotify_add_watch(m_fd, GetDirectory(filename).c_str(), NotifyMask) < 0)
+		{
+			Stop();
+			return false;
+		}
+
+		return true;
+	}
+
+	virtual void Stop() override
+	{
+		if (m_fd >= 0)
+		{
+			close(m_fd);
+			m_fd = -1;
+		}
+	}
+
+	virtual bool CheckForChanges() override
+	{
+		if (m_fd < 0)
+			return false;
+
+		bool changed = false;
+
+		// the descriptor is non-blocking, read until there is nothing left
+		for (;;)
+		{
+			ssize_t bytes = read(m_fd, m_buffer, sizeof(m_buffer));
+			if (bytes < 0)
+			{
+				// anything but running out of events means we can't rely on
+				// the watch any more. Assume it was our file.
+				if (errno != EAGAIN && errno != EWOULDBLOCK)
+				{
+					Stop();
+					changed = true;
+				}
+				break;
+			}
+
+			for (ssize_t offset = 0; offset < bytes;)
+			{
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(m_buffer + offset);
+
+				// events were dropped, we don't know what changed
+				if (event->mask & IN_Q_OVERFLOW)
+					changed = true;
+				else if (event->len > 0 && m_leafName == event->name)
+					changed = true;
+
+				offset += sizeof(inotify_event) + event->len;
+			}
+		}
+
+		return changed;
+	}
+
+	virtual bool IsNative() const override { return true; }
+
+private:
+	static const uint32_t NotifyMask = IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB
+		| IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+
+	std::string m_leafName;
+	int m_fd = -1;
+	alignas(inotify_event) char m_buffer[16 * 1024];
+};
+
+#endif
+
+// Checks the file time every interval. Works everywhere, but a change can
+// take up to an interval to be noticed.
+class PollingBackend : public FileWatchBackend
+{
+public:
+	explicit PollingBackend(std::chrono::milliseconds interval)
+		: m_interval(interval)
+	{
+	}
+
+	virtual bool Start(const std::string& filename) override
+	{
+		m_filename = filename;
+		m_lastPoll = clock::now();
+
+		m_exists = GetFileWriteTime(m_filename, m_writeTime);
+		return true;
+	}
+
+	virtual void Stop() override
+	{
+		m_filename.clear();
+	}
+
+	virtual bool CheckForChanges() override
+	{
+		if (m_filename.empty())
+			return false;
+
+		clock::time_point now = clock::now();
+		if (now - m_lastPoll < m_interval)
+			return false;
+
+		m_lastPoll = now;
+
+		FileWriteTime writeTime = 0;
+		bool exists = GetFileWriteTime(m_filename, writeTime);
+
+		if (exists == m_exists && writeTime == m_writeTime)
+			return false;
+
+		m_exists = exists;
+		m_writeTime = writeTime;
+		return true;
+	}
+
+	virtual bool IsNative() const override { return false; }
+
+private:
+	typedef std::chrono::steady_clock clock;
+
+	std::string m_filename;
+	std::chrono::milliseconds m_interval;
+	clock::time_point m_lastPoll;
+
+	bool m_exists = false;
+	FileWriteTime m_writeTime = 0;
+};
+
+} // namespace
+
+std::unique_ptr<FileWatchBackend> CreateNativeFileWatchBackend()
+{
+#if defined(_WIN32)
+	return std::make_unique<DirectoryChangesBackend>();
+#elif defined(__linux__)
+	return std::make_unique<InotifyBackend>();
+#else
+	return nullptr;
+#endif
+}
+
+std::unique_ptr<FileWatchBackend> CreatePollingFileWatchBackend(std::chrono::milliseconds interval)
+{
+	return std::make_unique<PollingBackend>(interval);
+}
+
+//----------------------------------------------------------------------------
+
+FileWatcher::FileWatcher()
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+	Stop();
+}
+
+void FileWatcher::Watch(const std::string& filename, FileWriteTime writeTime)
+{
+	Stop();
+
+	m_filename = filename;
+	m_writeTime = writeTime;
+
+	// if notifications aren't available (network share, etc), fall back to
+	// checking the file time.
+	if (m_useNotifications)
+		m_backend = CreateNativeFileWatchBackend();
+
+	if (!m_backend || !m_backend->Start(m_filename))
+	{
+		m_backend = CreatePollingFileWatchBackend(m_pollInterval);
+		m_backend->Start(m_filename);
+	}
+
+	// the file may have changed again before we started watching it
+	FileWriteTime currentTime = 0;
+	if (GetFileWriteTime(m_filename, currentTime) && currentTime != m_writeTime)
+	{
+		m_changePending = true;
+		m_lastChange = clock::now();
+	}
+}
+
+void FileWatcher::Stop()
+{
+	if (m_backend)
+	{
+		m_backend->Stop();
+		m_backend.reset();
+	}
+
+	m_filename.clear();
+	m_changePending = false;
+}
+
+bool FileWatcher::Poll()
+{
+	if (m_filename.empty())
+		return false;
+
+	clock::time_point now = clock::now();
+
+	if (m_backend->CheckForChanges())
+	{
+		m_changePending = true;
+		m_lastChange = now;
+	}
+
+	if (!m_changePending || now - m_lastChange < m_debounce)
+		return false;
+
+	// the writer may still have the file open even after it has been quiet
+	// for a bit (or it was deleted and not yet replaced). Try again later.
+	FileWriteTime writeTime;
+	if (!IsFileComplete(writeTime))
+	{
+		m_lastChange = now;
+		return false;
+	}
+
+	m_changePending = false;
+
+	// touched, but not modified
+	if (writeTime == m_writeTime)
+		return false;
+
+	m_writeTime = writeTime;
+	return true;
+}
+
+bool FileWatcher::IsFileComplete(FileWriteTime& writeTime) const
+{
+#if defined(_WIN32)
+	// Denying write access fails while anything still has the file open for
+	// writing. MeshGenerator writes a new file and renames it into place, so
+	// share delete access to not get in the way of that.
+	HANDLE hFile = CreateFileA(m_filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, 0, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	FILETIME fileTime;
+	bool result = GetFileTime(hFile, NULL, NULL, &fileTime) != FALSE;
+	CloseHandle(hFile);
+
+	if (result)
+		writeTime = ToWriteTime(fileTime);
+	return result;
+#else
+	// There's no way to ask whether someone still has the file open for
+	// writing here, so this relies on the debounce (and on the file being
+	// renamed into place, like WriteNavMeshFile does).
+	int fd = open(m_filename.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	bool result = fstat(fd, &info) == 0;
+	close(fd);
+
+	if (result)
+		writeTime = ToWriteTime(info);
+	return result;
+#endif
+}
@@ -0,0 +1,105 @@
+//
+// FileWatcher.h
+//
+// Watches a single file for changes. Uses directory change notifications
+// where they are available (ReadDirectoryChangesW on Windows, inotify on
+// Linux), and falls back to checking the file time.
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+//----------------------------------------------------------------------------
+
+// Last write time of a file, in the platform's own units. Only ever compared
+// with another one for the same file.
+typedef uint64_t FileWriteTime;
+
+// False if the file doesn't exist or can't be checked.
+bool GetFileWriteTime(const std::string& filename, FileWriteTime& writeTime);
+
+// Something that tells the watcher when the file might have changed. It
+// doesn't have to be exact: reporting a change that didn't happen only costs
+// a check of the file time, but a change it misses isn't seen at all.
+class FileWatchBackend
+{
+public:
+	virtual ~FileWatchBackend() {}
+
+	// False if this backend can't watch the file (no notifications on a
+	// network share, etc).
+	virtual bool Start(const std::string& filename) = 0;
+	virtual void Stop() = 0;
+
+	// Returns true if the file may have changed since the last call. Called
+	// every pulse, so it can't block.
+	virtual bool CheckForChanges() = 0;
+
+	// true if the backend is using change notifications rather than polling
+	virtual bool IsNative() const = 0;
+};
+
+// The backend for the platform's change notifications, or null if there
+// isn't one.
+std::unique_ptr<FileWatchBackend> CreateNativeFileWatchBackend();
+
+// Checks the file time every interval.
+std::unique_ptr<FileWatchBackend> CreatePollingFileWatchBackend(std::chrono::milliseconds interval);
+
+//----------------------------------------------------------------------------
+
+class FileWatcher
+{
+public:
+	FileWatcher();
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	// start watching a file. writeTime is the write time of the version of
+	// the file that we already have, anything else counts as a change.
+	void Watch(const std::string& filename, FileWriteTime writeTime);
+
+	// stop watching
+	void Stop();
+
+	bool IsWatching() const { return !m_filename.empty(); }
+
+	// returns true if the watcher is using change notifications rather than
+	// polling the file.
+	bool IsNative() const { return m_backend && m_backend->IsNative(); }
+
+	// Call periodically. Returns true (once) when the file has changed and
+	// has finished being written. A change is only reported after the file
+	// has been quiet for the debounce interval and can be opened without a
+	// writer holding it.
+	bool Poll();
+
+	void SetDebounceInterval(std::chrono::milliseconds interval) { m_debounce = interval; }
+
+	// These take effect on the next Watch().
+	void SetPollInterval(std::chrono::milliseconds interval) { m_pollInterval = interval; }
+	void SetUseNotifications(bool useNotifications) { m_useNotifications = useNotifications; }
+
+private:
+	bool IsFileComplete(FileWriteTime& writeTime) const;
+
+	typedef std::chrono::steady_clock clock;
+
+	std::string m_filename;
+	FileWriteTime m_writeTime = 0;
+
+	std::unique_ptr<FileWatchBackend> m_backend;
+	bool m_useNotifications = true;
+	std::chrono::milliseconds m_pollInterval{ 1000 };
+
+	// debouncing
+	bool m_changePending = false;
+	clock::time_point m_lastChange;
+	std::chrono::milliseconds m_debounce{ 500 };
+};
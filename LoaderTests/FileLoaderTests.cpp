@@ -0,0 +1,385 @@
+//
+// FileLoaderTests.cpp
+//
+// Tests for NavMeshFileLoader: loading in the background without holding up
+// the game thread, reloading only what changed, and files being replaced
+// while they are in use.
+//
+
+#include "Test.h"
+#include "TestMesh.h"
+
+#include "NavMeshFileLoader.h"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <random>
+#include <thread>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// The longest a pulse may spend in the loader. This is a few frames rather
+// than one, the workers are busy on the same cores and can take the pulse's
+// time slice. Waiting for a worker takes the rest of a load, which is far
+// longer (this is checked below).
+const std::chrono::milliseconds PULSE_BUDGET(50);
+
+const int ZONE_SWITCHES = 100;
+
+template <typename Func>
+Clock::duration Time(Func func)
+{
+	Clock::time_point start = Clock::now();
+	func();
+	return Clock::now() - start;
+}
+
+long long Milliseconds(Clock::duration duration)
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+}
+
+struct TestFile
+{
+	std::string filename;
+	TestMeshDesc desc;
+};
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+// Zone over and over, mostly before the last zone's mesh has finished loading,
+// the way someone running through zone lines does. Nothing the game thread
+// calls (starting a load, polling for it, cancelling it) may wait for the
+// worker.
+TEST(PulseNeverBlocksWhileZoning)
+{
+	TestMeshDesc small;
+	TestMeshDesc large;
+	large.tilesX = 32;
+	large.tilesY = 32;
+	large.quadsPerTile = 16;
+
+	std::vector<TestFile> files = {
+		{ GetTestFilePath("pulse_small.bin"), small },
+		{ GetTestFilePath("pulse_large.bin"), large },
+		{ GetTestFilePath("pulse_large_v2.bin"), large },
+	};
+
+	CHECK(WriteTestMeshFile(files[0].filename, files[0].desc));
+	CHECK(WriteTestMeshFile(files[1].filename, files[1].desc));
+	CHECK(WriteTestMeshFile(files[2].filename, files[2].desc, NAVMESHSET_VERSION_RAW));
+
+	// the budget only means something if a load takes longer than it
+	std::atomic<bool> cancel(false);
+	Clock::duration loadTime = Time([&]()
+	{
+		NavMeshFileLoader::LoadMeshFile(files[1].filename, NavMeshFileLoader::LoadOptions(), cancel);
+	});
+	CHECK(loadTime > 2 * PULSE_BUDGET);
+
+	NavMeshFileLoader loader;
+	std::mt19937 random(1234);
+
+	Clock::duration worst = Clock::duration::zero();
+	int completed = 0;
+	int mostAbandoned = 0;
+
+	for (int i = 0; i < ZONE_SWITCHES; ++i)
+	{
+		const TestFile& file = files[i % files.size()];
+
+		NavMeshFileLoader::LoadOptions options;
+		options.mapFile = (i & 1) != 0;
+		options.lazyTiles = (i & 2) != 0;
+
+		worst = std::max(worst, Time([&]() { loader.StartLoad(file.filename, options); }));
+		mostAbandoned = std::max(mostAbandoned, loader.GetAbandonedCount());
+
+		// zone again after a few pulses most of the time, and now and then
+		// stay long enough for the load to finish.
+		bool stay = i % 4 == 3;
+		int pulses = stay ? INT_MAX : static_cast<int>(random() % 5);
+
+		for (int pulse = 0; pulse < pulses && loader.IsLoading(); ++pulse)
+		{
+			std::shared_ptr<NavMeshFileLoader::LoadedMesh> loaded;
+			worst = std::max(worst, Time([&]() { loaded = loader.Poll(); }));
+
+			if (loaded)
+			{
+				int tileCount = file.desc.tilesX * file.desc.tilesY;
+
+				CHECK(loaded->result == NavMeshFileLoader::SUCCESS);
+				CHECK(loaded->mesh != nullptr);
+				CHECK(options.lazyTiles
+					? static_cast<int>(loaded->tiles.size()) == tileCount
+					: loaded->loadedTiles == tileCount);
+				completed++;
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	worst = std::max(worst, Time([&]() { loader.Cancel(); }));
+
+	printf("  %d loads finished, %d abandoned, slowest call %lld ms (a load takes %lld ms)\n",
+		completed, ZONE_SWITCHES - completed, Milliseconds(worst), Milliseconds(loadTime));
+
+	CHECK(completed >= ZONE_SWITCHES / 4);
+	CHECK(worst < PULSE_BUDGET);
+
+	// zoning while a load is running leaves it to finish in the background,
+	// if it never does then the cancel waited for it.
+	CHECK(mostAbandoned > 0);
+
+	// the abandoned workers still have to stop on their own
+	Clock::time_point deadline = Clock::now() + std::chrono::seconds(10);
+	while (loader.GetAbandonedCount() > 0 && Clock::now() < deadline)
+	{
+		loader.Poll();
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	CHECK(loader.GetAbandonedCount() == 0);
+
+	for (const TestFile& file : files)
+		remove(file.filename.c_str());
+}
+
+// Reloading a file that hasn't changed shouldn't replace any tiles. Version 2
+// tiles are used in place and have no stored checksum, so this only works if
+// the checksums are taken before detour writes its links into the tiles.
+TEST(UnchangedFileReloadsNoTiles)
+{
+	const int versions[] = { NAVMESHSET_VERSION_RAW, NAVMESHSET_VERSION };
+
+	for (int version : versions)
+	{
+		TestMeshDesc desc;
+		std::string filename = GetTestFilePath("unchanged.bin");
+		CHECK(WriteTestMeshFile(filename, desc, version));
+
+		std::atomic<bool> cancel(false);
+		NavMeshFileLoader::LoadOptions options;
+
+		auto loaded = NavMeshFileLoader::LoadMeshFile(filename, options, cancel);
+		CHECK(loaded->result == NavMeshFileLoader::SUCCESS);
+		CHECK(static_cast<int>(loaded->tileHashes.size()) == desc.tilesX * desc.tilesY);
+		if (loaded->result != NavMeshFileLoader::SUCCESS)
+			continue;
+
+		auto update = NavMeshFileLoader::LoadMeshFileUpdate(filename, loaded->tileHashes,
+			*loaded->mesh->getParams(), options, cancel);
+		CHECK(update->result == NavMeshFileLoader::SUCCESS);
+		CHECK(update->update);
+		CHECK(update->changedTiles.empty());
+		CHECK(update->removedTiles.empty());
+
+		remove(filename.c_str());
+	}
+}
+
+// The mesh generator saves over a mesh that the plugin has mapped. The save
+// has to succeed, and the loaded mesh has to keep working from the old file
+// until the new one is loaded.
+TEST(MappedFileCanBeReplaced)
+{
+	TestMeshDesc before;
+	TestMeshDesc after;
+	after.tilesX = 4;
+
+	std::string filename = GetTestFilePath("replaced.bin");
+
+	// version 2 tiles are used straight from the mapped pages
+	CHECK(WriteTestMeshFile(filename, before, NAVMESHSET_VERSION_RAW));
+
+	std::atomic<bool> cancel(false);
+	NavMeshFileLoader::LoadOptions options;
+	options.mapFile = true;
+
+	auto loaded = NavMeshFileLoader::LoadMeshFile(filename, options, cancel);
+	CHECK(loaded->result == NavMeshFileLoader::SUCCESS);
+	if (loaded->result != NavMeshFileLoader::SUCCESS)
+		return;
+
+	CHECK(WriteTestMeshFile(filename, after, NAVMESHSET_VERSION_RAW));
+
+	// the last tile is one that the new file doesn't have
+	dtNavMeshQuery query;
+	CHECK(dtStatusSucceed(query.init(loaded->mesh.get(), 256)));
+
+	float center[3];
+	GetTileCenter(before, before.tilesX - 1, before.tilesY - 1, center);
+	const float extents[3] = { 1.0f, 2.0f, 1.0f };
+	dtQueryFilter filter;
+	dtPolyRef ref = 0;
+	float nearest[3];
+
+	CHECK(dtStatusSucceed(query.findNearestPoly(center, extents, &filter, &ref, nearest)));
+	CHECK(ref != 0);
+
+	loaded.reset();
+
+	auto reloaded = NavMeshFileLoader::LoadMeshFile(filename, options, cancel);
+	CHECK(reloaded->result == NavMeshFileLoader::SUCCESS);
+	CHECK(reloaded->loadedTiles == after.tilesX * after.tilesY);
+	reloaded.reset();
+
+	remove(filename.c_str());
+}
+
+// Rebuild a few tiles of a loaded mesh and reload it. Only those tiles may
+// be swapped, they have to match a fresh load of the new file, and refs into
+// the tiles that didn't change have to stay valid the whole time (paths and
+// corridors hold on to them across the reload).
+TEST(UpdateSwapsChangedTiles)
+{
+	TestMeshDesc before;
+	TestMeshDesc after = before;
+	after.tileFlags[0] = 2;
+	after.tileFlags[before.tilesX + 3] = 4;
+	after.tileFlags[before.tilesX * before.tilesY - 1] = 8;
+
+	std::string filename = GetTestFilePath("update.bin");
+	CHECK(WriteTestMeshFile(filename, before));
+
+	std::atomic<bool> cancel(false);
+	NavMeshFileLoader::LoadOptions options;
+
+	auto loaded = NavMeshFileLoader::LoadMeshFile(filename, options, cancel);
+	CHECK(loaded->result == NavMeshFileLoader::SUCCESS);
+	if (loaded->result != NavMeshFileLoader::SUCCESS)
+		return;
+
+	dtNavMesh* mesh = loaded->mesh.get();
+	const float extents[3] = { 1.0f, 2.0f, 1.0f };
+	dtQueryFilter filter;
+
+	auto findPoly = [&](const dtNavMesh* navMesh, int tx, int ty)
+	{
+		dtNavMeshQuery query;
+		query.init(navMesh, 64);
+
+		float center[3], nearest[3];
+		GetTileCenter(before, tx, ty, center);
+		dtPolyRef ref = 0;
+		query.findNearestPoly(center, extents, &filter, &ref, nearest);
+		return ref;
+	};
+
+	std::vector<dtPolyRef> refsBefore;
+	for (int ty = 0; ty < before.tilesY; ++ty)
+	{
+		for (int tx = 0; tx < before.tilesX; ++tx)
+			refsBefore.push_back(findPoly(mesh, tx, ty));
+	}
+
+	CHECK(WriteTestMeshFile(filename, after));
+
+	auto update = NavMeshFileLoader::LoadMeshFileUpdate(filename, loaded->tileHashes,
+		*mesh->getParams(), options, cancel);
+	CHECK(update->result == NavMeshFileLoader::SUCCESS);
+	CHECK(update->update);
+	CHECK(update->changedTiles.size() == after.tileFlags.size());
+	CHECK(update->removedTiles.empty());
+
+	std::vector<std::string> messages;
+	int updated = NavMeshFileLoader::ApplyTileUpdate(*mesh, *update, loaded->tileHashes, messages);
+	CHECK(updated == static_cast<int>(after.tileFlags.size()));
+	CHECK(messages.empty());
+	CHECK(static_cast<int>(loaded->tileHashes.size()) == before.tilesX * before.tilesY);
+
+	auto fresh = NavMeshFileLoader::LoadMeshFile(filename, options, cancel);
+	CHECK(fresh->result == NavMeshFileLoader::SUCCESS);
+	if (fresh->result != NavMeshFileLoader::SUCCESS)
+		return;
+
+	for (int ty = 0; ty < before.tilesY; ++ty)
+	{
+		for (int tx = 0; tx < before.tilesX; ++tx)
+		{
+			int index = ty * before.tilesX + tx;
+			dtPolyRef ref = refsBefore[index];
+
+			// every tile kept its ref, changed or not
+			CHECK(mesh->isValidPolyRef(ref));
+			CHECK(findPoly(mesh, tx, ty) == ref);
+			CHECK(findPoly(fresh->mesh.get(), tx, ty) == ref);
+
+			unsigned short flags = 0, freshFlags = 0;
+			mesh->getPolyFlags(ref, &flags);
+			fresh->mesh->getPolyFlags(ref, &freshFlags);
+			CHECK(flags == freshFlags);
+
+			auto changed = after.tileFlags.find(index);
+			CHECK(flags == (changed != after.tileFlags.end() ? changed->second : 1));
+		}
+	}
+
+	// the tiles are linked to their neighbours again. Walk from one corner to
+	// the other, across both of the rebuilt corner tiles.
+	dtNavMeshQuery query;
+	CHECK(dtStatusSucceed(query.init(mesh, 2048)));
+
+	float start[3], end[3];
+	GetTileCenter(before, 0, 0, start);
+	GetTileCenter(before, before.tilesX - 1, before.tilesY - 1, end);
+
+	dtPolyRef path[256];
+	int pathCount = 0;
+	CHECK(dtStatusSucceed(query.findPath(refsBefore.front(), refsBefore.back(), start, end,
+		&filter, path, &pathCount, 256)));
+	CHECK(pathCount > 0 && path[pathCount - 1] == refsBefore.back());
+
+	fresh.reset();
+	loaded.reset();
+	remove(filename.c_str());
+}
+
+// A reload that can't swap tiles (here the mesh got bigger) loads the whole
+// file instead, and has to do it with the options the mesh was loaded with.
+TEST(UpdateFallsBackWithLoadOptions)
+{
+	TestMeshDesc before;
+	TestMeshDesc after;
+	after.tilesX = 16;
+	after.tilesY = 16;
+
+	std::string filename = GetTestFilePath("fallback.bin");
+	CHECK(WriteTestMeshFile(filename, before));
+
+	std::atomic<bool> cancel(false);
+	NavMeshFileLoader::LoadOptions options;
+
+	auto loaded = NavMeshFileLoader::LoadMeshFile(filename, options, cancel);
+	CHECK(loaded->result == NavMeshFileLoader::SUCCESS);
+	if (loaded->result != NavMeshFileLoader::SUCCESS)
+		return;
+
+	CHECK(WriteTestMeshFile(filename, after));
+
+	options.mapFile = true;
+	options.lazyTiles = true;
+
+	auto update = NavMeshFileLoader::LoadMeshFileUpdate(filename, loaded->tileHashes,
+		*loaded->mesh->getParams(), options, cancel);
+	CHECK(update->result == NavMeshFileLoader::SUCCESS);
+	CHECK(!update->update);
+	CHECK(update->lazy);
+	CHECK(update->reader != nullptr);
+	CHECK(static_cast<int>(update->tiles.size()) == after.tilesX * after.tilesY);
+
+	update.reset();
+	loaded.reset();
+	remove(filename.c_str());
+}
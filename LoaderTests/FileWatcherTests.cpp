@@ -0,0 +1,134 @@
+//
+// FileWatcherTests.cpp
+//
+// Tests for FileWatcher: a mesh file that is saved several times in quick
+// succession is picked up once, after the last save.
+//
+
+#include "Test.h"
+#include "TestMesh.h"
+
+#include "FileWatcher.h"
+#include "NavMeshFileLoader.h"
+
+#include "DetourNavMesh.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const std::chrono::milliseconds DEBOUNCE(200);
+const std::chrono::milliseconds POLL_INTERVAL(50);
+
+// the plugin checks every pulse, this is close enough
+const std::chrono::milliseconds PULSE(10);
+
+// time between saves, well inside the debounce interval
+const std::chrono::milliseconds SAVE_INTERVAL(30);
+
+// tiles that each save changes, on top of the ones before it
+const int CHANGED_TILES[] = { 3, 10, 20 };
+const int SAVES = sizeof(CHANGED_TILES) / sizeof(CHANGED_TILES[0]);
+
+// How long to keep polling after the last save. Long enough for a second
+// reload to show up if there was going to be one.
+const std::chrono::milliseconds SETTLE_TIME(1500);
+
+// Save the file SAVES times while pulsing the watcher, then keep pulsing for
+// a while. Returns the number of reloads, and the tiles the last one changed.
+int CountReloads(bool useNotifications, int& changedTiles)
+{
+	TestMeshDesc desc;
+	std::string filename = GetTestFilePath("watched.bin");
+	CHECK(WriteTestMeshFile(filename, desc));
+
+	std::atomic<bool> cancel(false);
+	NavMeshFileLoader::LoadOptions options;
+
+	auto loaded = NavMeshFileLoader::LoadMeshFile(filename, options, cancel);
+	CHECK(loaded->result == NavMeshFileLoader::SUCCESS);
+	if (loaded->result != NavMeshFileLoader::SUCCESS)
+		return -1;
+
+	FileWriteTime writeTime = 0;
+	CHECK(GetFileWriteTime(filename, writeTime));
+
+	FileWatcher watcher;
+	watcher.SetDebounceInterval(DEBOUNCE);
+	watcher.SetPollInterval(POLL_INTERVAL);
+	watcher.SetUseNotifications(useNotifications);
+	watcher.Watch(filename, writeTime);
+
+	CHECK(watcher.IsWatching());
+	CHECK(watcher.IsNative() == useNotifications);
+
+	int reloads = 0;
+	changedTiles = 0;
+
+	auto pulse = [&]()
+	{
+		if (!watcher.Poll())
+			return;
+
+		// what NavMeshLoader does when the watcher fires
+		reloads++;
+
+		auto update = NavMeshFileLoader::LoadMeshFileUpdate(filename, loaded->tileHashes,
+			*loaded->mesh->getParams(), options, cancel);
+		CHECK(update->result == NavMeshFileLoader::SUCCESS);
+		changedTiles = static_cast<int>(update->changedTiles.size());
+	};
+
+	for (int save = 0; save < SAVES; ++save)
+	{
+		desc.tileFlags[CHANGED_TILES[save]] = 2;
+		CHECK(WriteTestMeshFile(filename, desc));
+
+		Clock::time_point next = Clock::now() + SAVE_INTERVAL;
+		while (Clock::now() < next)
+		{
+			pulse();
+			std::this_thread::sleep_for(PULSE);
+		}
+	}
+
+	Clock::time_point end = Clock::now() + SETTLE_TIME;
+	while (Clock::now() < end)
+	{
+		pulse();
+		std::this_thread::sleep_for(PULSE);
+	}
+
+	watcher.Stop();
+	remove(filename.c_str());
+
+	return reloads;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+// Each save writes a new file and renames it over the old one. All of the
+// saves land inside one debounce interval, so they're one reload, and that
+// reload sees every tile they changed.
+TEST(RewrittenFileReloadsOnce)
+{
+	int changedTiles = 0;
+	CHECK(CountReloads(true, changedTiles) == 1);
+	CHECK(changedTiles == SAVES);
+}
+
+// Same, with the file time checked every interval instead of notifications
+// (what happens on a network share).
+TEST(PolledFileReloadsOnce)
+{
+	int changedTiles = 0;
+	CHECK(CountReloads(false, changedTiles) == 1);
+	CHECK(changedTiles == SAVES);
+}
@@ -0,0 +1,374 @@
+//
+// LoadBenchmark.cpp
+//
+
+#include "LoadBenchmark.h"
+#include "TestMesh.h"
+
+#include "NavMeshFileLoader.h"
+#include "NavMeshFile.h"
+#include "NavMeshTileResidency.h"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#pragma comment (lib, "psapi.lib")
+#else
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double Milliseconds(Clock::duration duration)
+{
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+// Memory the process is using right now, and the most it has used. The peak
+// covers the whole run, so only one kind of load should be measured per run.
+size_t GetResidentBytes()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.WorkingSetSize;
+#else
+	long pages = 0, resident = 0;
+	FILE* fp = fopen("/proc/self/statm", "r");
+	if (!fp)
+		return 0;
+	if (fscanf(fp, "%ld %ld", &pages, &resident) != 2)
+		resident = 0;
+	fclose(fp);
+	return static_cast<size_t>(resident) * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+size_t GetPeakResidentBytes()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.PeakWorkingSetSize;
+#else
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+	return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+double Megabytes(size_t bytes)
+{
+	return bytes / (1024.0 * 1024.0);
+}
+
+// Get the file out of the system's file cache, so that the next load has to
+// read it from the disk. This is best effort: Windows drops a file's cached
+// pages when it is opened unbuffered, Linux when it is asked to.
+bool DropFileCache(const std::string& filename)
+{
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	CloseHandle(file);
+	return true;
+#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	// dirty pages aren't dropped, and a file that was just written has them
+	fdatasync(fd);
+	bool result = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+	close(fd);
+	return result;
+#endif
+}
+
+size_t GetFileBytes(const std::string& filename)
+{
+	FILE* fp = fopen(filename.c_str(), "rb");
+	if (!fp)
+		return 0;
+
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fclose(fp);
+
+	return size > 0 ? static_cast<size_t>(size) : 0;
+}
+
+// Answer one query on a freshly loaded mesh, the first thing the plugin does
+// with it. Returns false if there was nothing to find.
+bool RunFirstQuery(const dtNavMesh& mesh)
+{
+	const dtMeshTile* first = nullptr;
+	for (int i = 0; i < mesh.getMaxTiles() && !first; ++i)
+	{
+		const dtMeshTile* tile = mesh.getTile(i);
+		if (tile && tile->header)
+			first = tile;
+	}
+	if (!first)
+		return false;
+
+	float center[3], extents[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		center[i] = (first->header->bmin[i] + first->header->bmax[i]) * 0.5f;
+		extents[i] = (first->header->bmax[i] - first->header->bmin[i]) * 0.5f;
+	}
+
+	dtNavMeshQuery query;
+	if (dtStatusFailed(query.init(&mesh, 2048)))
+		return false;
+
+	dtQueryFilter filter;
+	dtPolyRef ref = 0;
+	float nearest[3];
+
+	return dtStatusSucceed(query.findNearestPoly(center, extents, &filter, &ref, nearest)) && ref != 0;
+}
+
+// Load the old file, then time picking up the new one: loading it whole
+// (what the plugin did on every change) against loading only the tiles that
+// changed and swapping them into the old mesh.
+int RunReloadBenchmark(const std::string& oldFile, const std::string& newFile)
+{
+	std::atomic<bool> cancel(false);
+	NavMeshFileLoader::LoadOptions options;
+
+	auto loaded = NavMeshFileLoader::LoadMeshFile(oldFile, options, cancel);
+	if (loaded->result != NavMeshFileLoader::SUCCESS)
+	{
+		printf("%s: failed to load (%d)\n", oldFile.c_str(), loaded->result);
+		return 1;
+	}
+
+	Clock::time_point wholeStart = Clock::now();
+	auto whole = NavMeshFileLoader::LoadMeshFile(newFile, options, cancel);
+	Clock::time_point wholeLoaded = Clock::now();
+
+	if (whole->result != NavMeshFileLoader::SUCCESS)
+	{
+		printf("%s: failed to load (%d)\n", newFile.c_str(), whole->result);
+		return 1;
+	}
+	whole.reset();
+
+	Clock::time_point updateStart = Clock::now();
+	auto update = NavMeshFileLoader::LoadMeshFileUpdate(newFile, loaded->tileHashes,
+		*loaded->mesh->getParams(), options, cancel);
+	Clock::time_point updateLoaded = Clock::now();
+
+	if (update->result != NavMeshFileLoader::SUCCESS)
+	{
+		printf("%s: failed to load the changed tiles (%d)\n", newFile.c_str(), update->result);
+		return 1;
+	}
+
+	if (!update->update)
+	{
+		printf("%s: the mesh layout changed, tiles can't be swapped\n", newFile.c_str());
+		return 1;
+	}
+
+	// swapping happens on the game thread, so it is timed on its own
+	std::vector<std::string> messages;
+	Clock::time_point swapStart = Clock::now();
+	int swappedTiles = NavMeshFileLoader::ApplyTileUpdate(*loaded->mesh, *update, loaded->tileHashes, messages);
+	Clock::time_point swapEnd = Clock::now();
+
+	printf("%s -> %s: %d of %d tiles changed, %d removed\n", oldFile.c_str(), newFile.c_str(),
+		static_cast<int>(update->changedTiles.size()), static_cast<int>(loaded->tileHashes.size()),
+		static_cast<int>(update->removedTiles.size()));
+	printf("  full reload %.1f ms, tile reload %.1f ms on the worker + %.1f ms swapping %d tiles in\n",
+		Milliseconds(wholeLoaded - wholeStart), Milliseconds(updateLoaded - updateStart),
+		Milliseconds(swapEnd - swapStart), swappedTiles);
+
+	return messages.empty() ? 0 : 1;
+}
+
+// times each format is loaded once it is in the file cache, the best is kept
+const int WARM_LOADS = 5;
+
+// Write each file out in both formats, and compare their size and how long
+// they take to load, from the disk and from the file cache.
+int RunFormatBenchmark(const std::vector<std::string>& files)
+{
+	struct Format
+	{
+		const char* name;
+		int version;
+	};
+	const Format formats[] = {
+		{ "v2 (raw)", NAVMESHSET_VERSION_RAW },
+		{ "v3 (compressed, checksummed)", NAVMESHSET_VERSION },
+	};
+
+	std::atomic<bool> cancel(false);
+	NavMeshFileLoader::LoadOptions options;
+	int failures = 0;
+
+	for (const std::string& filename : files)
+	{
+		printf("%s:\n", filename.c_str());
+
+		for (const Format& format : formats)
+		{
+			std::string converted = GetTestFilePath("format_v" + std::to_string(format.version) + ".bin");
+			if (!ConvertNavMeshFile(filename, converted, format.version))
+			{
+				printf("  %s: failed to write\n", format.name);
+				failures++;
+				continue;
+			}
+
+			bool dropped = DropFileCache(converted);
+
+			Clock::time_point start = Clock::now();
+			auto loaded = NavMeshFileLoader::LoadMeshFile(converted, options, cancel);
+			Clock::duration cold = Clock::now() - start;
+
+			if (loaded->result != NavMeshFileLoader::SUCCESS)
+			{
+				printf("  %s: failed to load (%d)\n", format.name, loaded->result);
+				failures++;
+				remove(converted.c_str());
+				continue;
+			}
+			loaded.reset();
+
+			Clock::duration warm = Clock::duration::max();
+			for (int i = 0; i < WARM_LOADS; ++i)
+			{
+				start = Clock::now();
+				NavMeshFileLoader::LoadMeshFile(converted, options, cancel);
+				warm = std::min(warm, Clock::now() - start);
+			}
+
+			printf("  %-30s %8.1f KB, cold load %.1f ms%s, warm load %.1f ms\n", format.name,
+				GetFileBytes(converted) / 1024.0, Milliseconds(cold),
+				dropped ? "" : " (still cached)", Milliseconds(warm));
+
+			remove(converted.c_str());
+		}
+	}
+
+	return failures == 0 ? 0 : 1;
+}
+
+} // namespace
+
+int RunLoadBenchmark(int argc, char* argv[])
+{
+	NavMeshFileLoader::LoadOptions options;
+	std::vector<std::string> files;
+	bool reload = false;
+	bool compareFormats = false;
+
+	for (int i = 0; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--map") == 0)
+			options.mapFile = true;
+		else if (strcmp(argv[i], "--read") == 0)
+			options.mapFile = false;
+		else if (strcmp(argv[i], "--lazy") == 0)
+			options.lazyTiles = true;
+		else if (strcmp(argv[i], "--reload") == 0)
+			reload = true;
+		else if (strcmp(argv[i], "--formats") == 0)
+			compareFormats = true;
+		else
+			files.push_back(argv[i]);
+	}
+
+	if (files.empty() || (reload && files.size() != 2))
+	{
+		printf("usage: LoaderTests --bench [--map|--read] [--lazy] <file.bin> ...\n"
+			"       LoaderTests --bench --reload <old.bin> <new.bin>\n"
+			"       LoaderTests --bench --formats <file.bin> ...\n");
+		return 2;
+	}
+
+	if (reload)
+		return RunReloadBenchmark(files[0], files[1]);
+	if (compareFormats)
+		return RunFormatBenchmark(files);
+
+	printf("%s the files%s, %.1f MB in use before loading\n",
+		options.mapFile ? "Mapping" : "Reading", options.lazyTiles ? " with lazy tile loading" : "",
+		Megabytes(GetResidentBytes()));
+
+	std::atomic<bool> cancel(false);
+	int failures = 0;
+
+	for (const std::string& filename : files)
+	{
+		Clock::time_point start = Clock::now();
+
+		auto loaded = NavMeshFileLoader::LoadMeshFile(filename, options, cancel);
+		if (loaded->result != NavMeshFileLoader::SUCCESS)
+		{
+			printf("%s: failed to load (%d)\n", filename.c_str(), loaded->result);
+			failures++;
+			continue;
+		}
+
+		Clock::time_point meshLoaded = Clock::now();
+		int tileCount = loaded->lazy ? static_cast<int>(loaded->tiles.size()) : loaded->loadedTiles;
+
+		// with lazy loading the mesh starts out empty. Bring in the tile
+		// where the query will be, like the plugin does around the character.
+		NavMeshTileResidency residency;
+		if (loaded->lazy && !loaded->tiles.empty())
+		{
+			const dtNavMeshParams* params = loaded->mesh->getParams();
+			const NavMeshFileLoader::TileSlot& slot = loaded->tiles[0];
+			float pos[3] = {
+				params->orig[0] + (slot.x + 0.5f) * params->tileWidth,
+				params->orig[1],
+				params->orig[2] + (slot.y + 0.5f) * params->tileHeight,
+			};
+
+			residency.Attach(loaded->mesh.get(), loaded->reader.get(),
+				std::move(loaded->tiles), std::move(loaded->tileGrid));
+			residency.RequestArea(pos, 0.0f);
+		}
+
+		bool found = RunFirstQuery(*loaded->mesh);
+		Clock::time_point firstQuery = Clock::now();
+
+		if (!found)
+			failures++;
+
+		printf("%s: %d tiles, loaded in %.1f ms, first query %s after %.1f ms, %.1f MB in use\n",
+			filename.c_str(), tileCount, Milliseconds(meshLoaded - start),
+			found ? "answered" : "FAILED", Milliseconds(firstQuery - start),
+			Megabytes(GetResidentBytes()));
+	}
+
+	printf("Peak memory use: %.1f MB\n", Megabytes(GetPeakResidentBytes()));
+
+	return failures == 0 ? 0 : 1;
+}
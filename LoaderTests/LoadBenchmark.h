@@ -0,0 +1,17 @@
+//
+// LoadBenchmark.h
+//
+// Measures loading real mesh files: LoaderTests.exe --bench [--map] [--lazy] <file> ...
+// or reloading one that changed: LoaderTests.exe --bench --reload <old> <new>
+// or the file formats: LoaderTests.exe --bench --formats <file> ...
+//
+
+#pragma once
+
+// Load each file, time how long it takes until the first query on the mesh
+// can be answered, and report the memory used. With --reload, time a full
+// reload of the new file against swapping in only its changed tiles. With
+// --formats, write the files as version 2 and 3 and compare their size and
+// load time, cold (from the disk) and warm. argv holds the arguments after
+// --bench. Returns the exit code.
+int RunLoadBenchmark(int argc, char* argv[]);
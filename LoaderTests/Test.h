@@ -0,0 +1,46 @@
+//
+// Test.h
+//
+// Just enough of a test framework for the loader tests. Tests register
+// themselves with TEST(), and a failed CHECK() reports where it failed and
+// lets the test carry on. Benchmarks register with BENCHMARK(), and only run
+// when they're asked for.
+//
+
+#pragma once
+
+#include <vector>
+
+struct TestCase
+{
+	const char* name;
+	void (*run)();
+};
+
+std::vector<TestCase>& GetTests();
+std::vector<TestCase>& GetBenchmarks();
+
+struct TestRegistrar
+{
+	TestRegistrar(const char* name, void (*run)()) { GetTests().push_back(TestCase{ name, run }); }
+};
+
+struct BenchmarkRegistrar
+{
+	BenchmarkRegistrar(const char* name, void (*run)()) { GetBenchmarks().push_back(TestCase{ name, run }); }
+};
+
+void ReportFailure(const char* file, int line, const char* expression);
+
+#define TEST(name) \
+	static void name(); \
+	static TestRegistrar name##_registrar(#name, &name); \
+	static void name()
+
+#define BENCHMARK(name) \
+	static void name(); \
+	static BenchmarkRegistrar name##_registrar(#name, &name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) ReportFailure(__FILE__, __LINE__, #expression); } while (0)
@@ -0,0 +1,231 @@
+//
+// TestMesh.cpp
+//
+
+#include "TestMesh.h"
+
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+#include "DetourNavMeshBuilder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <zlib.h>
+
+//----------------------------------------------------------------------------
+
+namespace {
+
+const int VERTS_PER_POLY = 6;
+const unsigned short NULL_INDEX = 0xffff;
+
+// Build the data for one tile: a grid of quads, with the edges on the tile
+// border marked as portals so that detour links them to the next tile.
+bool BuildTile(const TestMeshDesc& desc, int tx, int ty, NavMeshFileTile& tile)
+{
+	const int n = desc.quadsPerTile;
+	const float cs = desc.tileSize / n;
+
+	std::vector<unsigned short> verts;
+	for (int z = 0; z <= n; ++z)
+	{
+		for (int x = 0; x <= n; ++x)
+		{
+			verts.push_back(static_cast<unsigned short>(x));
+			verts.push_back(0);
+			verts.push_back(static_cast<unsigned short>(z));
+		}
+	}
+
+	auto vertIndex = [n](int x, int z) { return static_cast<unsigned short>(z * (n + 1) + x); };
+	auto polyIndex = [n](int x, int z) { return static_cast<unsigned short>(z * n + x); };
+
+	std::vector<unsigned short> polys;
+	for (int z = 0; z < n; ++z)
+	{
+		for (int x = 0; x < n; ++x)
+		{
+			unsigned short p[VERTS_PER_POLY * 2];
+			std::fill(p, p + VERTS_PER_POLY * 2, NULL_INDEX);
+
+			p[0] = vertIndex(x, z);
+			p[1] = vertIndex(x, z + 1);
+			p[2] = vertIndex(x + 1, z + 1);
+			p[3] = vertIndex(x + 1, z);
+
+			// neighbours across each edge, or the side of the tile (the same
+			// way recast marks them)
+			p[VERTS_PER_POLY + 0] = x > 0 ? polyIndex(x - 1, z) : 0x8000 | 0;
+			p[VERTS_PER_POLY + 1] = z < n - 1 ? polyIndex(x, z + 1) : 0x8000 | 1;
+			p[VERTS_PER_POLY + 2] = x < n - 1 ? polyIndex(x + 1, z) : 0x8000 | 2;
+			p[VERTS_PER_POLY + 3] = z > 0 ? polyIndex(x, z - 1) : 0x8000 | 3;
+
+			polys.insert(polys.end(), p, p + VERTS_PER_POLY * 2);
+		}
+	}
+
+	const int polyCount = n * n;
+	auto tileFlags = desc.tileFlags.find(ty * desc.tilesX + tx);
+	std::vector<unsigned short> flags(polyCount, tileFlags != desc.tileFlags.end() ? tileFlags->second : 1);
+	std::vector<unsigned char> areas(polyCount, 0);
+
+	dtNavMeshCreateParams params;
+	memset(&params, 0, sizeof(params));
+	params.verts = verts.data();
+	params.vertCount = static_cast<int>(verts.size() / 3);
+	params.polys = polys.data();
+	params.polyFlags = flags.data();
+	params.polyAreas = areas.data();
+	params.polyCount = polyCount;
+	params.nvp = VERTS_PER_POLY;
+	params.tileX = tx;
+	params.tileY = ty;
+	params.bmin[0] = tx * desc.tileSize;
+	params.bmin[1] = -1.0f;
+	params.bmin[2] = ty * desc.tileSize;
+	params.bmax[0] = (tx + 1) * desc.tileSize;
+	params.bmax[1] = 1.0f;
+	params.bmax[2] = (ty + 1) * desc.tileSize;
+	params.walkableHeight = 2.0f;
+	params.walkableRadius = 0.5f;
+	params.walkableClimb = 0.9f;
+	params.cs = cs;
+	params.ch = 0.5f;
+	params.buildBvTree = true;
+
+	return dtCreateNavMeshData(&params, &tile.data, &tile.dataSize);
+}
+
+// Version 3 file with every tile stored raw, which WriteNavMeshFile only does
+// for tiles that don't compress.
+bool WriteUncompressedFile(const std::string& filename, const dtNavMeshParams& params,
+	const std::vector<NavMeshFileTile>& tiles)
+{
+	FILE* fp = fopen(filename.c_str(), "wb");
+	if (!fp)
+		return false;
+	std::unique_ptr<FILE, decltype(&fclose)> fileGuard(fp, &fclose);
+
+	NavMeshSetHeader header;
+	header.magic = NAVMESHSET_MAGIC;
+	header.version = NAVMESHSET_VERSION;
+	header.numTiles = static_cast<int>(tiles.size());
+	header.params = params;
+	fwrite(&header, sizeof(header), 1, fp);
+
+	std::vector<NavMeshTileIndex> index(tiles.size());
+	uint32_t offset = static_cast<uint32_t>(sizeof(NavMeshSetHeader) + sizeof(NavMeshTileIndex) * tiles.size());
+
+	for (size_t i = 0; i < tiles.size(); ++i)
+	{
+		NavMeshTileIndex& entry = index[i];
+		memset(&entry, 0, sizeof(entry));
+
+		offset = (offset + 3) & ~3;
+		entry.tileRef = tiles[i].tileRef;
+		entry.offset = offset;
+		entry.storedSize = tiles[i].dataSize;
+		entry.dataSize = tiles[i].dataSize;
+		entry.crc = crc32(crc32(0L, Z_NULL, 0), tiles[i].data, tiles[i].dataSize);
+		entry.codec = TILE_CODEC_NONE;
+		offset += entry.storedSize;
+	}
+
+	fwrite(index.data(), sizeof(NavMeshTileIndex), index.size(), fp);
+
+	long position = ftell(fp);
+	for (size_t i = 0; i < tiles.size(); ++i)
+	{
+		static const char padding[4] = { 0, 0, 0, 0 };
+		if (index[i].offset > static_cast<uint32_t>(position))
+			fwrite(padding, 1, index[i].offset - position, fp);
+
+		fwrite(tiles[i].data, tiles[i].dataSize, 1, fp);
+		position = index[i].offset + index[i].storedSize;
+	}
+
+	return ferror(fp) == 0;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+dtNavMeshParams GetTestMeshParams(const TestMeshDesc& desc)
+{
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	params.tileWidth = desc.tileSize;
+	params.tileHeight = desc.tileSize;
+	params.maxTiles = static_cast<int>(dtNextPow2(static_cast<unsigned int>(desc.tilesX * desc.tilesY)));
+	params.maxPolys = static_cast<int>(dtNextPow2(static_cast<unsigned int>(desc.quadsPerTile * desc.quadsPerTile)));
+	return params;
+}
+
+void GetTileCenter(const TestMeshDesc& desc, int tx, int ty, float* pos)
+{
+	pos[0] = (tx + 0.5f) * desc.tileSize;
+	pos[1] = 0.0f;
+	pos[2] = (ty + 0.5f) * desc.tileSize;
+}
+
+bool WriteTestMeshFile(const std::string& filename, const TestMeshDesc& desc, int version, bool compress)
+{
+	dtNavMeshParams params = GetTestMeshParams(desc);
+
+	// only used to make refs the same way the mesh will
+	dtNavMesh refs;
+	if (dtStatusFailed(refs.init(&params)))
+		return false;
+
+	std::vector<NavMeshFileTile> tiles;
+	bool result = true;
+
+	for (int ty = 0; ty < desc.tilesY && result; ++ty)
+	{
+		for (int tx = 0; tx < desc.tilesX && result; ++tx)
+		{
+			NavMeshFileTile tile;
+			result = BuildTile(desc, tx, ty, tile);
+			if (!result)
+				break;
+
+			tile.tileRef = refs.encodePolyId(1, ty * desc.tilesX + tx, 0);
+			tile.owned = true;
+			tiles.push_back(tile);
+		}
+	}
+
+	if (result)
+	{
+		if (version == NAVMESHSET_VERSION && !compress)
+			result = WriteUncompressedFile(filename, params, tiles);
+		else
+			result = WriteNavMeshFile(filename, params, tiles, version);
+	}
+
+	for (NavMeshFileTile& tile : tiles)
+		dtFree(tile.data);
+
+	return result;
+}
+
+std::string GetTestFilePath(const std::string& name)
+{
+#if defined(_WIN32)
+	const char* directory = getenv("TEMP");
+	if (!directory || !*directory)
+		directory = ".";
+#else
+	const char* directory = getenv("TMPDIR");
+	if (!directory || !*directory)
+		directory = "/tmp";
+#endif
+
+	return std::string(directory) + "/MQ2Nav_" + name;
+}
@@ -0,0 +1,44 @@
+//
+// TestMesh.h
+//
+// Mesh files for the loader tests to load. The meshes are flat grids of
+// square tiles, each covered in quads, so their size is easy to pick and
+// any two points on them are connected.
+//
+
+#pragma once
+
+#include "NavMeshFile.h"
+
+#include <map>
+#include <string>
+
+struct TestMeshDesc
+{
+	int tilesX = 8;
+	int tilesY = 8;
+
+	// each tile is covered by quadsPerTile x quadsPerTile quads
+	int quadsPerTile = 8;
+	float tileSize = 32.0f;
+
+	// tiles (y * tilesX + x) whose polys get these flags instead of 1. This
+	// changes the tile data without changing the layout of the mesh.
+	std::map<int, unsigned short> tileFlags;
+};
+
+// the params of the mesh that the file will hold
+dtNavMeshParams GetTestMeshParams(const TestMeshDesc& desc);
+
+// world position (detour coordinates) of the middle of a tile
+void GetTileCenter(const TestMeshDesc& desc, int tx, int ty, float* pos);
+
+// Build the tiles of a test mesh and write them to a file. Tiles are stored
+// the way WriteNavMeshFile would: compressed for version 3, raw for version
+// 2. If compress is false, version 3 files keep their tiles uncompressed
+// (and aligned), so that they can be used in place.
+bool WriteTestMeshFile(const std::string& filename, const TestMeshDesc& desc,
+	int version = NAVMESHSET_VERSION, bool compress = true);
+
+// a path in the system's temp directory, for the tests' files
+std::string GetTestFilePath(const std::string& name);
@@ -0,0 +1,178 @@
+//
+// TileResidencyTests.cpp
+//
+// Tests for NavMeshTileResidency: replaying a walk across a lazily loaded
+// mesh, with a memory budget that only holds part of it.
+//
+
+#include "Test.h"
+#include "TestMesh.h"
+
+#include "NavMeshFileLoader.h"
+#include "NavMeshTileResidency.h"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+// Where the character goes: around the edge of the mesh, across it and
+// back, so most tiles are evicted and then needed again. In tiles.
+const float WALK[][2] = {
+	{ 0.5f, 0.5f }, { 15.5f, 0.5f }, { 15.5f, 15.5f }, { 0.5f, 15.5f },
+	{ 0.5f, 0.5f }, { 15.5f, 15.5f }, { 0.5f, 0.5f },
+};
+
+// steps per tile walked
+const int STEPS_PER_TILE = 4;
+
+// the path is planned this many steps ahead
+const int LOOK_AHEAD = 12;
+
+// times around the walk. Everything from the start of one lap has been
+// evicted by the start of the next.
+const int LAPS = 2;
+
+struct Trace
+{
+	std::vector<float> points;
+
+	int Count() const { return static_cast<int>(points.size() / 3); }
+	const float* At(int index) const { return &points[index * 3]; }
+};
+
+Trace MakeWalkTrace(const TestMeshDesc& desc)
+{
+	Trace trace;
+
+	for (size_t i = 1; i < sizeof(WALK) / sizeof(WALK[0]); ++i)
+	{
+		float dx = WALK[i][0] - WALK[i - 1][0];
+		float dz = WALK[i][1] - WALK[i - 1][1];
+		int steps = static_cast<int>((fabsf(dx) > fabsf(dz) ? fabsf(dx) : fabsf(dz)) * STEPS_PER_TILE);
+
+		for (int step = 0; step < steps; ++step)
+		{
+			float t = static_cast<float>(step) / steps;
+			trace.points.push_back((WALK[i - 1][0] + dx * t) * desc.tileSize);
+			trace.points.push_back(0.0f);
+			trace.points.push_back((WALK[i - 1][1] + dz * t) * desc.tileSize);
+		}
+	}
+
+	return trace;
+}
+
+dtPolyRef FindPoly(const dtNavMesh* mesh, const float* pos)
+{
+	dtNavMeshQuery query;
+	if (dtStatusFailed(query.init(mesh, 64)))
+		return 0;
+
+	const float extents[3] = { 1.0f, 2.0f, 1.0f };
+	dtQueryFilter filter;
+	dtPolyRef ref = 0;
+	float nearest[3];
+	query.findNearestPoly(pos, extents, &filter, &ref, nearest);
+
+	return ref;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+// Walk the mesh the way the plugin does with lazy loading: keep the tiles
+// around the character, bring in the tiles along the path ahead, and evict
+// down to the budget. Tiles are evicted and read again many times over, and
+// have to come back intact (uncompressed tiles used to be modified in the
+// file's memory and then fail their checksum), with the same poly refs as
+// when the whole mesh is loaded.
+TEST(TileResidencyReplaysWalk)
+{
+	TestMeshDesc desc;
+	desc.tilesX = 16;
+	desc.tilesY = 16;
+
+	std::string filename = GetTestFilePath("residency.bin");
+	CHECK(WriteTestMeshFile(filename, desc, NAVMESHSET_VERSION, false));
+
+	std::atomic<bool> cancel(false);
+	NavMeshFileLoader::LoadOptions options;
+
+	auto whole = NavMeshFileLoader::LoadMeshFile(filename, options, cancel);
+	CHECK(whole->result == NavMeshFileLoader::SUCCESS);
+
+	options.mapFile = true;
+	options.lazyTiles = true;
+
+	auto lazy = NavMeshFileLoader::LoadMeshFile(filename, options, cancel);
+	CHECK(lazy->result == NavMeshFileLoader::SUCCESS);
+
+	if (whole->result != NavMeshFileLoader::SUCCESS || lazy->result != NavMeshFileLoader::SUCCESS)
+		return;
+
+	int changes = 0;
+	NavMeshTileResidency residency([&changes]() { changes++; });
+	residency.Attach(lazy->mesh.get(), lazy->reader.get(), std::move(lazy->tiles), std::move(lazy->tileGrid));
+
+	// enough for the tiles around the character and along the path, but
+	// nowhere near the whole mesh.
+	const size_t tileBytes = lazy->reader->GetTileDataSize(0);
+	const size_t budget = tileBytes * 24;
+	const float radius = desc.tileSize;
+
+	Trace trace = MakeWalkTrace(desc);
+	int wrongRefs = 0;
+	int messages = 0;
+	uint32_t firstLapMisses = 0;
+
+	for (int step = 0; step < trace.Count() * LAPS; ++step)
+	{
+		int i = step % trace.Count();
+		if (step == trace.Count())
+			firstLapMisses = residency.GetStats().misses;
+
+		const float* pos = trace.At(i);
+
+		if (i % STEPS_PER_TILE == 0)
+		{
+			int end = i + LOOK_AHEAD < trace.Count() ? i + LOOK_AHEAD : trace.Count() - 1;
+			residency.RequestLine(pos, end - i + 1);
+			residency.Evict(budget);
+		}
+
+		residency.RequestArea(pos, radius);
+		residency.Evict(budget);
+
+		messages += static_cast<int>(residency.TakeMessages().size());
+
+		CHECK(residency.GetStats().residentBytes <= budget);
+
+		if (FindPoly(lazy->mesh.get(), pos) != FindPoly(whole->mesh.get(), pos))
+			wrongRefs++;
+	}
+
+	const NavMeshTileResidency::Stats& stats = residency.GetStats();
+	printf("  %d steps: %u hits, %u misses, %u evictions, %d of %d tiles resident\n",
+		trace.Count() * LAPS, stats.hits, stats.misses, stats.evictions, stats.residentTiles, stats.totalTiles);
+
+	CHECK(messages == 0);
+	CHECK(wrongRefs == 0);
+	CHECK(changes > 0);
+
+	// the later laps had to read their tiles again
+	CHECK(stats.evictions > 0);
+	CHECK(stats.misses > firstLapMisses * 3 / 2);
+
+	residency.Reset();
+	lazy.reset();
+	whole.reset();
+
+	remove(filename.c_str());
+}
@@ -0,0 +1,56 @@
+//
+// main.cpp
+//
+// Runs the loader tests. Pass test names to run just those, or --bench to
+// measure loading mesh files instead.
+//
+
+#include "LoadBenchmark.h"
+#include "Test.h"
+
+#include <cstdio>
+#include <cstring>
+
+static int s_failures = 0;
+
+std::vector<TestCase>& GetTests()
+{
+	static std::vector<TestCase> tests;
+	return tests;
+}
+
+void ReportFailure(const char* file, int line, const char* expression)
+{
+	printf("  %s(%d): CHECK(%s) failed\n", file, line, expression);
+	s_failures++;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+		return RunLoadBenchmark(argc - 2, argv + 2);
+
+	int failedTests = 0;
+	int ranTests = 0;
+
+	for (const TestCase& test : GetTests())
+	{
+		bool selected = argc < 2;
+		for (int i = 1; i < argc && !selected; ++i)
+			selected = strcmp(argv[i], test.name) == 0;
+		if (!selected)
+			continue;
+
+		printf("%s\n", test.name);
+
+		int failuresBefore = s_failures;
+		test.run();
+		ranTests++;
+
+		if (s_failures != failuresBefore)
+			failedTests++;
+	}
+
+	printf("%d of %d tests passed\n", ranTests - failedTests, ranTests);
+	return failedTests == 0 ? 0 : 1;
+}
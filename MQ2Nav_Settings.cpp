@@ -40,6 +40,62 @@ void LoadSettings(bool showMessage/* = true*/)
 		szTemp, MAX_STRING, INIFileName);
 	g_settings.autoreload = (!strnicmp(szTemp, "on", 3));
 
+	GetPrivateProfileString("Settings", "MapMeshFiles",
+		defaults.map_mesh_files ? "on" : "off",
+		szTemp, MAX_STRING, INIFileName);
+	g_settings.map_mesh_files = (!strnicmp(szTemp, "on", 3));
+
+	GetPrivateProfileString("Settings", "LazyTileLoading",
+		defaults.lazy_tile_loading ? "on" : "off",
+		szTemp, MAX_STRING, INIFileName);
+	g_settings.lazy_tile_loading = (!strnicmp(szTemp, "on", 3));
+
+	sprintf_s(szTemp, "%.2f", defaults.tile_load_radius);
+	GetPrivateProfileString("Settings", "TileLoadRadius", szTemp,
+		szTemp, MAX_STRING, INIFileName);
+	g_settings.tile_load_radius = static_cast<float>(atof(szTemp));
+
+	g_settings.tile_memory_budget = GetPrivateProfileInt("Settings", "TileMemoryBudget",
+		defaults.tile_memory_budget, INIFileName);
+
+	g_settings.path_search_budget = GetPrivateProfileInt("Settings", "PathSearchBudget",
+		defaults.path_search_budget, INIFileName);
+
+	GetPrivateProfileString("Settings", "UseLandmarks",
+		defaults.use_landmarks ? "on" : "off",
+		szTemp, MAX_STRING, INIFileName);
+	g_settings.use_landmarks = (!strnicmp(szTemp, "on", 3));
+
+	GetPrivateProfileString("Settings", "ShortcutPaths",
+		defaults.shortcut_paths ? "on" : "off",
+		szTemp, MAX_STRING, INIFileName);
+	g_settings.shortcut_paths = (!strnicmp(szTemp, "on", 3));
+
+	GetPrivateProfileString("Settings", "IncludeFlags",
+		FormatFlags(defaults.filter.includeFlags).c_str(),
+		szTemp, MAX_STRING, INIFileName);
+	if (!ParseFlags(szTemp, g_settings.filter.includeFlags))
+		g_settings.filter.includeFlags = defaults.filter.includeFlags;
+
+	GetPrivateProfileString("Settings", "ExcludeFlags",
+		FormatFlags(defaults.filter.excludeFlags).c_str(),
+		szTemp, MAX_STRING, INIFileName);
+	if (!ParseFlags(szTemp, g_settings.filter.excludeFlags))
+		g_settings.filter.excludeFlags = defaults.filter.excludeFlags;
+
+	for (int i = 0; i < NavArea_Count; ++i)
+	{
+		char szDefault[32];
+		sprintf_s(szDefault, "%.2f", defaults.filter.areaCosts[i]);
+		GetPrivateProfileString("AreaCosts", GetAreaName(i), szDefault,
+			szTemp, MAX_STRING, INIFileName);
+
+		float cost = static_cast<float>(atof(szTemp));
+		if (!(cost >= NavigationFilter::MIN_AREA_COST))
+			cost = NavigationFilter::MIN_AREA_COST;
+		g_settings.filter.areaCosts[i] = cost;
+	}
+
 	GetPrivateProfileString("Settings", "ShowUI",
 		defaults.show_ui ? "on" : "off",
 		szTemp, MAX_STRING, INIFileName);
@@ -71,10 +127,28 @@ void SaveSettings(bool showMessage/* = true*/)
 	WritePrivateProfileString("Settings", "AutoBreak", g_settings.autobreak ? "on" : "off", INIFileName);
 	WritePrivateProfileString("Settings", "AutoPause", g_settings.autopause ? "on" : "off", INIFileName);
 	WritePrivateProfileString("Settings", "AutoReload", g_settings.autoreload ? "on" : "off", INIFileName);
+	WritePrivateProfileString("Settings", "MapMeshFiles", g_settings.map_mesh_files ? "on" : "off", INIFileName);
+	WritePrivateProfileString("Settings", "LazyTileLoading", g_settings.lazy_tile_loading ? "on" : "off", INIFileName);
+	sprintf_s(szTemp, "%.2f", g_settings.tile_load_radius);
+	WritePrivateProfileString("Settings", "TileLoadRadius", szTemp, INIFileName);
+	sprintf_s(szTemp, "%d", g_settings.tile_memory_budget);
+	WritePrivateProfileString("Settings", "TileMemoryBudget", szTemp, INIFileName);
+	sprintf_s(szTemp, "%d", g_settings.path_search_budget);
+	WritePrivateProfileString("Settings", "PathSearchBudget", szTemp, INIFileName);
+	WritePrivateProfileString("Settings", "UseLandmarks", g_settings.use_landmarks ? "on" : "off", INIFileName);
+	WritePrivateProfileString("Settings", "ShortcutPaths", g_settings.shortcut_paths ? "on" : "off", INIFileName);
+	WritePrivateProfileString("Settings", "IncludeFlags", FormatFlags(g_settings.filter.includeFlags).c_str(), INIFileName);
+	WritePrivateProfileString("Settings", "ExcludeFlags", FormatFlags(g_settings.filter.excludeFlags).c_str(), INIFileName);
 	WritePrivateProfileString("Settings", "ShowUI", g_settings.show_ui ? "on" : "off", INIFileName);
 	WritePrivateProfileString("Settings", "ShowNavMesh", g_settings.show_navmesh_overlay ? "on" : "off", INIFileName);
 	WritePrivateProfileString("Settings", "ShowNavPath", g_settings.show_nav_path ? "on" : "off", INIFileName);
 
+	for (int i = 0; i < NavArea_Count; ++i)
+	{
+		sprintf_s(szTemp, "%.2f", g_settings.filter.areaCosts[i]);
+		WritePrivateProfileString("AreaCosts", GetAreaName(i), szTemp, INIFileName);
+	}
+
 #if 0
 	WritePrivateProfileString("Defaults",   "AllowMove",              ftoa(SET->AllowMove,      szTemp),     INIFileName);
 	WritePrivateProfileString("Defaults",   "AutoPauseMsg",           (uiVerbLevel & V_AUTOPAUSE) == V_AUTOPAUSE             ? "on" : "off",      INIFileName);
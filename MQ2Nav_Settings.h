@@ -5,6 +5,7 @@
 #pragma once
 
 #include "MQ2Navigation.h"
+#include "NavigationFilter.h"
 
 namespace mq2nav {
 
@@ -19,6 +20,32 @@ struct SettingsData
 	// auto reload navmesh if file changes
 	bool autoreload = true;
 
+	// map navmesh files into memory instead of reading them into a buffer
+	bool map_mesh_files = true;
+
+	// only keep the tiles near the player loaded, instead of the whole mesh
+	bool lazy_tile_loading = false;
+
+	// distance around the player to keep tiles loaded (lazy tile loading)
+	float tile_load_radius = 750.0f;
+
+	// memory to allow for loaded tiles, in MB (lazy tile loading)
+	int tile_memory_budget = 32;
+
+	// time to spend searching for a path each pulse, in microseconds. Longer
+	// searches continue on the next pulse. 0 to always finish the search.
+	int path_search_budget = 2000;
+
+	// use the landmark tables saved with the mesh (if it has them) to guide
+	// path searches
+	bool use_landmarks = true;
+
+	// drop waypoints that can be walked past in a straight line
+	bool shortcut_paths = true;
+
+	// flags and area costs for navigation, unless the command gives its own
+	NavigationFilter filter;
+
 	// show the MQ2Nav Tools debug ui
 	bool show_ui = true;
 
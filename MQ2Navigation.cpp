@@ -4,12 +4,18 @@
 
 #include "MQ2Navigation.h"
 #include "NavigationPath.h"
+#include "NavigationPathCache.h"
 #include "NavigationType.h"
 #include "RenderHandler.h"
 #include "ImGuiRenderer.h"
 #include "KeybindHandler.h"
 #include "MQ2Nav_Hooks.h"
+#include "NavMeshLandmarks.h"
 #include "NavMeshLoader.h"
+#include "NavMeshClusterGraph.h"
+#include "NavMeshObstacles.h"
+#include "NavMeshPolyIndex.h"
+#include "NavMeshQueryPool.h"
 #include "ModelLoader.h"
 #include "NavMeshRenderer.h"
 #include "MQ2Nav_Util.h"
@@ -18,7 +24,9 @@
 
 #include "DetourCommon.h"
 
+#include <cfloat>
 #include <set>
+#include <vector>
 
 #pragma comment (lib, "d3d9.lib")
 #pragma comment (lib, "d3dx9.lib")
@@ -84,8 +92,28 @@ static void ClickGroundItem(PGROUNDITEM pGroundItem)
 MQ2NavigationPlugin::MQ2NavigationPlugin()
   : m_navigationType(new MQ2NavigationType(this))
   , m_meshLoader(new NavMeshLoader())
+  , m_queryPool(new NavMeshQueryPool(m_meshLoader->GetNavMesh()))
+  , m_clusterGraph(new NavMeshClusterGraph(m_meshLoader->GetNavMesh()))
+  , m_polyIndex(new NavMeshPolyIndex(m_meshLoader->GetNavMesh()))
+  , m_pathCache(new NavigationPathCache())
+  , m_obstacles(new NavMeshObstacles(m_meshLoader.get()))
   , m_modelLoader(new ModelLoader())
 {
+	// the helpers that don't know about the loader follow its mesh
+	m_meshHelpersConn = m_meshLoader->OnNavMeshChanged.Connect([this](dtNavMesh* navMesh)
+	{
+		m_queryPool->SetNavMesh(navMesh);
+		m_clusterGraph->SetNavMesh(navMesh);
+		m_polyIndex->SetNavMesh(navMesh);
+		m_pathCache->Clear();
+	});
+	m_tileHelpersConn = m_meshLoader->OnTilesChanged.Connect([this]()
+	{
+		m_clusterGraph->Update();
+		m_polyIndex->Rebuild();
+		m_pathCache->Clear();
+	});
+
 	Initialize();
 
 	if (m_initialized)
@@ -114,6 +142,7 @@ void MQ2NavigationPlugin::OnPulse()
 		Initialize();
 
 	m_meshLoader->Process();
+	m_obstacles->Process();
 	m_modelLoader->Process();
 
 	if (m_initialized && mq2nav::ValidIngame(TRUE))
@@ -216,6 +245,8 @@ void MQ2NavigationPlugin::Initialize()
 	g_renderHandler->AddRenderable(g_navMeshRenderer);
 
 	m_uiConn = g_imguiRenderer->OnUpdateUI.Connect([this]() { OnUpdateUI(); });
+	m_navMeshConn = m_meshLoader->OnNavMeshChanged.Connect(
+		[this](dtNavMesh*) { OnNavMeshChanged(); });
 
 	// add the keybind handler and connect it to our keypress handler
 	g_keybindHandler = std::make_unique<KeybindHandler>();
@@ -277,6 +308,11 @@ void MQ2NavigationPlugin::Command_Navigate(PSPAWNINFO pChar, PCHAR szLine)
 		m_isPaused = !m_isPaused;
 		return;
 	}
+	else if (!stricmp(buffer, "obstacle")) {
+		// doesn't stop navigation, the path goes around it instead
+		Command_Obstacle(szLine);
+		return;
+	}
 
 	m_pEndingDoor = nullptr;
 	m_pEndingItem = nullptr;
@@ -313,6 +349,9 @@ void MQ2NavigationPlugin::Command_Navigate(PSPAWNINFO pChar, PCHAR szLine)
 			WriteChatf(PLUGIN_MSG "\ag/navigate [save | load]\ax - save/load settings");
 			WriteChatf(PLUGIN_MSG "\ag/navigate reload\ax - reload navmesh");
 			WriteChatf(PLUGIN_MSG "\ag/navigate recordwaypoint <waypoint name> <waypoint tag>\ax - create a waypoint");
+			WriteChatf(PLUGIN_MSG "\ag/navigate obstacle [add X Y Z radius height | box X1 Y1 Z1 X2 Y2 Z2]\ax - block off part of the mesh");
+			WriteChatf(PLUGIN_MSG "\ag/navigate obstacle [target | door] [radius] [height]\ax - block off the area around a spawn or door");
+			WriteChatf(PLUGIN_MSG "\ag/navigate obstacle [remove <id> | clear]\ax - remove obstacles");
 
 			WriteChatf(PLUGIN_MSG "\aoNavigation Options:\ax");
 			WriteChatf(PLUGIN_MSG "\ag/navigate target\ax - navigate to target");
@@ -322,6 +361,10 @@ void MQ2NavigationPlugin::Command_Navigate(PSPAWNINFO pChar, PCHAR szLine)
 			WriteChatf(PLUGIN_MSG "\ag/navigate waypoint <waypoint>\ax - navigate to waypoint");
 			WriteChatf(PLUGIN_MSG "\ag/navigate stop\ax - stop navigation");
 			WriteChatf(PLUGIN_MSG "\ag/navigate pause\ax - pause navigation");
+
+			WriteChatf(PLUGIN_MSG "\aoPath Options:\ax (after the destination)");
+			WriteChatf(PLUGIN_MSG "\aginclude=<flags>\ax, \agexclude=<flags>\ax - polys the path may use (walk, swim, door, jump)");
+			WriteChatf(PLUGIN_MSG "\ag<area>=<cost>\ax - cost to cross an area (ground, water, road, door, grass, jump)");
 		}
 		else if (!stricmp(buffer, "load")) {
 			mq2nav::LoadSettings(true);
@@ -333,32 +376,185 @@ void MQ2NavigationPlugin::Command_Navigate(PSPAWNINFO pChar, PCHAR szLine)
 		return;
 	}
 
+	NavigationFilter filter;
+	if (!ParseFilter(szLine, filter, true))
+	{
+		Stop();
+		return;
+	}
+
 	// we were given a destination. Check if we should click once at the end.
 	GetArg(buffer, szLine, 3);
 	m_bSpamClick = strcmp(buffer, "once");
 
-	BeginNavigation(destination);
+	BeginNavigation(destination, filter);
 
 	if (m_isActive)
 		EzCommand("/squelch /stick off");
 }
 
-void MQ2NavigationPlugin::BeginNavigation(const glm::vec3& pos)
+// read count numbers from the arguments, starting at the first one
+static bool GetFloatArgs(PCHAR szLine, int first, float* values, int count)
+{
+	CHAR buffer[MAX_STRING] = { 0 };
+
+	for (int i = 0; i < count; ++i)
+	{
+		GetArg(buffer, szLine, first + i);
+		if (!IsInt(buffer))
+			return false;
+		values[i] = static_cast<float>(atof(buffer));
+	}
+
+	return true;
+}
+
+void MQ2NavigationPlugin::Command_Obstacle(PCHAR szLine)
+{
+	CHAR buffer[MAX_STRING] = { 0 };
+	GetArg(buffer, szLine, 2);
+
+	if (!m_obstacles->IsAvailable())
+	{
+		WriteChatf(PLUGIN_MSG "\arNo dynamic obstacles - the mesh wasn't built with obstacle layers, or tiles are loaded lazily.");
+		return;
+	}
+
+	if (!stricmp(buffer, "remove"))
+	{
+		GetArg(buffer, szLine, 3);
+		uint32_t id = strtoul(buffer, nullptr, 10);
+
+		if (m_obstacles->Remove(id))
+			WriteChatf(PLUGIN_MSG "Removed obstacle \ay%u\ax", id);
+		else
+			WriteChatf(PLUGIN_MSG "\arNo obstacle with id: %s", buffer);
+		return;
+	}
+
+	if (!stricmp(buffer, "clear"))
+	{
+		int count = m_obstacles->GetObstacleCount();
+		m_obstacles->Clear();
+
+		WriteChatf(PLUGIN_MSG "Removed \ay%d\ax obstacles", count);
+		return;
+	}
+
+	// everything here is in eq coordinates (x, y, z), and goes to detour as
+	// (x, z, y). Cylinders are centered on the point.
+	uint32_t id = 0;
+
+	if (!stricmp(buffer, "box"))
+	{
+		float values[6];
+		if (!GetFloatArgs(szLine, 3, values, 6))
+		{
+			WriteChatf(PLUGIN_MSG "Usage: /navigate obstacle box X1 Y1 Z1 X2 Y2 Z2");
+			return;
+		}
+
+		float bmin[3] = { values[0], values[2], values[1] };
+		float bmax[3] = { values[3], values[5], values[4] };
+		id = m_obstacles->AddBox(bmin, bmax);
+	}
+	else
+	{
+		glm::vec3 pos;
+		float size[2] = { OBSTACLE_DEFAULT_RADIUS, OBSTACLE_DEFAULT_HEIGHT };
+
+		if (!stricmp(buffer, "add"))
+		{
+			float values[5];
+			if (!GetFloatArgs(szLine, 3, values, 5))
+			{
+				WriteChatf(PLUGIN_MSG "Usage: /navigate obstacle add X Y Z radius height");
+				return;
+			}
+
+			pos = glm::vec3(values[0], values[1], values[2]);
+			size[0] = values[3];
+			size[1] = values[4];
+		}
+		else if (!stricmp(buffer, "target") && pTarget)
+		{
+			PSPAWNINFO target = (PSPAWNINFO)pTarget;
+			pos = glm::vec3(target->X, target->Y, target->Z);
+		}
+		else if (!stricmp(buffer, "door") && pDoorTarget)
+		{
+			pos = glm::vec3(pDoorTarget->X, pDoorTarget->Y, pDoorTarget->Z);
+		}
+		else
+		{
+			WriteChatf(PLUGIN_MSG "Usage: /navigate obstacle [add X Y Z radius height | box X1 Y1 Z1 X2 Y2 Z2 | target | door | remove <id> | clear]");
+			return;
+		}
+
+		// radius and height are optional for spawns and doors
+		if (stricmp(buffer, "add"))
+		{
+			GetFloatArgs(szLine, 3, &size[0], 1);
+			GetFloatArgs(szLine, 4, &size[1], 1);
+		}
+
+		if (size[0] <= 0 || size[1] <= 0)
+		{
+			WriteChatf(PLUGIN_MSG "\arObstacle radius and height must be positive");
+			return;
+		}
+
+		float base[3] = { pos.x, pos.z - size[1] * 0.5f, pos.y };
+		id = m_obstacles->AddCylinder(base, size[0], size[1]);
+	}
+
+	if (id)
+		WriteChatf(PLUGIN_MSG "Added obstacle \ay%u\ax", id);
+	else
+		WriteChatf(PLUGIN_MSG "\arCouldn't add obstacle, there are already %d", m_obstacles->GetObstacleCount());
+}
+
+void MQ2NavigationPlugin::BeginNavigation(const glm::vec3& pos, const NavigationFilter& filter)
 {
 	// first clear existing state
 	m_isActive = false;
 	m_activePath.reset();
+	m_linkCrossing = LinkCrossing();
 
 	if (!m_meshLoader->IsNavMeshLoaded())
 	{
-		WriteChatf(PLUGIN_MSG "\arCannot navigate - No mesh file loaded.");
+		if (m_meshLoader->IsLoading())
+			WriteChatf(PLUGIN_MSG "\ayCannot navigate - Mesh file is still loading.");
+		else
+			WriteChatf(PLUGIN_MSG "\arCannot navigate - No mesh file loaded.");
 		return;
 	}
 
-	m_activePath = std::make_unique<NavigationPath>(m_meshLoader->GetNavMesh());
+	m_activePath = std::make_unique<NavigationPath>(m_queryPool.get());
+	m_activePath->SetSearchBudget(mq2nav::GetSettings().path_search_budget);
+	m_activePath->SetFilter(filter);
 
 	m_activePath->FindPath(pos);
-	m_isActive = m_activePath->GetPathSize() > 0;
+	m_isActive = m_activePath->GetPathSize() > 0 || m_activePath->IsSearching();
+}
+
+void MQ2NavigationPlugin::OnNavMeshChanged()
+{
+	// the active path refers to the old mesh. Replan against the new one, or
+	// stop if the mesh went away.
+	if (m_activePath)
+	{
+		if (m_isActive && m_meshLoader->IsNavMeshLoaded())
+		{
+			glm::vec3 destination = m_activePath->GetDestination();
+			NavigationFilter filter = m_activePath->GetNavigationFilter();
+			BeginNavigation(destination, filter);
+		}
+		else
+		{
+			Stop();
+		}
+	}
 }
 
 bool MQ2NavigationPlugin::IsMeshLoaded() const
@@ -366,6 +562,11 @@ bool MQ2NavigationPlugin::IsMeshLoaded() const
 	return m_meshLoader->IsNavMeshLoaded();
 }
 
+bool MQ2NavigationPlugin::IsMeshLoading() const
+{
+	return m_meshLoader->IsLoading() && !m_meshLoader->IsNavMeshLoaded();
+}
+
 void MQ2NavigationPlugin::OnMovementKeyPressed()
 {
 	if (m_isActive)
@@ -503,7 +704,9 @@ void MQ2NavigationPlugin::LookAt(const glm::vec3& pos)
 
 void MQ2NavigationPlugin::AttemptMovement()
 {
-	if (m_isActive)
+	// the path can't be followed across an off-mesh link, it is picked up
+	// again once we come out the other end.
+	if (m_isActive && !m_linkCrossing.active)
 	{
 		clock::time_point now = clock::now();
 
@@ -513,10 +716,15 @@ void MQ2NavigationPlugin::AttemptMovement()
 
 			// update path
 			m_activePath->UpdatePath();
-			m_isActive = m_activePath->GetPathSize() > 0;
-
 			m_pathfindTimer = now;
 		}
+		else if (m_activePath->IsSearching())
+		{
+			// keep working on a search that didn't fit in the last pulse
+			m_activePath->ContinueSearch();
+		}
+
+		m_isActive = m_activePath->GetPathSize() > 0 || m_activePath->IsSearching();
 	}
 
 	// if no active path, then leave
@@ -530,6 +738,10 @@ void MQ2NavigationPlugin::AttemptMovement()
 	//WriteChatf(PLUGIN_MSG "Distance from target: %.2f. I am at: %.2f %.2f %.2f", distanceToTarget,
 	//	me->X, me->Y, me->Z);
 
+	// still searching for the first path, nowhere to go yet
+	if (m_activePath->GetPathSize() == 0 && m_activePath->IsSearching())
+		return;
+
 	if (m_activePath->IsAtEnd())
 	{
 		DebugSpewAlways("[MQ2Nav] Reached destination at: %.2f %.2f %.2f",
@@ -548,6 +760,9 @@ void MQ2NavigationPlugin::AttemptMovement()
 	}
 	else if (m_activePath->GetPathSize() > 0)
 	{
+		if (m_linkCrossing.active && UpdateLinkCrossing())
+			return;
+
 		if (!m_isPaused)
 		{
 			if (!GetCharInfo()->pSpawn->SpeedRun)
@@ -556,15 +771,20 @@ void MQ2NavigationPlugin::AttemptMovement()
 
 		glm::vec3 nextPosition = m_activePath->GetNextPosition();
 
+		// The path is rebuilt on a timer, so reaching a waypoint only needs to
+		// move on to the next one.
 		if (GetDistance(nextPosition.x, nextPosition.z) < WAYPOINT_PROGRESSION_DISTANCE)
 		{
+			if (m_activePath->GetFlags(m_activePath->GetPathIndex()) & DT_STRAIGHTPATH_OFFMESH_CONNECTION)
+			{
+				BeginLinkCrossing();
+				return;
+			}
+
 			m_activePath->Increment();
 
 			if (!m_activePath->IsAtEnd())
-			{
-				m_activePath->UpdatePath();
 				nextPosition = m_activePath->GetNextPosition();
-			}
 		}
 
 		if (m_currentWaypoint != nextPosition)
@@ -578,6 +798,140 @@ void MQ2NavigationPlugin::AttemptMovement()
 	}
 }
 
+void MQ2NavigationPlugin::BeginLinkCrossing()
+{
+	int index = m_activePath->GetPathIndex();
+
+	// the other end of the link is the next corner
+	if (index + 1 >= m_activePath->GetPathSize())
+	{
+		m_activePath->Increment();
+		return;
+	}
+
+	LinkCrossing crossing;
+	crossing.active = true;
+	crossing.start = m_activePath->GetPosition(index);
+	crossing.end = m_activePath->GetPosition(index + 1);
+	crossing.startTime = clock::now();
+
+	// The link's poly has its id. Links that the mesh file doesn't know
+	// about are walked across.
+	std::string actionData;
+	const dtOffMeshConnection* con = m_activePath->GetNavMesh()->getOffMeshConnectionByRef(
+		m_activePath->GetPolyRef(index));
+	if (con)
+	{
+		crossing.id = con->userId;
+
+		auto links = m_meshLoader->GetOffMeshLinks();
+		const NavMeshOffMeshLink* link = links ? links->FindLink(con->userId) : nullptr;
+		if (link)
+		{
+			crossing.action = link->action;
+			actionData = link->actionData;
+		}
+	}
+
+	m_linkCrossing = crossing;
+	m_activePath->MoveOverOffMeshLink(m_activePath->GetPolyRef(index));
+	m_activePath->Increment();
+
+	DebugSpewAlways("[MQ2Nav] Crossing off-mesh link %u (%s) to: %.2f %.2f %.2f", crossing.id,
+		GetLinkActionName(crossing.action), crossing.end.x, crossing.end.z, crossing.end.y);
+
+	if (crossing.action == NavLinkAction_Walk)
+		return;
+
+	// stand still while the door or command takes us across
+	MQ2Globals::ExecuteCmd(FindMappableCommand("FORWARD"), 0, 0);
+
+	if (crossing.action == NavLinkAction_Door)
+	{
+		if (!ClickDoorByName(actionData, crossing.start))
+		{
+			WriteChatf(PLUGIN_MSG "\arCan't find door '%s' for off-mesh link %u", actionData.c_str(), crossing.id);
+			Stop();
+		}
+	}
+	else if (crossing.action == NavLinkAction_Command)
+	{
+		CHAR command[MAX_STRING] = { 0 };
+		strcpy_s(command, actionData.c_str());
+		EzCommand(command);
+	}
+}
+
+bool MQ2NavigationPlugin::UpdateLinkCrossing()
+{
+	const glm::vec3& start = m_linkCrossing.start;
+	const glm::vec3& end = m_linkCrossing.end;
+
+	// Doors and commands might put us somewhere other than the end of the
+	// link. Walking across can take us further from the start than that.
+	bool arrived = GetDistance(end.x, end.z) < LINK_ARRIVAL_DISTANCE
+		|| (m_linkCrossing.action != NavLinkAction_Walk
+			&& GetDistance(start.x, start.z) > LINK_DEPARTURE_DISTANCE);
+
+	if (arrived)
+	{
+		DebugSpewAlways("[MQ2Nav] Crossed off-mesh link %u", m_linkCrossing.id);
+		m_linkCrossing = LinkCrossing();
+		m_linksCrossed++;
+
+		// find the path again from wherever we came out
+		m_pathfindTimer = clock::time_point();
+		return false;
+	}
+
+	if (clock::now() - m_linkCrossing.startTime > std::chrono::milliseconds(LINK_TIMEOUT_MS))
+	{
+		WriteChatf(PLUGIN_MSG "\arOff-mesh link %u didn't take us across", m_linkCrossing.id);
+		Stop();
+		return true;
+	}
+
+	if (m_linkCrossing.action == NavLinkAction_Walk)
+	{
+		if (!m_isPaused && !GetCharInfo()->pSpawn->SpeedRun)
+			MQ2Globals::ExecuteCmd(FindMappableCommand("FORWARD"), 1, 0);
+
+		LookAt(glm::vec3(end.x, end.z, end.y));
+	}
+
+	return true;
+}
+
+bool MQ2NavigationPlugin::ClickDoorByName(const std::string& name, const glm::vec3& nearPos)
+{
+	if (!ppSwitchMgr || !pSwitchMgr) return false;
+
+	PDOORTABLE pDoorTable = (PDOORTABLE)pSwitchMgr;
+	PDOOR pDoor = nullptr;
+	float nearestDistance = FLT_MAX;
+
+	// door names aren't unique, use the one closest to the link
+	for (DWORD index = 0; index < pDoorTable->NumEntries; index++)
+	{
+		PDOOR door = pDoorTable->pDoor[index];
+		if (_stricmp(door->Name, name.c_str()))
+			continue;
+
+		FLOAT distance = GetDistance(door->X, door->Y, nearPos.x, nearPos.z);
+		if (distance < nearestDistance)
+		{
+			pDoor = door;
+			nearestDistance = distance;
+		}
+	}
+
+	if (!pDoor)
+		return false;
+
+	ClickDoor(pDoor);
+	return true;
+}
+
 bool MQ2NavigationPlugin::ParseDestination(PCHAR szLine, glm::vec3& destination)
 {
 	bool result = true;
@@ -669,52 +1023,126 @@ bool MQ2NavigationPlugin::ParseDestination(PCHAR szLine, glm::vec3& destination)
 	return result;
 }
 
-float MQ2NavigationPlugin::GetNavigationPathLength(const glm::vec3& pos)
+bool MQ2NavigationPlugin::ParseFilter(PCHAR szLine, NavigationFilter& filter, bool showErrors)
 {
-	float result = -1.f;
-
-	NavigationPath path(m_meshLoader->GetNavMesh());
-	path.FindPath(pos);
+	CHAR buffer[MAX_STRING] = { 0 };
+	filter = mq2nav::GetSettings().filter;
 
-	//WriteChatf("MQ2Nav::GetPathLength - num points: %d", numPoints);
-	int numPoints = path.GetPathSize();
-	if (numPoints > 0)
+	for (int i = 1; ; ++i)
 	{
-		result = 0;
+		GetArg(buffer, szLine, i);
+		if (0 == *buffer)
+			break;
 
-		for (int i = 0; i < numPoints - 1; ++i)
+		if (strchr(buffer, '=') && !filter.ParseOption(buffer))
 		{
-			const float* first = path.GetRawPosition(i);
-			const float* second = path.GetRawPosition(i + 1);
-
-			float segment = dtVdist(first, second);
-			result += segment;
-			//WriteChatf("MQ2Nav::GetPathLength - segment #%d length: %f - total: %f", i, segment, result);
+			if (showErrors)
+				WriteChatf(PLUGIN_MSG "\arInvalid path option: %s", buffer);
+			return false;
 		}
 	}
-	return result;
+
+	return true;
+}
+
+bool MQ2NavigationPlugin::GetPathResult(const glm::vec3& pos, const NavigationFilter& filter, float& length)
+{
+	NavigationPath path(m_queryPool.get(), false);
+	path.SetFilter(filter);
+
+	return m_pathCache->FindPath(path, pos, length);
+}
+
+float MQ2NavigationPlugin::GetNavigationPathLength(const glm::vec3& pos, const NavigationFilter& filter)
+{
+	float length;
+	GetPathResult(pos, filter, length);
+
+	return length;
 }
 
 float MQ2NavigationPlugin::GetNavigationPathLength(PCHAR szLine)
 {
+	if (IsMeshLoading())
+		return PATH_LENGTH_LOADING;
+
 	float result = -1.f;
 	glm::vec3 destination;
+	NavigationFilter filter;
 
-	if (ParseDestination(szLine, destination)) {
-		result = GetNavigationPathLength(destination);
+	if (ParseDestination(szLine, destination) && ParseFilter(szLine, filter, false)) {
+		result = GetNavigationPathLength(destination, filter);
 	}
 	return result;
 }
 
+void MQ2NavigationPlugin::GetNavigationPathLengths(PCHAR szLine, PCHAR szResult, size_t resultSize)
+{
+	CHAR buffer[MAX_STRING] = { 0 };
+
+	std::vector<glm::vec3> destinations;
+	std::vector<bool> found;
+
+	NavigationFilter filter;
+	bool validFilter = ParseFilter(szLine, filter, false);
+
+	for (int i = 1; ; ++i)
+	{
+		GetArg(buffer, szLine, i);
+		if (0 == *buffer)
+			break;
+
+		// path options, not a spawn
+		if (strchr(buffer, '='))
+			continue;
+
+		PSPAWNINFO spawn = IsNumber(buffer) ? (PSPAWNINFO)GetSpawnByID(atoi(buffer)) : nullptr;
+		found.push_back(spawn != nullptr);
+
+		if (spawn)
+			destinations.emplace_back(spawn->X, spawn->Y, spawn->Z);
+		else
+			destinations.emplace_back(0.0f, 0.0f, 0.0f);
+	}
+
+	const bool loading = IsMeshLoading();
+	std::vector<float> lengths(destinations.size(), loading ? PATH_LENGTH_LOADING : -1.f);
+
+	if (!destinations.empty() && validFilter && !loading)
+	{
+		// one search for all of them
+		NavigationPath path(m_queryPool.get(), false);
+		path.SetFilter(filter);
+		path.FindPathLengths(destinations.data(), static_cast<int>(destinations.size()),
+			lengths.data());
+	}
+
+	*szResult = 0;
+	size_t used = 0;
+
+	for (size_t i = 0; i < lengths.size(); ++i)
+	{
+		// stop at the last one that fits
+		int written = _snprintf_s(szResult + used, resultSize - used, _TRUNCATE,
+			i ? ",%.2f" : "%.2f", found[i] || loading ? lengths[i] : -1.f);
+		if (written < 0)
+		{
+			szResult[used] = 0;
+			break;
+		}
+		used += written;
+	}
+}
+
 bool MQ2NavigationPlugin::CanNavigateToPoint(PCHAR szLine)
 {
 	glm::vec3 destination;
+	NavigationFilter filter;
 	bool result = false;
 
-	if (ParseDestination(szLine, destination)) {
-		NavigationPath path(m_meshLoader->GetNavMesh());
-		path.FindPath(destination);
-		result = path.GetPathSize() > 0;
+	if (ParseDestination(szLine, destination) && ParseFilter(szLine, filter, false)) {
+		float length;
+		result = GetPathResult(destination, filter, length);
 	}
 
 	return result;
@@ -730,6 +1158,7 @@ void MQ2NavigationPlugin::Stop()
 
 	m_activePath.reset();
 	m_isActive = false;
+	m_linkCrossing = LinkCrossing();
 
 	m_pEndingDoor = nullptr;
 	m_pEndingItem = nullptr;
@@ -783,6 +1212,63 @@ void MQ2NavigationPlugin::OnUpdateUI()
 			ImGui::LabelText("Last Click", "%d", m_lastClick.time_since_epoch());
 			ImGui::LabelText("Pathfind Timer", "%d", m_pathfindTimer.time_since_epoch());
 
+			auto queryStats = m_queryPool->GetStats();
+			ImGui::LabelText("Path Queries", "%u (%u allocated)", queryStats.acquired, queryStats.created);
+
+			auto& graphStats = m_clusterGraph->GetStats();
+			ImGui::LabelText("Clusters", "%d (%d portals, %d edges)", graphStats.clusters,
+				graphStats.portals, graphStats.edges);
+			ImGui::LabelText("Components", "%d", graphStats.components);
+			ImGui::LabelText("Cluster Graph Build", "%.2f ms (%d tiles)", graphStats.buildTimeMs,
+				graphStats.tilesUpdated);
+			ImGui::LabelText("Cluster Routes", "%d (last expanded %d)", graphStats.routes,
+				graphStats.lastExpansions);
+
+			if (auto landmarks = m_meshLoader->GetLandmarks())
+			{
+				ImGui::LabelText("Landmarks", "%d (%d tiles)", landmarks->GetLandmarkCount(),
+					landmarks->GetTileCount());
+			}
+			else
+			{
+				ImGui::LabelText("Landmarks", "none");
+			}
+
+			auto& indexStats = m_polyIndex->GetStats();
+			ImGui::LabelText("Poly Index", "%d cells, %d entries (%.2f ms)", indexStats.cells,
+				indexStats.entries, indexStats.buildTimeMs);
+			ImGui::LabelText("Nearest Poly Queries", "%u (%u hinted, %.1f polys each)", indexStats.queries,
+				indexStats.hintHits, indexStats.queries ? float(indexStats.polysChecked) / indexStats.queries : 0.0f);
+
+			auto& cacheStats = m_pathCache->GetStats();
+			uint32_t lookups = cacheStats.hits + cacheStats.misses;
+			ImGui::LabelText("Path Cache", "%u/%u hits (%.0f%%), %d entries", cacheStats.hits, lookups,
+				lookups ? 100.0f * cacheStats.hits / lookups : 0.0f, static_cast<int>(m_pathCache->GetSize()));
+			ImGui::LabelText("Path Cache Resets", "%u", cacheStats.invalidations);
+
+			if (m_obstacles->IsAvailable())
+			{
+				auto& obstacleStats = m_obstacles->GetStats();
+				ImGui::LabelText("Obstacles", "%d (%d pending)", m_obstacles->GetObstacleCount(),
+					obstacleStats.pending);
+				ImGui::LabelText("Obstacle Layers", "%d (%d KB)", obstacleStats.layers,
+					static_cast<int>(obstacleStats.layerBytes / 1024));
+				ImGui::LabelText("Obstacle Tile Updates", "%u (%.2f ms last pulse, %.2f ms max)",
+					obstacleStats.tileUpdates, obstacleStats.lastPulseMs, obstacleStats.maxPulseMs);
+			}
+			else
+			{
+				ImGui::LabelText("Obstacles", "unavailable");
+			}
+
+			auto links = m_meshLoader->GetOffMeshLinks();
+			ImGui::LabelText("Off-Mesh Links", "%d (%d crossed)", links ? links->GetCount() : 0, m_linksCrossed);
+			if (m_linkCrossing.active)
+			{
+				ImGui::LabelText("Crossing Link", "%u (%s)", m_linkCrossing.id,
+					GetLinkActionName(m_linkCrossing.action));
+			}
+
 			ImGui::TreePop();
 		}
 
@@ -812,6 +1298,82 @@ void MQ2NavigationPlugin::OnUpdateUI()
 				changed = true;
 			if (ImGui::IsItemHovered())
 				ImGui::SetTooltip("Automatically reload the navmesh when it is modified");
+
+			if (ImGui::Checkbox("Map nav mesh files", &settings.map_mesh_files))
+				changed = true;
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("Load navmesh tiles directly from a memory mapped file. Faster zoning, and the\n"
+					"mesh generator can still save over the file while it is loaded.");
+
+			if (ImGui::Checkbox("Lazy tile loading", &settings.lazy_tile_loading))
+				changed = true;
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("Only load the navmesh tiles near the character (and along paths), loading\n"
+					"the rest as they are needed. Takes effect the next time the navmesh is loaded.");
+
+			if (settings.lazy_tile_loading)
+			{
+				if (ImGui::DragFloat("Tile load radius", &settings.tile_load_radius, 10.0f, 0.0f, 10000.0f, "%.0f"))
+					changed = true;
+				if (ImGui::IsItemHovered())
+					ImGui::SetTooltip("Distance around the character to keep tiles loaded");
+
+				if (ImGui::DragInt("Tile memory (MB)", &settings.tile_memory_budget, 1.0f, 1, 1024))
+					changed = true;
+				if (ImGui::IsItemHovered())
+					ImGui::SetTooltip("Tiles that haven't been used recently are unloaded to stay under this limit");
+			}
+
+			if (ImGui::DragInt("Path search time (us)", &settings.path_search_budget, 100.0f, 0, 100000))
+				changed = true;
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("Time to spend searching for a path each frame. Long searches continue on the\n"
+					"next frame instead of stalling the game. 0 to always finish the search right away.");
+
+			if (ImGui::Checkbox("Use landmarks", &settings.use_landmarks))
+				changed = true;
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("Use the landmark tables saved with the navmesh to guide path searches. They\n"
+					"find the same paths, but look at fewer polys in zones with winding passages.");
+
+			if (ImGui::Checkbox("Shortcut paths", &settings.shortcut_paths))
+				changed = true;
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("Skip waypoints that can be walked past in a straight line, so the path has\n"
+					"fewer, longer legs.");
+
+			if (ImGui::TreeNode("Path Filter"))
+			{
+				unsigned int includeFlags = settings.filter.includeFlags;
+				if (ImGui::CheckboxFlags("Walk", &includeFlags, NavFlag_Walk))
+					changed = true;
+				ImGui::SameLine();
+				if (ImGui::CheckboxFlags("Swim", &includeFlags, NavFlag_Swim))
+					changed = true;
+				ImGui::SameLine();
+				if (ImGui::CheckboxFlags("Door", &includeFlags, NavFlag_Door))
+					changed = true;
+				ImGui::SameLine();
+				if (ImGui::CheckboxFlags("Jump", &includeFlags, NavFlag_Jump))
+					changed = true;
+				settings.filter.includeFlags = static_cast<uint16_t>(includeFlags);
+
+				for (int i = 0; i < NavArea_Count; ++i)
+				{
+					char label[32];
+					sprintf_s(label, "%s cost", GetAreaName(i));
+					if (ImGui::DragFloat(label, &settings.filter.areaCosts[i], 0.1f,
+						NavigationFilter::MIN_AREA_COST, 1000.0f, "%.1f"))
+					{
+						changed = true;
+					}
+				}
+				if (ImGui::IsItemHovered())
+					ImGui::SetTooltip("Cost to cross each kind of area, compared to open ground. These can be\n"
+						"changed for a single navigation with options like water=10.");
+
+				ImGui::TreePop();
+			}
 		}
 
 		// "Objects" section
@@ -6,10 +6,14 @@
 
 #include "MQ2Plugin.h"
 
+#include "NavigationFilter.h"
+#include "NavigationPathCache.h"
+#include "NavMeshOffMeshLinks.h"
 #include "Signal.h"
 
 #include <memory>
 #include <chrono>
+#include <string>
 
 #define GLM_FORCE_RADIANS
 #include <glm.hpp>
@@ -25,6 +29,10 @@ class NavigationPath;
 class ModelLoader;
 class RenderHandler;
 class NavMeshLoader;
+class NavMeshQueryPool;
+class NavMeshClusterGraph;
+class NavMeshPolyIndex;
+class NavMeshObstacles;
 
 extern std::unique_ptr<MQ2NavigationPlugin> g_mq2Nav;
 
@@ -64,25 +72,55 @@ public:
 	// how often to update the path (in milliseconds)
 	static const int PATHFINDING_DELAY_MS = 200;
 
+	// Crossing an off-mesh link is done once we're this close to the end of
+	// it, or this far from the start (a teleporter that put us somewhere
+	// else). It's abandoned if neither happens in time.
+	static constexpr float LINK_ARRIVAL_DISTANCE = 10.0f;
+	static constexpr float LINK_DEPARTURE_DISTANCE = 50.0f;
+	static const int LINK_TIMEOUT_MS = 10000;
+
+	// size of an obstacle around a spawn or door, when none is given
+	static constexpr float OBSTACLE_DEFAULT_RADIUS = 5.0f;
+	static constexpr float OBSTACLE_DEFAULT_HEIGHT = 10.0f;
+
+	// path length given to the TLO while the mesh is still loading. -1 means
+	// there is no path.
+	static constexpr float PATH_LENGTH_LOADING = -2.0f;
+
 	//----------------------------------------------------------------------------
 
 	bool IsActive() const { return m_isActive; }
 	bool IsPaused() const { return m_isPaused; }
 	bool IsMeshLoaded() const;
 
+	// True while the zone's mesh is loading in the background and there is
+	// no mesh to use yet. Reloading a mesh keeps the old one in use, so that
+	// doesn't count.
+	bool IsMeshLoading() const;
+
 	// Load navigation mesh for the current zone
 	bool LoadNavigationMesh();
 
-	// Check if a point is pathable (given a coordinate string)
+	// Check if a point is pathable (given a coordinate string). False while
+	// the mesh is loading, check IsMeshLoading() to tell the two apart.
 	bool CanNavigateToPoint(PCHAR szLine);
 
-	// Check how far away a point is (given a coordinate string)
+	// Check how far away a point is (given a coordinate string). Returns -1
+	// if there is no path, or PATH_LENGTH_LOADING while the mesh is loading.
 	float GetNavigationPathLength(PCHAR szLine);
 
+	// Check how far away a list of spawns are (given their spawn ids). Writes
+	// a comma separated list of path lengths, -1 for unreachable spawns, or
+	// PATH_LENGTH_LOADING for all of them while the mesh is loading.
+	void GetNavigationPathLengths(PCHAR szLine, PCHAR szResult, size_t resultSize);
+
 	// Begin navigating to a point
-	void BeginNavigation(const glm::vec3& pos);
+	void BeginNavigation(const glm::vec3& pos, const NavigationFilter& filter);
 
 	NavMeshLoader* GetMeshLoader() const { return m_meshLoader.get(); }
+	NavMeshClusterGraph* GetClusterGraph() const { return m_clusterGraph.get(); }
+	NavMeshPolyIndex* GetPolyIndex() const { return m_polyIndex.get(); }
+	NavMeshObstacles* GetObstacles() const { return m_obstacles.get(); }
 
 private:
 	void Initialize();
@@ -90,12 +128,24 @@ private:
 
 	void UpdateCurrentZone();
 	void OnUpdateUI();
+	void OnNavMeshChanged();
 
 	//----------------------------------------------------------------------------
 
 	bool ParseDestination(PCHAR szLine, glm::vec3& destination);
 
-	float GetNavigationPathLength(const glm::vec3& pos);
+	// Handler for /navigate obstacle
+	void Command_Obstacle(PCHAR szLine);
+
+	// Start with the filter from the settings and apply any name=value
+	// options in the line. Returns false if one of them isn't valid.
+	bool ParseFilter(PCHAR szLine, NavigationFilter& filter, bool showErrors);
+
+	float GetNavigationPathLength(const glm::vec3& pos, const NavigationFilter& filter);
+
+	// find a path (or follow the polys of a cached one) for the TLO.
+	// Returns true if there is a path, and its length in length.
+	bool GetPathResult(const glm::vec3& pos, const NavigationFilter& filter, float& length);
 
 	void AttemptClick();
 	bool ClickNearestClosedDoor(float cDistance = 30);
@@ -107,6 +157,13 @@ private:
 	void AttemptMovement();
 	void Stop();
 
+	// Off-mesh links: at the start of one, do whatever the link says to
+	// (click a door, run a command), then wait until we come out the other
+	// end before following the path again.
+	void BeginLinkCrossing();
+	bool UpdateLinkCrossing();
+	bool ClickDoorByName(const std::string& name, const glm::vec3& nearPos);
+
 	void OnMovementKeyPressed();
 
 	void UpdateNavigationDisplay();
@@ -117,10 +174,18 @@ private:
 
 	// our nav mesh and active path
 	std::unique_ptr<NavMeshLoader> m_meshLoader;
+	std::unique_ptr<NavMeshQueryPool> m_queryPool;
+	std::unique_ptr<NavMeshClusterGraph> m_clusterGraph;
+	std::unique_ptr<NavMeshPolyIndex> m_polyIndex;
+	std::unique_ptr<NavigationPathCache> m_pathCache;
+	std::unique_ptr<NavMeshObstacles> m_obstacles;
 	std::unique_ptr<ModelLoader> m_modelLoader;
 	std::unique_ptr<NavigationPath> m_activePath;
 
 	Signal<>::ScopedConnection m_uiConn;
+	Signal<dtNavMesh*>::ScopedConnection m_navMeshConn;
+	Signal<dtNavMesh*>::ScopedConnection m_meshHelpersConn;
+	Signal<>::ScopedConnection m_tileHelpersConn;
 
 	bool m_initialized = false;
 	int m_zoneId = -1;
@@ -149,6 +214,19 @@ private:
 
 	clock::time_point m_pathfindTimer = clock::now();
 
+	// the off-mesh link we are crossing. Positions are in detour coordinates.
+	struct LinkCrossing
+	{
+		bool active = false;
+		uint32_t id = 0;
+		NavMeshLinkAction action = NavLinkAction_Walk;
+		glm::vec3 start;
+		glm::vec3 end;
+		clock::time_point startTime;
+	};
+	LinkCrossing m_linkCrossing;
+	int m_linksCrossed = 0;
+
 	Signal<>::ScopedConnection m_keypressConn;
 };
 
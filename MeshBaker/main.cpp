@@ -0,0 +1,52 @@
+//
+// main.cpp
+//
+// MeshBaker: the MeshGenerator batch bake on its own, for build machines and
+// scripts. Nothing here needs a window, so this also builds on Linux.
+//
+
+#include "BatchBaker.h"
+
+#include "zone-utilities/log/log_macros.h"
+#include "zone-utilities/log/log_file.h"
+
+#include <boost/filesystem.hpp>
+
+#include <cstdio>
+#include <memory>
+
+// MeshBaker --eq <path> --output <path> [--reports <path>] [--jobs <n>]
+//     [--threads <n>] [--rebuild] [--check-determinism] <zone> [<zone> ...]
+int main(int argc, char* argv[])
+{
+	BatchBakeOptions options;
+
+	if (!ParseBatchBakeArgs(argc, argv, 1, options))
+		return 1;
+
+	// there's no Zones.ini here to list them from
+	if (options.allZones)
+	{
+		fprintf(stderr, "MeshBaker needs the zone names, use MeshGenerator.exe --bake for all\n");
+		return 1;
+	}
+
+	if (options.zones.empty() || options.everquestPath.empty() || options.outputPath.empty())
+	{
+		fprintf(stderr, "usage: %s --eq <path> --output <path> [--reports <path>]\n"
+			"    [--jobs <n>] [--threads <n>] [--rebuild] [--check-determinism]\n"
+			"    <zone> [<zone> ...]\n", argv[0]);
+		return 1;
+	}
+
+	// the zone loaders log here, the console is for the bake progress
+	boost::system::error_code ec;
+	boost::filesystem::create_directories(options.outputPath, ec);
+
+	eqLogInit(-1);
+	eqLogRegister(std::make_shared<EQEmu::Log::LogFile>(
+		(boost::filesystem::path(options.outputPath) / "MeshBaker.log").string()));
+
+	BatchBaker baker(options);
+	return baker.Run() == 0 ? 0 : 2;
+}
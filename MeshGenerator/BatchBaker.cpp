@@ -0,0 +1,426 @@
+//
+// BatchBaker.cpp
+//
+
+#include "BatchBaker.h"
+
+#include "BuildContext.h"
+#include "InputGeom.h"
+#include "Sample_TileMesh.h"
+#include "TileBuildArena.h"
+#include "TileBuildScheduler.h"
+
+#include "DetourNavMesh.h"
+
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+//----------------------------------------------------------------------------
+
+namespace {
+
+// zones print their progress from different threads
+std::mutex s_consoleMutex;
+
+void PrintLine(const std::string& zone, const char* category, const std::string& message)
+{
+	std::lock_guard<std::mutex> lock(s_consoleMutex);
+	printf("[%s] %s%s\n", zone.c_str(), category, message.c_str());
+	fflush(stdout);
+}
+
+// Prints the errors and warnings from building a zone, and keeps them for
+// the report.
+class BatchBuildContext : public BuildContext
+{
+public:
+	BatchBuildContext(const std::string& zone, std::vector<std::string>& messages)
+		: m_zone(zone)
+		, m_messages(messages)
+	{
+	}
+
+protected:
+	virtual void doLog(const rcLogCategory category, const char* msg, const int len) override
+	{
+		if (category == RC_LOG_PROGRESS || len <= 0)
+			return;
+
+		std::string message(msg, static_cast<size_t>(len));
+		while (!message.empty() && message.back() == '\n')
+			message.pop_back();
+
+		PrintLine(m_zone, category == RC_LOG_ERROR ? "error: " : "warning: ", message);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_messages.push_back(std::move(message));
+	}
+
+private:
+	std::string m_zone;
+	std::vector<std::string>& m_messages;
+	std::mutex m_mutex;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+float ElapsedMs(Clock::time_point start)
+{
+	return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+// Builds every tile of the zone into the mesh and waits for it to finish.
+// Tiles are only reused from the build cache if there is one.
+bool BuildAllTiles(Sample_TileMesh& mesh, InputGeom& geom, BuildContext& context, int threads,
+	const std::string& buildCachePath)
+{
+	mesh.setContext(&context);
+	mesh.setBuildThreads(threads);
+	mesh.setReuseTiles(!buildCachePath.empty());
+	mesh.handleMeshChanged(&geom);
+	if (!buildCachePath.empty())
+		mesh.setBuildCachePath(buildCachePath);
+
+	bool built = mesh.handleBuild();
+	mesh.waitForBuildAllTiles();
+
+	return built && mesh.getNavMesh() != nullptr;
+}
+
+bool ReadFileBytes(const std::string& filename, std::vector<char>& data)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return !file.bad();
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+bool ParseBatchBakeArgs(int argc, char* argv[], int first, BatchBakeOptions& options)
+{
+	for (int i = first; i < argc; ++i)
+	{
+		const bool hasValue = i + 1 < argc;
+
+		if (!strcmp(argv[i], "--eq") && hasValue)
+			options.everquestPath = argv[++i];
+		else if (!strcmp(argv[i], "--output") && hasValue)
+			options.outputPath = argv[++i];
+		else if (!strcmp(argv[i], "--reports") && hasValue)
+			options.reportPath = argv[++i];
+		else if (!strcmp(argv[i], "--jobs") && hasValue)
+			options.jobs = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--threads") && hasValue)
+			options.threadsPerZone = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--rebuild"))
+			options.reuseTiles = false;
+		else if (!strcmp(argv[i], "--check-determinism"))
+			options.checkDeterminism = true;
+		else if (!strcmp(argv[i], "all"))
+			options.allZones = true;
+		else if (argv[i][0] == '-')
+		{
+			fprintf(stderr, "Unknown option: %s\n", argv[i]);
+			return false;
+		}
+		else
+			options.zones.push_back(argv[i]);
+	}
+
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+BatchBaker::BatchBaker(const BatchBakeOptions& options)
+	: m_options(options)
+{
+}
+
+std::string BatchBaker::GetMeshDirectory() const
+{
+	return (boost::filesystem::path(m_options.outputPath) / "MQ2Nav").string();
+}
+
+int BatchBaker::Run()
+{
+	const int zoneCount = static_cast<int>(m_options.zones.size());
+	m_results.clear();
+	m_results.resize(zoneCount);
+
+	if (zoneCount == 0)
+		return 0;
+
+	boost::system::error_code ec;
+	boost::filesystem::create_directories(GetMeshDirectory(), ec);
+	if (!m_options.reportPath.empty())
+		boost::filesystem::create_directories(m_options.reportPath, ec);
+
+	// A few zones at a time, each with a share of the cores for its tiles.
+	// Zones are uneven enough that one per core would leave most of them
+	// waiting on the big ones anyway.
+	const int cores = TileBuildScheduler::GetCoreCount();
+	int jobs = m_options.jobs > 0 ? m_options.jobs : std::max(1, cores / 4);
+	jobs = std::min(jobs, zoneCount);
+
+	const int threads = m_options.threadsPerZone > 0
+		? m_options.threadsPerZone : std::max(1, cores / jobs);
+
+	printf("Building %d zone(s), %d at a time with %d thread(s) each\n", zoneCount, jobs, threads);
+	if (m_options.checkDeterminism)
+		printf("Building each zone again on one thread to check that it comes out the same\n");
+
+	// before any of the samples are made on the job threads
+	TileBuildArena::InstallAllocator();
+
+	std::atomic<int> nextZone{ 0 };
+	auto worker = [&]()
+	{
+		for (int i = nextZone++; i < zoneCount; i = nextZone++)
+		{
+			BatchBakeResult& result = m_results[i];
+			BakeZone(m_options.zones[i], threads, result);
+
+			if (!WriteReport(result) && result.success)
+			{
+				result.success = false;
+				result.error = "Could not write the report";
+			}
+
+			char summary[256];
+			snprintf(summary, sizeof(summary), "%s in %.1fs (%d tiles, %d reused, %d polys, %zu KB%s)",
+				result.success ? "done" : "FAILED", result.totalTime / 1000.0f,
+				result.tileCount, result.tilesReused, result.polyCount, result.fileBytes / 1024,
+				!result.determinismChecked ? "" : result.deterministic ? ", deterministic" : ", NOT deterministic");
+			PrintLine(result.zone, "",
+				result.success ? summary : std::string(summary) + ": " + result.error);
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (int i = 0; i < jobs; ++i)
+		workers.emplace_back(worker);
+	for (std::thread& thread : workers)
+		thread.join();
+
+	int failures = 0;
+	for (const BatchBakeResult& result : m_results)
+	{
+		if (!result.success)
+			failures++;
+	}
+
+	printf("Built %d of %d zone(s)\n", zoneCount - failures, zoneCount);
+	return failures;
+}
+
+void BatchBaker::BakeZone(const std::string& zone, int threads, BatchBakeResult& result)
+{
+	result = BatchBakeResult();
+	result.zone = zone;
+
+	auto totalStart = Clock::now();
+	BatchBuildContext context(zone, result.messages);
+
+	// load the geometry
+	auto start = Clock::now();
+	InputGeom geom(zone, m_options.everquestPath, m_options.outputPath);
+	if (!geom.loadMesh(&context))
+	{
+		result.error = "Could not load the zone geometry";
+		result.totalTime = ElapsedMs(totalStart);
+		return;
+	}
+	result.loadTime = ElapsedMs(start);
+
+	const MapGeometryLoader* loader = geom.getMeshLoader();
+	result.vertCount = loader->getVertCount();
+	result.triCount = loader->getTriCount();
+	result.geometryBytes = static_cast<size_t>(result.vertCount) * 3 * sizeof(float)
+		+ static_cast<size_t>(result.triCount) * 3 * sizeof(int);
+
+	const boost::filesystem::path meshDirectory(GetMeshDirectory());
+	const std::string meshFile = (meshDirectory / (zone + ".bin")).string();
+
+	// build all of the tiles. Reused tiles would hide a difference between
+	// the two builds when checking them against each other.
+	const bool reuseTiles = m_options.reuseTiles && !m_options.checkDeterminism;
+	const std::string buildCachePath = reuseTiles
+		? (meshDirectory / (zone + ".buildcache")).string() : std::string();
+
+	Sample_TileMesh mesh;
+
+	start = Clock::now();
+	bool built = BuildAllTiles(mesh, geom, context, threads, buildCachePath);
+	result.buildTime = ElapsedMs(start);
+	result.tilesReused = mesh.getTilesReused();
+
+	const dtNavMesh* navMesh = mesh.getNavMesh();
+	if (!built)
+	{
+		result.error = "Could not set up the navmesh";
+		result.totalTime = ElapsedMs(totalStart);
+		return;
+	}
+
+	for (int i = 0; i < navMesh->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = navMesh->getTile(i);
+		if (!tile || !tile->header)
+			continue;
+
+		result.tileCount++;
+		result.polyCount += tile->header->polyCount;
+		result.navMeshBytes += tile->dataSize;
+	}
+
+	if (result.tileCount == 0)
+	{
+		result.error = "No tiles were built";
+		result.totalTime = ElapsedMs(totalStart);
+		return;
+	}
+
+	// save it, along with the landmarks and anything else that goes in the file
+	start = Clock::now();
+	if (!mesh.SaveMesh(meshFile))
+	{
+		result.error = "Could not save " + meshFile;
+		result.totalTime = ElapsedMs(totalStart);
+		return;
+	}
+	result.saveTime = ElapsedMs(start);
+
+	boost::system::error_code ec;
+	result.fileBytes = static_cast<size_t>(boost::filesystem::file_size(meshFile, ec));
+
+	if (m_options.checkDeterminism && !CheckDeterminism(geom, context, meshFile, result))
+	{
+		result.totalTime = ElapsedMs(totalStart);
+		return;
+	}
+
+	result.success = true;
+	result.totalTime = ElapsedMs(totalStart);
+}
+
+bool BatchBaker::CheckDeterminism(InputGeom& geom, BuildContext& context, const std::string& meshFile,
+	BatchBakeResult& result)
+{
+	auto start = Clock::now();
+	result.determinismChecked = true;
+
+	// Build it again on one thread, so that the tiles finish in a different
+	// order, and save it next to the real one to compare.
+	const std::string checkFile = meshFile + ".check";
+
+	Sample_TileMesh mesh;
+	if (!BuildAllTiles(mesh, geom, context, 1, std::string()) || !mesh.SaveMesh(checkFile))
+	{
+		result.error = "Could not build the mesh again to check it";
+		result.checkTime = ElapsedMs(start);
+		return false;
+	}
+
+	std::vector<char> expected, actual;
+	bool read = ReadFileBytes(meshFile, expected) && ReadFileBytes(checkFile, actual);
+
+	boost::system::error_code ec;
+	boost::filesystem::remove(checkFile, ec);
+
+	result.checkTime = ElapsedMs(start);
+
+	if (!read)
+	{
+		result.error = "Could not read the meshes back to compare them";
+		return false;
+	}
+
+	result.deterministic = expected == actual;
+	if (!result.deterministic)
+	{
+		auto mismatch = std::mismatch(expected.begin(), expected.end(), actual.begin(), actual.end());
+		result.error = "The mesh built on one thread is different, from byte "
+			+ std::to_string(mismatch.first - expected.begin());
+		return false;
+	}
+
+	return true;
+}
+
+bool BatchBaker::WriteReport(const BatchBakeResult& result) const
+{
+	const std::string directory = m_options.reportPath.empty() ? GetMeshDirectory() : m_options.reportPath;
+	const std::string filename = (boost::filesystem::path(directory) / (result.zone + ".json")).string();
+
+	std::ofstream file(filename);
+	if (!file.is_open())
+		return false;
+
+	rapidjson::StringBuffer sb;
+	rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(sb);
+
+	writer.StartObject();
+
+	writer.String("zone"); writer.String(result.zone.c_str());
+	writer.String("success"); writer.Bool(result.success);
+	writer.String("error"); writer.String(result.error.c_str());
+
+	writer.String("timeMs");
+	writer.StartObject();
+	writer.String("load"); writer.Double(result.loadTime);
+	writer.String("build"); writer.Double(result.buildTime);
+	writer.String("save"); writer.Double(result.saveTime);
+	writer.String("check"); writer.Double(result.checkTime);
+	writer.String("total"); writer.Double(result.totalTime);
+	writer.EndObject();
+
+	writer.String("geometry");
+	writer.StartObject();
+	writer.String("verts"); writer.Int(result.vertCount);
+	writer.String("tris"); writer.Int(result.triCount);
+	writer.String("bytes"); writer.Uint64(result.geometryBytes);
+	writer.EndObject();
+
+	writer.String("navMesh");
+	writer.StartObject();
+	writer.String("tiles"); writer.Int(result.tileCount);
+	writer.String("tilesReused"); writer.Int(result.tilesReused);
+	writer.String("polys"); writer.Int(result.polyCount);
+	writer.String("bytes"); writer.Uint64(result.navMeshBytes);
+	writer.String("fileBytes"); writer.Uint64(result.fileBytes);
+	writer.EndObject();
+
+	if (result.determinismChecked)
+	{
+		writer.String("deterministic"); writer.Bool(result.deterministic);
+	}
+
+	writer.String("messages");
+	writer.StartArray();
+	for (const std::string& message : result.messages)
+		writer.String(message.c_str());
+	writer.EndArray();
+
+	writer.EndObject();
+
+	file << sb.GetString() << std::endl;
+	return file.good();
+}
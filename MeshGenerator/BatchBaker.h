@@ -0,0 +1,116 @@
+//
+// BatchBaker.h
+//
+// Builds and saves meshes for a list of zones without the interface, for
+// refreshing meshes from a script:
+//
+//   MeshGenerator.exe --bake [options] <zone> [<zone> ...]
+//   MeshGenerator.exe --bake [options] all
+//   MeshBaker [options] <zone> [<zone> ...]
+//
+// MeshBaker is the same bake without the interface or its dependencies, so
+// it can also be built on Linux. It has no Zones.ini, so it needs the paths
+// and the zone names on the command line.
+//
+// Zones are built in parallel, and so are the tiles within each zone. Each
+// zone gets a .bin in <output>/MQ2Nav and a .json report next to it with how
+// long the load, build and save took and how big the results are.
+//
+// Tiles that haven't changed since the last bake come out of the build cache
+// next to the mesh, unless --rebuild is given.
+//
+// With --check-determinism each zone is built a second time on one thread
+// and the two files are compared byte for byte. The zone fails if they
+// differ. This implies --rebuild, so both builds do all of the work.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+class BuildContext;
+class InputGeom;
+
+struct BatchBakeOptions
+{
+	std::string everquestPath;
+	std::string outputPath;
+
+	// where to write the reports, the mesh directory if empty
+	std::string reportPath;
+
+	std::vector<std::string> zones;
+
+	// zones to build at once (0 to pick from the core count), and the tile
+	// build threads for each of them (0 to split the cores between them)
+	int jobs = 0;
+	int threadsPerZone = 0;
+
+	// reuse tiles from the last bake's build cache
+	bool reuseTiles = true;
+
+	// build each zone again on one thread and check that the file is the same
+	bool checkDeterminism = false;
+
+	// "all" was given instead of zone names
+	bool allZones = false;
+};
+
+// Reads the bake options from argv[first] on. Paths given here replace the
+// ones already in options. Prints the problem and returns false for an
+// option it doesn't know.
+bool ParseBatchBakeArgs(int argc, char* argv[], int first, BatchBakeOptions& options);
+
+struct BatchBakeResult
+{
+	std::string zone;
+	bool success = false;
+	std::string error;
+
+	// milliseconds
+	float loadTime = 0;
+	float buildTime = 0;
+	float saveTime = 0;
+	float totalTime = 0;
+
+	int vertCount = 0;
+	int triCount = 0;
+	size_t geometryBytes = 0;
+
+	int tileCount = 0;
+	int tilesReused = 0;
+	int polyCount = 0;
+	size_t navMeshBytes = 0;
+	size_t fileBytes = 0;
+
+	// set if the zone was built a second time to compare against
+	bool determinismChecked = false;
+	bool deterministic = false;
+	float checkTime = 0;
+
+	// errors and warnings from the build
+	std::vector<std::string> messages;
+};
+
+class BatchBaker
+{
+public:
+	explicit BatchBaker(const BatchBakeOptions& options);
+
+	// Builds all of the zones, and returns the number that failed.
+	int Run();
+
+	const std::vector<BatchBakeResult>& GetResults() const { return m_results; }
+
+private:
+	void BakeZone(const std::string& zone, int threads, BatchBakeResult& result);
+	bool CheckDeterminism(InputGeom& geom, BuildContext& context, const std::string& meshFile,
+		BatchBakeResult& result);
+	bool WriteReport(const BatchBakeResult& result) const;
+
+	std::string GetMeshDirectory() const;
+
+	BatchBakeOptions m_options;
+	std::vector<BatchBakeResult> m_results;
+};
@@ -0,0 +1,226 @@
+//
+// BuildContext.cpp
+//
+
+#include "BuildContext.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include <cstdarg>
+#include <cstdio>
+
+//----------------------------------------------------------------------------
+
+static const int32_t MAX_LOG_MESSAGES = 1000;
+
+BuildContext::BuildContext()
+{
+	resetTimers();
+}
+
+BuildContext::~BuildContext()
+{
+}
+
+//----------------------------------------------------------------------------
+
+void BuildContext::doResetLog()
+{
+	std::unique_lock<std::mutex> lock(m_mtx);
+
+	m_logs.clear();
+}
+
+void BuildContext::doLog(const rcLogCategory category,
+	const char* message, const int length)
+{
+#if 0
+	if (!length)
+		return;
+
+	std::unique_lock<std::mutex> lock(m_mtx);
+
+	// if the message buffer is full, drop an old message
+	if (m_logs.size() > MAX_LOG_MESSAGES)
+		m_logs.pop_front();
+
+	m_logs.emplace_back(std::string(message, static_cast<std::size_t>(length)));
+#endif
+#if defined(_WIN32)
+	OutputDebugStringA(message);
+#endif
+}
+
+void BuildContext::dumpLog(const char* format, ...)
+{
+	return;
+
+
+	// Print header.
+	va_list ap;
+	va_start(ap, format);
+	vprintf(format, ap);
+	va_end(ap);
+	printf("\n");
+
+	std::unique_lock<std::mutex> lock(m_mtx);
+
+	// Print messages
+	const int TAB_STOPS[4] = { 28, 36, 44, 52 };
+	for (auto& message : m_logs)
+	{
+		const char* msg = message.c_str();
+		int n = 0;
+		while (*msg)
+		{
+			if (*msg == '\t')
+			{
+				int count = 1;
+				for (int j = 0; j < 4; ++j)
+				{
+					if (n < TAB_STOPS[j])
+					{
+						count = TAB_STOPS[j] - n;
+						break;
+					}
+				}
+				while (--count)
+				{
+					putchar(' ');
+					n++;
+				}
+			}
+			else
+			{
+				putchar(*msg);
+				n++;
+			}
+			msg++;
+		}
+		putchar('\n');
+	}
+}
+
+const char* BuildContext::getLogText(int32_t index) const
+{
+	std::unique_lock<std::mutex> lock(m_mtx);
+
+	if (index >= 0 && index < (int32_t)m_logs.size())
+		return m_logs[index].c_str();
+
+	return nullptr;
+}
+
+int BuildContext::getLogCount() const
+{
+	std::unique_lock<std::mutex> lock(m_mtx);
+
+	return m_logs.size();
+}
+
+//----------------------------------------------------------------------------
+
+void BuildContext::doResetTimers()
+{
+	for (int i = 0; i < RC_MAX_TIMERS; ++i)
+		m_accTime[i] = -1;
+}
+
+void BuildContext::doStartTimer(const rcTimerLabel label)
+{
+	m_startTime[label] = getPerfTime();
+}
+
+void BuildContext::doStopTimer(const rcTimerLabel label)
+{
+	const TimeVal endTime = getPerfTime();
+	const int deltaTime = static_cast<int>(endTime - m_startTime[label]);
+	if (m_accTime[label] == -1)
+		m_accTime[label] = deltaTime;
+	else
+		m_accTime[label] += deltaTime;
+}
+
+int BuildContext::doGetAccumulatedTime(const rcTimerLabel label) const
+{
+	return m_accTime[label];
+}
+
+//----------------------------------------------------------------------------
+
+void BuildContext::addTileContext(const TileBuildContext& tileContext)
+{
+	for (int i = 0; i < RC_MAX_TIMERS; ++i)
+	{
+		const int time = tileContext.getAccumulatedTime(static_cast<rcTimerLabel>(i));
+		if (time == -1)
+			continue;
+
+		if (m_accTime[i] == -1)
+			m_accTime[i] = time;
+		else
+			m_accTime[i] += time;
+	}
+
+	for (const auto& message : tileContext.getLogs())
+	{
+		log(message.category, "%s", message.text.c_str());
+	}
+}
+
+//============================================================================
+
+TileBuildContext::TileBuildContext(int tileX, int tileY, const float* tileBmin, const float* tileBmax)
+	: tx(tileX)
+	, ty(tileY)
+{
+	rcVcopy(bmin, tileBmin);
+	rcVcopy(bmax, tileBmax);
+
+	resetTimers();
+}
+
+TileBuildContext::~TileBuildContext()
+{
+}
+
+void TileBuildContext::doResetLog()
+{
+	m_logs.clear();
+}
+
+void TileBuildContext::doLog(const rcLogCategory category, const char* message, const int length)
+{
+	if (!length)
+		return;
+
+	m_logs.push_back({ category, std::string(message, static_cast<std::size_t>(length)) });
+}
+
+void TileBuildContext::doResetTimers()
+{
+	for (int i = 0; i < RC_MAX_TIMERS; ++i)
+		m_accTime[i] = -1;
+}
+
+void TileBuildContext::doStartTimer(const rcTimerLabel label)
+{
+	m_startTime[label] = getPerfTime();
+}
+
+void TileBuildContext::doStopTimer(const rcTimerLabel label)
+{
+	const TimeVal endTime = getPerfTime();
+	const int deltaTime = static_cast<int>(endTime - m_startTime[label]);
+	if (m_accTime[label] == -1)
+		m_accTime[label] = deltaTime;
+	else
+		m_accTime[label] += deltaTime;
+}
+
+int TileBuildContext::doGetAccumulatedTime(const rcTimerLabel label) const
+{
+	return m_accTime[label];
+}
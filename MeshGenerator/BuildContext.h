@@ -0,0 +1,92 @@
+//
+// BuildContext.h
+//
+// Logging and timers for building a mesh, for recast to report to. This is
+// used by the interface and by the command line bake, so it doesn't depend
+// on either.
+//
+
+#pragma once
+
+#include "Recast.h"
+#include "PerfTimer.h"
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class TileBuildContext;
+
+class BuildContext : public rcContext
+{
+public:
+	BuildContext();
+	virtual ~BuildContext();
+
+	// Adds the log and timers from building a tile. Call from one thread
+	// at a time.
+	void addTileContext(const TileBuildContext& tileContext);
+
+	// Dumps the log to stdout
+	void dumpLog(const char* format, ...);
+
+	// Returns the number of log messages
+	int getLogCount() const;
+
+	// Returns the log message text
+	const char* getLogText(int32_t index) const;
+
+protected:
+	virtual void doResetLog() override;
+	virtual void doLog(const rcLogCategory category, const char* msg, const int len) override;
+	virtual void doResetTimers() override;
+	virtual void doStartTimer(const rcTimerLabel label) override;
+	virtual void doStopTimer(const rcTimerLabel label) override;
+	virtual int doGetAccumulatedTime(const rcTimerLabel label) const override;
+
+private:
+	TimeVal m_startTime[RC_MAX_TIMERS];
+	int32_t m_accTime[RC_MAX_TIMERS];
+
+	std::deque<std::string> m_logs;
+	mutable std::mutex m_mtx;
+};
+
+// Log and timers for building one tile on a worker thread, along with the
+// tile's bounds. Each tile gets its own so the workers don't share anything,
+// and they are merged into the BuildContext in tile order once the build is
+// done.
+class TileBuildContext : public rcContext
+{
+public:
+	TileBuildContext(int tx, int ty, const float* bmin, const float* bmax);
+	virtual ~TileBuildContext();
+
+	const int tx;
+	const int ty;
+	float bmin[3];
+	float bmax[3];
+
+	struct LogMessage
+	{
+		rcLogCategory category;
+		std::string text;
+	};
+	const std::vector<LogMessage>& getLogs() const { return m_logs; }
+
+protected:
+	virtual void doResetLog() override;
+	virtual void doLog(const rcLogCategory category, const char* msg, const int len) override;
+	virtual void doResetTimers() override;
+	virtual void doStartTimer(const rcTimerLabel label) override;
+	virtual void doStopTimer(const rcTimerLabel label) override;
+	virtual int doGetAccumulatedTime(const rcTimerLabel label) const override;
+
+private:
+	TimeVal m_startTime[RC_MAX_TIMERS];
+	int32_t m_accTime[RC_MAX_TIMERS];
+
+	std::vector<LogMessage> m_logs;
+};
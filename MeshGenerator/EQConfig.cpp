@@ -14,7 +14,8 @@
 #include <string>
 #include <sstream>
 
-EQConfig::EQConfig()
+EQConfig::EQConfig(bool interactive)
+	: m_interactive(interactive)
 {
 	// Init COM library
 	::CoInitializeEx(NULL,
@@ -26,7 +27,8 @@ EQConfig::EQConfig()
 
 EQConfig::~EQConfig()
 {
-	SaveConfigToIni();
+	if (m_interactive)
+		SaveConfigToIni();
 
 	::CoUninitialize();
 }
@@ -146,7 +148,8 @@ void EQConfig::LoadConfigFromIni()
 
 	if (!GetPrivateProfileStringA("General", "EverQuest Path", "", eqPath, MAX_PATH, fullPath))
 	{
-		SelectEverquestPath();
+		if (m_interactive)
+			SelectEverquestPath();
 	}
 	else
 	{
@@ -157,7 +160,8 @@ void EQConfig::LoadConfigFromIni()
 
 	if (!GetPrivateProfileStringA("General", "Output Path", "", outPath, MAX_PATH, fullPath))
 	{
-		SelectOutputPath();
+		if (m_interactive)
+			SelectOutputPath();
 	}
 	else
 	{
@@ -12,12 +12,18 @@
 class EQConfig
 {
 public:
-	EQConfig();
+	// When not interactive (building from the command line), missing paths
+	// are left empty instead of asking for them, and nothing is saved.
+	explicit EQConfig(bool interactive = true);
 	~EQConfig();
 
 	const std::string& GetEverquestPath() const { return m_everquestPath; }
 	const std::string& GetOutputPath() const { return m_outputPath; }
 
+	// override the paths from the ini, for this run only
+	void SetEverquestPath(const std::string& path) { m_everquestPath = path; }
+	void SetOutputPath(const std::string& path) { m_outputPath = path; }
+
 	void SelectEverquestPath();
 	void SelectOutputPath();
 
@@ -43,6 +49,7 @@ private:
 
 	void LoadZones();
 
+	bool m_interactive;
 	std::string m_everquestPath;
 	std::string m_outputPath;
 
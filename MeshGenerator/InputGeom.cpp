@@ -103,7 +103,7 @@ InputGeom::~InputGeom()
 bool InputGeom::loadMesh(rcContext* ctx)
 {
 	m_chunkyMesh.reset();
-	m_offMeshConCount = 0;
+	m_offMeshLinks.Clear();
 	m_volumeCount = 0;
 	
 	m_loader.reset(new MapGeometryLoader(m_zoneShortName, m_eqPath, m_meshPath));
@@ -114,6 +114,27 @@ bool InputGeom::loadMesh(rcContext* ctx)
 		return false;
 	}
 
+	return initMesh(ctx);
+}
+
+bool InputGeom::loadMesh(rcContext* ctx, const std::vector<float>& verts, const std::vector<int>& tris)
+{
+	m_chunkyMesh.reset();
+	m_offMeshLinks.Clear();
+	m_volumeCount = 0;
+
+	m_loader.reset(new MapGeometryLoader(m_zoneShortName, m_eqPath, m_meshPath));
+	if (!m_loader->load(verts, tris))
+	{
+		ctx->log(RC_LOG_ERROR, "buildTiledNavigation: No vertices and triangles.");
+		return false;
+	}
+
+	return initMesh(ctx);
+}
+
+bool InputGeom::initMesh(rcContext* ctx)
+{
 	if (m_loader->getVerts() == nullptr)
 		return false;
 
@@ -225,34 +246,6 @@ bool InputGeom::raycastMesh(float* src, float* dst, float& tmin)
 #pragma endregion
 
 #pragma region Off-Mesh connections
-void InputGeom::addOffMeshConnection(const float* spos, const float* epos, const float rad,
-	unsigned char bidir, unsigned char area, unsigned short flags)
-{
-	if (m_offMeshConCount >= MAX_OFFMESH_CONNECTIONS) return;
-	float* v = &m_offMeshConVerts[m_offMeshConCount*3*2];
-	m_offMeshConRads[m_offMeshConCount] = rad;
-	m_offMeshConDirs[m_offMeshConCount] = bidir;
-	m_offMeshConAreas[m_offMeshConCount] = area;
-	m_offMeshConFlags[m_offMeshConCount] = flags;
-	m_offMeshConId[m_offMeshConCount] = 1000 + m_offMeshConCount;
-	rcVcopy(&v[0], spos);
-	rcVcopy(&v[3], epos);
-	m_offMeshConCount++;
-}
-
-void InputGeom::deleteOffMeshConnection(int i)
-{
-	m_offMeshConCount--;
-	float* src = &m_offMeshConVerts[m_offMeshConCount*3*2];
-	float* dst = &m_offMeshConVerts[i*3*2];
-	rcVcopy(&dst[0], &src[0]);
-	rcVcopy(&dst[3], &src[3]);
-	m_offMeshConRads[i] = m_offMeshConRads[m_offMeshConCount];
-	m_offMeshConDirs[i] = m_offMeshConDirs[m_offMeshConCount];
-	m_offMeshConAreas[i] = m_offMeshConAreas[m_offMeshConCount];
-	m_offMeshConFlags[i] = m_offMeshConFlags[m_offMeshConCount];
-}
-
 void InputGeom::drawOffMeshConnections(duDebugDraw* dd, bool hilight)
 {
 	unsigned int conColor = duRGBA(192,0,128,192);
@@ -260,23 +253,25 @@ void InputGeom::drawOffMeshConnections(duDebugDraw* dd, bool hilight)
 	dd->depthMask(false);
 
 	dd->begin(DU_DRAW_LINES, 2.0f);
-	for (int i = 0; i < m_offMeshConCount; ++i)
+	for (int i = 0; i < m_offMeshLinks.GetCount(); ++i)
 	{
-		float* v = &m_offMeshConVerts[i*3*2];
+		const NavMeshOffMeshLink& link = m_offMeshLinks.GetLink(i);
+		const float* v = link.start;
+		const float* e = link.end;
 
 		dd->vertex(v[0],v[1],v[2], baseColor);
 		dd->vertex(v[0],v[1]+0.2f,v[2], baseColor);
 		
-		dd->vertex(v[3],v[4],v[5], baseColor);
-		dd->vertex(v[3],v[4]+0.2f,v[5], baseColor);
+		dd->vertex(e[0],e[1],e[2], baseColor);
+		dd->vertex(e[0],e[1]+0.2f,e[2], baseColor);
 		
-		duAppendCircle(dd, v[0],v[1]+0.1f,v[2], m_offMeshConRads[i], baseColor);
-		duAppendCircle(dd, v[3],v[4]+0.1f,v[5], m_offMeshConRads[i], baseColor);
+		duAppendCircle(dd, v[0],v[1]+0.1f,v[2], link.radius, baseColor);
+		duAppendCircle(dd, e[0],e[1]+0.1f,e[2], link.radius, baseColor);
 
 		if (hilight)
 		{
-			duAppendArc(dd, v[0],v[1],v[2], v[3],v[4],v[5], 0.25f,
-						(m_offMeshConDirs[i]&1) ? 0.6f : 0.0f, 0.6f, conColor);
+			duAppendArc(dd, v[0],v[1],v[2], e[0],e[1],e[2], 0.25f,
+						link.bidirectional ? 0.6f : 0.0f, 0.6f, conColor);
 		}
 	}	
 	dd->end();
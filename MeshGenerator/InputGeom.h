@@ -3,6 +3,7 @@
 
 #include "ChunkyTriMesh.h"
 #include "MapGeometryLoader.h"
+#include "../NavMeshOffMeshLinks.h"
 
 static const int MAX_CONVEXVOL_PTS = 12;
 
@@ -22,6 +23,9 @@ public:
 
 	bool loadMesh(class rcContext* ctx);
 
+	// Load this geometry instead of the zone's (see MapGeometryLoader::load).
+	bool loadMesh(class rcContext* ctx, const std::vector<float>& verts, const std::vector<int>& tris);
+
 	/// Method to return static mesh data.
 	inline const glm::vec3& getMeshBoundsMin() const { return m_meshBMinCustom; }
 	inline const glm::vec3& getMeshBoundsMax() const { return m_meshBMaxCustom; }
@@ -40,16 +44,8 @@ public:
 
 	/// @name Off-Mesh connections.
 	///@{
-	int getOffMeshConnectionCount() const { return m_offMeshConCount; }
-	const float* getOffMeshConnectionVerts() const { return m_offMeshConVerts; }
-	const float* getOffMeshConnectionRads() const { return m_offMeshConRads; }
-	const unsigned char* getOffMeshConnectionDirs() const { return m_offMeshConDirs; }
-	const unsigned char* getOffMeshConnectionAreas() const { return m_offMeshConAreas; }
-	const unsigned short* getOffMeshConnectionFlags() const { return m_offMeshConFlags; }
-	const unsigned int* getOffMeshConnectionId() const { return m_offMeshConId; }
-	void addOffMeshConnection(const float* spos, const float* epos, const float rad,
-							  unsigned char bidir, unsigned char area, unsigned short flags);
-	void deleteOffMeshConnection(int i);
+	NavMeshOffMeshLinks& getOffMeshLinks() { return m_offMeshLinks; }
+	const NavMeshOffMeshLinks& getOffMeshLinks() const { return m_offMeshLinks; }
 	void drawOffMeshConnections(struct duDebugDraw* dd, bool hilight = false);
 	///@}
 
@@ -67,6 +63,9 @@ public:
 	bool raycastMesh(float* src, float* dst, float& tmin);
 
 private:
+	// bounds and chunky mesh for the geometry the loader has
+	bool initMesh(class rcContext* ctx);
+
 	std::string m_eqPath;
 	std::string m_zoneShortName;
 	std::string m_meshPath;
@@ -81,14 +80,8 @@ private:
 #pragma region Off-Mesh connections
 	/// @name Off-Mesh connections.
 	///@{
-	static const int MAX_OFFMESH_CONNECTIONS = 256;
-	float m_offMeshConVerts[MAX_OFFMESH_CONNECTIONS * 3 * 2];
-	float m_offMeshConRads[MAX_OFFMESH_CONNECTIONS];
-	unsigned char m_offMeshConDirs[MAX_OFFMESH_CONNECTIONS];
-	unsigned char m_offMeshConAreas[MAX_OFFMESH_CONNECTIONS];
-	unsigned short m_offMeshConFlags[MAX_OFFMESH_CONNECTIONS];
-	unsigned int m_offMeshConId[MAX_OFFMESH_CONNECTIONS];
-	int m_offMeshConCount = 0;
+	// saved with the mesh (SECTION_OFFMESHLINKS), not with the geometry
+	NavMeshOffMeshLinks m_offMeshLinks;
 	///@}
 #pragma endregion
 
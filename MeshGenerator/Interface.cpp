@@ -6,7 +6,7 @@
 
 #include "RecastDebugDraw.h"
 #include "InputGeom.h"
-#include "Sample_TileMesh.h"
+#include "TileMeshEditor.h"
 #include "Sample_Debug.h"
 #include "resource.h"
 
@@ -26,8 +26,6 @@
 
 //============================================================================
 
-static const int32_t MAX_LOG_MESSAGES = 1000;
-
 static bool IsKeyboardBlocked() {
 	return ImGui::GetIO().WantCaptureKeyboard || ImGui::GetIO().WantTextInput;
 }
@@ -36,7 +34,7 @@ static bool IsKeyboardBlocked() {
 
 Interface::Interface(const std::string& defaultZone)
 	: m_context(new BuildContext())
-	, m_mesh(new Sample_TileMesh)
+	, m_mesh(new TileMeshEditor)
 	, m_resetCamera(true)
 	, m_width(1600), m_height(900)
 	, m_progress(0.0)
@@ -573,12 +571,14 @@ void Interface::RenderInterface()
 			m_mesh->getTileStatistics(tw, th, tm);
 			int tt = tw*th;
 
-			float percent = (float)m_mesh->getTilesBuilt() / (float)tt;
+			// tiles that came out of the cache are done too
+			int tilesDone = m_mesh->getTilesBuilt() + m_mesh->getTilesReused();
+			float percent = (float)tilesDone / (float)tt;
 
 			if (m_mesh->isBuildingTiles())
 			{
 				char szProgress[256];
-				sprintf_s(szProgress, "%d of %d (%.2f%%)", m_mesh->getTilesBuilt(), tt, percent * 100);
+				sprintf_s(szProgress, "%d of %d (%.2f%%)", tilesDone, tt, percent * 100);
 
 				ImGui::ProgressBar(percent, ImVec2(-1, 0), szProgress);
 
@@ -912,6 +912,14 @@ std::string Interface::GetMeshFilename()
 	return ss.str();
 }
 
+std::string Interface::GetBuildCacheFilename()
+{
+	std::stringstream ss;
+	ss << m_eqConfig.GetOutputPath() << "\\MQ2Nav\\" << m_zoneShortname << ".buildcache";
+
+	return ss.str();
+}
+
 void Interface::Halt()
 {
 	m_mesh->cancelBuildAllTiles();
@@ -955,6 +963,7 @@ void Interface::LoadGeometry(const std::string& zoneShortName)
 		SDL_SetWindowTitle(m_window, windowTitle.c_str());
 
 		m_mesh->handleMeshChanged(m_geom.get());
+		m_mesh->setBuildCachePath(GetBuildCacheFilename());
 		m_resetCamera = true;
 	}
 }
@@ -1166,137 +1175,4 @@ void Interface::SetTheme(Theme theme, bool force)
 	#pragma endregion
 }
 
-//============================================================================
-
-BuildContext::BuildContext()
-{
-	resetTimers();
-}
-
-BuildContext::~BuildContext()
-{
-}
-
-//----------------------------------------------------------------------------
-
-void BuildContext::doResetLog()
-{
-	std::unique_lock<std::mutex> lock(m_mtx);
-
-	m_logs.clear();
-}
-
-void BuildContext::doLog(const rcLogCategory category,
-	const char* message, const int length)
-{
-#if 0
-	if (!length)
-		return;
-
-	std::unique_lock<std::mutex> lock(m_mtx);
-
-	// if the message buffer is full, drop an old message
-	if (m_logs.size() > MAX_LOG_MESSAGES)
-		m_logs.pop_front();
-
-	m_logs.emplace_back(std::string(message, static_cast<std::size_t>(length)));
-#endif
-	OutputDebugStringA(message);
-}
-
-void BuildContext::dumpLog(const char* format, ...)
-{
-	return;
-
-
-	// Print header.
-	va_list ap;
-	va_start(ap, format);
-	vprintf(format, ap);
-	va_end(ap);
-	printf("\n");
-
-	std::unique_lock<std::mutex> lock(m_mtx);
-
-	// Print messages
-	const int TAB_STOPS[4] = { 28, 36, 44, 52 };
-	for (auto& message : m_logs)
-	{
-		const char* msg = message.c_str();
-		int n = 0;
-		while (*msg)
-		{
-			if (*msg == '\t')
-			{
-				int count = 1;
-				for (int j = 0; j < 4; ++j)
-				{
-					if (n < TAB_STOPS[j])
-					{
-						count = TAB_STOPS[j] - n;
-						break;
-					}
-				}
-				while (--count)
-				{
-					putchar(' ');
-					n++;
-				}
-			}
-			else
-			{
-				putchar(*msg);
-				n++;
-			}
-			msg++;
-		}
-		putchar('\n');
-	}
-}
-
-const char* BuildContext::getLogText(int32_t index) const
-{
-	std::unique_lock<std::mutex> lock(m_mtx);
-
-	if (index >= 0 && index < (int32_t)m_logs.size())
-		return m_logs[index].c_str();
-
-	return nullptr;
-}
-
-int BuildContext::getLogCount() const
-{
-	std::unique_lock<std::mutex> lock(m_mtx);
-
-	return m_logs.size();
-}
-
-//----------------------------------------------------------------------------
-
-void BuildContext::doResetTimers()
-{
-	for (int i = 0; i < RC_MAX_TIMERS; ++i)
-		m_accTime[i] = -1;
-}
-
-void BuildContext::doStartTimer(const rcTimerLabel label)
-{
-	m_startTime[label] = getPerfTime();
-}
-
-void BuildContext::doStopTimer(const rcTimerLabel label)
-{
-	const TimeVal endTime = getPerfTime();
-	const int deltaTime = static_cast<int>(endTime - m_startTime[label]);
-	if (m_accTime[label] == -1)
-		m_accTime[label] = deltaTime;
-	else
-		m_accTime[label] += deltaTime;
-}
-
-int BuildContext::doGetAccumulatedTime(const rcTimerLabel label) const
-{
-	return m_accTime[label];
-}
-
 #pragma warning(pop)
@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include "BuildContext.h"
 #include "EQConfig.h"
 #include "Recast.h"
 #include "PerfTimer.h"
@@ -16,8 +17,8 @@
 #include <deque>
 #include <mutex>
 #include <thread>
+#include <vector>
 
-class BuildContext;
 class Sample_TileMesh;
 struct SDL_Surface;
 class InputGeom;
@@ -59,6 +60,7 @@ private:
 
 	// Get the filename of the mesh that would be used to save/open based on current zone
 	std::string GetMeshFilename();
+	std::string GetBuildCacheFilename();
 
 	enum Theme { DefaultTheme, LightTheme, DarkTheme1, DarkTheme2, DarkTheme3 };
 	void SetTheme(Theme theme, bool force = false);
@@ -154,35 +156,3 @@ private:
 	// current navmesh build worker thread
 	std::thread m_buildThread;
 };
-
-
-class BuildContext : public rcContext
-{
-public:
-	BuildContext();
-	virtual ~BuildContext();
-
-	// Dumps the log to stdout
-	void dumpLog(const char* format, ...);
-
-	// Returns the number of log messages
-	int getLogCount() const;
-
-	// Returns the log message text
-	const char* getLogText(int32_t index) const;
-
-protected:
-	virtual void doResetLog() override;
-	virtual void doLog(const rcLogCategory category, const char* msg, const int len) override;
-	virtual void doResetTimers() override;
-	virtual void doStartTimer(const rcTimerLabel label) override;
-	virtual void doStopTimer(const rcTimerLabel label) override;
-	virtual int doGetAccumulatedTime(const rcTimerLabel label) const override;
-
-private:
-	TimeVal m_startTime[RC_MAX_TIMERS];
-	int32_t m_accTime[RC_MAX_TIMERS];
-
-	std::deque<std::string> m_logs;
-	mutable std::mutex m_mtx;
-};
\ No newline at end of file
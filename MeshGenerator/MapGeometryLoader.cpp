@@ -1,5 +1,4 @@
 
-#include "pch.h"
 #include "MapGeometryLoader.h"
 
 #include "../ZoneData.h"
@@ -10,6 +9,7 @@
 #include <gtc/matrix_transform.hpp>
 #include <rapidjson/document.h>
 
+#include <fstream>
 #include <sstream>
 #include <boost/filesystem.hpp>
 
@@ -115,6 +115,47 @@ void MapGeometryLoader::addTriangle(int a, int b, int c)
 	m_triCount++;
 }
 
+bool MapGeometryLoader::load(const std::vector<float>& verts, const std::vector<int>& tris)
+{
+	for (size_t i = 0; i + 2 < verts.size(); i += 3)
+		addVertex(verts[i], verts[i + 1], verts[i + 2]);
+
+	for (size_t i = 0; i + 2 < tris.size(); i += 3)
+		addTriangle(tris[i], tris[i + 1], tris[i + 2]);
+
+	calculateNormals();
+	return m_triCount > 0;
+}
+
+void MapGeometryLoader::calculateNormals()
+{
+	m_normals = new float[m_triCount*3];
+	for (int i = 0; i < m_triCount*3; i += 3)
+	{
+		const float* v0 = &m_verts[m_tris[i]*3];
+		const float* v1 = &m_verts[m_tris[i+1]*3];
+		const float* v2 = &m_verts[m_tris[i+2]*3];
+		float e0[3], e1[3];
+		for (int j = 0; j < 3; ++j)
+		{
+			e0[j] = v1[j] - v0[j];
+			e1[j] = v2[j] - v0[j];
+		}
+		float* n = &m_normals[i];
+		n[0] = e0[1]*e1[2] - e0[2]*e1[1];
+		n[1] = e0[2]*e1[0] - e0[0]*e1[2];
+		n[2] = e0[0]*e1[1] - e0[1]*e1[0];
+		float d = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+		if (d > 0)
+		{
+			d = 1.0f/d;
+			n[0] *= d;
+			n[1] *= d;
+			n[2] *= d;
+		}
+	}
+}
+
 auto GetTranslation = [](auto obj) -> glm::vec3 {
 	return glm::vec3(obj->GetX(), obj->GetY(), obj->GetZ());
 };
@@ -386,32 +427,7 @@ bool MapGeometryLoader::load()
 
 	LoadDoors();
 
-	//message = "Calculating Surface Normals...";
-	m_normals = new float[m_triCount*3];
-	for (int i = 0; i < m_triCount*3; i += 3)
-	{
-		const float* v0 = &m_verts[m_tris[i]*3];
-		const float* v1 = &m_verts[m_tris[i+1]*3];
-		const float* v2 = &m_verts[m_tris[i+2]*3];
-		float e0[3], e1[3];
-		for (int j = 0; j < 3; ++j)
-		{
-			e0[j] = v1[j] - v0[j];
-			e1[j] = v2[j] - v0[j];
-		}
-		float* n = &m_normals[i];
-		n[0] = e0[1]*e1[2] - e0[2]*e1[1];
-		n[1] = e0[2]*e1[0] - e0[0]*e1[2];
-		n[2] = e0[0]*e1[1] - e0[1]*e1[0];
-		float d = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
-		if (d > 0)
-		{
-			d = 1.0f/d;
-			n[0] *= d;
-			n[1] *= d;
-			n[2] *= d;
-		}
-	}
+	calculateNormals();
 
 	return true;
 }
@@ -425,7 +441,7 @@ struct DoorParams
 	glm::mat4x4 transform;
 };
 
-bool IsSwitchStationary(DWORD type)
+bool IsSwitchStationary(uint32_t type)
 {
 	return (type != 53 && type >= 50 && type < 59)
 		|| (type >= 153 && type <= 155);
@@ -437,7 +453,7 @@ void MapGeometryLoader::LoadDoors()
 	//
 	// Load the door data
 	//
-	std::string filename = m_meshPath + "\\MQ2Nav\\" + m_zoneName + "_doors.json";
+	std::string filename = (boost::filesystem::path(m_meshPath) / "MQ2Nav" / (m_zoneName + "_doors.json")).string();
 	
 	boost::system::error_code ec;
 	if (!boost::filesystem::is_regular_file(filename, ec))
@@ -568,7 +584,7 @@ bool MapGeometryLoader::Build()
 {
 	eqLogMessage(LogTrace, "Attempting to load %s.eqg as a standard eqg.", m_zoneName.c_str());
 
-	std::string filePath = m_eqPath + "\\" + m_zoneName;
+	std::string filePath = (boost::filesystem::path(m_eqPath) / m_zoneName).string();
 
 	EQEmu::EQGLoader eqg;
 	std::vector<std::shared_ptr<EQEmu::EQG::Geometry>> eqg_models;
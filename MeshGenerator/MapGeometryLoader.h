@@ -14,6 +14,7 @@
 #include <string>
 #include <map>
 #include <tuple>
+#include <vector>
 
 #include <glm.hpp>
 
@@ -26,6 +27,11 @@ public:
 
 	bool load();
 
+	// Use this geometry instead of reading the zone, for building meshes
+	// that aren't of a zone (the build tests). verts are x,y,z triples in
+	// recast coordinates, tris are three vert indices each.
+	bool load(const std::vector<float>& verts, const std::vector<int>& tris);
+
 	inline const std::string& getFileName() const { return m_zoneName; }
 
 	inline const float* getVerts() const { return m_verts; }
@@ -101,6 +107,7 @@ private:
 	
 	void addVertex(float x, float y, float z);
 	void addTriangle(int a, int b, int c);
+	void calculateNormals();
 
 	int vcap = 0, tcap = 0;
 	float m_scale = 1.0;
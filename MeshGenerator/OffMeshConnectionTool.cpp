@@ -37,8 +37,10 @@ OffMeshConnectionTool::OffMeshConnectionTool() :
 	m_sample(0),
 	m_hitPosSet(0),
 	m_bidir(true),
-	m_oldFlags(0)
+	m_oldFlags(0),
+	m_action(NavLinkAction_Walk)
 {
+	m_actionData[0] = 0;
 }
 
 OffMeshConnectionTool::~OffMeshConnectionTool()
@@ -70,6 +72,25 @@ void OffMeshConnectionTool::handleMenu()
 		m_bidir = false;
 	if (ImGui::RadioButton("Bidirectional", m_bidir))
 		m_bidir = true;
+
+	ImGui::Separator();
+	ImGui::Text("Action");
+
+	if (ImGui::RadioButton("Walk / Jump / Zone Line", m_action == NavLinkAction_Walk))
+		m_action = NavLinkAction_Walk;
+	if (ImGui::RadioButton("Click Door", m_action == NavLinkAction_Door))
+		m_action = NavLinkAction_Door;
+	if (ImGui::RadioButton("Command", m_action == NavLinkAction_Command))
+		m_action = NavLinkAction_Command;
+
+	if (m_action == NavLinkAction_Door)
+		ImGui::InputText("Door Name", m_actionData, sizeof(m_actionData));
+	else if (m_action == NavLinkAction_Command)
+		ImGui::InputText("Command", m_actionData, sizeof(m_actionData));
+
+	InputGeom* geom = m_sample ? m_sample->getInputGeom() : nullptr;
+	if (geom)
+		ImGui::Text("%d connections", geom->getOffMeshLinks().GetCount());
 }
 
 void OffMeshConnectionTool::handleClick(const float* /*s*/, const float* p, bool shift)
@@ -82,24 +103,24 @@ void OffMeshConnectionTool::handleClick(const float* /*s*/, const float* p, bool
 	{
 		// Delete
 		// Find nearest link end-point
+		NavMeshOffMeshLinks& links = geom->getOffMeshLinks();
 		float nearestDist = FLT_MAX;
-		int nearestIndex = -1;
-		const float* verts = geom->getOffMeshConnectionVerts();
-		for (int i = 0; i < geom->getOffMeshConnectionCount()*2; ++i)
+		uint32_t nearestId = 0;
+		for (int i = 0; i < links.GetCount(); ++i)
 		{
-			const float* v = &verts[i*3];
-			float d = rcVdistSqr(p, v);
+			const NavMeshOffMeshLink& link = links.GetLink(i);
+			float d = rcMin(rcVdistSqr(p, link.start), rcVdistSqr(p, link.end));
 			if (d < nearestDist)
 			{
 				nearestDist = d;
-				nearestIndex = i/2; // Each link has two vertices.
+				nearestId = link.id;
 			}
 		}
 		// If end point close enough, delete it.
-		if (nearestIndex != -1 &&
+		if (nearestId != 0 &&
 			sqrtf(nearestDist) < m_sample->getAgentRadius())
 		{
-			geom->deleteOffMeshConnection(nearestIndex);
+			links.Remove(nearestId);
 		}
 	}
 	else
@@ -112,9 +133,23 @@ void OffMeshConnectionTool::handleClick(const float* /*s*/, const float* p, bool
 		}
 		else
 		{
-			const unsigned char area = SAMPLE_POLYAREA_JUMP;
-			const unsigned short flags = SAMPLE_POLYFLAGS_JUMP; 
-			geom->addOffMeshConnection(m_hitPos, p, m_sample->getAgentRadius(), m_bidir ? 1 : 0, area, flags);
+			// Everything can be walked through, so that paths use them with
+			// the default filter. Doors and jumps can still be left out.
+			unsigned char area = SAMPLE_POLYAREA_JUMP;
+			unsigned short flags = SAMPLE_POLYFLAGS_WALK | SAMPLE_POLYFLAGS_JUMP;
+			if (m_action == NavLinkAction_Door)
+			{
+				area = SAMPLE_POLYAREA_DOOR;
+				flags = SAMPLE_POLYFLAGS_WALK | SAMPLE_POLYFLAGS_DOOR;
+			}
+			else if (m_action == NavLinkAction_Command)
+			{
+				flags = SAMPLE_POLYFLAGS_WALK;
+			}
+
+			geom->getOffMeshLinks().Add(m_hitPos, p, m_sample->getAgentRadius(), m_bidir, area, flags,
+				static_cast<NavMeshLinkAction>(m_action),
+				m_action != NavLinkAction_Walk ? m_actionData : "");
 			m_hitPosSet = false;
 		}
 	}
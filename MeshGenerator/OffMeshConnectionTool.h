@@ -20,6 +20,7 @@
 #define OFFMESHCONNECTIONTOOL_H
 
 #include "Sample.h"
+#include "../NavMeshOffMeshLinks.h"
 
 // Tool to create off-mesh connection for InputGeom
 
@@ -30,6 +31,10 @@ class OffMeshConnectionTool : public SampleTool
 	bool m_hitPosSet;
 	bool m_bidir;
 	unsigned char m_oldFlags;
+
+	// what the plugin does when it gets to the start of a new connection
+	int m_action;
+	char m_actionData[NavMeshOffMeshLinks::MAX_ACTION_DATA + 1];
 	
 public:
 	OffMeshConnectionTool();
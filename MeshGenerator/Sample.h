@@ -163,7 +163,6 @@ public:
 	void renderOverlayToolStates(double* proj, double* model, int* view);
 
 	void resetCommonSettings();
-	void handleCommonSettings();
 };
 
 
@@ -654,6 +654,9 @@ bool Sample_SoloMesh::handleBuild()
 		}
 
 
+		NavMeshOffMeshLinkSet offMeshLinks;
+		m_geom->getOffMeshLinks().GetLinksInBounds(m_pmesh->bmin, m_pmesh->bmax, offMeshLinks);
+
 		dtNavMeshCreateParams params;
 		memset(&params, 0, sizeof(params));
 		params.verts = m_pmesh->verts;
@@ -668,13 +671,7 @@ bool Sample_SoloMesh::handleBuild()
 		params.detailVertsCount = m_dmesh->nverts;
 		params.detailTris = m_dmesh->tris;
 		params.detailTriCount = m_dmesh->ntris;
-		params.offMeshConVerts = m_geom->getOffMeshConnectionVerts();
-		params.offMeshConRad = m_geom->getOffMeshConnectionRads();
-		params.offMeshConDir = m_geom->getOffMeshConnectionDirs();
-		params.offMeshConAreas = m_geom->getOffMeshConnectionAreas();
-		params.offMeshConFlags = m_geom->getOffMeshConnectionFlags();
-		params.offMeshConUserID = m_geom->getOffMeshConnectionId();
-		params.offMeshConCount = m_geom->getOffMeshConnectionCount();
+		offMeshLinks.Apply(params);
 		params.walkableHeight = m_agentHeight;
 		params.walkableRadius = m_agentRadius;
 		params.walkableClimb = m_agentMaxClimb;
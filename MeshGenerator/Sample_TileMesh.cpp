@@ -17,27 +17,25 @@
 //
 
 #include "Sample_TileMesh.h"
-#include "Interface.h"
+#include "BuildContext.h"
 #include "InputGeom.h"
 #include "Sample.h"
 #include "Recast.h"
-#include "RecastDebugDraw.h"
 #include "DetourNavMesh.h"
 #include "DetourNavMeshBuilder.h"
-#include "DetourDebugDraw.h"
-#include "NavMeshTesterTool.h"
-#include "NavMeshPruneTool.h"
-#include "OffMeshConnectionTool.h"
-#include "ConvexVolumeTool.h"
-#include "CrowdTool.h"
-
-#include "SDL.h"
-#include "SDL_opengl.h"
-#include "imgui.h"
-#include <gl/GLU.h>
-
-#include <ppl.h>
-#include <agents.h>
+#include "DetourTileCache.h"
+#include "PerfTimer.h"
+#include "TileBuildArena.h"
+#include "TileBuildCache.h"
+#include "TileBuildScheduler.h"
+#include "../NavMeshFile.h"
+#include "../NavMeshLandmarks.h"
+#include "../NavMeshTileCache.h"
+
+#include "DebugDraw.h"
+
+#include <boost/filesystem.hpp>
+
 #include <mutex>
 
 #include <math.h>
@@ -73,195 +71,108 @@ inline unsigned int ilog2(unsigned int v)
 	return r;
 }
 
-class NavMeshTileTool : public SampleTool
-{
-	Sample_TileMesh* m_sample;
-	float m_hitPos[3];
-	bool m_hitPosSet;
-	
-public:
-
-	NavMeshTileTool() :
-		m_sample(0),
-		m_hitPosSet(false)
-	{
-		m_hitPos[0] = m_hitPos[1] = m_hitPos[2] = 0;
-	}
-
-	virtual ~NavMeshTileTool()
-	{
-	}
-
-	virtual int type() { return TOOL_TILE_EDIT; }
-
-	virtual void init(Sample* sample)
-	{
-		m_sample = (Sample_TileMesh*)sample; 
-	}
-	
-	virtual void reset() {}
-
-	virtual void handleMenu()
-	{
-#if 0
-		imguiLabel("Create Tiles");
-		if (imguiButton("Create All"))
-		{
-			if (m_sample)
-				m_sample->buildAllTiles();
-		}
-#endif
-		if (ImGui::Button("Remove All"))
-		{
-			if (m_sample)
-				m_sample->removeAllTiles();
-		}
-	}
-
-	virtual void handleClick(const float* /*s*/, const float* p, bool shift)
-	{
-		m_hitPosSet = true;
-		rcVcopy(m_hitPos,p);
-		if (m_sample)
-		{
-			if (shift)
-				m_sample->removeTile(m_hitPos);
-			else
-				m_sample->buildTile(m_hitPos);
-		}
-	}
-
-	virtual void handleToggle() {}
-
-	virtual void handleStep() {}
-
-	virtual void handleUpdate(const float /*dt*/) {}
-	
-	virtual void handleRender()
-	{
-		if (m_hitPosSet)
-		{
-			const float s = m_sample->getAgentRadius();
-			glColor4ub(0,0,0,128);
-			glLineWidth(2.0f);
-			glBegin(GL_LINES);
-			glVertex3f(m_hitPos[0]-s,m_hitPos[1]+0.1f,m_hitPos[2]);
-			glVertex3f(m_hitPos[0]+s,m_hitPos[1]+0.1f,m_hitPos[2]);
-			glVertex3f(m_hitPos[0],m_hitPos[1]-s+0.1f,m_hitPos[2]);
-			glVertex3f(m_hitPos[0],m_hitPos[1]+s+0.1f,m_hitPos[2]);
-			glVertex3f(m_hitPos[0],m_hitPos[1]+0.1f,m_hitPos[2]-s);
-			glVertex3f(m_hitPos[0],m_hitPos[1]+0.1f,m_hitPos[2]+s);
-			glEnd();
-			glLineWidth(1.0f);
-		}
-	}
-	
-	virtual void handleRenderOverlay(double* proj, double* model, int* view)
-	{
-		GLdouble x, y, z;
-		if (m_hitPosSet && gluProject((GLdouble)m_hitPos[0], (GLdouble)m_hitPos[1], (GLdouble)m_hitPos[2],
-									  model, proj, view, &x, &y, &z))
-		{
-			int tx=0, ty=0;
-			m_sample->getTilePos(m_hitPos, tx, ty);
-
-			ImGui::RenderText((int)x + 5, -((int)y - 5), ImVec4(0, 0, 0, 220), "(%d,%d)", tx, ty);
-		}
-		
-		// Tool help
-		const int h = view[3];
-
-		ImGui::RenderTextRight(-330, -(h - 40), ImVec4(255, 255, 255, 192),
-			"LMB: Rebuild hit tile.  Shift+LMB: Clear hit tile.");
-	}
-};
-
 Sample_TileMesh::Sample_TileMesh() :
 	m_buildAll(true),
 	m_totalBuildTimeMs(0),
-	m_drawMode(DRAWMODE_NAVMESH),
 	m_maxTiles(0),
 	m_maxPolysPerTile(0),
 	m_tileSize(128),
 	m_tileCol(duRGBA(0,0,0,32)),
-	m_tileBuildTime(0),
-	m_tileMemUsage(0),
-	m_tileTriCount(0)
+	m_saveCompressed(true),
+	m_landmarkCount(NavMeshLandmarks::DEFAULT_LANDMARKS),
+	m_buildTileCache(false)
 {
 	resetCommonSettings();
+	TileBuildArena::InstallAllocator();
 	memset(m_tileBmin, 0, sizeof(m_tileBmin));
 	memset(m_tileBmax, 0, sizeof(m_tileBmax));
-	
-	m_outputPath = new char[MAX_PATH];
-	setTool(new NavMeshTileTool);
 }
 
 Sample_TileMesh::~Sample_TileMesh()
 {
 	dtFreeNavMesh(m_navMesh);
 	m_navMesh = 0;
-	delete[] m_outputPath;
 }
 
-static const int NAVMESHSET_MAGIC = 'M'<<24 | 'S'<<16 | 'E'<<8 | 'T'; //'MSET';
-static const int NAVMESHSET_VERSION = 2;
-
-struct NavMeshSetHeader
+bool Sample_TileMesh::SaveMesh(const std::string& outputPath)
 {
-	int magic;
-	int version;
-	int numTiles;
-	dtNavMeshParams params;
-};
+	return saveAll(outputPath.c_str(), m_navMesh);
+}
 
-struct NavMeshTileHeader
+bool Sample_TileMesh::saveAll(const char* path, const dtNavMesh* mesh)
 {
-	dtTileRef tileRef;
-	int dataSize;
-};
+	if (!mesh) return false;
 
-void Sample_TileMesh::SaveMesh(const std::string& outputPath)
-{
-	saveAll(outputPath.c_str(), m_navMesh);
-}
+	std::vector<NavMeshFileSection> sections;
 
-void Sample_TileMesh::saveAll(const char* path, const dtNavMesh* mesh)
-{
-	if (!mesh) return;
-	
-	FILE* fp = fopen(path, "wb");
-	if (!fp)
-		return;
-	
-	// Store header.
-	NavMeshSetHeader header;
-	header.magic = NAVMESHSET_MAGIC;
-	header.version = NAVMESHSET_VERSION;
-	header.numTiles = 0;
-	for (int i = 0; i < mesh->getMaxTiles(); ++i)
+	// The landmark tables make path searches in the plugin faster, but need
+	// a search over the whole mesh for each landmark, so build them here.
+	std::vector<char> landmarkData;
+	if (m_landmarkCount > 0)
 	{
-		const dtMeshTile* tile = mesh->getTile(i);
-		if (!tile || !tile->header || !tile->dataSize) continue;
-		header.numTiles++;
+		TimeVal startTime = getPerfTime();
+
+		NavMeshLandmarks landmarks;
+		if (landmarks.Build(mesh, m_landmarkCount))
+		{
+			landmarks.Write(landmarkData);
+
+			NavMeshFileSection section;
+			section.type = SECTION_LANDMARKS;
+			section.data = landmarkData.data();
+			section.size = landmarkData.size();
+			sections.push_back(section);
+		}
+
+		m_ctx->log(RC_LOG_PROGRESS, "saveAll: Built %d landmarks in %.1f ms (%d KB)", landmarks.GetLandmarkCount(),
+			getPerfDeltaTimeUsec(startTime, getPerfTime()) / 1000.0f, static_cast<int>(landmarkData.size() / 1024));
 	}
-	memcpy(&header.params, mesh->getParams(), sizeof(dtNavMeshParams));
-	fwrite(&header, sizeof(NavMeshSetHeader), 1, fp);
 
-	// Store tiles.
-	for (int i = 0; i < mesh->getMaxTiles(); ++i)
+	// the layers are only there if the mesh was built out of them
+	std::vector<char> tileCacheData;
+	if (m_tileCache)
 	{
-		const dtMeshTile* tile = mesh->getTile(i);
-		if (!tile || !tile->header || !tile->dataSize) continue;
+		NavMeshTileCacheData layers;
+		layers.Build(m_tileCache.get());
 
-		NavMeshTileHeader tileHeader;
-		tileHeader.tileRef = mesh->getTileRef(tile);
-		tileHeader.dataSize = tile->dataSize;
-		fwrite(&tileHeader, sizeof(tileHeader), 1, fp);
+		if (!layers.IsEmpty())
+		{
+			layers.Write(tileCacheData);
+
+			NavMeshFileSection section;
+			section.type = SECTION_TILECACHE;
+			section.data = tileCacheData.data();
+			section.size = tileCacheData.size();
+			sections.push_back(section);
 
-		fwrite(tile->data, tile->dataSize, 1, fp);
+			m_ctx->log(RC_LOG_PROGRESS, "saveAll: Saved %d tile cache layers (%d KB)", layers.GetLayerCount(),
+				static_cast<int>(tileCacheData.size() / 1024));
+		}
 	}
 
-	fclose(fp);
+	// The tiles already have the links in them. The plugin needs the actions
+	// that go with them, and we need them to edit and rebuild tiles later.
+	std::vector<char> linkData;
+	if (m_geom && !m_geom->getOffMeshLinks().IsEmpty())
+	{
+		m_geom->getOffMeshLinks().Write(linkData);
+
+		NavMeshFileSection section;
+		section.type = SECTION_OFFMESHLINKS;
+		section.data = linkData.data();
+		section.size = linkData.size();
+		sections.push_back(section);
+
+		m_ctx->log(RC_LOG_PROGRESS, "saveAll: Saved %d off-mesh connections", m_geom->getOffMeshLinks().GetCount());
+	}
+
+	if (!SaveNavMeshFile(path, mesh, m_saveCompressed ? NAVMESHSET_VERSION : NAVMESHSET_VERSION_RAW, sections))
+	{
+		m_ctx->log(RC_LOG_ERROR, "saveAll: Could not write navmesh to '%s'", path);
+		return false;
+	}
+
+	return true;
 }
 
 bool Sample_TileMesh::LoadMesh(const std::string& outputPath)
@@ -273,6 +184,10 @@ bool Sample_TileMesh::LoadMesh(const std::string& outputPath)
 			dtFreeNavMesh(m_navMesh);
 		m_navMesh = mesh;
 
+		// the layers aren't loaded, they'd have to be built again anyway
+		// once the mesh is edited.
+		m_tileCache.reset();
+
 		dtStatus status = m_navQuery->init(m_navMesh, MAX_NODES);
 		if (dtStatusFailed(status))
 		{
@@ -292,69 +207,56 @@ bool Sample_TileMesh::LoadMesh(const std::string& outputPath)
 
 dtNavMesh* Sample_TileMesh::loadAll(const char* path)
 {
-	FILE* fp = fopen(path, "rb");
-	if (!fp) return 0;
-	
-	// Read header.
-	NavMeshSetHeader header;
-	size_t readLen = fread(&header, sizeof(NavMeshSetHeader), 1, fp);
-	if (readLen != 1)
-	{
-		fclose(fp);
-		return 0;
-	}
-	if (header.magic != NAVMESHSET_MAGIC)
-	{
-		fclose(fp);
+	std::vector<char> buffer;
+	if (!ReadNavMeshFileData(path, buffer))
 		return 0;
-	}
-	if (header.version != NAVMESHSET_VERSION)
-	{
-		fclose(fp);
+
+	// Read header.
+	NavMeshFileReader reader;
+	if (reader.Open(buffer.data(), buffer.size()) != NavMeshFileReader::SUCCESS)
 		return 0;
-	}
-	
+
 	dtNavMesh* mesh = dtAllocNavMesh();
 	if (!mesh)
-	{
-		fclose(fp);
 		return 0;
-	}
-	dtStatus status = mesh->init(&header.params);
+
+	dtStatus status = mesh->init(&reader.GetParams());
 	if (dtStatusFailed(status))
 	{
-		fclose(fp);
+		dtFreeNavMesh(mesh);
 		return 0;
 	}
-		
-	// Read tiles.
-	for (int i = 0; i < header.numTiles; ++i)
-	{
-		NavMeshTileHeader tileHeader;
-		readLen = fread(&tileHeader, sizeof(tileHeader), 1, fp);
-		if (readLen != 1)
-			return 0;
 
-		if (!tileHeader.tileRef || !tileHeader.dataSize)
-			break;
-
-		unsigned char* data = (unsigned char*)dtAlloc(tileHeader.dataSize, DT_ALLOC_PERM);
-		if (!data) break;
-		memset(data, 0, tileHeader.dataSize);
-		readLen = fread(data, tileHeader.dataSize, 1, fp);
-		if (readLen != 1)
+	// Read tiles. The file buffer goes away when we return, so every tile
+	// gets its own copy for the navmesh to own.
+	for (int i = 0; i < reader.GetTileCount(); ++i)
+	{
+		NavMeshFileTile tile;
+		if (reader.ReadTile(i, tile, true) != NavMeshFileReader::SUCCESS)
+		{
+			m_ctx->log(RC_LOG_ERROR, "loadAll: Tile %d is corrupt", i);
+			dtFreeNavMesh(mesh);
 			return 0;
+		}
 
-		dtMeshHeader* header = (dtMeshHeader*)data;
+		const dtMeshHeader* header = (const dtMeshHeader*)tile.data;
+		m_ctx->log(RC_LOG_PROGRESS, "Read Tile: %d, %d (%d)\n", header->x,
+			header->y, header->layer);
 
-		dtStatus status = mesh->addTile(data, tileHeader.dataSize, DT_TILE_FREE_DATA, tileHeader.tileRef, 0);
+		dtStatus status = mesh->addTile(tile.data, tile.dataSize, DT_TILE_FREE_DATA, tile.tileRef, 0);
+		if (dtStatusFailed(status))
+			dtFree(tile.data);
+	}
 
-		m_ctx->log(RC_LOG_PROGRESS, "Read Tile: %d, %d (%d) = %d\n", header->x,
-			header->y, header->layer, status);
+	// bring back the off-mesh connections that went into the tiles, so they
+	// are there to edit and to build into the tiles again.
+	NavMeshFileSection section;
+	if (m_geom && reader.GetSection(SECTION_OFFMESHLINKS, section))
+	{
+		if (!m_geom->getOffMeshLinks().Read(section.data, section.size))
+			m_ctx->log(RC_LOG_ERROR, "loadAll: Off-mesh connections are corrupt");
 	}
-	
-	fclose(fp);
-	
+
 	return mesh;
 }
 
@@ -365,6 +267,8 @@ void Sample_TileMesh::ResetMesh()
 		dtFreeNavMesh(m_navMesh);
 		m_navMesh = 0;
 	}
+
+	m_tileCache.reset();
 }
 
 void Sample_TileMesh::getTileStatistics(int& width, int& height, int& maxTiles) const
@@ -374,339 +278,37 @@ void Sample_TileMesh::getTileStatistics(int& width, int& height, int& maxTiles)
 	maxTiles = m_maxTiles;
 }
 
-void Sample_TileMesh::handleSettings()
-{
-	if (ImGui::CollapsingHeader("Mesh Generation", 0, true, true))
-	{
-		ImGui::Text("Tiling");
-		ImGui::SliderFloat("TileSize", &m_tileSize, 16.0f, 1024.0f, "%.0f");
-
-		if (m_geom)
-		{
-			const glm::vec3& bmin = m_geom->getMeshBoundsMin();
-			const glm::vec3& bmax = m_geom->getMeshBoundsMax();
-			int gw = 0, gh = 0;
-			rcCalcGridSize(&bmin[0], &bmax[0], m_cellSize, &gw, &gh);
-			const int ts = (int)m_tileSize;
-			m_tilesWidth = (gw + ts - 1) / ts;
-			m_tilesHeight = (gh + ts - 1) / ts;
-			m_tilesCount = m_tilesWidth * m_tilesHeight;
-
-			// Max tiles and max polys affect how the tile IDs are caculated.
-			// There are 22 bits available for identifying a tile and a polygon.
-			int tileBits = rcMin((int)ilog2(nextPow2(m_tilesCount)), 14);
-			if (tileBits > 14) tileBits = 14;
-			int polyBits = 22 - tileBits;
-			m_maxTiles = 1 << tileBits;
-			m_maxPolysPerTile = 1 << polyBits;
-		}
-		else
-		{
-			m_maxTiles = 0;
-			m_maxPolysPerTile = 0;
-			m_tilesWidth = 0;
-			m_tilesHeight = 0;
-			m_tilesCount = 0;
-		}
-
-		ImGui::Separator();
-		Sample::handleCommonSettings();
-
-		if (m_geom)
-		{
-
-			// custom bounding box controls
-			ImGui::Text("Bounding Box");
-
-			glm::vec3 min = m_geom->getMeshBoundsMin();
-			glm::vec3 max = m_geom->getMeshBoundsMax();
-
-			ImGui::SliderFloat("Min X", &min.x, m_geom->getRealMeshBoundsMin().x, m_geom->getRealMeshBoundsMax().x, "%.1f");
-			ImGui::SliderFloat("Min Y", &min.y, m_geom->getRealMeshBoundsMin().y, m_geom->getRealMeshBoundsMax().y, "%.1f");
-			ImGui::SliderFloat("Min Z", &min.z, m_geom->getRealMeshBoundsMin().z, m_geom->getRealMeshBoundsMax().z, "%.1f");
-			ImGui::SliderFloat("Max X", &max.x, m_geom->getRealMeshBoundsMin().x, m_geom->getRealMeshBoundsMax().x, "%.1f");
-			ImGui::SliderFloat("Max Y", &max.y, m_geom->getRealMeshBoundsMin().y, m_geom->getRealMeshBoundsMax().y, "%.1f");
-			ImGui::SliderFloat("Max Z", &max.z, m_geom->getRealMeshBoundsMin().z, m_geom->getRealMeshBoundsMax().z, "%.1f");
-
-			m_geom->setMeshBoundsMin(min);
-			m_geom->setMeshBoundsMax(max);
-
-			if (ImGui::Button("Reset Bounds"))
-			{
-				m_geom->resetMeshBounds();
-			}
-		}
-	}
-}
-
-void Sample_TileMesh::handleTools()
-{
-	int type = !m_tool ? TOOL_NONE : m_tool->type();
-
-	if (ImGui::RadioButton("Test Navmesh", type == TOOL_NAVMESH_TESTER))
-	{
-		setTool(new NavMeshTesterTool);
-	}
-	if (ImGui::RadioButton("Prune Navmesh", type == TOOL_NAVMESH_PRUNE))
-	{
-		setTool(new NavMeshPruneTool);
-	}
-	if (ImGui::RadioButton("Create Tiles", type == TOOL_TILE_EDIT))
-	{
-		setTool(new NavMeshTileTool);
-	}
-	if (ImGui::RadioButton("Create Off-Mesh Links", type == TOOL_OFFMESH_CONNECTION))
-	{
-		setTool(new OffMeshConnectionTool);
-	}
-	if (ImGui::RadioButton("Create Convex Volumes", type == TOOL_CONVEX_VOLUME))
-	{
-		setTool(new ConvexVolumeTool);
-	}
-	if (ImGui::RadioButton("Create Crowds", type == TOOL_CROWD))
-	{
-		setTool(new CrowdTool);
-	}
-	
-	ImGui::Separator();
-
-	ImGui::Indent();
-
-	if (m_tool)
-		m_tool->handleMenu();
-
-	ImGui::Unindent();
-}
-
-void Sample_TileMesh::handleDebugMode()
+void Sample_TileMesh::updateTileCounts()
 {
-	// Check which modes are valid.
-	bool valid[MAX_DRAWMODE];
-	for (int i = 0; i < MAX_DRAWMODE; ++i)
-		valid[i] = false;
-	
 	if (m_geom)
 	{
-		valid[DRAWMODE_NAVMESH] = m_navMesh != 0;
-		valid[DRAWMODE_NAVMESH_TRANS] = m_navMesh != 0;
-		valid[DRAWMODE_NAVMESH_BVTREE] = m_navMesh != 0;
-		valid[DRAWMODE_NAVMESH_NODES] = m_navQuery != 0;
-		valid[DRAWMODE_NAVMESH_PORTALS] = m_navMesh != 0;
-		valid[DRAWMODE_NAVMESH_INVIS] = m_navMesh != 0;
-		valid[DRAWMODE_MESH] = true;
-		valid[DRAWMODE_VOXELS] = false; // m_solid != 0;
-		valid[DRAWMODE_VOXELS_WALKABLE] = false; // = m_solid != 0;
-		valid[DRAWMODE_COMPACT] = false; // m_chf != 0;
-		valid[DRAWMODE_COMPACT_DISTANCE] = false; // m_chf != 0;
-		valid[DRAWMODE_COMPACT_REGIONS] = false; // m_chf != 0;
-		valid[DRAWMODE_REGION_CONNECTIONS] = false; // m_cset != 0;
-		valid[DRAWMODE_RAW_CONTOURS] = false; // m_cset != 0;
-		valid[DRAWMODE_BOTH_CONTOURS] = false; // m_cset != 0;
-		valid[DRAWMODE_CONTOURS] = false; // m_cset != 0;
-		valid[DRAWMODE_POLYMESH] = false; // m_pmesh != 0;
-		valid[DRAWMODE_POLYMESH_DETAIL] = false; // m_dmesh != 0;
+		const glm::vec3& bmin = m_geom->getMeshBoundsMin();
+		const glm::vec3& bmax = m_geom->getMeshBoundsMax();
+		int gw = 0, gh = 0;
+		rcCalcGridSize(&bmin[0], &bmax[0], m_cellSize, &gw, &gh);
+		const int ts = (int)m_tileSize;
+		m_tilesWidth = (gw + ts - 1) / ts;
+		m_tilesHeight = (gh + ts - 1) / ts;
+		m_tilesCount = m_tilesWidth * m_tilesHeight;
+
+		// Max tiles and max polys affect how the tile IDs are caculated.
+		// There are 22 bits available for identifying a tile and a polygon.
+		// Tiles built from layers can have more than one per location.
+		int maxTiles = m_buildTileCache ? m_tilesCount * EXPECTED_LAYERS_PER_TILE : m_tilesCount;
+		int tileBits = rcMin((int)ilog2(nextPow2(maxTiles)), 14);
+		if (tileBits > 14) tileBits = 14;
+		int polyBits = 22 - tileBits;
+		m_maxTiles = 1 << tileBits;
+		m_maxPolysPerTile = 1 << polyBits;
 	}
-	
-	int unavail = 0;
-	for (int i = 0; i < MAX_DRAWMODE; ++i)
-		if (!valid[i]) unavail++;
-	
-	if (unavail == MAX_DRAWMODE)
-		return;
-	
-	ImGui::Text("Draw");
-
-	if (valid[DRAWMODE_MESH] && ImGui::RadioButton("Input Mesh", m_drawMode == DRAWMODE_MESH))
-		m_drawMode = DRAWMODE_MESH;
-	if (valid[DRAWMODE_NAVMESH] && ImGui::RadioButton("Navmesh", m_drawMode == DRAWMODE_NAVMESH))
-		m_drawMode = DRAWMODE_NAVMESH;
-	if (valid[DRAWMODE_NAVMESH_INVIS] && ImGui::RadioButton("Navmesh Invis", m_drawMode == DRAWMODE_NAVMESH_INVIS))
-		m_drawMode = DRAWMODE_NAVMESH_INVIS;
-	if (valid[DRAWMODE_NAVMESH_TRANS] && ImGui::RadioButton("Navmesh Trans", m_drawMode == DRAWMODE_NAVMESH_TRANS))
-		m_drawMode = DRAWMODE_NAVMESH_TRANS;
-	if (valid[DRAWMODE_NAVMESH_BVTREE] && ImGui::RadioButton("Navmesh BVTree", m_drawMode == DRAWMODE_NAVMESH_BVTREE))
-		m_drawMode = DRAWMODE_NAVMESH_BVTREE;
-	if (valid[DRAWMODE_NAVMESH_NODES] && ImGui::RadioButton("Navmesh Nodes", m_drawMode == DRAWMODE_NAVMESH_NODES))
-		m_drawMode = DRAWMODE_NAVMESH_NODES;
-	if (valid[DRAWMODE_NAVMESH_PORTALS] && ImGui::RadioButton("Navmesh Portals", m_drawMode == DRAWMODE_NAVMESH_PORTALS))
-		m_drawMode = DRAWMODE_NAVMESH_PORTALS;
-	if (valid[DRAWMODE_VOXELS] && ImGui::RadioButton("Voxels", m_drawMode == DRAWMODE_VOXELS))
-		m_drawMode = DRAWMODE_VOXELS;
-	if (valid[DRAWMODE_VOXELS_WALKABLE] && ImGui::RadioButton("Walkable Voxels", m_drawMode == DRAWMODE_VOXELS_WALKABLE))
-		m_drawMode = DRAWMODE_VOXELS_WALKABLE;
-	if (valid[DRAWMODE_COMPACT] && ImGui::RadioButton("Compact", m_drawMode == DRAWMODE_COMPACT))
-		m_drawMode = DRAWMODE_COMPACT;
-	if (valid[DRAWMODE_COMPACT_DISTANCE] && ImGui::RadioButton("Compact Distance", m_drawMode == DRAWMODE_COMPACT_DISTANCE))
-		m_drawMode = DRAWMODE_COMPACT_DISTANCE;
-	if (valid[DRAWMODE_COMPACT_REGIONS] && ImGui::RadioButton("Compact Regions", m_drawMode == DRAWMODE_COMPACT_REGIONS))
-		m_drawMode = DRAWMODE_COMPACT_REGIONS;
-	if (valid[DRAWMODE_REGION_CONNECTIONS] && ImGui::RadioButton("Region Connections", m_drawMode == DRAWMODE_REGION_CONNECTIONS))
-		m_drawMode = DRAWMODE_REGION_CONNECTIONS;
-	if (valid[DRAWMODE_RAW_CONTOURS] && ImGui::RadioButton("Raw Contours", m_drawMode == DRAWMODE_RAW_CONTOURS))
-		m_drawMode = DRAWMODE_RAW_CONTOURS;
-	if (valid[DRAWMODE_BOTH_CONTOURS] && ImGui::RadioButton("Both Contours", m_drawMode == DRAWMODE_BOTH_CONTOURS))
-		m_drawMode = DRAWMODE_BOTH_CONTOURS;
-	if (valid[DRAWMODE_CONTOURS] && ImGui::RadioButton("Contours", m_drawMode == DRAWMODE_CONTOURS))
-		m_drawMode = DRAWMODE_CONTOURS;
-	if (valid[DRAWMODE_POLYMESH] && ImGui::RadioButton("Poly Mesh", m_drawMode == DRAWMODE_POLYMESH))
-		m_drawMode = DRAWMODE_POLYMESH;
-	if (valid[DRAWMODE_POLYMESH_DETAIL] && ImGui::RadioButton("Poly Mesh Detail", m_drawMode == DRAWMODE_POLYMESH_DETAIL))
-		m_drawMode = DRAWMODE_POLYMESH_DETAIL;
-		
-	//if (unavail)
-	//{
-	//	imguiValue("Tick 'Keep Itermediate Results'");
-	//	imguiValue("rebuild some tiles to see");
-	//	imguiValue("more debug mode options.");
-	//}
-}
-
-void Sample_TileMesh::handleRender()
-{
-	if (!m_geom || !m_geom->getMeshLoader())
-		return;
-	
-	DebugDrawGL dd;
-
-	const float texScale = 1.0f / (m_cellSize * 10.0f);
-	
-	// Draw mesh
-	if (m_drawMode != DRAWMODE_NAVMESH_TRANS)
+	else
 	{
-		// Draw mesh
-		duDebugDrawTriMeshSlope(&dd, m_geom->getMeshLoader()->getVerts(), m_geom->getMeshLoader()->getVertCount(),
-								m_geom->getMeshLoader()->getTris(), m_geom->getMeshLoader()->getNormals(), m_geom->getMeshLoader()->getTriCount(),
-								m_agentMaxSlope, texScale);
-		m_geom->drawOffMeshConnections(&dd);
+		m_maxTiles = 0;
+		m_maxPolysPerTile = 0;
+		m_tilesWidth = 0;
+		m_tilesHeight = 0;
+		m_tilesCount = 0;
 	}
-		
-	glDepthMask(GL_FALSE);
-	
-	// Draw bounds
-	const glm::vec3& bmin = m_geom->getMeshBoundsMin();
-	const glm::vec3& bmax = m_geom->getMeshBoundsMax();
-	duDebugDrawBoxWire(&dd, bmin[0],bmin[1],bmin[2], bmax[0],bmax[1],bmax[2], duRGBA(255,255,255,128), 1.0f);
-	
-	// Tiling grid.
-	int gw = 0, gh = 0;
-	rcCalcGridSize(&bmin[0], &bmax[0], m_cellSize, &gw, &gh);
-	const int tw = (gw + (int)m_tileSize-1) / (int)m_tileSize;
-	const int th = (gh + (int)m_tileSize-1) / (int)m_tileSize;
-	const float s = m_tileSize*m_cellSize;
-	duDebugDrawGridXZ(&dd, bmin[0],bmin[1],bmin[2], tw,th, s, duRGBA(0,0,0,64), 1.0f);
-	
-	// Draw active tile
-	duDebugDrawBoxWire(&dd, m_tileBmin[0],m_tileBmin[1],m_tileBmin[2],
-					   m_tileBmax[0],m_tileBmax[1],m_tileBmax[2], m_tileCol, 1.0f);
-		
-	if (m_navMesh && m_navQuery &&
-		(m_drawMode == DRAWMODE_NAVMESH ||
-		 m_drawMode == DRAWMODE_NAVMESH_TRANS ||
-		 m_drawMode == DRAWMODE_NAVMESH_BVTREE ||
-		 m_drawMode == DRAWMODE_NAVMESH_NODES ||
-		 m_drawMode == DRAWMODE_NAVMESH_PORTALS ||
-		 m_drawMode == DRAWMODE_NAVMESH_INVIS))
-	{
-		if (m_drawMode != DRAWMODE_NAVMESH_INVIS)
-			duDebugDrawNavMeshWithClosedList(&dd, *m_navMesh, *m_navQuery, m_navMeshDrawFlags);
-		if (m_drawMode == DRAWMODE_NAVMESH_BVTREE)
-			duDebugDrawNavMeshBVTree(&dd, *m_navMesh);
-		if (m_drawMode == DRAWMODE_NAVMESH_PORTALS)
-			duDebugDrawNavMeshPortals(&dd, *m_navMesh);
-		if (m_drawMode == DRAWMODE_NAVMESH_NODES)
-			duDebugDrawNavMeshNodes(&dd, *m_navQuery);
-		duDebugDrawNavMeshPolysWithFlags(&dd, *m_navMesh, SAMPLE_POLYFLAGS_DISABLED, duRGBA(0,0,0,128));
-	}
-	
-	
-	glDepthMask(GL_TRUE);
-	
-	//if (m_chf && m_drawMode == DRAWMODE_COMPACT)
-	//	duDebugDrawCompactHeightfieldSolid(&dd, *m_chf);
-	//if (m_chf && m_drawMode == DRAWMODE_COMPACT_DISTANCE)
-	//	duDebugDrawCompactHeightfieldDistance(&dd, *m_chf);
-	//if (m_chf && m_drawMode == DRAWMODE_COMPACT_REGIONS)
-	//	duDebugDrawCompactHeightfieldRegions(&dd, *m_chf);
-	//if (m_solid && m_drawMode == DRAWMODE_VOXELS)
-	//{
-	//	glEnable(GL_FOG);
-	//	duDebugDrawHeightfieldSolid(&dd, *m_solid);
-	//	glDisable(GL_FOG);
-	//}
-	//if (m_solid && m_drawMode == DRAWMODE_VOXELS_WALKABLE)
-	//{
-	//	glEnable(GL_FOG);
-	//	duDebugDrawHeightfieldWalkable(&dd, *m_solid);
-	//	glDisable(GL_FOG);
-	//}
-	//if (m_cset && m_drawMode == DRAWMODE_RAW_CONTOURS)
-	//{
-	//	glDepthMask(GL_FALSE);
-	//	duDebugDrawRawContours(&dd, *m_cset);
-	//	glDepthMask(GL_TRUE);
-	//}	
-	//if (m_cset && m_drawMode == DRAWMODE_BOTH_CONTOURS)
-	//{
-	//	glDepthMask(GL_FALSE);
-	//	duDebugDrawRawContours(&dd, *m_cset, 0.5f);
-	//	duDebugDrawContours(&dd, *m_cset);
-	//	glDepthMask(GL_TRUE);
-	//}
-	//if (m_cset && m_drawMode == DRAWMODE_CONTOURS)
-	//{
-	//	glDepthMask(GL_FALSE);
-	//	duDebugDrawContours(&dd, *m_cset);
-	//	glDepthMask(GL_TRUE);
-	//}
-	//if (m_chf && m_cset && m_drawMode == DRAWMODE_REGION_CONNECTIONS)
-	//{
-	//	duDebugDrawCompactHeightfieldRegions(&dd, *m_chf);
-	//	
-	//	glDepthMask(GL_FALSE);
-	//	duDebugDrawRegionConnections(&dd, *m_cset);
-	//	glDepthMask(GL_TRUE);
-	//}
-	//if (m_pmesh && m_drawMode == DRAWMODE_POLYMESH)
-	//{
-	//	glDepthMask(GL_FALSE);
-	//	duDebugDrawPolyMesh(&dd, *m_pmesh);
-	//	glDepthMask(GL_TRUE);
-	//}
-	//if (m_dmesh && m_drawMode == DRAWMODE_POLYMESH_DETAIL)
-	//{
-	//	glDepthMask(GL_FALSE);
-	//	duDebugDrawPolyMeshDetail(&dd, *m_dmesh);
-	//	glDepthMask(GL_TRUE);
-	//}
-		
-	m_geom->drawConvexVolumes(&dd);
-	
-	if (m_tool)
-		m_tool->handleRender();
-	renderToolStates();
-
-	glDepthMask(GL_TRUE);
-}
-
-void Sample_TileMesh::handleRenderOverlay(double* proj, double* model, int* view)
-{
-	GLdouble x, y, z;
-	
-	// Draw start and end point labels
-	if (m_tileBuildTime > 0.0f
-		&& gluProject(
-			(GLdouble)(m_tileBmin[0]+m_tileBmax[0])/2,
-			(GLdouble)(m_tileBmin[1]+m_tileBmax[1])/2,
-			(GLdouble)(m_tileBmin[2]+m_tileBmax[2])/2,
-			model, proj, view, &x, &y, &z))
-	{
-		ImGui::RenderText((int)x, -((int)y - 25), ImVec4(0, 0, 0, 220),
-			"%.3fms / %dTris / %.1fkB", m_tileBuildTime, m_tileTriCount, m_tileMemUsage);
-	}
-	
-	if (m_tool)
-		m_tool->handleRenderOverlay(proj, model, view);
-	renderOverlayToolStates(proj, model, view);
 }
 
 void Sample_TileMesh::handleMeshChanged(class InputGeom* geom)
@@ -715,6 +317,11 @@ void Sample_TileMesh::handleMeshChanged(class InputGeom* geom)
 
 	dtFreeNavMesh(m_navMesh);
 	m_navMesh = 0;
+	m_tileCache.reset();
+
+	// none of it is any use for a different zone
+	m_buildCache.Clear();
+	m_buildCachePath.clear();
 
 	if (m_tool)
 	{
@@ -732,6 +339,10 @@ bool Sample_TileMesh::handleBuild()
 		m_ctx->log(RC_LOG_ERROR, "buildTiledNavigation: No vertices and triangles.");
 		return false;
 	}
+
+	// the settings panel keeps these up to date, but it isn't there when
+	// building from the command line
+	updateTileCounts();
 	
 	dtFreeNavMesh(m_navMesh);
 	
@@ -765,6 +376,45 @@ bool Sample_TileMesh::handleBuild()
 		return false;
 	}
 
+	m_tileCache.reset();
+
+	if (m_buildTileCache)
+	{
+		// the layer dimensions are stored in bytes
+		if (m_tileSize > 255)
+		{
+			m_ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Tile size must be 255 or less to build layers.");
+			return false;
+		}
+
+		dtTileCacheParams tcparams;
+		memset(&tcparams, 0, sizeof(tcparams));
+		rcVcopy(tcparams.orig, &m_geom->getMeshBoundsMin()[0]);
+		tcparams.cs = m_cellSize;
+		tcparams.ch = m_cellHeight;
+		tcparams.width = (int)m_tileSize;
+		tcparams.height = (int)m_tileSize;
+		tcparams.walkableHeight = m_agentHeight;
+		tcparams.walkableRadius = m_agentRadius;
+		tcparams.walkableClimb = m_agentMaxClimb;
+		tcparams.maxSimplificationError = m_edgeMaxError;
+		tcparams.maxTiles = m_maxTiles;
+		tcparams.maxObstacles = 1; // the plugin picks its own limit
+
+		// tiles built from the layers get the same links as buildTileMesh
+		m_tileCacheMeshProcess.SetOffMeshLinks(&m_geom->getOffMeshLinks());
+		m_tileCache = deleted_unique_ptr<dtTileCache>(dtAllocTileCache(),
+			[](dtTileCache* tc) { dtFreeTileCache(tc); });
+
+		status = m_tileCache->init(&tcparams, &m_tileCacheAlloc, &m_tileCacheCompressor, &m_tileCacheMeshProcess);
+		if (dtStatusFailed(status))
+		{
+			m_ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Could not init tile cache.");
+			m_tileCache.reset();
+			return false;
+		}
+	}
+
 	if (m_buildAll)
 		buildAllTiles();
 	
@@ -776,6 +426,46 @@ bool Sample_TileMesh::handleBuild()
 	return true;
 }
 
+// Remove all of the tiles at a location, and their layers in the tile cache.
+static void RemoveTilesAt(dtNavMesh* navMesh, dtTileCache* tileCache, int tx, int ty)
+{
+	const int MAX_LAYERS = NavMeshTileCacheData::MAX_LAYERS_PER_TILE;
+
+	if (tileCache)
+	{
+		dtCompressedTileRef layers[MAX_LAYERS];
+		const int nlayers = tileCache->getTilesAt(tx, ty, layers, MAX_LAYERS);
+		for (int i = 0; i < nlayers; ++i)
+			tileCache->removeTile(layers[i], 0, 0);
+	}
+
+	const dtMeshTile* tiles[MAX_LAYERS];
+	dtTileRef refs[MAX_LAYERS];
+	const int ntiles = navMesh->getTilesAt(tx, ty, tiles, MAX_LAYERS);
+	for (int i = 0; i < ntiles; ++i)
+		refs[i] = navMesh->getTileRef(tiles[i]);
+
+	// Remove any previous data (navmesh owns and deletes the data).
+	for (int i = 0; i < ntiles; ++i)
+		navMesh->removeTile(refs[i], 0, 0);
+}
+
+// Replace the layers at a location. The tile cache owns and deletes the layer
+// data. The location has no tiles until buildNavMeshTilesAt is called.
+static void AddTileLayers(dtNavMesh* navMesh, dtTileCache* tileCache, int tx, int ty,
+	std::vector<TileCacheLayer>& layers)
+{
+	RemoveTilesAt(navMesh, tileCache, tx, ty);
+
+	for (TileCacheLayer& layer : layers)
+	{
+		dtStatus status = tileCache->addTile(layer.data, layer.dataSize, DT_COMPRESSEDTILE_FREE_DATA, 0);
+		if (dtStatusFailed(status))
+			dtFree(layer.data);
+		layer.data = nullptr;
+	}
+}
+
 void Sample_TileMesh::buildTile(const float* pos)
 {
 	if (!m_geom) return;
@@ -799,9 +489,19 @@ void Sample_TileMesh::buildTile(const float* pos)
 	m_tileCol = duRGBA(255,255,255,64);
 	
 	m_ctx->resetLog();
+
+	if (m_tileCache)
+	{
+		std::vector<TileCacheLayer> layers = buildTileLayers(m_ctx, tx, ty, m_tileBmin, m_tileBmax);
+		AddTileLayers(m_navMesh, m_tileCache.get(), tx, ty, layers);
+		m_tileCache->buildNavMeshTilesAt(tx, ty, m_navMesh);
+
+		m_ctx->dumpLog("Build Tile (%d,%d): %d layers", tx, ty, static_cast<int>(layers.size()));
+		return;
+	}
 	
 	int dataSize = 0;
-	unsigned char* data = buildTileMesh(tx, ty, m_tileBmin, m_tileBmax, dataSize);
+	unsigned char* data = buildTileMesh(m_ctx, tx, ty, m_tileBmin, m_tileBmax, dataSize);
 
 	// Remove any previous data (navmesh owns and deletes the data).
 	m_navMesh->removeTile(m_navMesh->getTileRefAt(tx,ty,0),0,0);
@@ -851,7 +551,7 @@ void Sample_TileMesh::removeTile(const float* pos)
 	
 	m_tileCol = duRGBA(128,32,16,64);
 	
-	m_navMesh->removeTile(m_navMesh->getTileRefAt(tx,ty,0),0,0);
+	RemoveTilesAt(m_navMesh, m_tileCache.get(), tx, ty);
 }
 
 struct TileData
@@ -860,46 +560,129 @@ struct TileData
 	int length = 0;
 	int x = 0;
 	int y = 0;
+
+	// instead of data, when building from tile cache layers
+	std::vector<TileCacheLayer> layers;
+
+	// bounds, log and timers from building the tile
+	std::unique_ptr<TileBuildContext> context;
 };
 
 typedef std::shared_ptr<TileData> TileDataPtr;
 
-class NavmeshUpdaterAgent : public concurrency::agent
+// Copy a built tile into a build cache entry: the tile data, or the number of
+// layers followed by the size and data of each. Empty tiles are empty.
+static std::vector<char> PackTile(const TileData& tile)
 {
-public:
-	explicit NavmeshUpdaterAgent(concurrency::ISource<TileDataPtr>& dataSource,
-		dtNavMesh* navMesh)
-		: m_source(dataSource)
-		, m_navMesh(navMesh)
+	std::vector<char> blob;
+
+	if (tile.data)
 	{
+		blob.assign(tile.data, tile.data + tile.length);
 	}
-
-protected:
-	virtual void run() override
+	else if (!tile.layers.empty())
 	{
-		TileDataPtr data = receive(m_source);
-		while (data != nullptr)
+		const int count = static_cast<int>(tile.layers.size());
+		blob.insert(blob.end(), (const char*)&count, (const char*)&count + sizeof(int));
+
+		for (const TileCacheLayer& layer : tile.layers)
 		{
-			// Remove any previous data (navmesh owns and deletes the data).
-			m_navMesh->removeTile(m_navMesh->getTileRefAt(data->x, data->y, 0), 0, 0);
+			blob.insert(blob.end(), (const char*)&layer.dataSize, (const char*)&layer.dataSize + sizeof(int));
+			blob.insert(blob.end(), layer.data, layer.data + layer.dataSize);
+		}
+	}
 
-			// Let the navmesh own the data.
-			dtStatus status = m_navMesh->addTile(data->data, data->length, DT_TILE_FREE_DATA, 0, 0);
-			if (dtStatusFailed(status))
-			{
-				dtFree(data->data);
-			}
+	return blob;
+}
 
-			data = receive(m_source);
-		}
+// Make a tile out of a build cache entry, in memory the mesh (or tile cache)
+// can own, same as if it was just built.
+static bool UnpackTile(const std::vector<char>& blob, bool layers, TileData& tile)
+{
+	if (blob.empty())
+		return true;
 
-		done();
+	if (!layers)
+	{
+		tile.length = static_cast<int>(blob.size());
+		tile.data = (unsigned char*)dtAlloc(tile.length, DT_ALLOC_PERM);
+		if (!tile.data)
+			return false;
+
+		memcpy(tile.data, blob.data(), blob.size());
+		return true;
 	}
 
-private:
-	concurrency::ISource<TileDataPtr>& m_source;
-	dtNavMesh* m_navMesh;
-};
+	const char* p = blob.data();
+	const char* end = p + blob.size();
+
+	int count = 0;
+	if (end - p < (ptrdiff_t)sizeof(int))
+		return false;
+	memcpy(&count, p, sizeof(int));
+	p += sizeof(int);
+
+	for (int i = 0; i < count; ++i)
+	{
+		TileCacheLayer layer;
+		if (end - p < (ptrdiff_t)sizeof(int))
+			return false;
+		memcpy(&layer.dataSize, p, sizeof(int));
+		p += sizeof(int);
+
+		if (layer.dataSize <= 0 || end - p < layer.dataSize)
+			return false;
+
+		layer.data = (unsigned char*)dtAlloc(layer.dataSize, DT_ALLOC_PERM);
+		if (!layer.data)
+			return false;
+
+		memcpy(layer.data, p, layer.dataSize);
+		p += layer.dataSize;
+
+		tile.layers.push_back(layer);
+	}
+
+	return true;
+}
+
+// Errors might not happen the next time, so those tiles aren't cached.
+static bool HasErrors(const TileBuildContext& context)
+{
+	for (const TileBuildContext::LogMessage& message : context.getLogs())
+	{
+		if (message.category == RC_LOG_ERROR)
+			return true;
+	}
+
+	return false;
+}
+
+// Add a built tile to the mesh. Only one thread does this at a time.
+//
+// The tile goes in the mesh slot for its location, not the next free one, so
+// its tile and poly refs (and the saved file, which is in slot order) are the
+// same whatever order the workers finish the tiles in.
+static void AddBuiltTile(dtNavMesh* navMesh, TileData& tile, int tilesWide)
+{
+	// Remove any previous data (navmesh owns and deletes the data).
+	navMesh->removeTile(navMesh->getTileRefAt(tile.x, tile.y, 0), 0, 0);
+
+	// every slot of a new mesh has a salt of 1
+	const dtTileRef ref = navMesh->encodePolyId(1, tile.y * tilesWide + tile.x, 0);
+
+	// Let the navmesh own the data.
+	dtStatus status = navMesh->addTile(tile.data, tile.length, DT_TILE_FREE_DATA, ref, 0);
+
+	// the slot is only taken if the mesh already had tiles in other places
+	if (dtStatusFailed(status))
+		status = navMesh->addTile(tile.data, tile.length, DT_TILE_FREE_DATA, 0, 0);
+
+	if (dtStatusFailed(status))
+	{
+		dtFree(tile.data);
+	}
+}
 
 void Sample_TileMesh::buildAllTiles(bool async)
 {
@@ -933,70 +716,179 @@ void Sample_TileMesh::buildAllTiles(bool async)
 	const float tcs = m_tileSize*m_cellSize;
 
 	m_tilesBuilt = 0;
+	m_tilesReused = 0;
 
-	//concurrency::CurrentScheduler::Create(concurrency::SchedulerPolicy(1, concurrency::MaxConcurrency, 3));
-
-	concurrency::unbounded_buffer<TileDataPtr> agentTiles;
-	NavmeshUpdaterAgent updater_agent(agentTiles, m_navMesh);
-
-	updater_agent.start();
+	if (m_reuseTiles)
+		m_buildCache.MarkAllUnused();
 
 	// Start the build process.
 	m_ctx->startTimer(RC_TIMER_TEMP);
 
-	concurrency::task_group tasks;
-	for (int x = 0; x < tw; x++)
+	// The workers build the tiles, and this thread adds them to the mesh as
+	// they come in.
+	BoundedQueue<TileDataPtr> builtTiles(BUILT_TILE_QUEUE_SIZE);
+	TileBuildScheduler scheduler(m_buildThreads, m_pinBuildThreads);
+
+	scheduler.Run(tw * th, [this, tw, &bmin, &bmax, tcs, &builtTiles](int index)
 	{
-		for (int y = 0; y < th; y++)
+		const int x = index % tw;
+		const int y = index / tw;
+
+		// everything recast allocates for this tile goes away with it
+		TileBuildArena::Scope arenaScope(TileBuildArena::ForCurrentThread());
+
+		float tileBmin[3], tileBmax[3];
+		tileBmin[0] = bmin[0] + x*tcs;
+		tileBmin[1] = bmin[1];
+		tileBmin[2] = bmin[2] + y*tcs;
+
+		tileBmax[0] = bmin[0] + (x + 1)*tcs;
+		tileBmax[1] = bmax[1];
+		tileBmax[2] = bmin[2] + (y + 1)*tcs;
+
+		// Every tile goes to the queue, even empty ones, so their logs
+		// get merged too.
+		TileDataPtr tileData = std::make_shared<TileData>();
+		tileData->x = x;
+		tileData->y = y;
+		tileData->context = std::make_unique<TileBuildContext>(x, y, tileBmin, tileBmax);
+
+		uint64_t inputHash = 0;
+		if (m_reuseTiles)
 		{
-			tasks.run([this, x, y, &bmin, &bmax, tcs, &agentTiles]()
+			inputHash = hashTileInputs(x, y, tileBmin, tileBmax);
+
+			TileBuildCache::TileBlob blob = m_buildCache.Find(inputHash);
+			if (blob && UnpackTile(*blob, m_tileCache != nullptr, *tileData))
 			{
-				if (m_cancelTiles)
-					return;
+				++m_tilesReused;
+				builtTiles.Push(tileData);
+				return;
+			}
 
-				++m_tilesBuilt;
+			// the tile is built again below, don't leave half of it behind
+			for (TileCacheLayer& layer : tileData->layers)
+				dtFree(layer.data);
+			tileData->layers.clear();
+			dtFree(tileData->data);
+			tileData->data = nullptr;
+			tileData->length = 0;
+		}
 
-				m_tileBmin[0] = bmin[0] + x*tcs;
-				m_tileBmin[1] = bmin[1];
-				m_tileBmin[2] = bmin[2] + y*tcs;
+		// only tiles that actually get built count, not the ones taken from
+		// the cache
+		++m_tilesBuilt;
 
-				m_tileBmax[0] = bmin[0] + (x + 1)*tcs;
-				m_tileBmax[1] = bmax[1];
-				m_tileBmax[2] = bmin[2] + (y + 1)*tcs;
+		if (m_tileCache)
+		{
+			tileData->layers = buildTileLayers(tileData->context.get(), x, y, tileBmin, tileBmax);
+		}
+		else
+		{
+			tileData->data = buildTileMesh(tileData->context.get(), x, y, tileBmin, tileBmax,
+				tileData->length);
+		}
 
-				int dataSize = 0;
-				unsigned char* data = buildTileMesh(x, y, m_tileBmin, m_tileBmax, dataSize);
+		if (m_reuseTiles && !HasErrors(*tileData->context))
+			m_buildCache.Store(inputHash, PackTile(*tileData));
 
-				if (data)
-				{
-					TileDataPtr tileData = std::make_shared<TileData>();
-					tileData->data = data;
-					tileData->length = dataSize;
-					tileData->x = x;
-					tileData->y = y;
+		builtTiles.Push(tileData);
+	}, m_cancelTiles, [&builtTiles]() { builtTiles.Close(); });
 
-					asend(agentTiles, tileData);
-				}
-			});
-		}
-	}
+	// Tiles that were already built when the build was cancelled still get
+	// added, same as the ones that finish building after it.
+	std::vector<std::unique_ptr<TileBuildContext>> tileContexts(tw * th);
 
-	tasks.wait();
+	// The tiles are added as they come in. Tiles built from layers are the
+	// exception: the tile cache adds their navmesh tiles to the next free
+	// slot, so those are built in tile order, each once the ones before it
+	// have their layers. The layers are kept in the tile cache either way, so
+	// this doesn't hold on to anything extra.
+	std::vector<char> layersAdded(tw * th, 0);
+	int nextLayerTile = 0;
 
-	// send terminator
-	asend(agentTiles, TileDataPtr());
+	auto buildLayerTiles = [&]()
+	{
+		for (; nextLayerTile < tw * th && layersAdded[nextLayerTile]; ++nextLayerTile)
+			m_tileCache->buildNavMeshTilesAt(nextLayerTile % tw, nextLayerTile / tw, m_navMesh);
+	};
 
-	concurrency::agent::wait(&updater_agent);
+	TileDataPtr tileData;
+	while (builtTiles.Pop(tileData))
+	{
+		const int index = tileData->y * tw + tileData->x;
+
+		if (m_tileCache)
+		{
+			AddTileLayers(m_navMesh, m_tileCache.get(), tileData->x, tileData->y, tileData->layers);
+
+			layersAdded[index] = 1;
+			buildLayerTiles();
+		}
+		else if (tileData->data)
+		{
+			AddBuiltTile(m_navMesh, *tileData, tw);
+		}
+
+		tileContexts[index] = std::move(tileData->context);
+		tileData.reset();
+	}
+
+	// a cancelled build leaves gaps, the tiles after them still get built
+	if (m_tileCache)
+	{
+		for (; nextLayerTile < tw * th; ++nextLayerTile)
+		{
+			if (layersAdded[nextLayerTile])
+				m_tileCache->buildNavMeshTilesAt(nextLayerTile % tw, nextLayerTile / tw, m_navMesh);
+		}
+	}
 
+	scheduler.Wait();
 
 	// Start the build process.
 	m_ctx->stopTimer(RC_TIMER_TEMP);
 
 	m_totalBuildTimeMs = m_ctx->getAccumulatedTime(RC_TIMER_TEMP)/1000.0f;
 
+	// in tile order, however the workers happened to finish them
+	for (const auto& tileContext : tileContexts)
+	{
+		if (tileContext)
+			m_ctx->addTileContext(*tileContext);
+	}
+
+	// A cancelled build didn't look at every tile, so the cache still has
+	// tiles it would have needed.
+	if (m_reuseTiles && !m_cancelTiles)
+	{
+		m_ctx->log(RC_LOG_PROGRESS, "buildAllTiles: Reused %d of %d tiles", (int)m_tilesReused, tw * th);
+
+		m_buildCache.RemoveUnused();
+
+		if (!m_buildCachePath.empty() && !m_buildCache.Save(m_buildCachePath))
+		{
+			m_ctx->log(RC_LOG_WARNING, "buildAllTiles: Could not save the build cache to '%s'",
+				m_buildCachePath.c_str());
+		}
+	}
+
 	m_buildingTiles = false;
 }
 
+void Sample_TileMesh::setBuildCachePath(const std::string& path)
+{
+	m_buildCachePath = path;
+	m_buildCache.Clear();
+
+	// no file just means nothing has been built yet
+	if (!path.empty() && m_buildCache.Load(path))
+	{
+		m_ctx->log(RC_LOG_PROGRESS, "setBuildCachePath: Loaded %d tiles from '%s'",
+			m_buildCache.GetCount(), path.c_str());
+	}
+}
+
 void Sample_TileMesh::removeAllTiles()
 {
 	const glm::vec3& bmin = m_geom->getMeshBoundsMin();
@@ -1010,10 +902,16 @@ void Sample_TileMesh::removeAllTiles()
 	for (int y = 0; y < th; ++y)
 	{
 		for (int x = 0; x < tw; ++x)
-			m_navMesh->removeTile(m_navMesh->getTileRefAt(x, y, 0), 0, 0);
+			RemoveTilesAt(m_navMesh, m_tileCache.get(), x, y);
 	}
 }
 
+void Sample_TileMesh::waitForBuildAllTiles()
+{
+	if (m_buildThread.joinable())
+		m_buildThread.join();
+}
+
 void Sample_TileMesh::cancelBuildAllTiles(bool wait)
 {
 	if (m_buildingTiles)
@@ -1023,15 +921,15 @@ void Sample_TileMesh::cancelBuildAllTiles(bool wait)
 		m_buildThread.join();
 }
 
-deleted_unique_ptr<rcCompactHeightfield> Sample_TileMesh::rasterizeGeometry(rcConfig& cfg) const
+deleted_unique_ptr<rcCompactHeightfield> Sample_TileMesh::rasterizeGeometry(rcContext* ctx, rcConfig& cfg) const
 {
 	// Allocate voxel heightfield where we rasterize our input data to.
 	deleted_unique_ptr<rcHeightfield> solid(rcAllocHeightfield(),
 		[](rcHeightfield* hf) { rcFreeHeightField(hf); });
 
-	if (!rcCreateHeightfield(m_ctx, *solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch))
+	if (!rcCreateHeightfield(ctx, *solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch))
 	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not create solid heightfield.");
+		ctx->log(RC_LOG_ERROR, "buildNavigation: Could not create solid heightfield.");
 		return 0;
 	}
 
@@ -1067,18 +965,18 @@ deleted_unique_ptr<rcCompactHeightfield> Sample_TileMesh::rasterizeGeometry(rcCo
 		//m_tileTriCount += nctris;
 
 		memset(triareas.get(), 0, nctris*sizeof(unsigned char));
-		rcMarkWalkableTriangles(m_ctx, cfg.walkableSlopeAngle,
+		rcMarkWalkableTriangles(ctx, cfg.walkableSlopeAngle,
 			verts, nverts, ctris, nctris, triareas.get());
 
-		rcRasterizeTriangles(m_ctx, verts, nverts, ctris, triareas.get(), nctris, *solid, cfg.walkableClimb);
+		rcRasterizeTriangles(ctx, verts, nverts, ctris, triareas.get(), nctris, *solid, cfg.walkableClimb);
 	}
 
 	// Once all geometry is rasterized, we do initial pass of filtering to
 	// remove unwanted overhangs caused by the conservative rasterization
 	// as well as filter spans where the character cannot possibly stand.
-	rcFilterLowHangingWalkableObstacles(m_ctx, cfg.walkableClimb, *solid);
-	rcFilterLedgeSpans(m_ctx, cfg.walkableHeight, cfg.walkableClimb, *solid);
-	rcFilterWalkableLowHeightSpans(m_ctx, cfg.walkableHeight, *solid);
+	rcFilterLowHangingWalkableObstacles(ctx, cfg.walkableClimb, *solid);
+	rcFilterLedgeSpans(ctx, cfg.walkableHeight, cfg.walkableClimb, *solid);
+	rcFilterWalkableLowHeightSpans(ctx, cfg.walkableHeight, *solid);
 
 	// Compact the heightfield so that it is faster to handle from now on.
 	// This will result more cache coherent data as well as the neighbours
@@ -1086,29 +984,18 @@ deleted_unique_ptr<rcCompactHeightfield> Sample_TileMesh::rasterizeGeometry(rcCo
 	deleted_unique_ptr<rcCompactHeightfield> chf(rcAllocCompactHeightfield(),
 		[](rcCompactHeightfield* hf) { rcFreeCompactHeightfield(hf); });
 
-	if (!rcBuildCompactHeightfield(m_ctx, cfg.walkableHeight, cfg.walkableClimb, *solid, *chf))
+	if (!rcBuildCompactHeightfield(ctx, cfg.walkableHeight, cfg.walkableClimb, *solid, *chf))
 	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build compact data.");
+		ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build compact data.");
 		return 0;
 	}
 
 	return std::move(chf);
 }
 
-unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const float* bmin, const float* bmax, int& dataSize) const
+void Sample_TileMesh::initTileConfig(rcConfig& cfg, const float* bmin, const float* bmax) const
 {
-	if (!m_geom || !m_geom->getMeshLoader() || !m_geom->getChunkyMesh())
-	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Input mesh is not specified.");
-		return 0;
-	}
-	
-	//m_tileMemUsage = 0;
-	//m_tileBuildTime = 0;
-
 	// Init build configuration from GUI
-	rcConfig cfg;
-
 	memset(&cfg, 0, sizeof(cfg));
 	cfg.cs = m_cellSize;
 	cfg.ch = m_cellHeight;
@@ -1155,34 +1042,159 @@ unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const
 	cfg.bmin[2] -= cfg.borderSize*cfg.cs;
 	cfg.bmax[0] += cfg.borderSize*cfg.cs;
 	cfg.bmax[2] += cfg.borderSize*cfg.cs;
+}
+
+uint64_t Sample_TileMesh::hashTileInputs(const int tx, const int ty, const float* bmin, const float* bmax) const
+{
+	// Bump this when the tile build changes in a way that changes the
+	// tiles, so the cached ones get built again.
+	const int TILE_BUILD_VERSION = 1;
+
+	TileInputHasher hasher;
+	hasher.AddValue(TILE_BUILD_VERSION);
+	hasher.AddValue(tx);
+	hasher.AddValue(ty);
+
+	// The settings, and the bounds with the border around them. Anything
+	// else that buildTileMesh or buildTileLayers reads has to go in too.
+	rcConfig cfg;
+	initTileConfig(cfg, bmin, bmax);
+	hasher.Add(&cfg, sizeof(cfg));
+	hasher.AddValue(m_partitionType);
+	hasher.AddValue(m_agentHeight);
+	hasher.AddValue(m_agentRadius);
+	hasher.AddValue(m_agentMaxClimb);
+
+	const bool layers = m_tileCache != nullptr;
+	hasher.AddValue(layers);
+
+	// The triangles that rasterizeGeometry will use. Their positions, not
+	// their indices, so geometry added elsewhere in the zone doesn't count.
+	const float* verts = m_geom->getMeshLoader()->getVerts();
+	const rcChunkyTriMesh* chunkyMesh = m_geom->getChunkyMesh();
+
+	float tbmin[2], tbmax[2];
+	tbmin[0] = cfg.bmin[0];
+	tbmin[1] = cfg.bmin[2];
+	tbmax[0] = cfg.bmax[0];
+	tbmax[1] = cfg.bmax[2];
+	int cid[512];
+	const int ncid = rcGetChunksOverlappingRect(chunkyMesh, tbmin, tbmax, cid, 512);
+
+	for (int i = 0; i < ncid; ++i)
+	{
+		const rcChunkyTriMeshNode& node = chunkyMesh->nodes[cid[i]];
+		const int* ctris = &chunkyMesh->tris[node.i * 3];
+
+		for (int j = 0; j < node.n * 3; j += 3)
+		{
+			float tri[9];
+			rcVcopy(&tri[0], &verts[ctris[j] * 3]);
+			rcVcopy(&tri[3], &verts[ctris[j + 1] * 3]);
+			rcVcopy(&tri[6], &verts[ctris[j + 2] * 3]);
+			hasher.Add(tri, sizeof(tri));
+		}
+	}
+
+	// The convex volumes that reach into the tile or its border, in order,
+	// since later ones mark over earlier ones.
+	const ConvexVolume* vols = m_geom->getConvexVolumes();
+	for (int i = 0; i < m_geom->getConvexVolumeCount(); ++i)
+	{
+		const ConvexVolume& vol = vols[i];
+		if (vol.nverts <= 0)
+			continue;
+
+		float vmin[2] = { vol.verts[0].x, vol.verts[0].z };
+		float vmax[2] = { vmin[0], vmin[1] };
+		for (int j = 1; j < vol.nverts; ++j)
+		{
+			vmin[0] = rcMin(vmin[0], vol.verts[j].x);
+			vmin[1] = rcMin(vmin[1], vol.verts[j].z);
+			vmax[0] = rcMax(vmax[0], vol.verts[j].x);
+			vmax[1] = rcMax(vmax[1], vol.verts[j].z);
+		}
+
+		if (vmin[0] > tbmax[0] || vmax[0] < tbmin[0] || vmin[1] > tbmax[1] || vmax[1] < tbmin[1])
+			continue;
+
+		hasher.AddValue(vol.nverts);
+		hasher.Add(&vol.verts[0], vol.nverts * sizeof(vol.verts[0]));
+		hasher.AddValue(vol.hmin);
+		hasher.AddValue(vol.hmax);
+		hasher.AddValue(vol.area);
+	}
+
+	// The links are built into navmesh tiles. The layers don't have them,
+	// the tile cache adds them when it makes the tiles.
+	if (!layers)
+	{
+		// the poly mesh bounds that buildTileMesh looks them up with
+		const float pad = cfg.borderSize * cfg.cs;
+		float lbmin[3], lbmax[3];
+		rcVcopy(lbmin, cfg.bmin);
+		rcVcopy(lbmax, cfg.bmax);
+		lbmin[0] += pad;
+		lbmin[2] += pad;
+		lbmax[0] -= pad;
+		lbmax[2] -= pad;
+
+		NavMeshOffMeshLinkSet links;
+		m_geom->getOffMeshLinks().GetLinksInBounds(lbmin, lbmax, links);
+
+		hasher.AddValue(links.GetCount());
+		hasher.Add(links.verts.data(), links.verts.size() * sizeof(float));
+		hasher.Add(links.radii.data(), links.radii.size() * sizeof(float));
+		hasher.Add(links.dirs.data(), links.dirs.size());
+		hasher.Add(links.areas.data(), links.areas.size());
+		hasher.Add(links.flags.data(), links.flags.size() * sizeof(unsigned short));
+		hasher.Add(links.ids.data(), links.ids.size() * sizeof(unsigned int));
+	}
+
+	return hasher.GetHash();
+}
+
+unsigned char* Sample_TileMesh::buildTileMesh(rcContext* ctx, const int tx, const int ty, const float* bmin, const float* bmax, int& dataSize) const
+{
+	if (!m_geom || !m_geom->getMeshLoader() || !m_geom->getChunkyMesh())
+	{
+		ctx->log(RC_LOG_ERROR, "buildNavigation: Input mesh is not specified.");
+		return 0;
+	}
+	
+	//m_tileMemUsage = 0;
+	//m_tileBuildTime = 0;
+
+	rcConfig cfg;
+	initTileConfig(cfg, bmin, bmax);
 	
 	// Reset build times gathering.
-	m_ctx->resetTimers();
+	ctx->resetTimers();
 	
 	// Start the build process.
-	m_ctx->startTimer(RC_TIMER_TOTAL);
+	ctx->startTimer(RC_TIMER_TOTAL);
 	
 #if 0
-	m_ctx->log(RC_LOG_PROGRESS, "Building navigation:");
-	m_ctx->log(RC_LOG_PROGRESS, " - %d x %d cells", m_cfg.width, m_cfg.height);
-	m_ctx->log(RC_LOG_PROGRESS, " - %.1fK verts, %.1fK tris", nverts/1000.0f, ntris/1000.0f);
+	ctx->log(RC_LOG_PROGRESS, "Building navigation:");
+	ctx->log(RC_LOG_PROGRESS, " - %d x %d cells", m_cfg.width, m_cfg.height);
+	ctx->log(RC_LOG_PROGRESS, " - %.1fK verts, %.1fK tris", nverts/1000.0f, ntris/1000.0f);
 #endif
 
-	deleted_unique_ptr<rcCompactHeightfield> chf = rasterizeGeometry(cfg);
+	deleted_unique_ptr<rcCompactHeightfield> chf = rasterizeGeometry(ctx, cfg);
 	if (!chf)
 		return 0;
 
 	// Erode the walkable area by agent radius.
-	if (!rcErodeWalkableArea(m_ctx, cfg.walkableRadius, *chf))
+	if (!rcErodeWalkableArea(ctx, cfg.walkableRadius, *chf))
 	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not erode.");
+		ctx->log(RC_LOG_ERROR, "buildNavigation: Could not erode.");
 		return 0;
 	}
 
 	// (Optional) Mark areas.
 	const ConvexVolume* vols = m_geom->getConvexVolumes();
 	for (int i  = 0; i < m_geom->getConvexVolumeCount(); ++i)
-		rcMarkConvexPolyArea(m_ctx, &vols[i].verts[0][0], vols[i].nverts, vols[i].hmin, vols[i].hmax, (unsigned char)vols[i].area, *chf);
+		rcMarkConvexPolyArea(ctx, &vols[i].verts[0][0], vols[i].nverts, vols[i].hmin, vols[i].hmax, (unsigned char)vols[i].area, *chf);
 	
 	
 	// Partition the heightfield so that we can use simple algorithm later to triangulate the walkable areas.
@@ -1214,44 +1226,44 @@ unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const
 	if (m_partitionType == SAMPLE_PARTITION_WATERSHED)
 	{
 		// Prepare for region partitioning, by calculating distance field along the walkable surface.
-		if (!rcBuildDistanceField(m_ctx, *chf))
+		if (!rcBuildDistanceField(ctx, *chf))
 		{
-			m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build distance field.");
-			return false;
+			ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build distance field.");
+			return nullptr;
 		}
 		
 		// Partition the walkable surface into simple regions without holes.
-		if (!rcBuildRegions(m_ctx, *chf, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea))
+		if (!rcBuildRegions(ctx, *chf, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea))
 		{
-			m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build watershed regions.");
-			return false;
+			ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build watershed regions.");
+			return nullptr;
 		}
 	}
 	else if (m_partitionType == SAMPLE_PARTITION_MONOTONE)
 	{
 		// Partition the walkable surface into simple regions without holes.
 		// Monotone partitioning does not need distancefield.
-		if (!rcBuildRegionsMonotone(m_ctx, *chf, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea))
+		if (!rcBuildRegionsMonotone(ctx, *chf, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea))
 		{
-			m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build monotone regions.");
-			return false;
+			ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build monotone regions.");
+			return nullptr;
 		}
 	}
 	else // SAMPLE_PARTITION_LAYERS
 	{
 		// Partition the walkable surface into simple regions without holes.
-		if (!rcBuildLayerRegions(m_ctx, *chf, cfg.borderSize, cfg.minRegionArea))
+		if (!rcBuildLayerRegions(ctx, *chf, cfg.borderSize, cfg.minRegionArea))
 		{
-			m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build layer regions.");
-			return false;
+			ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build layer regions.");
+			return nullptr;
 		}
 	}
 	 	
 	// Create contours.
 	deleted_unique_ptr<rcContourSet> cset(rcAllocContourSet(), [](rcContourSet* cs) { rcFreeContourSet(cs); });
-	if (!rcBuildContours(m_ctx, *chf, cfg.maxSimplificationError, cfg.maxEdgeLen, *cset))
+	if (!rcBuildContours(ctx, *chf, cfg.maxSimplificationError, cfg.maxEdgeLen, *cset))
 	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not create contours.");
+		ctx->log(RC_LOG_ERROR, "buildNavigation: Could not create contours.");
 		return 0;
 	}
 	
@@ -1262,19 +1274,19 @@ unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const
 	
 	// Build polygon navmesh from the contours.
 	deleted_unique_ptr<rcPolyMesh> pmesh(rcAllocPolyMesh(), [](rcPolyMesh* pm) { rcFreePolyMesh(pm); });
-	if (!rcBuildPolyMesh(m_ctx, *cset, cfg.maxVertsPerPoly, *pmesh))
+	if (!rcBuildPolyMesh(ctx, *cset, cfg.maxVertsPerPoly, *pmesh))
 	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not triangulate contours.");
+		ctx->log(RC_LOG_ERROR, "buildNavigation: Could not triangulate contours.");
 		return 0;
 	}
 	
 	// Build detail mesh.
 	deleted_unique_ptr<rcPolyMeshDetail> dmesh(rcAllocPolyMeshDetail(), [](rcPolyMeshDetail* pm) { rcFreePolyMeshDetail(pm); });
-	if (!rcBuildPolyMeshDetail(m_ctx, *pmesh, *chf,
+	if (!rcBuildPolyMeshDetail(ctx, *pmesh, *chf,
 							   cfg.detailSampleDist, cfg.detailSampleMaxError,
 							   *dmesh))
 	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could build polymesh detail.");
+		ctx->log(RC_LOG_ERROR, "buildNavigation: Could build polymesh detail.");
 		return 0;
 	}
 	
@@ -1288,7 +1300,7 @@ unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const
 		if (pmesh->nverts >= 0xffff)
 		{
 			// The vertex indices are ushorts, and cannot point to more than 0xffff vertices.
-			m_ctx->log(RC_LOG_ERROR, "Too many vertices per tile %d (max: %d).", pmesh->nverts, 0xffff);
+			ctx->log(RC_LOG_ERROR, "Too many vertices per tile %d (max: %d).", pmesh->nverts, 0xffff);
 			return 0;
 		}
 		
@@ -1314,6 +1326,10 @@ unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const
 			}
 		}
 		
+		// the links that start or end in this tile
+		NavMeshOffMeshLinkSet offMeshLinks;
+		m_geom->getOffMeshLinks().GetLinksInBounds(pmesh->bmin, pmesh->bmax, offMeshLinks);
+
 		dtNavMeshCreateParams params;
 		memset(&params, 0, sizeof(params));
 		params.verts = pmesh->verts;
@@ -1328,13 +1344,7 @@ unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const
 		params.detailVertsCount = dmesh->nverts;
 		params.detailTris = dmesh->tris;
 		params.detailTriCount = dmesh->ntris;
-		params.offMeshConVerts = m_geom->getOffMeshConnectionVerts();
-		params.offMeshConRad = m_geom->getOffMeshConnectionRads();
-		params.offMeshConDir = m_geom->getOffMeshConnectionDirs();
-		params.offMeshConAreas = m_geom->getOffMeshConnectionAreas();
-		params.offMeshConFlags = m_geom->getOffMeshConnectionFlags();
-		params.offMeshConUserID = m_geom->getOffMeshConnectionId();
-		params.offMeshConCount = m_geom->getOffMeshConnectionCount();
+		offMeshLinks.Apply(params);
 		params.walkableHeight = m_agentHeight;
 		params.walkableRadius = m_agentRadius;
 		params.walkableClimb = m_agentMaxClimb;
@@ -1349,28 +1359,112 @@ unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const
 		
 		if (!dtCreateNavMeshData(&params, &navData, &navDataSize))
 		{
-			m_ctx->log(RC_LOG_ERROR, "Could not build Detour navmesh.");
+			ctx->log(RC_LOG_ERROR, "Could not build Detour navmesh.");
 			return 0;
 		}		
 	}
 	//m_tileMemUsage = navDataSize/1024.0f;
 	
-	m_ctx->stopTimer(RC_TIMER_TOTAL);
+	ctx->stopTimer(RC_TIMER_TOTAL);
 	
 	// Show performance stats.
-	//duLogBuildTimes(*m_ctx, m_ctx->getAccumulatedTime(RC_TIMER_TOTAL));
-	//m_ctx->log(RC_LOG_PROGRESS, ">> Polymesh: %d vertices  %d polygons", pmesh->nverts, pmesh->npolys);
+	//duLogBuildTimes(*ctx, ctx->getAccumulatedTime(RC_TIMER_TOTAL));
+	//ctx->log(RC_LOG_PROGRESS, ">> Polymesh: %d vertices  %d polygons", pmesh->nverts, pmesh->npolys);
 	
-	//m_tileBuildTime = m_ctx->getAccumulatedTime(RC_TIMER_TOTAL)/1000.0f;
+	//m_tileBuildTime = ctx->getAccumulatedTime(RC_TIMER_TOTAL)/1000.0f;
 
 	dataSize = navDataSize;
 	return navData;
 }
 
+std::vector<TileCacheLayer> Sample_TileMesh::buildTileLayers(rcContext* ctx, const int tx, const int ty, const float* bmin, const float* bmax) const
+{
+	std::vector<TileCacheLayer> layers;
+
+	if (!m_geom || !m_geom->getMeshLoader() || !m_geom->getChunkyMesh())
+	{
+		ctx->log(RC_LOG_ERROR, "buildTileLayers: Input mesh is not specified.");
+		return layers;
+	}
+
+	rcConfig cfg;
+	initTileConfig(cfg, bmin, bmax);
+
+	// The same as buildTileMesh up until the regions. The tile cache builds
+	// the regions and the polys out of the layers when it makes the tiles.
+	deleted_unique_ptr<rcCompactHeightfield> chf = rasterizeGeometry(ctx, cfg);
+	if (!chf)
+		return layers;
+
+	// Erode the walkable area by agent radius.
+	if (!rcErodeWalkableArea(ctx, cfg.walkableRadius, *chf))
+	{
+		ctx->log(RC_LOG_ERROR, "buildTileLayers: Could not erode.");
+		return layers;
+	}
+
+	// (Optional) Mark areas.
+	const ConvexVolume* vols = m_geom->getConvexVolumes();
+	for (int i = 0; i < m_geom->getConvexVolumeCount(); ++i)
+		rcMarkConvexPolyArea(ctx, &vols[i].verts[0][0], vols[i].nverts, vols[i].hmin, vols[i].hmax, (unsigned char)vols[i].area, *chf);
+
+	deleted_unique_ptr<rcHeightfieldLayerSet> lset(rcAllocHeightfieldLayerSet(),
+		[](rcHeightfieldLayerSet* ls) { rcFreeHeightfieldLayerSet(ls); });
+	if (!rcBuildHeightfieldLayers(ctx, *chf, cfg.borderSize, cfg.walkableHeight, *lset))
+	{
+		ctx->log(RC_LOG_ERROR, "buildTileLayers: Could not build heightfield layers.");
+		return layers;
+	}
+
+	const int nlayers = rcMin(lset->nlayers, NavMeshTileCacheData::MAX_LAYERS_PER_TILE);
+	if (nlayers < lset->nlayers)
+	{
+		ctx->log(RC_LOG_WARNING, "buildTileLayers: Tile (%d,%d) has %d layers, only keeping %d.",
+			tx, ty, lset->nlayers, nlayers);
+	}
+
+	NavMeshTileCacheCompressor compressor;
+
+	for (int i = 0; i < nlayers; ++i)
+	{
+		const rcHeightfieldLayer* layer = &lset->layers[i];
+
+		dtTileCacheLayerHeader header;
+		header.magic = DT_TILECACHE_MAGIC;
+		header.version = DT_TILECACHE_VERSION;
+		header.tx = tx;
+		header.ty = ty;
+		header.tlayer = i;
+		rcVcopy(header.bmin, layer->bmin);
+		rcVcopy(header.bmax, layer->bmax);
+		header.width = (unsigned char)layer->width;
+		header.height = (unsigned char)layer->height;
+		header.minx = (unsigned char)layer->minx;
+		header.maxx = (unsigned char)layer->maxx;
+		header.miny = (unsigned char)layer->miny;
+		header.maxy = (unsigned char)layer->maxy;
+		header.hmin = (unsigned short)layer->hmin;
+		header.hmax = (unsigned short)layer->hmax;
+
+		TileCacheLayer tileLayer;
+		dtStatus status = dtBuildTileCacheLayer(&compressor, &header, layer->heights, layer->areas,
+			layer->cons, &tileLayer.data, &tileLayer.dataSize);
+		if (dtStatusFailed(status))
+		{
+			ctx->log(RC_LOG_ERROR, "buildTileLayers: Could not compress layer %d of tile (%d,%d).", i, tx, ty);
+			continue;
+		}
+
+		layers.push_back(tileLayer);
+	}
+
+	return layers;
+}
+
 void Sample_TileMesh::setOutputPath(const char* output_path)
 {
-	strcpy(m_outputPath, output_path);
-	char buffer[512];
-	sprintf(buffer, "%s\\MQ2Nav", output_path);
-	CreateDirectory(buffer, NULL);
+	m_outputPath = output_path;
+
+	boost::system::error_code ec;
+	boost::filesystem::create_directories(boost::filesystem::path(m_outputPath) / "MQ2Nav", ec);
 }
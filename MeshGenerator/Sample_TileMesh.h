@@ -23,15 +23,26 @@
 #include "DetourNavMesh.h"
 #include "Recast.h"
 #include "ChunkyTriMesh.h"
+#include "TileBuildCache.h"
+#include "../NavMeshTileCache.h"
 
 #include <atomic>
 #include <memory>
+#include <string>
 #include <functional>
 #include <thread>
+#include <vector>
 
 template <typename T>
 using deleted_unique_ptr = std::unique_ptr<T, std::function<void(T*)>>;
 
+// a compressed heightfield layer, allocated with dtAlloc
+struct TileCacheLayer
+{
+	unsigned char* data = nullptr;
+	int dataSize = 0;
+};
+
 class Sample_TileMesh : public Sample
 {
 protected:
@@ -40,31 +51,6 @@ protected:
 
 	const int MAX_NODES = 1024 * 1024;
 
-	enum DrawMode
-	{
-		DRAWMODE_NAVMESH,
-		DRAWMODE_NAVMESH_TRANS,
-		DRAWMODE_NAVMESH_BVTREE,
-		DRAWMODE_NAVMESH_NODES,
-		DRAWMODE_NAVMESH_PORTALS,
-		DRAWMODE_NAVMESH_INVIS,
-		DRAWMODE_MESH,
-		DRAWMODE_VOXELS,
-		DRAWMODE_VOXELS_WALKABLE,
-		DRAWMODE_COMPACT,
-		DRAWMODE_COMPACT_DISTANCE,
-		DRAWMODE_COMPACT_REGIONS,
-		DRAWMODE_REGION_CONNECTIONS,
-		DRAWMODE_RAW_CONTOURS,
-		DRAWMODE_BOTH_CONTOURS,
-		DRAWMODE_CONTOURS,
-		DRAWMODE_POLYMESH,
-		DRAWMODE_POLYMESH_DETAIL,
-		MAX_DRAWMODE
-	};
-		
-	DrawMode m_drawMode;
-	
 	int m_maxTiles;
 	int m_maxPolysPerTile;
 	float m_tileSize;
@@ -72,38 +58,75 @@ protected:
 	unsigned int m_tileCol;
 	float m_tileBmin[3];
 	float m_tileBmax[3];
-	float m_tileBuildTime;
-	float m_tileMemUsage;
-	int m_tileTriCount;
-	char* m_outputPath;
+	std::string m_outputPath;
+
+	// save in the compressed (v3) mesh format
+	bool m_saveCompressed;
+
+	// number of landmarks to save distance tables for (0 for none)
+	int m_landmarkCount;
+
+	// Build the tiles out of heightfield layers, and save the layers with the
+	// mesh so the plugin can rebuild tiles around dynamic obstacles.
+	bool m_buildTileCache;
+	deleted_unique_ptr<dtTileCache> m_tileCache;
+	dtTileCacheAlloc m_tileCacheAlloc;
+	NavMeshTileCacheCompressor m_tileCacheCompressor;
+	NavMeshTileCacheMeshProcess m_tileCacheMeshProcess;
+
+	// room to leave in the mesh for tiles with more than one layer
+	static const int EXPECTED_LAYERS_PER_TILE = 4;
 
 	int m_tilesWidth = 0;
 	int m_tilesHeight = 0;
 	int m_tilesCount = 0;
-	std::atomic<int> m_tilesBuilt = 0;
-	std::atomic<bool> m_buildingTiles = false;
-	std::atomic<bool> m_cancelTiles = false;
+	std::atomic<int> m_tilesBuilt{ 0 };
+	std::atomic<bool> m_buildingTiles{ false };
+	std::atomic<bool> m_cancelTiles{ false };
 	std::thread m_buildThread;
 
-	unsigned char* buildTileMesh(const int tx, const int ty, const float* bmin, const float* bmax, int& dataSize) const;
+	// worker threads for building all tiles (0 for one per core), and
+	// whether to keep each of them on its own core
+	int m_buildThreads = 0;
+	bool m_pinBuildThreads = false;
+
+	// built tiles waiting to be added to the mesh, before the workers wait
+	static const int BUILT_TILE_QUEUE_SIZE = 64;
 
-	void saveAll(const char* path, const dtNavMesh* mesh);
+	// Take tiles whose inputs haven't changed from the build cache instead
+	// of building them again. The cache is saved to m_buildCachePath after
+	// each full build, if there is one.
+	bool m_reuseTiles = true;
+	TileBuildCache m_buildCache;
+	std::string m_buildCachePath;
+	std::atomic<int> m_tilesReused{ 0 };
+
+	// tile grid size and the tile/poly bits of the tile ids, from the
+	// geometry bounds and the tile size
+	void updateTileCounts();
+
+	void initTileConfig(rcConfig& cfg, const float* bmin, const float* bmax) const;
+
+	// hash of everything the tile build reads, to look the tile up in the
+	// build cache
+	uint64_t hashTileInputs(const int tx, const int ty, const float* bmin, const float* bmax) const;
+
+	unsigned char* buildTileMesh(rcContext* ctx, const int tx, const int ty, const float* bmin, const float* bmax, int& dataSize) const;
+
+	std::vector<TileCacheLayer> buildTileLayers(rcContext* ctx, const int tx, const int ty, const float* bmin, const float* bmax) const;
+
+	bool saveAll(const char* path, const dtNavMesh* mesh);
 	dtNavMesh* loadAll(const char* path);
 	
 public:
 	Sample_TileMesh();
 	virtual ~Sample_TileMesh();
 
-	void SaveMesh(const std::string& outputPath);
+	bool SaveMesh(const std::string& outputPath);
 	bool LoadMesh(const std::string& outputPath);
 
 	void ResetMesh();
 	
-	virtual void handleSettings();
-	virtual void handleTools();
-	virtual void handleDebugMode();
-	virtual void handleRender();
-	virtual void handleRenderOverlay(double* proj, double* model, int* view);
 	virtual void handleMeshChanged(class InputGeom* geom);
 	virtual bool handleBuild();
 	
@@ -115,16 +138,29 @@ public:
 
 	void buildAllTiles(bool async = true);
 	void cancelBuildAllTiles(bool wait = true);
+	void waitForBuildAllTiles();
+
+	void setBuildThreads(int threads) { m_buildThreads = threads; }
+	void setBuildTileCache(bool build) { m_buildTileCache = build; }
+
+	// the layers the tiles were built out of, if setBuildTileCache was set
+	dtTileCache* getTileCache() const { return m_tileCache.get(); }
+
+	// Load the build cache from a file (next to the mesh), and save it there
+	// after building all tiles. Empty to keep the cache in memory only.
+	void setBuildCachePath(const std::string& path);
+	void setReuseTiles(bool reuse) { m_reuseTiles = reuse; }
 
 	bool isBuildingTiles() const { return m_buildingTiles; }
 
 	void getTileStatistics(int& width, int& height, int& maxTiles) const;
 	int getTilesBuilt() const { return m_tilesBuilt; }
+	int getTilesReused() const { return m_tilesReused; }
 	float getTotalBuildTimeMS() const { return m_totalBuildTimeMs; }
 
 	void setOutputPath(const char* output_path);
 
-	deleted_unique_ptr<rcCompactHeightfield> rasterizeGeometry(rcConfig& cfg) const;
+	deleted_unique_ptr<rcCompactHeightfield> rasterizeGeometry(rcContext* ctx, rcConfig& cfg) const;
 };
 
 
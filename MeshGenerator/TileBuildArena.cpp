@@ -0,0 +1,225 @@
+//
+// TileBuildArena.cpp
+//
+
+#include "TileBuildArena.h"
+
+#include "RecastAlloc.h"
+#include "DetourAlloc.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+
+//----------------------------------------------------------------------------
+
+namespace {
+
+// enough for a typical tile, so most tiles only ever use the first block
+const size_t MIN_BLOCK_SIZE = 4 * 1024 * 1024;
+const size_t ALIGNMENT = 16;
+
+thread_local TileBuildArena* t_currentArena = nullptr;
+bool s_enabled = true;
+
+// counted per thread, and added up when the scope ends
+thread_local TileBuildArena::Counts t_counts;
+std::atomic<long long> s_arenaAllocs{ 0 };
+std::atomic<long long> s_heapAllocs{ 0 };
+
+void* ArenaAlloc(size_t size)
+{
+	if (t_currentArena)
+	{
+		if (s_enabled)
+		{
+			if (void* ptr = t_currentArena->Allocate(size))
+			{
+				t_counts.arena++;
+				return ptr;
+			}
+		}
+
+		t_counts.heap++;
+	}
+
+	return malloc(size);
+}
+
+void ArenaFree(void* ptr)
+{
+	if (t_currentArena && t_currentArena->Free(ptr))
+		return;
+
+	free(ptr);
+}
+
+void* RecastAlloc(int size, rcAllocHint)
+{
+	return ArenaAlloc(size);
+}
+
+void* DetourAlloc(int size, dtAllocHint hint)
+{
+	// persistent detour data (tiles, the mesh itself) outlives the build
+	if (hint != DT_ALLOC_TEMP)
+		return malloc(size);
+
+	return ArenaAlloc(size);
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+TileBuildArena::TileBuildArena()
+{
+}
+
+TileBuildArena::~TileBuildArena()
+{
+	for (Block& block : m_blocks)
+		free(block.data);
+}
+
+void TileBuildArena::InstallAllocator()
+{
+	// every Sample_TileMesh does this, and the batch baker makes them on
+	// several threads at once
+	static std::once_flag installed;
+	std::call_once(installed, []()
+	{
+		rcAllocSetCustom(RecastAlloc, ArenaFree);
+		dtAllocSetCustom(DetourAlloc, ArenaFree);
+	});
+}
+
+TileBuildArena& TileBuildArena::ForCurrentThread()
+{
+	thread_local TileBuildArena arena;
+	return arena;
+}
+
+void TileBuildArena::SetEnabled(bool enabled)
+{
+	s_enabled = enabled;
+}
+
+TileBuildArena::Counts TileBuildArena::GetCounts()
+{
+	Counts counts;
+	counts.arena = s_arenaAllocs;
+	counts.heap = s_heapAllocs;
+	return counts;
+}
+
+void TileBuildArena::ResetCounts()
+{
+	s_arenaAllocs = 0;
+	s_heapAllocs = 0;
+}
+
+TileBuildArena::Scope::Scope(TileBuildArena& arena)
+	: m_arena(arena)
+	, m_previous(t_currentArena)
+{
+	t_currentArena = &m_arena;
+}
+
+TileBuildArena::Scope::~Scope()
+{
+	t_currentArena = m_previous;
+	m_arena.Reset();
+
+	s_arenaAllocs += t_counts.arena;
+	s_heapAllocs += t_counts.heap;
+	t_counts = Counts();
+}
+
+bool TileBuildArena::AddBlock(size_t minSize)
+{
+	// double up, so a big tile only takes a few blocks to fit
+	size_t size = std::max(std::max(minSize, MIN_BLOCK_SIZE), m_capacity);
+	if (m_capacity + size > MAX_ARENA_SIZE)
+	{
+		size = MAX_ARENA_SIZE - m_capacity;
+		if (size < minSize)
+			return false;
+	}
+
+	char* data = static_cast<char*>(malloc(size));
+	if (!data)
+		return false;
+
+	m_blocks.push_back({ data, size, 0 });
+	m_capacity += size;
+	return true;
+}
+
+void* TileBuildArena::Allocate(size_t size)
+{
+	size = (std::max<size_t>(size, 1) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+	if (m_blocks.empty() || m_blocks.back().size - m_blocks.back().used < size)
+	{
+		if (!AddBlock(size))
+			return nullptr;
+	}
+
+	Block& block = m_blocks.back();
+	m_lastOffset = block.used;
+	m_lastAlloc = block.data + block.used;
+	block.used += size;
+
+	return m_lastAlloc;
+}
+
+bool TileBuildArena::Owns(const void* ptr) const
+{
+	const char* p = static_cast<const char*>(ptr);
+
+	// newest first, that's where most frees are
+	for (auto iter = m_blocks.rbegin(); iter != m_blocks.rend(); ++iter)
+	{
+		if (p >= iter->data && p < iter->data + iter->size)
+			return true;
+	}
+
+	return false;
+}
+
+bool TileBuildArena::Free(void* ptr)
+{
+	if (ptr == m_lastAlloc)
+	{
+		// temp buffers are usually freed straight after use
+		m_blocks.back().used = m_lastOffset;
+		m_lastAlloc = nullptr;
+		return true;
+	}
+
+	return Owns(ptr);
+}
+
+void TileBuildArena::Reset()
+{
+	m_lastAlloc = nullptr;
+
+	// Tiles that needed more than one block get it as one block next time,
+	// so the arena settles on a single block as big as the biggest tile.
+	if (m_blocks.size() > 1)
+	{
+		size_t capacity = m_capacity;
+		for (Block& block : m_blocks)
+			free(block.data);
+		m_blocks.clear();
+		m_capacity = 0;
+
+		AddBlock(capacity);
+		return;
+	}
+
+	for (Block& block : m_blocks)
+		block.used = 0;
+}
@@ -0,0 +1,102 @@
+//
+// TileBuildArena.h
+//
+// Scratch memory for building one tile at a time on a worker thread. Building
+// a tile allocates a heightfield, compact heightfield, contours, poly mesh
+// and detail mesh through rcAlloc and throws them all away at the end. With
+// all the workers doing that through the global heap, the heap is where they
+// end up waiting on each other.
+//
+// Once the allocator is installed, rcAlloc (and dtAlloc for temp memory) on a
+// thread inside an arena Scope comes from that thread's arena, and rcFree of
+// it does nothing. When the scope ends, the whole arena is reset for the next
+// tile, keeping its memory. Anything else goes to malloc like it did before.
+//
+// Anything allocated in an arena has to be freed before the scope ends and on
+// the same thread. Recast's intermediate data is; the tile data that Detour
+// builds is persistent (DT_ALLOC_PERM) so it never comes from here.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class TileBuildArena
+{
+public:
+	TileBuildArena();
+	~TileBuildArena();
+
+	TileBuildArena(const TileBuildArena&) = delete;
+	TileBuildArena& operator=(const TileBuildArena&) = delete;
+
+	// Point rcAlloc/dtAlloc at the arena routing functions, the first time
+	// it's called. Call before any building starts.
+	static void InstallAllocator();
+
+	// the arena of the calling thread
+	static TileBuildArena& ForCurrentThread();
+
+	// Send allocations inside a Scope to the heap instead, to compare
+	// against. Only change it while nothing is being built.
+	static void SetEnabled(bool enabled);
+
+	// Allocations made inside Scopes, on every thread, since the counts were
+	// last reset: the ones an arena served and the ones that went to the heap.
+	// A thread's counts are added in when its Scope ends.
+	struct Counts
+	{
+		long long arena = 0;
+		long long heap = 0;
+	};
+	static Counts GetCounts();
+	static void ResetCounts();
+
+	// Routes the calling thread's allocations to an arena until it goes
+	// out of scope, then resets the arena.
+	class Scope
+	{
+	public:
+		explicit Scope(TileBuildArena& arena);
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		TileBuildArena& m_arena;
+		TileBuildArena* m_previous;
+	};
+
+	// null once the arena is at its size limit
+	void* Allocate(size_t size);
+
+	// true if the memory came from this arena (and so doesn't need freeing)
+	bool Free(void* ptr);
+
+	void Reset();
+
+	size_t GetCapacity() const { return m_capacity; }
+
+	// the arena is never bigger than this, bigger tiles spill over to malloc
+	static const size_t MAX_ARENA_SIZE = 256 * 1024 * 1024;
+
+private:
+	struct Block
+	{
+		char* data;
+		size_t size;
+		size_t used;
+	};
+
+	bool AddBlock(size_t minSize);
+	bool Owns(const void* ptr) const;
+
+	std::vector<Block> m_blocks;
+	size_t m_capacity = 0;
+
+	// the last allocation, so freeing it right away can give it back
+	void* m_lastAlloc = nullptr;
+	size_t m_lastOffset = 0;
+};
@@ -0,0 +1,226 @@
+//
+// TileBuildCache.cpp
+//
+
+#include "TileBuildCache.h"
+#include "../NavMeshFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+//----------------------------------------------------------------------------
+
+namespace {
+
+const uint32_t CACHE_MAGIC = 'M' << 24 | 'N' << 16 | 'B' << 8 | 'C';
+const uint32_t CACHE_VERSION = 1;
+
+const uint64_t PRIME1 = 0x9e3779b185ebca87ull;
+const uint64_t PRIME2 = 0xc2b2ae3d27d4eb4full;
+
+inline uint64_t Rotate(uint64_t value, int bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t Round(uint64_t hash, uint64_t value)
+{
+	hash ^= Rotate(value * PRIME2, 31) * PRIME1;
+	return Rotate(hash, 27) * PRIME1 + PRIME2;
+}
+
+struct CacheFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t count;
+};
+
+struct CacheFileEntry
+{
+	uint64_t hash;
+	uint32_t size;
+};
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+void TileInputHasher::Add(const void* data, size_t size)
+{
+	const char* p = static_cast<const char*>(data);
+	const char* end = p + size;
+
+	// most of what goes in is vertices, so go a word at a time
+	for (; p + sizeof(uint64_t) <= end; p += sizeof(uint64_t))
+	{
+		uint64_t word;
+		memcpy(&word, p, sizeof(word));
+		m_hash = Round(m_hash, word);
+	}
+
+	if (p < end)
+	{
+		uint64_t word = 0;
+		memcpy(&word, p, end - p);
+		m_hash = Round(m_hash, word);
+	}
+
+	m_length += size;
+}
+
+uint64_t TileInputHasher::GetHash() const
+{
+	// so inputs that only differ by trailing zeros don't match
+	uint64_t hash = Round(m_hash, m_length);
+
+	hash ^= hash >> 33;
+	hash *= PRIME2;
+	hash ^= hash >> 29;
+	hash *= PRIME1;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+//----------------------------------------------------------------------------
+
+bool TileBuildCache::Load(const std::string& filename)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_entries.clear();
+
+	std::ifstream file(filename, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	CacheFileHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+		|| header.magic != CACHE_MAGIC || header.version != CACHE_VERSION)
+	{
+		return false;
+	}
+
+	for (uint32_t i = 0; i < header.count; ++i)
+	{
+		CacheFileEntry fileEntry;
+		if (!file.read(reinterpret_cast<char*>(&fileEntry), sizeof(fileEntry)))
+			break;
+
+		auto blob = std::make_shared<std::vector<char>>(fileEntry.size);
+		if (fileEntry.size > 0 && !file.read(blob->data(), fileEntry.size))
+			break;
+
+		m_entries[fileEntry.hash].blob = std::move(blob);
+	}
+
+	// don't trust any of a file that was cut off
+	if (!file)
+	{
+		m_entries.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool TileBuildCache::Save(const std::string& filename) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// A save that gets cut off shouldn't cost the cache that was there
+	// before, so write it next to the old one and swap them when it's done.
+	std::string tempFile = filename + ".tmp";
+
+	bool result;
+	{
+		std::ofstream file(tempFile, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		CacheFileHeader header;
+		header.magic = CACHE_MAGIC;
+		header.version = CACHE_VERSION;
+		header.count = static_cast<uint32_t>(m_entries.size());
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		for (const auto& entry : m_entries)
+		{
+			CacheFileEntry fileEntry;
+			memset(&fileEntry, 0, sizeof(fileEntry));
+			fileEntry.hash = entry.first;
+			fileEntry.size = static_cast<uint32_t>(entry.second.blob->size());
+
+			file.write(reinterpret_cast<const char*>(&fileEntry), sizeof(fileEntry));
+			file.write(entry.second.blob->data(), fileEntry.size);
+		}
+
+		file.close();
+		result = !file.fail();
+	}
+
+	if (result)
+		result = ReplaceMeshFile(tempFile, filename);
+
+	if (!result)
+		remove(tempFile.c_str());
+
+	return result;
+}
+
+void TileBuildCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_entries.clear();
+}
+
+TileBuildCache::TileBlob TileBuildCache::Find(uint64_t hash)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto iter = m_entries.find(hash);
+	if (iter == m_entries.end())
+		return nullptr;
+
+	iter->second.used = true;
+	return iter->second.blob;
+}
+
+void TileBuildCache::Store(uint64_t hash, std::vector<char> blob)
+{
+	auto shared = std::make_shared<const std::vector<char>>(std::move(blob));
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Entry& entry = m_entries[hash];
+	entry.blob = std::move(shared);
+	entry.used = true;
+}
+
+void TileBuildCache::MarkAllUnused()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (auto& entry : m_entries)
+		entry.second.used = false;
+}
+
+void TileBuildCache::RemoveUnused()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (auto iter = m_entries.begin(); iter != m_entries.end();)
+	{
+		if (iter->second.used)
+			++iter;
+		else
+			iter = m_entries.erase(iter);
+	}
+}
+
+int TileBuildCache::GetCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return static_cast<int>(m_entries.size());
+}
@@ -0,0 +1,80 @@
+//
+// TileBuildCache.h
+//
+// Built tiles, keyed by a hash of everything that went into building them:
+// the triangles under the tile, the convex volumes and off-mesh links that
+// touch it, and the build settings. Building all tiles again looks each tile
+// up first, so after a small edit only the tiles the edit touched get built;
+// the rest come out of the cache.
+//
+// The cache is kept in a file next to the mesh (<zone>.buildcache), so a
+// rebuild in a later session (or a later --bake) gets the same benefit. It
+// is only an optimization, a missing or unreadable file just means every
+// tile gets built.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Hashes the inputs of a tile build. Not cryptographic, but 64 bits is
+// plenty to tell apart the few thousand tiles in a zone.
+class TileInputHasher
+{
+public:
+	void Add(const void* data, size_t size);
+
+	template <typename T>
+	void AddValue(const T& value) { Add(&value, sizeof(T)); }
+
+	uint64_t GetHash() const;
+
+private:
+	uint64_t m_hash = 0x27d4eb2f165667c5ull;
+	uint64_t m_length = 0;
+};
+
+class TileBuildCache
+{
+public:
+	typedef std::shared_ptr<const std::vector<char>> TileBlob;
+
+	// Replace the cache with the contents of a cache file. False (and an
+	// empty cache) if the file is missing or from a different version.
+	bool Load(const std::string& filename);
+
+	// Written under another name and then put in place of the old file, so
+	// an interrupted save leaves the previous cache intact.
+	bool Save(const std::string& filename) const;
+
+	void Clear();
+
+	// The stored result for a tile, or null. Marks the entry as used. Safe
+	// to call from the build workers.
+	TileBlob Find(uint64_t hash);
+	void Store(uint64_t hash, std::vector<char> blob);
+
+	// Call when starting to build all tiles, and RemoveUnused when all of
+	// them have been built. Entries that nothing looked up in between
+	// belong to tiles that have changed since.
+	void MarkAllUnused();
+	void RemoveUnused();
+
+	int GetCount() const;
+
+private:
+	struct Entry
+	{
+		TileBlob blob;
+		bool used = false;
+	};
+
+	mutable std::mutex m_mutex;
+	std::unordered_map<uint64_t, Entry> m_entries;
+};
@@ -0,0 +1,147 @@
+//
+// TileBuildScheduler.cpp
+//
+
+#include "TileBuildScheduler.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+
+//----------------------------------------------------------------------------
+
+static void PinCurrentThread(int core)
+{
+#if defined(_WIN32)
+	// affinity masks only reach the first 64 cores (one processor group)
+	const int maskBits = static_cast<int>(sizeof(DWORD_PTR) * 8);
+	SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << (core % maskBits));
+#elif defined(__linux__)
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(core % CPU_SETSIZE, &cpus);
+	pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#else
+	(void)core;
+#endif
+}
+
+//----------------------------------------------------------------------------
+
+TileBuildScheduler::TileBuildScheduler(int workerCount, bool pinThreads)
+	: m_workerCount(workerCount > 0 ? workerCount : GetCoreCount())
+	, m_pinThreads(pinThreads)
+{
+}
+
+TileBuildScheduler::~TileBuildScheduler()
+{
+	Wait();
+}
+
+int TileBuildScheduler::GetCoreCount()
+{
+	return std::max<int>(1, std::thread::hardware_concurrency());
+}
+
+void TileBuildScheduler::Run(int taskCount, const std::function<void(int)>& task,
+	const std::atomic<bool>& cancel, const std::function<void()>& onWorkersDone)
+{
+	Wait();
+
+	m_task = task;
+	m_onWorkersDone = onWorkersDone;
+	m_cancel = &cancel;
+
+	// no point in having more workers than there are tasks
+	const int workerCount = std::max(1, std::min(m_workerCount, taskCount));
+
+	// Hand out the tasks in blocks, so each worker starts on tiles next to
+	// each other and the stealing only happens towards the end.
+	m_workers.clear();
+	for (int i = 0; i < workerCount; ++i)
+	{
+		auto worker = std::make_unique<Worker>();
+		int first = static_cast<int>(static_cast<int64_t>(taskCount) * i / workerCount);
+		int last = static_cast<int>(static_cast<int64_t>(taskCount) * (i + 1) / workerCount);
+		for (int t = first; t < last; ++t)
+			worker->tasks.push_back(t);
+		m_workers.push_back(std::move(worker));
+	}
+
+	m_running = workerCount;
+	for (int i = 0; i < workerCount; ++i)
+		m_threads.emplace_back(&TileBuildScheduler::WorkerThread, this, i);
+}
+
+void TileBuildScheduler::Wait()
+{
+	for (std::thread& thread : m_threads)
+	{
+		if (thread.joinable())
+			thread.join();
+	}
+
+	m_threads.clear();
+}
+
+bool TileBuildScheduler::PopTask(int index, int& task)
+{
+	Worker& worker = *m_workers[index];
+	std::lock_guard<std::mutex> lock(worker.mutex);
+
+	if (worker.tasks.empty())
+		return false;
+
+	task = worker.tasks.front();
+	worker.tasks.pop_front();
+	return true;
+}
+
+bool TileBuildScheduler::StealTask(int index, int& task)
+{
+	// Take from the back of someone else's block, the end furthest from
+	// where its owner is working.
+	const int count = static_cast<int>(m_workers.size());
+	for (int i = 1; i < count; ++i)
+	{
+		Worker& victim = *m_workers[(index + i) % count];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+
+		if (!victim.tasks.empty())
+		{
+			task = victim.tasks.back();
+			victim.tasks.pop_back();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void TileBuildScheduler::WorkerThread(int index)
+{
+	if (m_pinThreads)
+		PinCurrentThread(index % GetCoreCount());
+
+	// Tasks don't add more tasks, so once there's nothing left to steal
+	// this worker is done.
+	int task = 0;
+	while (PopTask(index, task) || StealTask(index, task))
+	{
+		// skip what's left, but keep taking it so the queues empty out
+		if (*m_cancel)
+			continue;
+
+		m_task(task);
+	}
+
+	if (--m_running == 0 && m_onWorkersDone)
+		m_onWorkersDone();
+}
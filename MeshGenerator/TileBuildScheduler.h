@@ -0,0 +1,127 @@
+//
+// TileBuildScheduler.h
+//
+// Runs the tile builds for Sample_TileMesh on a pool of worker threads. Each
+// worker starts with a block of neighbouring tiles and steals from the others
+// once it runs out, so a few expensive tiles (cities, dense dungeons) don't
+// leave the rest of the cores idle at the end of a build.
+//
+// Built tiles go through a bounded queue to a single consumer, the thread
+// that adds them to the navmesh. The bound keeps the workers from getting
+// too far ahead of it and holding every built tile in memory at once.
+//
+// This only uses the standard library (plus the platform calls for pinning
+// threads to cores), so it works anywhere the generator builds.
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//----------------------------------------------------------------------------
+
+// A queue with room for a fixed number of items. Push blocks while it is full,
+// and Pop blocks while it is empty. Once closed, Pop drains what is left and
+// then returns false.
+template <typename T>
+class BoundedQueue
+{
+public:
+	explicit BoundedQueue(size_t capacity)
+		: m_capacity(capacity > 0 ? capacity : 1)
+	{
+	}
+
+	void Push(T item)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_notFull.wait(lock, [this]() { return m_items.size() < m_capacity; });
+
+		m_items.push_back(std::move(item));
+		m_notEmpty.notify_one();
+	}
+
+	bool Pop(T& item)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_notEmpty.wait(lock, [this]() { return !m_items.empty() || m_closed; });
+
+		if (m_items.empty())
+			return false;
+
+		item = std::move(m_items.front());
+		m_items.pop_front();
+		m_notFull.notify_one();
+		return true;
+	}
+
+	// no more items are coming
+	void Close()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_closed = true;
+		m_notEmpty.notify_all();
+	}
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_notFull;
+	std::condition_variable m_notEmpty;
+	std::deque<T> m_items;
+	size_t m_capacity;
+	bool m_closed = false;
+};
+
+//----------------------------------------------------------------------------
+
+class TileBuildScheduler
+{
+public:
+	// workerCount of 0 uses one worker per core
+	TileBuildScheduler(int workerCount, bool pinThreads);
+	~TileBuildScheduler();
+
+	int GetWorkerCount() const { return m_workerCount; }
+
+	// Run task(0) .. task(taskCount - 1) on the workers. Tasks that haven't
+	// started yet are skipped once cancel is set, the ones that are running
+	// are left to finish. onWorkersDone is called once, on the last worker
+	// to finish, after every task has either run or been skipped. Run itself
+	// returns straight away; call Wait to join the workers.
+	void Run(int taskCount, const std::function<void(int)>& task,
+		const std::atomic<bool>& cancel, const std::function<void()>& onWorkersDone);
+
+	void Wait();
+
+	static int GetCoreCount();
+
+private:
+	struct Worker
+	{
+		std::mutex mutex;
+		std::deque<int> tasks;
+	};
+
+	void WorkerThread(int index);
+
+	bool PopTask(int index, int& task);
+	bool StealTask(int index, int& task);
+
+	int m_workerCount;
+	bool m_pinThreads;
+
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	std::vector<std::thread> m_threads;
+	std::atomic<int> m_running{ 0 };
+
+	std::function<void(int)> m_task;
+	std::function<void()> m_onWorkersDone;
+	const std::atomic<bool>* m_cancel = nullptr;
+};
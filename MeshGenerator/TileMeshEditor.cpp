@@ -0,0 +1,537 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "TileMeshEditor.h"
+#include "InputGeom.h"
+#include "Recast.h"
+#include "RecastDebugDraw.h"
+#include "DetourDebugDraw.h"
+#include "NavMeshTesterTool.h"
+#include "NavMeshPruneTool.h"
+#include "OffMeshConnectionTool.h"
+#include "ConvexVolumeTool.h"
+#include "CrowdTool.h"
+#include "TileBuildScheduler.h"
+#include "../NavMeshLandmarks.h"
+
+#include "SDL.h"
+#include "SDL_opengl.h"
+#include "imgui.h"
+#include <gl/GLU.h>
+
+class NavMeshTileTool : public SampleTool
+{
+	Sample_TileMesh* m_sample;
+	float m_hitPos[3];
+	bool m_hitPosSet;
+	
+public:
+
+	NavMeshTileTool() :
+		m_sample(0),
+		m_hitPosSet(false)
+	{
+		m_hitPos[0] = m_hitPos[1] = m_hitPos[2] = 0;
+	}
+
+	virtual ~NavMeshTileTool()
+	{
+	}
+
+	virtual int type() { return TOOL_TILE_EDIT; }
+
+	virtual void init(Sample* sample)
+	{
+		m_sample = (Sample_TileMesh*)sample; 
+	}
+	
+	virtual void reset() {}
+
+	virtual void handleMenu()
+	{
+#if 0
+		imguiLabel("Create Tiles");
+		if (imguiButton("Create All"))
+		{
+			if (m_sample)
+				m_sample->buildAllTiles();
+		}
+#endif
+		if (ImGui::Button("Remove All"))
+		{
+			if (m_sample)
+				m_sample->removeAllTiles();
+		}
+	}
+
+	virtual void handleClick(const float* /*s*/, const float* p, bool shift)
+	{
+		m_hitPosSet = true;
+		rcVcopy(m_hitPos,p);
+		if (m_sample)
+		{
+			if (shift)
+				m_sample->removeTile(m_hitPos);
+			else
+				m_sample->buildTile(m_hitPos);
+		}
+	}
+
+	virtual void handleToggle() {}
+
+	virtual void handleStep() {}
+
+	virtual void handleUpdate(const float /*dt*/) {}
+	
+	virtual void handleRender()
+	{
+		if (m_hitPosSet)
+		{
+			const float s = m_sample->getAgentRadius();
+			glColor4ub(0,0,0,128);
+			glLineWidth(2.0f);
+			glBegin(GL_LINES);
+			glVertex3f(m_hitPos[0]-s,m_hitPos[1]+0.1f,m_hitPos[2]);
+			glVertex3f(m_hitPos[0]+s,m_hitPos[1]+0.1f,m_hitPos[2]);
+			glVertex3f(m_hitPos[0],m_hitPos[1]-s+0.1f,m_hitPos[2]);
+			glVertex3f(m_hitPos[0],m_hitPos[1]+s+0.1f,m_hitPos[2]);
+			glVertex3f(m_hitPos[0],m_hitPos[1]+0.1f,m_hitPos[2]-s);
+			glVertex3f(m_hitPos[0],m_hitPos[1]+0.1f,m_hitPos[2]+s);
+			glEnd();
+			glLineWidth(1.0f);
+		}
+	}
+	
+	virtual void handleRenderOverlay(double* proj, double* model, int* view)
+	{
+		GLdouble x, y, z;
+		if (m_hitPosSet && gluProject((GLdouble)m_hitPos[0], (GLdouble)m_hitPos[1], (GLdouble)m_hitPos[2],
+									  model, proj, view, &x, &y, &z))
+		{
+			int tx=0, ty=0;
+			m_sample->getTilePos(m_hitPos, tx, ty);
+
+			ImGui::RenderText((int)x + 5, -((int)y - 5), ImVec4(0, 0, 0, 220), "(%d,%d)", tx, ty);
+		}
+		
+		// Tool help
+		const int h = view[3];
+
+		ImGui::RenderTextRight(-330, -(h - 40), ImVec4(255, 255, 255, 192),
+			"LMB: Rebuild hit tile.  Shift+LMB: Clear hit tile.");
+	}
+};
+
+TileMeshEditor::TileMeshEditor() :
+	m_drawMode(DRAWMODE_NAVMESH),
+	m_tileBuildTime(0),
+	m_tileMemUsage(0),
+	m_tileTriCount(0)
+{
+	setTool(new NavMeshTileTool);
+}
+
+TileMeshEditor::~TileMeshEditor()
+{
+}
+
+void TileMeshEditor::handleSettings()
+{
+	if (ImGui::CollapsingHeader("Mesh Generation", 0, true, true))
+	{
+		ImGui::Text("Tiling");
+		ImGui::SliderFloat("TileSize", &m_tileSize, 16.0f, 1024.0f, "%.0f");
+
+		updateTileCounts();
+
+		ImGui::Checkbox("Compress Tiles", &m_saveCompressed);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Save compressed tiles with checksums (format v3).\n"
+				"Uncheck to save in the older v2 format.");
+
+		ImGui::SliderInt("Landmarks", &m_landmarkCount, 0, NavMeshLandmarks::MAX_LANDMARKS);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Number of landmarks to save distance tables for. These make path\n"
+				"searches faster in zones with winding passages. 0 to leave them out.");
+
+		ImGui::Checkbox("Dynamic Obstacle Layers", &m_buildTileCache);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Build the tiles out of heightfield layers, and save the layers with\n"
+				"the mesh so the plugin can rebuild tiles around doors and spawns.\n"
+				"Makes the mesh file bigger, and needs a tile size of 255 or less.");
+
+		ImGui::SliderInt("Build Threads", &m_buildThreads, 0, TileBuildScheduler::GetCoreCount());
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Number of threads to build tiles on. 0 to use one per core.");
+
+		ImGui::Checkbox("Pin Build Threads", &m_pinBuildThreads);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Keep each build thread on its own core.");
+
+		ImGui::Checkbox("Reuse Unchanged Tiles", &m_reuseTiles);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Only build the tiles whose geometry, volumes, links or settings\n"
+				"changed since the last build, and reuse the rest.");
+
+		ImGui::Separator();
+		handleCommonSettings();
+
+		if (m_geom)
+		{
+
+			// custom bounding box controls
+			ImGui::Text("Bounding Box");
+
+			glm::vec3 min = m_geom->getMeshBoundsMin();
+			glm::vec3 max = m_geom->getMeshBoundsMax();
+
+			ImGui::SliderFloat("Min X", &min.x, m_geom->getRealMeshBoundsMin().x, m_geom->getRealMeshBoundsMax().x, "%.1f");
+			ImGui::SliderFloat("Min Y", &min.y, m_geom->getRealMeshBoundsMin().y, m_geom->getRealMeshBoundsMax().y, "%.1f");
+			ImGui::SliderFloat("Min Z", &min.z, m_geom->getRealMeshBoundsMin().z, m_geom->getRealMeshBoundsMax().z, "%.1f");
+			ImGui::SliderFloat("Max X", &max.x, m_geom->getRealMeshBoundsMin().x, m_geom->getRealMeshBoundsMax().x, "%.1f");
+			ImGui::SliderFloat("Max Y", &max.y, m_geom->getRealMeshBoundsMin().y, m_geom->getRealMeshBoundsMax().y, "%.1f");
+			ImGui::SliderFloat("Max Z", &max.z, m_geom->getRealMeshBoundsMin().z, m_geom->getRealMeshBoundsMax().z, "%.1f");
+
+			m_geom->setMeshBoundsMin(min);
+			m_geom->setMeshBoundsMax(max);
+
+			if (ImGui::Button("Reset Bounds"))
+			{
+				m_geom->resetMeshBounds();
+			}
+		}
+	}
+}
+
+void TileMeshEditor::handleTools()
+{
+	int type = !m_tool ? TOOL_NONE : m_tool->type();
+
+	if (ImGui::RadioButton("Test Navmesh", type == TOOL_NAVMESH_TESTER))
+	{
+		setTool(new NavMeshTesterTool);
+	}
+	if (ImGui::RadioButton("Prune Navmesh", type == TOOL_NAVMESH_PRUNE))
+	{
+		setTool(new NavMeshPruneTool);
+	}
+	if (ImGui::RadioButton("Create Tiles", type == TOOL_TILE_EDIT))
+	{
+		setTool(new NavMeshTileTool);
+	}
+	if (ImGui::RadioButton("Create Off-Mesh Links", type == TOOL_OFFMESH_CONNECTION))
+	{
+		setTool(new OffMeshConnectionTool);
+	}
+	if (ImGui::RadioButton("Create Convex Volumes", type == TOOL_CONVEX_VOLUME))
+	{
+		setTool(new ConvexVolumeTool);
+	}
+	if (ImGui::RadioButton("Create Crowds", type == TOOL_CROWD))
+	{
+		setTool(new CrowdTool);
+	}
+	
+	ImGui::Separator();
+
+	ImGui::Indent();
+
+	if (m_tool)
+		m_tool->handleMenu();
+
+	ImGui::Unindent();
+}
+
+void TileMeshEditor::handleDebugMode()
+{
+	// Check which modes are valid.
+	bool valid[MAX_DRAWMODE];
+	for (int i = 0; i < MAX_DRAWMODE; ++i)
+		valid[i] = false;
+	
+	if (m_geom)
+	{
+		valid[DRAWMODE_NAVMESH] = m_navMesh != 0;
+		valid[DRAWMODE_NAVMESH_TRANS] = m_navMesh != 0;
+		valid[DRAWMODE_NAVMESH_BVTREE] = m_navMesh != 0;
+		valid[DRAWMODE_NAVMESH_NODES] = m_navQuery != 0;
+		valid[DRAWMODE_NAVMESH_PORTALS] = m_navMesh != 0;
+		valid[DRAWMODE_NAVMESH_INVIS] = m_navMesh != 0;
+		valid[DRAWMODE_MESH] = true;
+		valid[DRAWMODE_VOXELS] = false; // m_solid != 0;
+		valid[DRAWMODE_VOXELS_WALKABLE] = false; // = m_solid != 0;
+		valid[DRAWMODE_COMPACT] = false; // m_chf != 0;
+		valid[DRAWMODE_COMPACT_DISTANCE] = false; // m_chf != 0;
+		valid[DRAWMODE_COMPACT_REGIONS] = false; // m_chf != 0;
+		valid[DRAWMODE_REGION_CONNECTIONS] = false; // m_cset != 0;
+		valid[DRAWMODE_RAW_CONTOURS] = false; // m_cset != 0;
+		valid[DRAWMODE_BOTH_CONTOURS] = false; // m_cset != 0;
+		valid[DRAWMODE_CONTOURS] = false; // m_cset != 0;
+		valid[DRAWMODE_POLYMESH] = false; // m_pmesh != 0;
+		valid[DRAWMODE_POLYMESH_DETAIL] = false; // m_dmesh != 0;
+	}
+	
+	int unavail = 0;
+	for (int i = 0; i < MAX_DRAWMODE; ++i)
+		if (!valid[i]) unavail++;
+	
+	if (unavail == MAX_DRAWMODE)
+		return;
+	
+	ImGui::Text("Draw");
+
+	if (valid[DRAWMODE_MESH] && ImGui::RadioButton("Input Mesh", m_drawMode == DRAWMODE_MESH))
+		m_drawMode = DRAWMODE_MESH;
+	if (valid[DRAWMODE_NAVMESH] && ImGui::RadioButton("Navmesh", m_drawMode == DRAWMODE_NAVMESH))
+		m_drawMode = DRAWMODE_NAVMESH;
+	if (valid[DRAWMODE_NAVMESH_INVIS] && ImGui::RadioButton("Navmesh Invis", m_drawMode == DRAWMODE_NAVMESH_INVIS))
+		m_drawMode = DRAWMODE_NAVMESH_INVIS;
+	if (valid[DRAWMODE_NAVMESH_TRANS] && ImGui::RadioButton("Navmesh Trans", m_drawMode == DRAWMODE_NAVMESH_TRANS))
+		m_drawMode = DRAWMODE_NAVMESH_TRANS;
+	if (valid[DRAWMODE_NAVMESH_BVTREE] && ImGui::RadioButton("Navmesh BVTree", m_drawMode == DRAWMODE_NAVMESH_BVTREE))
+		m_drawMode = DRAWMODE_NAVMESH_BVTREE;
+	if (valid[DRAWMODE_NAVMESH_NODES] && ImGui::RadioButton("Navmesh Nodes", m_drawMode == DRAWMODE_NAVMESH_NODES))
+		m_drawMode = DRAWMODE_NAVMESH_NODES;
+	if (valid[DRAWMODE_NAVMESH_PORTALS] && ImGui::RadioButton("Navmesh Portals", m_drawMode == DRAWMODE_NAVMESH_PORTALS))
+		m_drawMode = DRAWMODE_NAVMESH_PORTALS;
+	if (valid[DRAWMODE_VOXELS] && ImGui::RadioButton("Voxels", m_drawMode == DRAWMODE_VOXELS))
+		m_drawMode = DRAWMODE_VOXELS;
+	if (valid[DRAWMODE_VOXELS_WALKABLE] && ImGui::RadioButton("Walkable Voxels", m_drawMode == DRAWMODE_VOXELS_WALKABLE))
+		m_drawMode = DRAWMODE_VOXELS_WALKABLE;
+	if (valid[DRAWMODE_COMPACT] && ImGui::RadioButton("Compact", m_drawMode == DRAWMODE_COMPACT))
+		m_drawMode = DRAWMODE_COMPACT;
+	if (valid[DRAWMODE_COMPACT_DISTANCE] && ImGui::RadioButton("Compact Distance", m_drawMode == DRAWMODE_COMPACT_DISTANCE))
+		m_drawMode = DRAWMODE_COMPACT_DISTANCE;
+	if (valid[DRAWMODE_COMPACT_REGIONS] && ImGui::RadioButton("Compact Regions", m_drawMode == DRAWMODE_COMPACT_REGIONS))
+		m_drawMode = DRAWMODE_COMPACT_REGIONS;
+	if (valid[DRAWMODE_REGION_CONNECTIONS] && ImGui::RadioButton("Region Connections", m_drawMode == DRAWMODE_REGION_CONNECTIONS))
+		m_drawMode = DRAWMODE_REGION_CONNECTIONS;
+	if (valid[DRAWMODE_RAW_CONTOURS] && ImGui::RadioButton("Raw Contours", m_drawMode == DRAWMODE_RAW_CONTOURS))
+		m_drawMode = DRAWMODE_RAW_CONTOURS;
+	if (valid[DRAWMODE_BOTH_CONTOURS] && ImGui::RadioButton("Both Contours", m_drawMode == DRAWMODE_BOTH_CONTOURS))
+		m_drawMode = DRAWMODE_BOTH_CONTOURS;
+	if (valid[DRAWMODE_CONTOURS] && ImGui::RadioButton("Contours", m_drawMode == DRAWMODE_CONTOURS))
+		m_drawMode = DRAWMODE_CONTOURS;
+	if (valid[DRAWMODE_POLYMESH] && ImGui::RadioButton("Poly Mesh", m_drawMode == DRAWMODE_POLYMESH))
+		m_drawMode = DRAWMODE_POLYMESH;
+	if (valid[DRAWMODE_POLYMESH_DETAIL] && ImGui::RadioButton("Poly Mesh Detail", m_drawMode == DRAWMODE_POLYMESH_DETAIL))
+		m_drawMode = DRAWMODE_POLYMESH_DETAIL;
+		
+	//if (unavail)
+	//{
+	//	imguiValue("Tick 'Keep Itermediate Results'");
+	//	imguiValue("rebuild some tiles to see");
+	//	imguiValue("more debug mode options.");
+	//}
+}
+
+void TileMeshEditor::handleRender()
+{
+	if (!m_geom || !m_geom->getMeshLoader())
+		return;
+	
+	DebugDrawGL dd;
+
+	const float texScale = 1.0f / (m_cellSize * 10.0f);
+	
+	// Draw mesh
+	if (m_drawMode != DRAWMODE_NAVMESH_TRANS)
+	{
+		// Draw mesh
+		duDebugDrawTriMeshSlope(&dd, m_geom->getMeshLoader()->getVerts(), m_geom->getMeshLoader()->getVertCount(),
+								m_geom->getMeshLoader()->getTris(), m_geom->getMeshLoader()->getNormals(), m_geom->getMeshLoader()->getTriCount(),
+								m_agentMaxSlope, texScale);
+		m_geom->drawOffMeshConnections(&dd);
+	}
+		
+	glDepthMask(GL_FALSE);
+	
+	// Draw bounds
+	const glm::vec3& bmin = m_geom->getMeshBoundsMin();
+	const glm::vec3& bmax = m_geom->getMeshBoundsMax();
+	duDebugDrawBoxWire(&dd, bmin[0],bmin[1],bmin[2], bmax[0],bmax[1],bmax[2], duRGBA(255,255,255,128), 1.0f);
+	
+	// Tiling grid.
+	int gw = 0, gh = 0;
+	rcCalcGridSize(&bmin[0], &bmax[0], m_cellSize, &gw, &gh);
+	const int tw = (gw + (int)m_tileSize-1) / (int)m_tileSize;
+	const int th = (gh + (int)m_tileSize-1) / (int)m_tileSize;
+	const float s = m_tileSize*m_cellSize;
+	duDebugDrawGridXZ(&dd, bmin[0],bmin[1],bmin[2], tw,th, s, duRGBA(0,0,0,64), 1.0f);
+	
+	// Draw active tile
+	duDebugDrawBoxWire(&dd, m_tileBmin[0],m_tileBmin[1],m_tileBmin[2],
+					   m_tileBmax[0],m_tileBmax[1],m_tileBmax[2], m_tileCol, 1.0f);
+		
+	if (m_navMesh && m_navQuery &&
+		(m_drawMode == DRAWMODE_NAVMESH ||
+		 m_drawMode == DRAWMODE_NAVMESH_TRANS ||
+		 m_drawMode == DRAWMODE_NAVMESH_BVTREE ||
+		 m_drawMode == DRAWMODE_NAVMESH_NODES ||
+		 m_drawMode == DRAWMODE_NAVMESH_PORTALS ||
+		 m_drawMode == DRAWMODE_NAVMESH_INVIS))
+	{
+		if (m_drawMode != DRAWMODE_NAVMESH_INVIS)
+			duDebugDrawNavMeshWithClosedList(&dd, *m_navMesh, *m_navQuery, m_navMeshDrawFlags);
+		if (m_drawMode == DRAWMODE_NAVMESH_BVTREE)
+			duDebugDrawNavMeshBVTree(&dd, *m_navMesh);
+		if (m_drawMode == DRAWMODE_NAVMESH_PORTALS)
+			duDebugDrawNavMeshPortals(&dd, *m_navMesh);
+		if (m_drawMode == DRAWMODE_NAVMESH_NODES)
+			duDebugDrawNavMeshNodes(&dd, *m_navQuery);
+		duDebugDrawNavMeshPolysWithFlags(&dd, *m_navMesh, SAMPLE_POLYFLAGS_DISABLED, duRGBA(0,0,0,128));
+	}
+	
+	
+	glDepthMask(GL_TRUE);
+	
+	//if (m_chf && m_drawMode == DRAWMODE_COMPACT)
+	//	duDebugDrawCompactHeightfieldSolid(&dd, *m_chf);
+	//if (m_chf && m_drawMode == DRAWMODE_COMPACT_DISTANCE)
+	//	duDebugDrawCompactHeightfieldDistance(&dd, *m_chf);
+	//if (m_chf && m_drawMode == DRAWMODE_COMPACT_REGIONS)
+	//	duDebugDrawCompactHeightfieldRegions(&dd, *m_chf);
+	//if (m_solid && m_drawMode == DRAWMODE_VOXELS)
+	//{
+	//	glEnable(GL_FOG);
+	//	duDebugDrawHeightfieldSolid(&dd, *m_solid);
+	//	glDisable(GL_FOG);
+	//}
+	//if (m_solid && m_drawMode == DRAWMODE_VOXELS_WALKABLE)
+	//{
+	//	glEnable(GL_FOG);
+	//	duDebugDrawHeightfieldWalkable(&dd, *m_solid);
+	//	glDisable(GL_FOG);
+	//}
+	//if (m_cset && m_drawMode == DRAWMODE_RAW_CONTOURS)
+	//{
+	//	glDepthMask(GL_FALSE);
+	//	duDebugDrawRawContours(&dd, *m_cset);
+	//	glDepthMask(GL_TRUE);
+	//}	
+	//if (m_cset && m_drawMode == DRAWMODE_BOTH_CONTOURS)
+	//{
+	//	glDepthMask(GL_FALSE);
+	//	duDebugDrawRawContours(&dd, *m_cset, 0.5f);
+	//	duDebugDrawContours(&dd, *m_cset);
+	//	glDepthMask(GL_TRUE);
+	//}
+	//if (m_cset && m_drawMode == DRAWMODE_CONTOURS)
+	//{
+	//	glDepthMask(GL_FALSE);
+	//	duDebugDrawContours(&dd, *m_cset);
+	//	glDepthMask(GL_TRUE);
+	//}
+	//if (m_chf && m_cset && m_drawMode == DRAWMODE_REGION_CONNECTIONS)
+	//{
+	//	duDebugDrawCompactHeightfieldRegions(&dd, *m_chf);
+	//	
+	//	glDepthMask(GL_FALSE);
+	//	duDebugDrawRegionConnections(&dd, *m_cset);
+	//	glDepthMask(GL_TRUE);
+	//}
+	//if (m_pmesh && m_drawMode == DRAWMODE_POLYMESH)
+	//{
+	//	glDepthMask(GL_FALSE);
+	//	duDebugDrawPolyMesh(&dd, *m_pmesh);
+	//	glDepthMask(GL_TRUE);
+	//}
+	//if (m_dmesh && m_drawMode == DRAWMODE_POLYMESH_DETAIL)
+	//{
+	//	glDepthMask(GL_FALSE);
+	//	duDebugDrawPolyMeshDetail(&dd, *m_dmesh);
+	//	glDepthMask(GL_TRUE);
+	//}
+		
+	m_geom->drawConvexVolumes(&dd);
+	
+	if (m_tool)
+		m_tool->handleRender();
+	renderToolStates();
+
+	glDepthMask(GL_TRUE);
+}
+
+void TileMeshEditor::handleRenderOverlay(double* proj, double* model, int* view)
+{
+	GLdouble x, y, z;
+	
+	// Draw start and end point labels
+	if (m_tileBuildTime > 0.0f
+		&& gluProject(
+			(GLdouble)(m_tileBmin[0]+m_tileBmax[0])/2,
+			(GLdouble)(m_tileBmin[1]+m_tileBmax[1])/2,
+			(GLdouble)(m_tileBmin[2]+m_tileBmax[2])/2,
+			model, proj, view, &x, &y, &z))
+	{
+		ImGui::RenderText((int)x, -((int)y - 25), ImVec4(0, 0, 0, 220),
+			"%.3fms / %dTris / %.1fkB", m_tileBuildTime, m_tileTriCount, m_tileMemUsage);
+	}
+	
+	if (m_tool)
+		m_tool->handleRenderOverlay(proj, model, view);
+	renderOverlayToolStates(proj, model, view);
+}
+
+void TileMeshEditor::handleCommonSettings()
+{
+	ImGui::Text("Rasterization");
+	ImGui::SliderFloat("Cell Size", &m_cellSize, 0.1f, 1.0f);
+	ImGui::SliderFloat("Cell Height", &m_cellHeight, 0.1f, 1.0f);
+
+	if (m_geom)
+	{
+		const glm::vec3& bmin = m_geom->getMeshBoundsMin();
+		const glm::vec3& bmax = m_geom->getMeshBoundsMax();
+		int gw = 0, gh = 0;
+		rcCalcGridSize(&bmin[0], &bmax[0], m_cellSize, &gw, &gh);
+
+		ImGui::LabelText("Voxels", "%d x %d", gw, gh);
+	}
+
+	ImGui::Separator();
+	ImGui::Text("Agent");
+	
+	ImGui::SliderFloat("Height", &m_agentHeight, 0.1f, 15.0f, "%.1f");
+	ImGui::SliderFloat("Radius", &m_agentRadius, 0.1f, 15.0f, "%.1f");
+	ImGui::SliderFloat("Max Climb", &m_agentMaxClimb, 0.1f, 15.0f, "%.1f");
+	ImGui::SliderFloat("Max Slope", &m_agentMaxSlope, 0.0f, 90.0f, "%.0f");
+
+	ImGui::Separator();
+	ImGui::Text("Region");
+	ImGui::SliderFloat("Min Region Size", &m_regionMinSize, 0.0f, 150.0f, "%.0f");
+	ImGui::SliderFloat("Merged Region Size", &m_regionMergeSize, 0.0f, 150.0f, "%.0f");
+
+	ImGui::Separator();
+	ImGui::Text("Partitioning");
+	const char *partition_types[] = { "Watershed", "Monotone", "Layers" };
+	ImGui::Combo("Type", &m_partitionType, partition_types, 3);
+
+	ImGui::Separator();
+	ImGui::Text("Polygonization");
+	ImGui::SliderFloat("Max Edge Length", &m_edgeMaxLen, 0.0f, 50.0f, "%.0f");
+	ImGui::SliderFloat("Max Edge Error", &m_edgeMaxError, 0.1f, 3.0f, "%.1f");
+	ImGui::SliderFloat("Verts Per Poly", &m_vertsPerPoly, 3.0f, 12.0f, "%.0f");
+
+	ImGui::Separator();
+	ImGui::Text("Detail Mesh");
+	ImGui::SliderFloat("Sample Distance", &m_detailSampleDist, 0.0f, 32.0f, "%.0f");
+	ImGui::SliderFloat("Max Sample Error", &m_detailSampleMaxError, 0.0f, 16.0f, "%.0f");
+
+	ImGui::Separator();
+}
@@ -11,6 +11,9 @@
 #include "Sample_Debug.h"
 
 #include "Interface.h"
+#include "BatchBaker.h"
+#include "EQConfig.h"
+#include "../NavMeshFile.h"
 
 #include "zone-utilities/log/log_macros.h"
 #include "zone-utilities/log/log_stdout.h"
@@ -87,8 +90,99 @@ VOID DebugSpewAlways(PCHAR szFormat, ...)
 	LocalFree(szOutput);
 }
 
+// We're a windows subsystem app, so hook up to the console we were started
+// from (if any) when running a command line operation.
+static void AttachParentConsole()
+{
+	if (AttachConsole(ATTACH_PARENT_PROCESS))
+	{
+		freopen("CONOUT$", "w", stdout);
+		freopen("CONOUT$", "w", stderr);
+	}
+}
+
+// MeshGenerator.exe --convert <input.bin> <output.bin> [--version <2|3>]
+static int ConvertMeshCommand(int argc, char* argv[])
+{
+	AttachParentConsole();
+
+	if (argc < 4)
+	{
+		fprintf(stderr, "usage: %s --convert <input.bin> <output.bin> [--version <2|3>]\n", argv[0]);
+		return 1;
+	}
+
+	std::string inputFile = argv[2];
+	std::string outputFile = argv[3];
+	int version = NAVMESHSET_VERSION;
+
+	if (argc > 5 && !strcmp(argv[4], "--version"))
+		version = atoi(argv[5]);
+
+	if (version != NAVMESHSET_VERSION && version != NAVMESHSET_VERSION_RAW)
+	{
+		fprintf(stderr, "Unsupported mesh version: %d\n", version);
+		return 1;
+	}
+
+	if (!ConvertNavMeshFile(inputFile, outputFile, version))
+	{
+		fprintf(stderr, "Failed to convert %s\n", inputFile.c_str());
+		return 1;
+	}
+
+	printf("Wrote %s (version %d)\n", outputFile.c_str(), version);
+	return 0;
+}
+
+// MeshGenerator.exe --bake [--eq <path>] [--output <path>] [--reports <path>]
+//     [--jobs <n>] [--threads <n>] [--rebuild] [--check-determinism]
+//     <zone> [<zone> ...] | all
+static int BakeMeshCommand(int argc, char* argv[])
+{
+	AttachParentConsole();
+
+	// paths default to the ones from the interface, but don't ask for them
+	EQConfig config(false);
+
+	BatchBakeOptions options;
+	options.everquestPath = config.GetEverquestPath();
+	options.outputPath = config.GetOutputPath();
+
+	if (!ParseBatchBakeArgs(argc, argv, 2, options))
+		return 1;
+
+	if (options.allZones)
+	{
+		options.zones.clear();
+		for (const auto& zone : config.GetAllMaps())
+			options.zones.push_back(zone.first);
+	}
+
+	if (options.zones.empty())
+	{
+		fprintf(stderr, "usage: %s --bake [--eq <path>] [--output <path>] [--reports <path>]\n"
+			"    [--jobs <n>] [--threads <n>] [--rebuild] [--check-determinism]\n"
+			"    <zone> [<zone> ...] | all\n", argv[0]);
+		return 1;
+	}
+
+	if (options.everquestPath.empty() || options.outputPath.empty())
+	{
+		fprintf(stderr, "The EverQuest and output paths need to be set, either in MeshGenerator.ini "
+			"or with --eq and --output\n");
+		return 1;
+	}
+
+	BatchBaker baker(options);
+	return baker.Run() == 0 ? 0 : 2;
+}
+
 int main(int argc, char* argv[])
 {
+	if (argc > 1 && !strcmp(argv[1], "--convert"))
+		return ConvertMeshCommand(argc, argv);
+
 	// Construct the path to the ini file
 	CHAR logfilePath[MAX_PATH] = { 0 };
 	GetModuleFileNameA(NULL, logfilePath, MAX_PATH);
@@ -97,6 +191,11 @@ int main(int argc, char* argv[])
 
 	eqLogInit(-1);
 	eqLogRegister(std::make_shared<EQEmu::Log::LogFile>(logfilePath));
+
+	// the zone loaders log here too, keep the console for the bake progress
+	if (argc > 1 && !strcmp(argv[1], "--bake"))
+		return BakeMeshCommand(argc, argv);
+
 	eqLogRegister(std::make_shared<EQEmu::Log::LogStdOut>());
 	//eqLogRegister(std::make_shared<LogContext>(ctx));
 
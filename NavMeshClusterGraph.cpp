@@ -0,0 +1,581 @@
+//
+// NavMeshClusterGraph.cpp
+//
+
+#include "NavMeshClusterGraph.h"
+
+#include "DetourCommon.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <numeric>
+#include <queue>
+
+//----------------------------------------------------------------------------
+
+NavMeshClusterGraph::NavMeshClusterGraph(dtNavMesh* navMesh)
+	: m_navMesh(navMesh)
+{
+	Update();
+}
+
+NavMeshClusterGraph::~NavMeshClusterGraph()
+{
+}
+
+void NavMeshClusterGraph::SetNavMesh(dtNavMesh* navMesh)
+{
+	m_navMesh = navMesh;
+	m_tiles.clear();
+	Update();
+}
+
+void NavMeshClusterGraph::Update()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	if (!m_navMesh)
+	{
+		m_tiles.clear();
+		m_portals.clear();
+		m_components.clear();
+		m_nodes.clear();
+		m_stats = Stats();
+		return;
+	}
+
+	const dtNavMesh* navMesh = m_navMesh;
+	int maxTiles = navMesh->getMaxTiles();
+	m_tiles.resize(maxTiles);
+
+	// Find the tiles that were added, removed or replaced. Their neighbors'
+	// links to them changed too, so those need their borders built again.
+	std::vector<bool> changed(maxTiles, false);
+	std::vector<bool> dirty(maxTiles, false);
+
+	auto markNeighbors = [&](int x, int y)
+	{
+		const int MAX_NEIGHBORS = 32;
+		const dtMeshTile* neighbors[MAX_NEIGHBORS];
+
+		for (int dy = -1; dy <= 1; ++dy)
+		{
+			for (int dx = -1; dx <= 1; ++dx)
+			{
+				int count = navMesh->getTilesAt(x + dx, y + dy, neighbors, MAX_NEIGHBORS);
+				for (int n = 0; n < count; ++n)
+					dirty[navMesh->decodePolyIdTile(navMesh->getTileRef(neighbors[n]))] = true;
+			}
+		}
+	};
+
+	for (int i = 0; i < maxTiles; ++i)
+	{
+		const dtMeshTile* tile = navMesh->getTile(i);
+		dtTileRef tileRef = tile && tile->header ? navMesh->getTileRef(tile) : 0;
+
+		if (tileRef == m_tiles[i].tileRef)
+			continue;
+
+		// neighbors of where it was, and of where it is now
+		if (m_tiles[i].tileRef)
+			markNeighbors(m_tiles[i].x, m_tiles[i].y);
+		if (tileRef)
+			markNeighbors(tile->header->x, tile->header->y);
+
+		changed[i] = true;
+		dirty[i] = true;
+	}
+
+	m_stats.tilesUpdated = 0;
+
+	for (int i = 0; i < maxTiles; ++i)
+	{
+		if (!changed[i])
+			continue;
+
+		m_tiles[i] = TileClusters();
+
+		const dtMeshTile* tile = navMesh->getTile(i);
+		if (tile && tile->header)
+		{
+			BuildTileClusters(tile, i);
+			m_stats.tilesUpdated++;
+		}
+	}
+
+	// borders refer to the clusters on both sides, so all of the clusters
+	// have to be labeled first.
+	for (int i = 0; i < maxTiles; ++i)
+	{
+		if (!dirty[i] || !m_tiles[i].tileRef)
+			continue;
+
+		m_tiles[i].borders.clear();
+		m_tiles[i].offMeshLinks.clear();
+		BuildTileBorders(navMesh->getTile(i), i);
+	}
+
+	BuildPortals();
+	BuildComponents();
+
+	m_stats.buildTimeMs = std::chrono::duration<float, std::milli>(
+		std::chrono::steady_clock::now() - start).count();
+}
+
+void NavMeshClusterGraph::BuildTileClusters(const dtMeshTile* tile, int tileIndex)
+{
+	TileClusters& clusters = m_tiles[tileIndex];
+	clusters.tileRef = m_navMesh->getTileRef(tile);
+	clusters.x = tile->header->x;
+	clusters.y = tile->header->y;
+
+	unsigned int polyCount = static_cast<unsigned int>(tile->header->polyCount);
+	clusters.polyClusters.assign(polyCount, NO_CLUSTER);
+
+	// flood fill across the links inside the tile
+	std::vector<unsigned int> stack;
+
+	for (unsigned int i = 0; i < polyCount; ++i)
+	{
+		if (clusters.polyClusters[i] != NO_CLUSTER)
+			continue;
+		if (clusters.numClusters == NO_CLUSTER)
+			break;
+
+		uint16_t cluster = static_cast<uint16_t>(clusters.numClusters++);
+		clusters.polyClusters[i] = cluster;
+		stack.push_back(i);
+
+		while (!stack.empty())
+		{
+			const dtPoly& poly = tile->polys[stack.back()];
+			stack.pop_back();
+
+			for (unsigned int l = poly.firstLink; l != DT_NULL_LINK; l = tile->links[l].next)
+			{
+				dtPolyRef ref = tile->links[l].ref;
+				if (!ref || m_navMesh->decodePolyIdTile(ref) != static_cast<unsigned int>(tileIndex))
+					continue;
+
+				unsigned int neighbor = m_navMesh->decodePolyIdPoly(ref);
+				if (neighbor < polyCount && clusters.polyClusters[neighbor] == NO_CLUSTER)
+				{
+					clusters.polyClusters[neighbor] = cluster;
+					stack.push_back(neighbor);
+				}
+			}
+		}
+	}
+}
+
+void NavMeshClusterGraph::BuildTileBorders(const dtMeshTile* tile, int tileIndex)
+{
+	// all of the poly edges that lead into another tile
+	struct BorderEdge
+	{
+		int otherTile;
+		uint16_t cluster;
+		uint16_t otherCluster;
+		dtPolyRef ref;
+		dtPolyRef otherRef;
+		float mid[3];
+	};
+	std::vector<BorderEdge> edges;
+
+	TileClusters& clusters = m_tiles[tileIndex];
+	dtPolyRef base = m_navMesh->getPolyRefBase(tile);
+
+	for (int i = 0; i < tile->header->polyCount; ++i)
+	{
+		const dtPoly& poly = tile->polys[i];
+		if (clusters.polyClusters[i] == NO_CLUSTER)
+			continue;
+
+		for (unsigned int l = poly.firstLink; l != DT_NULL_LINK; l = tile->links[l].next)
+		{
+			const dtLink& link = tile->links[l];
+			if (!link.ref)
+				continue;
+
+			// border links go both ways, only take them from one side
+			int otherTile = static_cast<int>(m_navMesh->decodePolyIdTile(link.ref));
+			if (otherTile <= tileIndex || otherTile >= static_cast<int>(m_tiles.size()))
+				continue;
+
+			const TileClusters& otherClusters = m_tiles[otherTile];
+			unsigned int otherPoly = m_navMesh->decodePolyIdPoly(link.ref);
+			if (otherPoly >= otherClusters.polyClusters.size()
+				|| otherClusters.polyClusters[otherPoly] == NO_CLUSTER)
+				continue;
+
+			const dtMeshTile* neighborTile = nullptr;
+			const dtPoly* neighborPoly = nullptr;
+			m_navMesh->getTileAndPolyByRefUnsafe(link.ref, &neighborTile, &neighborPoly);
+
+			// off-mesh connections only count towards components
+			if (poly.getType() == DT_POLYTYPE_OFFMESH_CONNECTION
+				|| neighborPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+			{
+				OffMeshLink offMeshLink;
+				offMeshLink.cluster = clusters.polyClusters[i];
+				offMeshLink.otherTile = otherTile;
+				offMeshLink.otherCluster = otherClusters.polyClusters[otherPoly];
+				clusters.offMeshLinks.push_back(offMeshLink);
+				continue;
+			}
+
+			BorderEdge edge;
+			edge.otherTile = otherTile;
+			edge.cluster = clusters.polyClusters[i];
+			edge.otherCluster = otherClusters.polyClusters[otherPoly];
+			edge.ref = base | static_cast<dtPolyRef>(i);
+			edge.otherRef = link.ref;
+
+			// the middle of the part of the edge that the link covers
+			const float* va = &tile->verts[poly.verts[link.edge] * 3];
+			const float* vb = &tile->verts[poly.verts[(link.edge + 1) % poly.vertCount] * 3];
+			float t = 0.5f;
+			if (link.side != 0xff)
+				t = (link.bmin + link.bmax) * 0.5f / 255.0f;
+			dtVlerp(edge.mid, va, vb, t);
+
+			edges.push_back(edge);
+		}
+	}
+
+	if (edges.empty())
+		return;
+
+	// Each pair of clusters that touch gets one portal. Use the edge nearest
+	// the middle of all of their edges as the place to cross.
+	std::sort(edges.begin(), edges.end(), [](const BorderEdge& a, const BorderEdge& b)
+	{
+		if (a.otherTile != b.otherTile) return a.otherTile < b.otherTile;
+		if (a.cluster != b.cluster) return a.cluster < b.cluster;
+		return a.otherCluster < b.otherCluster;
+	});
+
+	for (size_t first = 0; first < edges.size(); )
+	{
+		size_t last = first + 1;
+		while (last < edges.size()
+			&& edges[last].otherTile == edges[first].otherTile
+			&& edges[last].cluster == edges[first].cluster
+			&& edges[last].otherCluster == edges[first].otherCluster)
+		{
+			++last;
+		}
+
+		float center[3] = { 0, 0, 0 };
+		for (size_t i = first; i < last; ++i)
+			dtVadd(center, center, edges[i].mid);
+		dtVscale(center, center, 1.0f / (last - first));
+
+		size_t best = first;
+		float bestDist = FLT_MAX;
+		for (size_t i = first; i < last; ++i)
+		{
+			float dist = dtVdistSqr(center, edges[i].mid);
+			if (dist < bestDist)
+			{
+				best = i;
+				bestDist = dist;
+			}
+		}
+
+		const BorderEdge& edge = edges[best];
+
+		Portal portal;
+		portal.refs[0] = edge.ref;
+		portal.refs[1] = edge.otherRef;
+		portal.tiles[0] = tileIndex;
+		portal.tiles[1] = edge.otherTile;
+		portal.clusters[0] = edge.cluster;
+		portal.clusters[1] = edge.otherCluster;
+		dtVcopy(portal.pos, edge.mid);
+		clusters.borders.push_back(portal);
+
+		first = last;
+	}
+}
+
+void NavMeshClusterGraph::BuildPortals()
+{
+	m_portals.clear();
+	m_stats.edges = 0;
+
+	for (TileClusters& clusters : m_tiles)
+		clusters.portals.clear();
+
+	for (size_t i = 0; i < m_tiles.size(); ++i)
+	{
+		for (const Portal& portal : m_tiles[i].borders)
+		{
+			int index = static_cast<int>(m_portals.size());
+			m_portals.push_back(portal);
+			m_tiles[portal.tiles[0]].portals.push_back(index);
+			m_tiles[portal.tiles[1]].portals.push_back(index);
+		}
+	}
+
+	// every portal out of a cluster connects to every other one
+	for (size_t i = 0; i < m_tiles.size(); ++i)
+	{
+		const TileClusters& clusters = m_tiles[i];
+
+		std::vector<int> counts(clusters.numClusters, 0);
+		for (int p : clusters.portals)
+		{
+			const Portal& portal = m_portals[p];
+			counts[portal.clusters[portal.tiles[0] == static_cast<int>(i) ? 0 : 1]]++;
+		}
+
+		for (int count : counts)
+			m_stats.edges += count * (count - 1) / 2;
+	}
+
+	m_stats.portals = static_cast<int>(m_portals.size());
+
+	// one node for each side of each portal, and one for the goal
+	m_nodes.resize(m_portals.size() * 2 + 1);
+}
+
+void NavMeshClusterGraph::BuildComponents()
+{
+	// This is only over the clusters, which are far fewer than the polys, so
+	// it's cheap enough to do all of it whenever anything changes.
+	int numClusters = 0;
+	for (TileClusters& clusters : m_tiles)
+	{
+		clusters.firstCluster = numClusters;
+		numClusters += clusters.numClusters;
+	}
+
+	std::vector<int> parents(numClusters);
+	std::iota(parents.begin(), parents.end(), 0);
+
+	auto find = [&](int i)
+	{
+		while (parents[i] != i)
+		{
+			parents[i] = parents[parents[i]];
+			i = parents[i];
+		}
+		return i;
+	};
+
+	auto join = [&](int a, int b)
+	{
+		a = find(a);
+		b = find(b);
+		if (a != b)
+			parents[std::max(a, b)] = std::min(a, b);
+	};
+
+	for (const Portal& portal : m_portals)
+	{
+		join(m_tiles[portal.tiles[0]].firstCluster + portal.clusters[0],
+			m_tiles[portal.tiles[1]].firstCluster + portal.clusters[1]);
+	}
+
+	for (const TileClusters& clusters : m_tiles)
+	{
+		for (const OffMeshLink& link : clusters.offMeshLinks)
+		{
+			join(clusters.firstCluster + link.cluster,
+				m_tiles[link.otherTile].firstCluster + link.otherCluster);
+		}
+	}
+
+	// number them from zero
+	m_components.assign(numClusters, -1);
+	int numComponents = 0;
+
+	for (int i = 0; i < numClusters; ++i)
+	{
+		int root = find(i);
+		if (m_components[root] == -1)
+			m_components[root] = numComponents++;
+		m_components[i] = m_components[root];
+	}
+
+	m_stats.clusters = numClusters;
+	m_stats.components = numComponents;
+}
+
+bool NavMeshClusterGraph::GetCluster(dtPolyRef ref, int& tileIndex, uint16_t& cluster) const
+{
+	if (!m_navMesh || !m_navMesh->isValidPolyRef(ref))
+		return false;
+
+	unsigned int salt, it, ip;
+	m_navMesh->decodePolyId(ref, salt, it, ip);
+
+	if (it >= m_tiles.size() || ip >= m_tiles[it].polyClusters.size())
+		return false;
+
+	tileIndex = static_cast<int>(it);
+	cluster = m_tiles[it].polyClusters[ip];
+	return cluster != NO_CLUSTER;
+}
+
+bool NavMeshClusterGraph::FindRoute(dtPolyRef startRef, const float* startPos,
+	dtPolyRef endRef, const float* endPos, std::vector<Crossing>& route)
+{
+	route.clear();
+
+	int startTile, endTile;
+	uint16_t startCluster, endCluster;
+	if (!GetCluster(startRef, startTile, startCluster) || !GetCluster(endRef, endTile, endCluster))
+		return false;
+
+	if (startTile == endTile && startCluster == endCluster)
+		return true;
+
+	m_stats.routes++;
+
+	// A* over the portals. A node is a portal and the side of it that we're
+	// on after crossing it. Costs are straight line distances between the
+	// crossing points, so the distance to the goal is a consistent estimate.
+	const int goal = static_cast<int>(m_portals.size() * 2);
+
+	for (Node& node : m_nodes)
+	{
+		node.cost = FLT_MAX;
+		node.parent = -1;
+		node.closed = false;
+	}
+
+	typedef std::pair<float, int> OpenNode;
+	std::priority_queue<OpenNode, std::vector<OpenNode>, std::greater<OpenNode>> open;
+
+	auto visit = [&](int node, int parent, float cost, const float* pos)
+	{
+		Node& n = m_nodes[node];
+		if (n.closed || cost >= n.cost)
+			return;
+
+		n.cost = cost;
+		n.parent = parent;
+		open.push(OpenNode(cost + dtVdist(pos, endPos), node));
+	};
+
+	// everywhere we can go from inside a cluster
+	auto expand = [&](int tileIndex, uint16_t cluster, int node, float cost, const float* pos)
+	{
+		if (tileIndex == endTile && cluster == endCluster)
+			visit(goal, node, cost + dtVdist(pos, endPos), endPos);
+
+		for (int p : m_tiles[tileIndex].portals)
+		{
+			const Portal& portal = m_portals[p];
+			int side = portal.tiles[0] == tileIndex ? 0 : 1;
+			if (portal.clusters[side] != cluster)
+				continue;
+
+			visit(p * 2 + (1 - side), node, cost + dtVdist(pos, portal.pos), portal.pos);
+		}
+	};
+
+	expand(startTile, startCluster, -1, 0.0f, startPos);
+
+	int expansions = 0;
+	bool found = false;
+
+	while (!open.empty())
+	{
+		int node = open.top().second;
+		open.pop();
+
+		Node& n = m_nodes[node];
+		if (n.closed)
+			continue;
+		n.closed = true;
+
+		if (node == goal)
+		{
+			found = true;
+			break;
+		}
+
+		++expansions;
+
+		const Portal& portal = m_portals[node / 2];
+		int side = node & 1;
+		expand(portal.tiles[side], portal.clusters[side], node, n.cost, portal.pos);
+	}
+
+	m_stats.lastExpansions = expansions;
+
+	if (!found)
+		return false;
+
+	for (int node = m_nodes[goal].parent; node != -1; node = m_nodes[node].parent)
+	{
+		const Portal& portal = m_portals[node / 2];
+		int side = node & 1;
+
+		Crossing crossing;
+		crossing.fromRef = portal.refs[1 - side];
+		crossing.toRef = portal.refs[side];
+		dtVcopy(crossing.pos, portal.pos);
+		route.push_back(crossing);
+	}
+
+	std::reverse(route.begin(), route.end());
+	return true;
+}
+
+int NavMeshClusterGraph::GetComponent(dtPolyRef ref) const
+{
+	int tileIndex;
+	uint16_t cluster;
+	if (!GetCluster(ref, tileIndex, cluster))
+		return -1;
+
+	return m_components[m_tiles[tileIndex].firstCluster + cluster];
+}
+
+int NavMeshClusterGraph::GetClusterIndex(dtPolyRef ref) const
+{
+	int tileIndex;
+	uint16_t cluster;
+	if (!GetCluster(ref, tileIndex, cluster))
+		return -1;
+
+	return m_tiles[tileIndex].firstCluster + cluster;
+}
+
+bool NavMeshClusterGraph::MayBeConnected(dtPolyRef startRef, dtPolyRef endRef) const
+{
+	int startComponent = GetComponent(startRef);
+	int endComponent = GetComponent(endRef);
+
+	// if we don't know, we can't rule it out
+	return startComponent == -1 || endComponent == -1 || startComponent == endComponent;
+}
+
+//----------------------------------------------------------------------------
+
+void NavMeshClusterFilter::SetClusters(const NavMeshClusterGraph* graph, const std::vector<int>& clusters)
+{
+	m_graph = graph;
+	m_clusters = clusters;
+
+	std::sort(m_clusters.begin(), m_clusters.end());
+	m_clusters.erase(std::unique(m_clusters.begin(), m_clusters.end()), m_clusters.end());
+}
+
+bool NavMeshClusterFilter::passFilter(const dtPolyRef ref, const dtMeshTile* tile, const dtPoly* poly) const
+{
+	if (!m_filter->passFilter(ref, tile, poly))
+		return false;
+
+	if (!m_graph)
+		return true;
+
+	int cluster = m_graph->GetClusterIndex(ref);
+	return cluster == -1 || std::binary_search(m_clusters.begin(), m_clusters.end(), cluster);
+}
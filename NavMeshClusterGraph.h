@@ -0,0 +1,186 @@
+//
+// NavMeshClusterGraph.h
+//
+// A coarse graph over the tiles of the navmesh, used to plan long routes
+// before searching the polys along them. Each tile is split into clusters
+// of polys that are connected within the tile, and the graph's nodes are
+// the portals where clusters in neighboring tiles meet.
+//
+// The clusters are also grouped into connected components (counting
+// off-mesh connections), so we can tell right away when there is no way
+// to get from one poly to another. Whoever loads the mesh calls SetNavMesh
+// when it changes, and Update when tiles come or go.
+//
+
+#pragma once
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+
+#include <cstdint>
+#include <vector>
+
+//----------------------------------------------------------------------------
+
+class NavMeshClusterGraph
+{
+public:
+	NavMeshClusterGraph(dtNavMesh* navMesh);
+	~NavMeshClusterGraph();
+
+	// build the graph again for a new mesh, or none
+	void SetNavMesh(dtNavMesh* navMesh);
+
+	// bring the graph up to date with the tiles that are loaded. Only tiles
+	// that changed (and their neighbors) are looked at again. With lazy tile
+	// loading, the graph only covers the tiles that are loaded.
+	void Update();
+
+	// A step across a tile border along a route. fromRef is the poly on the
+	// near side of the border, toRef is on the far side.
+	struct Crossing
+	{
+		dtPolyRef fromRef;
+		dtPolyRef toRef;
+		float pos[3];
+	};
+
+	// Plan a coarse route between two polys. On success, route holds the
+	// tile borders to cross in order (empty if both are in the same cluster).
+	// Returns false if the graph says there is no way to get there.
+	bool FindRoute(dtPolyRef startRef, const float* startPos,
+		dtPolyRef endRef, const float* endPos, std::vector<Crossing>& route);
+
+	// The connected component that a poly is in, or -1 if it isn't known.
+	int GetComponent(dtPolyRef ref) const;
+
+	// The cluster that a poly is in, numbered across the whole graph, or -1
+	// if it isn't known.
+	int GetClusterIndex(dtPolyRef ref) const;
+
+	// Returns false if there is definitely no path between the polys. Links
+	// are treated as two-way and filters are ignored, so true only means
+	// that there might be one.
+	bool MayBeConnected(dtPolyRef startRef, dtPolyRef endRef) const;
+
+	bool IsValid() const { return m_navMesh != nullptr; }
+
+	struct Stats
+	{
+		int clusters = 0;
+		int portals = 0;
+		int edges = 0;
+		int components = 0;
+		int tilesUpdated = 0;
+		float buildTimeMs = 0;
+
+		int routes = 0;
+		int lastExpansions = 0;
+	};
+	const Stats& GetStats() const { return m_stats; }
+
+private:
+	void BuildTileClusters(const dtMeshTile* tile, int tileIndex);
+	void BuildTileBorders(const dtMeshTile* tile, int tileIndex);
+	void BuildPortals();
+	void BuildComponents();
+
+	bool GetCluster(dtPolyRef ref, int& tileIndex, uint16_t& cluster) const;
+
+	static const uint16_t NO_CLUSTER = 0xffff;
+
+	struct Portal
+	{
+		dtPolyRef refs[2];
+		int tiles[2];
+		uint16_t clusters[2];
+		float pos[3];
+	};
+
+	// an off-mesh connection into another tile, which joins components but
+	// isn't used for routes.
+	struct OffMeshLink
+	{
+		uint16_t cluster;
+		int otherTile;
+		uint16_t otherCluster;
+	};
+
+	struct TileClusters
+	{
+		// the tile these were built for
+		dtTileRef tileRef = 0;
+		int x = 0;
+		int y = 0;
+
+		// cluster of each poly in the tile
+		std::vector<uint16_t> polyClusters;
+		int numClusters = 0;
+
+		// connections to tiles with a higher index, so that each one is only
+		// stored once.
+		std::vector<Portal> borders;
+		std::vector<OffMeshLink> offMeshLinks;
+
+		// portals touching this tile
+		std::vector<int> portals;
+
+		// where this tile's clusters start in m_components
+		int firstCluster = 0;
+	};
+
+	dtNavMesh* m_navMesh = nullptr;
+
+	std::vector<TileClusters> m_tiles;
+	std::vector<Portal> m_portals;
+
+	// component of each cluster
+	std::vector<int> m_components;
+
+	// search state, reused between routes
+	struct Node
+	{
+		float cost;
+		float total;
+		int parent;
+		bool closed;
+	};
+	std::vector<Node> m_nodes;
+
+	Stats m_stats;
+};
+
+//----------------------------------------------------------------------------
+
+// Wraps a query filter to keep a search inside some of the clusters. Used to
+// search one piece of a route at a time without it wandering off the route.
+// Polys that the graph doesn't know the cluster of are let through.
+class NavMeshClusterFilter : public dtQueryFilter
+{
+public:
+	explicit NavMeshClusterFilter(const dtQueryFilter* filter)
+		: m_filter(filter)
+	{
+	}
+
+	// clusters are from GetClusterIndex
+	void SetClusters(const NavMeshClusterGraph* graph, const std::vector<int>& clusters);
+
+	virtual bool passFilter(const dtPolyRef ref, const dtMeshTile* tile, const dtPoly* poly) const override;
+
+	virtual float getCost(const float* pa, const float* pb,
+		const dtPolyRef prevRef, const dtMeshTile* prevTile, const dtPoly* prevPoly,
+		const dtPolyRef curRef, const dtMeshTile* curTile, const dtPoly* curPoly,
+		const dtPolyRef nextRef, const dtMeshTile* nextTile, const dtPoly* nextPoly) const override
+	{
+		return m_filter->getCost(pa, pb, prevRef, prevTile, prevPoly, curRef, curTile, curPoly,
+			nextRef, nextTile, nextPoly);
+	}
+
+private:
+	const dtQueryFilter* m_filter;
+	const NavMeshClusterGraph* m_graph = nullptr;
+
+	// sorted, there are only a few of them
+	std::vector<int> m_clusters;
+};
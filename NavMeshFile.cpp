@@ -0,0 +1,665 @@
+//
+// NavMeshFile.cpp
+//
+
+#include "NavMeshFile.h"
+
+#include "DetourAlloc.h"
+
+#include <zlib.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+//----------------------------------------------------------------------------
+
+namespace {
+
+struct ReadCursor {
+	const char* data;
+	size_t length;
+};
+
+template <typename T>
+bool FillStructure(ReadCursor& cursor, T& data)
+{
+	size_t l = sizeof(T);
+	if (l > cursor.length)
+		return false;
+
+	memcpy(&data, cursor.data, l);
+	cursor.data += l;
+	cursor.length -= l;
+	return true;
+}
+
+uint32_t TileChecksum(const unsigned char* data, int dataSize)
+{
+	uLong crc = crc32(0L, Z_NULL, 0);
+	return crc32(crc, data, dataSize);
+}
+
+// Copy a tile's data as it was before the mesh linked it to its neighbours.
+// The links are filled in when the tile is added, in whatever order its
+// neighbours were, and are filled in again when it's loaded. Leaving them
+// out keeps the file (and the tile checksums) the same however the mesh
+// was put together.
+void CopyUnlinkedTileData(const dtMeshTile* tile, std::vector<unsigned char>& data)
+{
+	data.assign(tile->data, tile->data + tile->dataSize);
+
+	const size_t polysOffset = reinterpret_cast<const unsigned char*>(tile->polys) - tile->data;
+	const size_t linksOffset = reinterpret_cast<const unsigned char*>(tile->links) - tile->data;
+
+	dtPoly* polys = reinterpret_cast<dtPoly*>(data.data() + polysOffset);
+	for (int i = 0; i < tile->header->polyCount; ++i)
+		polys[i].firstLink = 0;
+
+	memset(data.data() + linksOffset, 0, sizeof(dtLink) * tile->header->maxLinkCount);
+}
+
+const char s_padding[4] = { 0, 0, 0, 0 };
+
+// Append the sections and their table at the current end of the file. Each
+// section starts on a 4-byte boundary, like the tiles.
+bool WriteSections(FILE* fp, const std::vector<NavMeshFileSection>& sections)
+{
+	if (sections.empty())
+		return true;
+
+	long position = ftell(fp);
+	std::vector<NavMeshSectionIndex> index;
+
+	for (const NavMeshFileSection& section : sections)
+	{
+		long aligned = (position + 3) & ~3;
+		if (aligned > position)
+			fwrite(s_padding, 1, aligned - position, fp);
+
+		NavMeshSectionIndex entry;
+		entry.type = section.type;
+		entry.offset = static_cast<uint32_t>(aligned);
+		entry.size = static_cast<uint32_t>(section.size);
+		entry.crc = TileChecksum((const unsigned char*)section.data, (int)section.size);
+		index.push_back(entry);
+
+		if (section.size && fwrite(section.data, section.size, 1, fp) != 1)
+			return false;
+
+		position = aligned + static_cast<long>(section.size);
+	}
+
+	NavMeshSectionFooter footer;
+	footer.numSections = static_cast<uint32_t>(index.size());
+	footer.magic = NAVMESHSECTIONS_MAGIC;
+
+	return fwrite(index.data(), sizeof(NavMeshSectionIndex), index.size(), fp) == index.size()
+		&& fwrite(&footer, sizeof(footer), 1, fp) == 1;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+// Put a newly written file in place of the old one. Readers only ever see
+// the old file or the new one, never one that is half written.
+bool ReplaceMeshFile(const std::string& newFile, const std::string& filename)
+{
+#if defined(_WIN32)
+	// A file that is mapped into memory can't be deleted or replaced, but it
+	// can be renamed if it was opened with FILE_SHARE_DELETE, which the plugin
+	// does. If the old file can't be replaced, move it aside first. It is
+	// deleted once nothing is using it (here, or on the next save).
+	std::string oldFile = filename + ".old";
+	DeleteFileA(oldFile.c_str());
+
+	// Someone might have the file open for a moment without sharing delete
+	// access (a virus scanner, the plugin checking the file time). Give them
+	// a chance to let go.
+	for (int attempt = 0; attempt < 10; ++attempt)
+	{
+		if (attempt > 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+		if (MoveFileExA(newFile.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING))
+			return true;
+
+		if (MoveFileExA(filename.c_str(), oldFile.c_str(), MOVEFILE_REPLACE_EXISTING))
+		{
+			if (MoveFileExA(newFile.c_str(), filename.c_str(), 0))
+			{
+				DeleteFileA(oldFile.c_str());
+				return true;
+			}
+
+			// put it back the way it was
+			MoveFileExA(oldFile.c_str(), filename.c_str(), 0);
+		}
+	}
+
+	return false;
+#else
+	return rename(newFile.c_str(), filename.c_str()) == 0;
+#endif
+}
+
+//----------------------------------------------------------------------------
+
+NavMeshFileReader::Result NavMeshFileReader::Open(const char* data, size_t length)
+{
+	ReadCursor cursor{ data, length };
+	m_tiles.clear();
+	m_sections.clear();
+
+	if (!FillStructure(cursor, m_header))
+		return CORRUPT;
+	if (m_header.magic != NAVMESHSET_MAGIC)
+		return CORRUPT;
+	if (m_header.numTiles < 0)
+		return CORRUPT;
+
+	if (m_header.version == NAVMESHSET_VERSION_RAW)
+	{
+		// tiles follow one after another, each with its own header. Walk them
+		// to build the same table that version 3 stores up front.
+		for (int i = 0; i < m_header.numTiles; ++i)
+		{
+			NavMeshTileHeader tileHeader;
+			if (!FillStructure(cursor, tileHeader))
+				return CORRUPT;
+
+			if (tileHeader.dataSize < 0 || static_cast<size_t>(tileHeader.dataSize) > cursor.length)
+				return CORRUPT;
+
+			if (tileHeader.tileRef && tileHeader.dataSize)
+			{
+				TileEntry entry = { tileHeader.tileRef, cursor.data, (uint32_t)tileHeader.dataSize,
+					(uint32_t)tileHeader.dataSize, 0, TILE_CODEC_NONE, false };
+				m_tiles.push_back(entry);
+			}
+
+			cursor.data += tileHeader.dataSize;
+			cursor.length -= tileHeader.dataSize;
+		}
+
+		return ReadSections(data, length) ? SUCCESS : CORRUPT;
+	}
+
+	if (m_header.version == NAVMESHSET_VERSION)
+	{
+		m_tiles.reserve(m_header.numTiles);
+
+		for (int i = 0; i < m_header.numTiles; ++i)
+		{
+			NavMeshTileIndex index;
+			if (!FillStructure(cursor, index))
+				return CORRUPT;
+
+			if (index.offset > length || index.storedSize > length - index.offset)
+				return CORRUPT;
+			if (index.codec > TILE_CODEC_ZLIB)
+				return VERSION_MISMATCH;
+			if (index.codec == TILE_CODEC_NONE && index.storedSize != index.dataSize)
+				return CORRUPT;
+
+			if (index.tileRef && index.dataSize)
+			{
+				TileEntry entry = { index.tileRef, data + index.offset, index.storedSize,
+					index.dataSize, index.crc, index.codec, true };
+				m_tiles.push_back(entry);
+			}
+		}
+
+		return ReadSections(data, length) ? SUCCESS : CORRUPT;
+	}
+
+	return VERSION_MISMATCH;
+}
+
+bool NavMeshFileReader::ReadSections(const char* data, size_t length)
+{
+	// files without sections just end after the last tile
+	NavMeshSectionFooter footer;
+	if (length < sizeof(NavMeshSetHeader) + sizeof(footer))
+		return true;
+
+	memcpy(&footer, data + length - sizeof(footer), sizeof(footer));
+	if (footer.magic != NAVMESHSECTIONS_MAGIC)
+		return true;
+
+	size_t tableSize = footer.numSections * sizeof(NavMeshSectionIndex);
+	if (tableSize > length - sizeof(NavMeshSetHeader) - sizeof(footer))
+		return false;
+
+	ReadCursor cursor{ data + length - sizeof(footer) - tableSize, tableSize };
+
+	for (uint32_t i = 0; i < footer.numSections; ++i)
+	{
+		NavMeshSectionIndex index;
+		if (!FillStructure(cursor, index))
+			return false;
+
+		if (index.offset > length || index.size > length - index.offset)
+			return false;
+
+		NavMeshFileSection section;
+		section.type = index.type;
+		section.data = data + index.offset;
+		section.size = index.size;
+		m_sections.push_back(section);
+		m_sectionCrcs.push_back(index.crc);
+	}
+
+	return true;
+}
+
+bool NavMeshFileReader::GetSection(uint32_t type, NavMeshFileSection& section) const
+{
+	for (size_t i = 0; i < m_sections.size(); ++i)
+	{
+		if (m_sections[i].type != type)
+			continue;
+
+		if (TileChecksum((const unsigned char*)m_sections[i].data, (int)m_sections[i].size) != m_sectionCrcs[i])
+			return false;
+
+		section = m_sections[i];
+		return true;
+	}
+
+	return false;
+}
+
+NavMeshFileReader::Result NavMeshFileReader::ReadTile(int index, NavMeshFileTile& tile, bool copy) const
+{
+	const TileEntry& entry = m_tiles[index];
+
+	tile.tileRef = entry.tileRef;
+	tile.dataSize = static_cast<int>(entry.dataSize);
+
+	if (entry.codec == TILE_CODEC_NONE)
+	{
+		// Detour needs tile data to be 4-byte aligned to use it in place.
+		if (copy || (reinterpret_cast<uintptr_t>(entry.data) & 3))
+		{
+			tile.data = (unsigned char*)dtAlloc(entry.dataSize, DT_ALLOC_PERM);
+			if (!tile.data)
+				return CORRUPT;
+			memcpy(tile.data, entry.data, entry.dataSize);
+			tile.owned = true;
+		}
+		else
+		{
+			tile.data = (unsigned char*)entry.data;
+			tile.owned = false;
+		}
+	}
+	else
+	{
+		tile.data = (unsigned char*)dtAlloc(entry.dataSize, DT_ALLOC_PERM);
+		if (!tile.data)
+			return CORRUPT;
+		tile.owned = true;
+
+		uLongf destLen = entry.dataSize;
+		int zret = uncompress(tile.data, &destLen, (const Bytef*)entry.data, entry.storedSize);
+		if (zret != Z_OK || destLen != entry.dataSize)
+		{
+			dtFree(tile.data);
+			tile.data = nullptr;
+			return CORRUPT;
+		}
+	}
+
+	if (entry.hasCrc && TileChecksum(tile.data, tile.dataSize) != entry.crc)
+	{
+		if (tile.owned)
+			dtFree(tile.data);
+		tile.data = nullptr;
+		return CORRUPT;
+	}
+
+	return SUCCESS;
+}
+
+uint32_t NavMeshFileReader::GetTileChecksum(int index) const
+{
+	const TileEntry& entry = m_tiles[index];
+
+	if (entry.hasCrc)
+		return entry.crc;
+
+	return TileChecksum((const unsigned char*)entry.data, entry.dataSize);
+}
+
+NavMeshFileReader::Result NavMeshFileReader::ReadTileHeader(int index, dtMeshHeader& header) const
+{
+	const TileEntry& entry = m_tiles[index];
+
+	if (entry.dataSize < sizeof(dtMeshHeader))
+		return CORRUPT;
+
+	if (entry.codec == TILE_CODEC_NONE)
+	{
+		memcpy(&header, entry.data, sizeof(dtMeshHeader));
+	}
+	else
+	{
+		// inflate only as far as the end of the header
+		z_stream stream;
+		memset(&stream, 0, sizeof(stream));
+		stream.next_in = (Bytef*)entry.data;
+		stream.avail_in = entry.storedSize;
+		stream.next_out = (Bytef*)&header;
+		stream.avail_out = sizeof(dtMeshHeader);
+
+		if (inflateInit(&stream) != Z_OK)
+			return CORRUPT;
+
+		int zret = inflate(&stream, Z_SYNC_FLUSH);
+		inflateEnd(&stream);
+
+		if ((zret != Z_OK && zret != Z_STREAM_END) || stream.avail_out != 0)
+			return CORRUPT;
+	}
+
+	if (header.magic != DT_NAVMESH_MAGIC)
+		return CORRUPT;
+
+	return SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+
+bool ReadNavMeshFileData(const std::string& filename, std::vector<char>& buffer)
+{
+	FILE* fp = fopen(filename.c_str(), "rb");
+	if (!fp)
+		return false;
+
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	rewind(fp);
+
+	bool result = false;
+	if (size > 0)
+	{
+		buffer.resize(size);
+		result = fread(buffer.data(), 1, size, fp) == static_cast<size_t>(size);
+	}
+
+	fclose(fp);
+	return result;
+}
+
+static bool WriteNavMeshFileData(FILE* fp, const dtNavMeshParams& params,
+	const std::vector<NavMeshFileTile>& tiles, int version,
+	const std::vector<NavMeshFileSection>& sections)
+{
+	// Store header.
+	NavMeshSetHeader header;
+	header.magic = NAVMESHSET_MAGIC;
+	header.version = version;
+	header.numTiles = static_cast<int>(tiles.size());
+	memcpy(&header.params, &params, sizeof(dtNavMeshParams));
+	if (fwrite(&header, sizeof(NavMeshSetHeader), 1, fp) != 1)
+		return false;
+
+	if (version == NAVMESHSET_VERSION_RAW)
+	{
+		// Store tiles.
+		for (const NavMeshFileTile& tile : tiles)
+		{
+			NavMeshTileHeader tileHeader;
+			tileHeader.tileRef = tile.tileRef;
+			tileHeader.dataSize = tile.dataSize;
+			fwrite(&tileHeader, sizeof(tileHeader), 1, fp);
+
+			if (fwrite(tile.data, tile.dataSize, 1, fp) != 1)
+				return false;
+		}
+
+		return WriteSections(fp, sections);
+	}
+
+	// Encode the tiles first so that the index can be written ahead of them.
+	// Tiles that don't get smaller are stored raw so they can be loaded in
+	// place. Every blob starts on a 4-byte boundary.
+	std::vector<NavMeshTileIndex> index(tiles.size());
+	std::vector<std::vector<unsigned char>> blobs(tiles.size());
+
+	uint32_t offset = static_cast<uint32_t>(sizeof(NavMeshSetHeader)
+		+ sizeof(NavMeshTileIndex) * tiles.size());
+
+	for (size_t i = 0; i < tiles.size(); ++i)
+	{
+		const NavMeshFileTile& tile = tiles[i];
+		NavMeshTileIndex& entry = index[i];
+		memset(&entry, 0, sizeof(entry));
+
+		entry.tileRef = tile.tileRef;
+		entry.dataSize = tile.dataSize;
+		entry.crc = TileChecksum(tile.data, tile.dataSize);
+		entry.codec = TILE_CODEC_NONE;
+		entry.storedSize = tile.dataSize;
+
+		uLongf compressedSize = compressBound(tile.dataSize);
+		blobs[i].resize(compressedSize);
+
+		if (compress2(blobs[i].data(), &compressedSize, tile.data, tile.dataSize, Z_BEST_SPEED) == Z_OK
+			&& compressedSize < static_cast<uLongf>(tile.dataSize))
+		{
+			blobs[i].resize(compressedSize);
+			entry.codec = TILE_CODEC_ZLIB;
+			entry.storedSize = static_cast<uint32_t>(compressedSize);
+		}
+		else
+		{
+			blobs[i].clear();
+		}
+
+		offset = (offset + 3) & ~3;
+		entry.offset = offset;
+		offset += entry.storedSize;
+	}
+
+	if (!index.empty() && fwrite(index.data(), sizeof(NavMeshTileIndex), index.size(), fp) != index.size())
+		return false;
+
+	long position = static_cast<long>(sizeof(NavMeshSetHeader) + sizeof(NavMeshTileIndex) * tiles.size());
+
+	for (size_t i = 0; i < tiles.size(); ++i)
+	{
+		const NavMeshTileIndex& entry = index[i];
+
+		if (entry.offset > static_cast<uint32_t>(position))
+			fwrite(s_padding, 1, entry.offset - position, fp);
+
+		const void* blob = entry.codec == TILE_CODEC_NONE ? (const void*)tiles[i].data : (const void*)blobs[i].data();
+		if (fwrite(blob, entry.storedSize, 1, fp) != 1)
+			return false;
+
+		position = entry.offset + entry.storedSize;
+	}
+
+	return WriteSections(fp, sections);
+}
+
+std::shared_ptr<char> ReadNavMeshFileData(const std::string& filename, size_t& length)
+{
+	length = 0;
+
+	FILE* fp = fopen(filename.c_str(), "rb");
+	if (!fp)
+		return nullptr;
+	std::unique_ptr<FILE, decltype(&fclose)> fileGuard(fp, &fclose);
+
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	rewind(fp);
+
+	if (size <= 0)
+		return nullptr;
+
+	std::shared_ptr<char> buffer(new char[size], [](char* p) { delete[] p; });
+	if (fread(buffer.get(), 1, size, fp) != static_cast<size_t>(size))
+		return nullptr;
+
+	length = static_cast<size_t>(size);
+	return buffer;
+}
+
+std::shared_ptr<char> MapNavMeshFileData(const std::string& filename, size_t& length)
+{
+	length = 0;
+
+#if defined(_WIN32)
+	HANDLE hFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return nullptr;
+
+	DWORD size = GetFileSize(hFile, NULL);
+	HANDLE hMapping = NULL;
+	if (size != 0 && size != INVALID_FILE_SIZE)
+		hMapping = CreateFileMappingA(hFile, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	CloseHandle(hFile);
+
+	if (hMapping == NULL)
+		return nullptr;
+
+	// the view holds its own reference to the mapping, so the handles can
+	// be closed as soon as the view exists.
+	char* view = static_cast<char*>(MapViewOfFile(hMapping, FILE_MAP_COPY, 0, 0, 0));
+	CloseHandle(hMapping);
+
+	if (view == nullptr)
+		return nullptr;
+
+	length = size;
+	return std::shared_ptr<char>(view, [](char* p) { UnmapViewOfFile(p); });
+#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return nullptr;
+
+	struct stat st;
+	void* view = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+		view = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (view == MAP_FAILED)
+		return nullptr;
+
+	size_t size = static_cast<size_t>(st.st_size);
+	length = size;
+	return std::shared_ptr<char>(static_cast<char*>(view), [size](char* p) { munmap(p, size); });
+#endif
+}
+
+bool WriteNavMeshFile(const std::string& filename, const dtNavMeshParams& params,
+	const std::vector<NavMeshFileTile>& tiles, int version,
+	const std::vector<NavMeshFileSection>& sections)
+{
+	if (version != NAVMESHSET_VERSION && version != NAVMESHSET_VERSION_RAW)
+		return false;
+
+	// The plugin may have the file loaded (and mapped) while we save over
+	// it, so write the new one next to it and swap them when it's done.
+	std::string tempFile = filename + ".tmp";
+
+	FILE* fp = fopen(tempFile.c_str(), "wb");
+	if (!fp)
+		return false;
+
+	bool result = WriteNavMeshFileData(fp, params, tiles, version, sections);
+	result = fclose(fp) == 0 && result;
+
+	if (result)
+		result = ReplaceMeshFile(tempFile, filename);
+
+	if (!result)
+		remove(tempFile.c_str());
+
+	return result;
+}
+
+bool SaveNavMeshFile(const std::string& filename, const dtNavMesh* mesh, int version,
+	const std::vector<NavMeshFileSection>& sections)
+{
+	if (!mesh) return false;
+
+	std::vector<NavMeshFileTile> tiles;
+	std::vector<std::vector<unsigned char>> tileData;
+
+	for (int i = 0; i < mesh->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = mesh->getTile(i);
+		if (!tile || !tile->header || !tile->dataSize) continue;
+
+		tileData.emplace_back();
+		CopyUnlinkedTileData(tile, tileData.back());
+
+		NavMeshFileTile fileTile;
+		fileTile.tileRef = mesh->getTileRef(tile);
+		fileTile.data = tileData.back().data();
+		fileTile.dataSize = tile->dataSize;
+		tiles.push_back(fileTile);
+	}
+
+	return WriteNavMeshFile(filename, *mesh->getParams(), tiles, version, sections);
+}
+
+bool ConvertNavMeshFile(const std::string& inputFile, const std::string& outputFile, int version)
+{
+	std::vector<char> buffer;
+	if (!ReadNavMeshFileData(inputFile, buffer))
+		return false;
+
+	NavMeshFileReader reader;
+	if (reader.Open(buffer.data(), buffer.size()) != NavMeshFileReader::SUCCESS)
+		return false;
+
+	std::vector<NavMeshFileTile> tiles(reader.GetTileCount());
+	bool result = true;
+
+	for (int i = 0; i < reader.GetTileCount() && result; ++i)
+	{
+		result = reader.ReadTile(i, tiles[i]) == NavMeshFileReader::SUCCESS;
+	}
+
+	if (result)
+	{
+		// carry the sections over, leaving out any that are corrupt
+		std::vector<NavMeshFileSection> sections;
+		for (const NavMeshFileSection& stored : reader.GetSections())
+		{
+			NavMeshFileSection section;
+			if (reader.GetSection(stored.type, section))
+				sections.push_back(section);
+		}
+
+		result = WriteNavMeshFile(outputFile, reader.GetParams(), tiles, version, sections);
+	}
+
+	for (NavMeshFileTile& tile : tiles)
+	{
+		if (tile.owned)
+			dtFree(tile.data);
+	}
+
+	return result;
+}
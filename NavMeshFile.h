@@ -0,0 +1,204 @@
+//
+// NavMeshFile.h
+//
+// Reading and writing of navmesh set files (<zone>.bin). This is shared by
+// the plugin and the mesh generator, so it shouldn't depend on either.
+//
+
+#pragma once
+
+#include "DetourNavMesh.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+static const int NAVMESHSET_MAGIC = 'M' << 24 | 'S' << 16 | 'E' << 8 | 'T'; //'MSET';
+
+// version 2: raw tiles, each preceded by a NavMeshTileHeader.
+// version 3: a table of NavMeshTileIndex entries followed by the tile
+//            blobs. Tiles can be compressed and carry a checksum.
+static const int NAVMESHSET_VERSION_RAW = 2;
+static const int NAVMESHSET_VERSION = 3;
+
+// header (the same across all versions)
+struct NavMeshSetHeader
+{
+	int magic;
+	int version;
+	int numTiles;
+	dtNavMeshParams params;
+};
+
+// version 2 tile header
+struct NavMeshTileHeader
+{
+	dtTileRef tileRef;
+	int dataSize;
+};
+
+enum NavMeshTileCodec : uint8_t
+{
+	TILE_CODEC_NONE = 0,
+	TILE_CODEC_ZLIB = 1,
+};
+
+// version 3 tile index entry
+struct NavMeshTileIndex
+{
+	dtTileRef tileRef;
+	uint32_t offset;           // offset of the tile blob from the start of the file
+	uint32_t storedSize;       // size of the blob in the file
+	uint32_t dataSize;         // size of the tile once decoded
+	uint32_t crc;              // crc32 of the decoded tile data
+	uint8_t codec;             // NavMeshTileCodec
+	uint8_t reserved[3];
+};
+
+// Extra data (anything that isn't a tile) is stored in sections after the
+// tiles, with a table of them at the very end of the file. Readers that
+// don't know about sections never look there, so adding them doesn't change
+// the version.
+enum NavMeshSectionType : uint32_t
+{
+	SECTION_LANDMARKS = 1,     // landmark distance tables (NavMeshLandmarks)
+	SECTION_TILECACHE = 2,     // compressed layers for dynamic obstacles (NavMeshTileCacheData)
+	SECTION_OFFMESHLINKS = 3,  // off-mesh links and their actions (NavMeshOffMeshLinks)
+};
+
+static const int NAVMESHSECTIONS_MAGIC = 'S' << 24 | 'E' << 16 | 'C' << 8 | 'T'; //'SECT';
+
+// section table entry
+struct NavMeshSectionIndex
+{
+	uint32_t type;             // NavMeshSectionType
+	uint32_t offset;           // offset of the section from the start of the file
+	uint32_t size;
+	uint32_t crc;              // crc32 of the section data
+};
+
+// last thing in the file, preceded by the section table
+struct NavMeshSectionFooter
+{
+	uint32_t numSections;
+	int magic;
+};
+
+// A section to be written, or a section that was read. The data isn't
+// owned, when reading it points into the file buffer.
+struct NavMeshFileSection
+{
+	uint32_t type = 0;
+	const char* data = nullptr;
+	size_t size = 0;
+};
+
+// A tile to be written, or a tile that was read.
+struct NavMeshFileTile
+{
+	dtTileRef tileRef = 0;
+	unsigned char* data = nullptr;
+	int dataSize = 0;
+
+	// if true, data was allocated with dtAlloc and belongs to whoever holds
+	// this tile (pass DT_TILE_FREE_DATA to addTile, or dtFree it). Otherwise
+	// it points into the file buffer.
+	bool owned = false;
+};
+
+//----------------------------------------------------------------------------
+
+class NavMeshFileReader
+{
+public:
+	enum Result { SUCCESS, CORRUPT, VERSION_MISMATCH };
+
+	// Parse the header and tile table out of a file buffer. The buffer must
+	// stay valid for as long as tiles are read from it.
+	Result Open(const char* data, size_t length);
+
+	int GetVersion() const { return m_header.version; }
+	const dtNavMeshParams& GetParams() const { return m_header.params; }
+
+	int GetTileCount() const { return static_cast<int>(m_tiles.size()); }
+	dtTileRef GetTileRef(int index) const { return m_tiles[index].tileRef; }
+
+	// Decode a tile. Uncompressed tiles are returned in place (pointing into
+	// the buffer) unless copy is true. Fails with CORRUPT if the tile does
+	// not decode or does not match its checksum.
+	Result ReadTile(int index, NavMeshFileTile& tile, bool copy = false) const;
+
+	// Read just the detour header of a tile, without decoding the rest of it.
+	// Used to find where a tile is without loading it.
+	Result ReadTileHeader(int index, dtMeshHeader& header) const;
+
+	// size of the tile once decoded
+	int GetTileDataSize(int index) const { return static_cast<int>(m_tiles[index].dataSize); }
+
+	// crc32 of the decoded tile. Version 3 files store this in the index,
+	// for version 2 files it is calculated from the tile data.
+	uint32_t GetTileChecksum(int index) const;
+
+	// Find a section of the given type. Returns false if the file doesn't
+	// have one, or if it is corrupt.
+	bool GetSection(uint32_t type, NavMeshFileSection& section) const;
+
+	// all of the sections in the file, without checking them
+	const std::vector<NavMeshFileSection>& GetSections() const { return m_sections; }
+
+private:
+	struct TileEntry
+	{
+		dtTileRef tileRef;
+		const char* data;
+		uint32_t storedSize;
+		uint32_t dataSize;
+		uint32_t crc;
+		uint8_t codec;
+		bool hasCrc;
+	};
+
+	bool ReadSections(const char* data, size_t length);
+
+	NavMeshSetHeader m_header;
+	std::vector<TileEntry> m_tiles;
+	std::vector<NavMeshFileSection> m_sections;
+	std::vector<uint32_t> m_sectionCrcs;
+};
+
+//----------------------------------------------------------------------------
+
+// Read a whole file into a buffer. Returns false if it can't be read.
+bool ReadNavMeshFileData(const std::string& filename, std::vector<char>& buffer);
+
+// Read a whole file into a shared buffer, for tiles that are used in place
+// to keep alive. Returns null if it can't be read.
+std::shared_ptr<char> ReadNavMeshFileData(const std::string& filename, size_t& length);
+
+// Map a whole file into memory. The view is copy-on-write: detour writes tile
+// links into the tile data, and those pages get private copies while the rest
+// stay backed by the file. It is unmapped when the last reference to it is
+// released. The file can still be renamed while it is mapped, which is how
+// WriteNavMeshFile replaces it. Returns null if it can't be mapped.
+std::shared_ptr<char> MapNavMeshFileData(const std::string& filename, size_t& length);
+
+// Put a newly written file in place of another one. Readers only ever see
+// the old file or the new one, never one that is half written.
+bool ReplaceMeshFile(const std::string& newFile, const std::string& filename);
+
+// Write a set of tiles (and any extra sections) to a file in the given
+// format version. The file is written under another name and then put in
+// place of the old one, so it can be saved while the plugin has it loaded.
+bool WriteNavMeshFile(const std::string& filename, const dtNavMeshParams& params,
+	const std::vector<NavMeshFileTile>& tiles, int version = NAVMESHSET_VERSION,
+	const std::vector<NavMeshFileSection>& sections = std::vector<NavMeshFileSection>());
+
+// Write all of the tiles of a navmesh to a file in the given format version.
+bool SaveNavMeshFile(const std::string& filename, const dtNavMesh* mesh,
+	int version = NAVMESHSET_VERSION,
+	const std::vector<NavMeshFileSection>& sections = std::vector<NavMeshFileSection>());
+
+// Rewrite a mesh file in another format version. Sections are kept.
+bool ConvertNavMeshFile(const std::string& inputFile, const std::string& outputFile,
+	int version = NAVMESHSET_VERSION);
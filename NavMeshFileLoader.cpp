@@ -0,0 +1,490 @@
+//
+// NavMeshFileLoader.cpp
+//
+
+#include "NavMeshFileLoader.h"
+#include "NavMeshLandmarks.h"
+#include "NavMeshOffMeshLinks.h"
+#include "NavMeshTileCache.h"
+
+#include "DetourAlloc.h"
+#include "DetourNavMesh.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+//----------------------------------------------------------------------------
+
+namespace {
+
+void AddMessage(std::vector<std::string>& messages, const char* format, ...)
+{
+	char buffer[512];
+
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+
+	messages.push_back(buffer);
+}
+
+// Read the landmark tables out of a mesh file, if it has them. The mesh is
+// still usable without them, so problems with them aren't errors.
+std::shared_ptr<const NavMeshLandmarks> ReadLandmarks(const NavMeshFileReader& reader,
+	std::vector<std::string>& messages)
+{
+	NavMeshFileSection section;
+	if (!reader.GetSection(SECTION_LANDMARKS, section))
+		return nullptr;
+
+	auto landmarks = std::make_shared<NavMeshLandmarks>();
+	if (!landmarks->Read(section.data, section.size))
+	{
+		AddMessage(messages, "Landmark tables are corrupt, not using them");
+		return nullptr;
+	}
+
+	return landmarks;
+}
+
+// Read the tile cache layers out of a mesh file, if it has them. Without them
+// there just aren't any dynamic obstacles.
+std::shared_ptr<const NavMeshTileCacheData> ReadTileCacheData(const NavMeshFileReader& reader,
+	std::vector<std::string>& messages)
+{
+	NavMeshFileSection section;
+	if (!reader.GetSection(SECTION_TILECACHE, section))
+		return nullptr;
+
+	auto tileCacheData = std::make_shared<NavMeshTileCacheData>();
+	if (!tileCacheData->Read(section.data, section.size))
+	{
+		AddMessage(messages, "Tile cache layers are corrupt, not using them");
+		return nullptr;
+	}
+
+	return tileCacheData;
+}
+
+// Read the off-mesh links out of a mesh file, if it has them. The tiles have
+// the links in them either way, this is just what to do when we get there.
+std::shared_ptr<const NavMeshOffMeshLinks> ReadOffMeshLinks(const NavMeshFileReader& reader,
+	std::vector<std::string>& messages)
+{
+	NavMeshFileSection section;
+	if (!reader.GetSection(SECTION_OFFMESHLINKS, section))
+		return nullptr;
+
+	auto links = std::make_shared<NavMeshOffMeshLinks>();
+	if (!links->Read(section.data, section.size))
+	{
+		AddMessage(messages, "Off-mesh links are corrupt, they will be walked across");
+		return nullptr;
+	}
+
+	return links;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+NavMeshFileLoader::LoadedMesh::~LoadedMesh()
+{
+	// free any tiles that were never added to a mesh
+	for (TileUpdate& update : changedTiles)
+	{
+		if (update.tile.owned && update.tile.data)
+			dtFree(update.tile.data);
+	}
+}
+
+NavMeshFileLoader::~NavMeshFileLoader()
+{
+	Cancel();
+
+	// the workers only use what they were given, but they have to be
+	// joined before their threads can go away.
+	for (auto& job : m_abandoned)
+		job->thread.join();
+}
+
+void NavMeshFileLoader::StartLoad(const std::string& filename, const LoadOptions& options)
+{
+	Start([filename, options](const std::atomic<bool>& cancel)
+	{
+		return LoadMeshFile(filename, options, cancel);
+	});
+}
+
+void NavMeshFileLoader::StartUpdate(const std::string& filename, const TileHashMap& currentTiles,
+	const dtNavMeshParams& currentParams, const LoadOptions& options)
+{
+	// the worker gets its own copy of the hashes, the caller's change as
+	// soon as it applies an update.
+	auto tiles = std::make_shared<TileHashMap>(currentTiles);
+
+	Start([filename, tiles, currentParams, options](const std::atomic<bool>& cancel)
+	{
+		return LoadMeshFileUpdate(filename, *tiles, currentParams, options, cancel);
+	});
+}
+
+void NavMeshFileLoader::Start(LoadFunction load)
+{
+	Cancel();
+
+	m_job.reset(new Job);
+	Job* job = m_job.get();
+
+	job->thread = std::thread([job, load]()
+	{
+		std::shared_ptr<LoadedMesh> loaded = load(job->cancel);
+
+		// a cancelled result is thrown away here, so that freeing it doesn't
+		// land on whoever is polling.
+		if (!job->cancel)
+			job->result = std::move(loaded);
+		loaded.reset();
+
+		job->done = true;
+	});
+}
+
+std::shared_ptr<NavMeshFileLoader::LoadedMesh> NavMeshFileLoader::Poll()
+{
+	ReapAbandoned();
+
+	if (!m_job || !m_job->done)
+		return nullptr;
+
+	// the worker is done once it has set its result, this only waits for
+	// the thread to exit.
+	m_job->thread.join();
+
+	std::shared_ptr<LoadedMesh> loaded = std::move(m_job->result);
+	m_job.reset();
+
+	return loaded;
+}
+
+void NavMeshFileLoader::Cancel()
+{
+	if (m_job)
+	{
+		m_job->cancel = true;
+		m_abandoned.push_back(std::move(m_job));
+	}
+
+	ReapAbandoned();
+}
+
+void NavMeshFileLoader::ReapAbandoned()
+{
+	for (auto iter = m_abandoned.begin(); iter != m_abandoned.end();)
+	{
+		if ((*iter)->done)
+		{
+			(*iter)->thread.join();
+			iter = m_abandoned.erase(iter);
+		}
+		else
+		{
+			++iter;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+
+std::shared_ptr<NavMeshFileLoader::LoadedMesh> NavMeshFileLoader::LoadMeshFile(
+	const std::string& filename, const LoadOptions& options, const std::atomic<bool>& cancel)
+{
+	auto loaded = std::make_shared<LoadedMesh>();
+	loaded->filename = filename;
+	loaded->lazy = options.lazyTiles;
+
+	// load raw mesh file first. Mapping the file lets the tiles be used
+	// directly from the file's pages. The file can't be overwritten while
+	// it is mapped, the mesh generator saves a new one in its place instead.
+	size_t length = 0;
+	std::shared_ptr<char> data = options.mapFile ? MapNavMeshFileData(filename, length) : nullptr;
+	if (!data)
+		data = ReadNavMeshFileData(filename, length);
+	if (!data)
+	{
+		loaded->result = NOT_FOUND;
+		return loaded;
+	}
+
+	if (cancel)
+	{
+		loaded->result = CANCELLED;
+		return loaded;
+	}
+
+	loaded->result = LoadZoneMeshData(data, length, *loaded, cancel);
+	return loaded;
+}
+
+std::shared_ptr<NavMeshFileLoader::LoadedMesh> NavMeshFileLoader::LoadMeshFileUpdate(
+	const std::string& filename, const TileHashMap& currentTiles, const dtNavMeshParams& currentParams,
+	const LoadOptions& options, const std::atomic<bool>& cancel)
+{
+	auto loaded = std::make_shared<LoadedMesh>();
+	loaded->filename = filename;
+
+	// The file is always read into a buffer here, the changed tiles are
+	// copied out of it so that it doesn't need to be kept around.
+	size_t length = 0;
+	std::shared_ptr<char> data = ReadNavMeshFileData(filename, length);
+	if (!data)
+	{
+		loaded->result = NOT_FOUND;
+		return loaded;
+	}
+
+	NavMeshFileReader reader;
+	if (reader.Open(data.get(), length) != NavMeshFileReader::SUCCESS
+		|| memcmp(&reader.GetParams(), &currentParams, sizeof(dtNavMeshParams)) != 0)
+	{
+		// the layout of the mesh changed (or the file is bad), so tiles can't
+		// be swapped in. Load the whole thing the way a first load would, so
+		// it is mapped and loaded lazily if that's what was asked for.
+		data.reset();
+
+		auto whole = LoadMeshFile(filename, options, cancel);
+		whole->messages.insert(whole->messages.begin(), "Mesh parameters changed, reloading the whole mesh");
+		return whole;
+	}
+
+	loaded->update = true;
+	loaded->landmarks = ReadLandmarks(reader, loaded->messages);
+	loaded->tileCacheData = ReadTileCacheData(reader, loaded->messages);
+	loaded->offMeshLinks = ReadOffMeshLinks(reader, loaded->messages);
+
+	for (int i = 0; i < reader.GetTileCount(); ++i)
+	{
+		if (cancel)
+		{
+			loaded->result = CANCELLED;
+			return loaded;
+		}
+
+		dtMeshHeader header;
+		if (reader.ReadTileHeader(i, header) != NavMeshFileReader::SUCCESS)
+		{
+			AddMessage(loaded->messages, "Tile %d is corrupt!", i);
+			loaded->result = CORRUPT;
+			return loaded;
+		}
+
+		TileKey key(header.x, header.y, header.layer);
+		uint32_t crc = reader.GetTileChecksum(i);
+
+		TileHash& hash = loaded->tileHashes[key];
+		hash.crc = crc;
+
+		// unchanged tiles stay as they are
+		auto iter = currentTiles.find(key);
+		if (iter != currentTiles.end() && iter->second.crc == crc)
+			continue;
+
+		TileUpdate update;
+		update.key = key;
+		update.crc = crc;
+
+		if (reader.ReadTile(i, update.tile, true) != NavMeshFileReader::SUCCESS)
+		{
+			AddMessage(loaded->messages, "Tile %d is corrupt!", i);
+			loaded->result = CORRUPT;
+			return loaded;
+		}
+
+		loaded->changedTiles.push_back(update);
+	}
+
+	for (const auto& tile : currentTiles)
+	{
+		if (loaded->tileHashes.find(tile.first) == loaded->tileHashes.end())
+			loaded->removedTiles.push_back(tile.first);
+	}
+
+	loaded->result = SUCCESS;
+	return loaded;
+}
+
+int NavMeshFileLoader::ApplyTileUpdate(dtNavMesh& mesh, LoadedMesh& loaded, TileHashMap& tileHashes,
+	std::vector<std::string>& messages)
+{
+	// remove all of the old tiles first, so that their slots in the mesh are
+	// free for the new tiles to take.
+	for (const TileKey& key : loaded.removedTiles)
+	{
+		mesh.removeTile(mesh.getTileRefAt(std::get<0>(key), std::get<1>(key), std::get<2>(key)), 0, 0);
+		tileHashes.erase(key);
+	}
+
+	for (const TileUpdate& update : loaded.changedTiles)
+	{
+		const TileKey& key = update.key;
+		mesh.removeTile(mesh.getTileRefAt(std::get<0>(key), std::get<1>(key), std::get<2>(key)), 0, 0);
+		tileHashes.erase(key);
+	}
+
+	int updatedTiles = 0;
+
+	for (TileUpdate& update : loaded.changedTiles)
+	{
+		NavMeshFileTile& tile = update.tile;
+
+		// try to keep the ref from the file. If the generator put the tile
+		// in a slot that is still in use here, let detour pick one.
+		dtStatus status = mesh.addTile(tile.data, tile.dataSize, DT_TILE_FREE_DATA, tile.tileRef, 0);
+		if (dtStatusFailed(status) && tile.tileRef != 0)
+			status = mesh.addTile(tile.data, tile.dataSize, DT_TILE_FREE_DATA, 0, 0);
+
+		if (dtStatusFailed(status))
+		{
+			AddMessage(messages, "Failed to load tile (%d, %d)", std::get<0>(update.key), std::get<1>(update.key));
+			continue;
+		}
+
+		// the mesh owns the data now
+		tile.data = nullptr;
+
+		TileHash& hash = tileHashes[update.key];
+		hash.crc = update.crc;
+		updatedTiles++;
+	}
+
+	return updatedTiles;
+}
+
+NavMeshFileLoader::LoadResult NavMeshFileLoader::LoadZoneMeshData(const std::shared_ptr<char>& data,
+	size_t length, LoadedMesh& loaded, const std::atomic<bool>& cancel)
+{
+	//------------------------------------------------------------------------
+	// Read the header and tile table
+	std::unique_ptr<NavMeshFileReader> readerPtr(new NavMeshFileReader);
+	NavMeshFileReader& reader = *readerPtr;
+
+	switch (reader.Open(data.get(), length))
+	{
+	case NavMeshFileReader::CORRUPT:
+		AddMessage(loaded.messages, "Failed to read header from mesh file!");
+		return CORRUPT;
+	case NavMeshFileReader::VERSION_MISMATCH:
+		AddMessage(loaded.messages, "Header version mismatch!");
+		return VERSION_MISMATCH;
+	default: break;
+	}
+
+	std::unique_ptr<dtNavMesh> navMesh(new dtNavMesh);
+	if (dtStatusFailed(navMesh->init(&reader.GetParams()))) {
+		AddMessage(loaded.messages, "Header params are bad!");
+		return CORRUPT;
+	}
+
+	loaded.landmarks = ReadLandmarks(reader, loaded.messages);
+	loaded.tileCacheData = ReadTileCacheData(reader, loaded.messages);
+	loaded.offMeshLinks = ReadOffMeshLinks(reader, loaded.messages);
+
+	if (loaded.lazy)
+	{
+		// Tiles are added on demand once the mesh is swapped in. Keep the
+		// reader around to load them from.
+		LoadResult result = IndexZoneMeshTiles(reader, loaded, cancel);
+		if (result != SUCCESS)
+			return result;
+
+		loaded.mesh = std::move(navMesh);
+		loaded.reader = std::move(readerPtr);
+		loaded.data = data;
+		return SUCCESS;
+	}
+
+	//------------------------------------------------------------------------
+	// Read the tiles
+	int passtile = 0, failtile = 0;
+
+	for (int i = 0; i < reader.GetTileCount(); ++i)
+	{
+		// stop early if the load was abandoned (zoned again, reloaded, etc)
+		if (cancel)
+			return CANCELLED;
+
+		// Uncompressed tiles are handed to the navmesh straight out of the file
+		// buffer, which we keep alive for as long as the mesh is loaded.
+		// Compressed tiles are decoded into their own buffer.
+		NavMeshFileTile tile;
+		if (reader.ReadTile(i, tile) != NavMeshFileReader::SUCCESS) {
+			AddMessage(loaded.messages, "Tile %d is corrupt!", i);
+			return CORRUPT;
+		}
+
+		int tileFlags = tile.owned ? DT_TILE_FREE_DATA : 0;
+
+		// remember what each tile looked like, to find the ones that change
+		// when the file is updated. This has to happen before the tile is
+		// added: detour writes its links into the tile data, and version 2
+		// files have no stored checksum, so it is calculated from that data.
+		const dtMeshHeader* header = reinterpret_cast<const dtMeshHeader*>(tile.data);
+		TileKey key(header->x, header->y, header->layer);
+		uint32_t crc = reader.GetTileChecksum(i);
+
+		if (dtStatusSucceed(navMesh->addTile(tile.data, tile.dataSize, tileFlags, tile.tileRef, 0)))
+		{
+			TileHash& hash = loaded.tileHashes[key];
+			hash.crc = crc;
+
+			passtile++;
+		}
+		else
+		{
+			AddMessage(loaded.messages, "Failed to load tile %d", i);
+			failtile++;
+
+			if (tile.owned)
+				dtFree(tile.data);
+		}
+	}
+
+	loaded.loadedTiles = passtile;
+	loaded.mesh = std::move(navMesh);
+	loaded.data = data;
+
+	return SUCCESS;
+}
+
+NavMeshFileLoader::LoadResult NavMeshFileLoader::IndexZoneMeshTiles(const NavMeshFileReader& reader,
+	LoadedMesh& loaded, const std::atomic<bool>& cancel)
+{
+	// Find out where each tile goes so that they can be looked up by
+	// position. Only the tile headers are read here.
+	loaded.tiles.resize(reader.GetTileCount());
+
+	for (int i = 0; i < reader.GetTileCount(); ++i)
+	{
+		if (cancel)
+			return CANCELLED;
+
+		dtMeshHeader header;
+		if (reader.ReadTileHeader(i, header) != NavMeshFileReader::SUCCESS) {
+			AddMessage(loaded.messages, "Tile %d is corrupt!", i);
+			return CORRUPT;
+		}
+
+		TileSlot& slot = loaded.tiles[i];
+		slot.x = header.x;
+		slot.y = header.y;
+		slot.fileIndex = i;
+		slot.dataSize = reader.GetTileDataSize(i);
+
+		loaded.tileGrid[std::make_pair(header.x, header.y)].push_back(i);
+	}
+
+	return SUCCESS;
+}
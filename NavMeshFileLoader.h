@@ -0,0 +1,182 @@
+//
+// NavMeshFileLoader.h
+//
+// Loads mesh files into navmeshes on a worker thread. This is the part of
+// NavMeshLoader that knows about files, but not about zones or the game, so
+// it can be run (and tested) outside of the plugin.
+//
+
+#pragma once
+
+#include "NavMeshFile.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+class dtNavMesh;
+class NavMeshLandmarks;
+class NavMeshTileCacheData;
+class NavMeshOffMeshLinks;
+
+class NavMeshFileLoader
+{
+public:
+	enum LoadResult { SUCCESS, CORRUPT, VERSION_MISMATCH, NOT_FOUND, CANCELLED };
+
+	struct LoadOptions
+	{
+		// map the file instead of reading it into a buffer
+		bool mapFile = false;
+
+		// leave the tiles in the file, to be added on demand
+		bool lazyTiles = false;
+	};
+
+	// a tile in the mesh file, and whether it is currently in the mesh
+	struct TileSlot
+	{
+		int x = 0, y = 0;
+		int fileIndex = 0;
+		int dataSize = 0;
+		bool resident = false;
+		uint32_t lastUsed = 0;
+
+		// resident tiles, least recently used first (indexes into the tiles)
+		int lruPrev = -1;
+		int lruNext = -1;
+	};
+	typedef std::map<std::pair<int, int>, std::vector<int>> TileGrid;
+
+	// content hash of each tile in the mesh, by tile location (x, y, layer).
+	// Used to find the tiles that changed when the file is modified. Tiles
+	// can be rebuilt in place, so they are looked up by location, not by ref.
+	struct TileHash
+	{
+		uint32_t crc = 0;
+	};
+	typedef std::tuple<int, int, int> TileKey;
+	typedef std::map<TileKey, TileHash> TileHashMap;
+
+	// a tile that changed (or was added) since the mesh was loaded
+	struct TileUpdate
+	{
+		TileKey key;
+		uint32_t crc = 0;
+		NavMeshFileTile tile;
+	};
+
+	// result of a load, handed from the worker to whoever started it
+	struct LoadedMesh
+	{
+		~LoadedMesh();
+
+		LoadResult result = CORRUPT;
+		std::string filename;
+		int loadedTiles = 0;
+
+		// data must outlive mesh, the mesh may use tiles in place
+		std::shared_ptr<char> data;
+		std::unique_ptr<dtNavMesh> mesh;
+
+		// lazy loading: the tiles are left in the file and loaded on demand
+		bool lazy = false;
+		std::unique_ptr<NavMeshFileReader> reader;
+		std::vector<TileSlot> tiles;
+		TileGrid tileGrid;
+
+		TileHashMap tileHashes;
+		std::shared_ptr<const NavMeshLandmarks> landmarks;
+		std::shared_ptr<const NavMeshTileCacheData> tileCacheData;
+		std::shared_ptr<const NavMeshOffMeshLinks> offMeshLinks;
+
+		// tile update: only the tiles that differ from the loaded mesh are
+		// decoded. The mesh itself is updated in place by the caller.
+		bool update = false;
+		std::vector<TileUpdate> changedTiles;
+		std::vector<TileKey> removedTiles;
+
+		// what went wrong along the way, for the caller to log. The worker
+		// doesn't log anything itself.
+		std::vector<std::string> messages;
+	};
+
+	NavMeshFileLoader() {}
+	~NavMeshFileLoader();
+
+	NavMeshFileLoader(const NavMeshFileLoader&) = delete;
+	NavMeshFileLoader& operator=(const NavMeshFileLoader&) = delete;
+
+	// Start loading a whole mesh file on a worker thread. A load that is
+	// already in progress is cancelled.
+	void StartLoad(const std::string& filename, const LoadOptions& options);
+
+	// Start loading only the tiles that differ from currentTiles. If the
+	// layout of the mesh changed, the whole file is loaded instead, with
+	// options.
+	void StartUpdate(const std::string& filename, const TileHashMap& currentTiles,
+		const dtNavMeshParams& currentParams, const LoadOptions& options);
+
+	// Returns the result of the load once it is done (once), or null. Never
+	// waits for the worker.
+	std::shared_ptr<LoadedMesh> Poll();
+
+	// Abandon the load in progress. This doesn't wait for the worker either,
+	// it stops at its next check and throws its result away.
+	void Cancel();
+
+	// returns true from the start of a load until Poll() returns its result.
+	bool IsLoading() const { return m_job != nullptr; }
+
+	// number of cancelled workers that haven't stopped yet
+	int GetAbandonedCount() const { return static_cast<int>(m_abandoned.size()); }
+
+	// The loads themselves, run on the calling thread. They stop early with
+	// CANCELLED once cancel is set.
+	static std::shared_ptr<LoadedMesh> LoadMeshFile(const std::string& filename,
+		const LoadOptions& options, const std::atomic<bool>& cancel);
+	static std::shared_ptr<LoadedMesh> LoadMeshFileUpdate(const std::string& filename,
+		const TileHashMap& currentTiles, const dtNavMeshParams& currentParams,
+		const LoadOptions& options, const std::atomic<bool>& cancel);
+
+	// Swap the tiles of a successful update into the mesh it was loaded
+	// against, and bring tileHashes up to date. Tiles keep the refs they
+	// were saved with where they can, and tiles that didn't change aren't
+	// touched, so refs to them stay valid. Returns the number of tiles that
+	// were added, and adds the ones that couldn't be to messages.
+	static int ApplyTileUpdate(dtNavMesh& mesh, LoadedMesh& loaded, TileHashMap& tileHashes,
+		std::vector<std::string>& messages);
+
+private:
+	typedef std::function<std::shared_ptr<LoadedMesh>(const std::atomic<bool>&)> LoadFunction;
+
+	// one run of a worker thread
+	struct Job
+	{
+		std::thread thread;
+		std::atomic<bool> cancel{ false };
+		std::atomic<bool> done{ false };
+
+		// set by the worker before done
+		std::shared_ptr<LoadedMesh> result;
+	};
+
+	void Start(LoadFunction load);
+
+	// join the abandoned workers that have finished
+	void ReapAbandoned();
+
+	static LoadResult LoadZoneMeshData(const std::shared_ptr<char>& data, size_t length,
+		LoadedMesh& loaded, const std::atomic<bool>& cancel);
+	static LoadResult IndexZoneMeshTiles(const NavMeshFileReader& reader,
+		LoadedMesh& loaded, const std::atomic<bool>& cancel);
+
+	std::unique_ptr<Job> m_job;
+	std::vector<std::unique_ptr<Job>> m_abandoned;
+};
@@ -0,0 +1,26 @@
+//
+// NavMeshFilter.h
+//
+// dtQueryFilter's passFilter and getCost are defined inside of Detour, and
+// are virtual so that filters can be wrapped. These do what the default ones
+// do, inline, for the searches that we run ourselves.
+//
+
+#pragma once
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+
+//----------------------------------------------------------------------------
+
+inline bool PassFilter(const dtQueryFilter& filter, const dtPoly* poly)
+{
+	return (poly->flags & filter.getIncludeFlags()) != 0
+		&& (poly->flags & filter.getExcludeFlags()) == 0;
+}
+
+inline float GetCost(const dtQueryFilter& filter, const float* pa, const float* pb, const dtPoly* poly)
+{
+	return dtVdist(pa, pb) * filter.getAreaCost(poly->getArea());
+}
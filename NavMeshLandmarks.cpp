@@ -0,0 +1,540 @@
+//
+// NavMeshLandmarks.cpp
+//
+
+#include "NavMeshLandmarks.h"
+
+#include "DetourCommon.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include <queue>
+
+const float NavMeshLandmarks::UNREACHABLE = FLT_MAX;
+
+//----------------------------------------------------------------------------
+
+namespace {
+
+struct LandmarksHeader
+{
+	int magic;
+	int version;
+	int numLandmarks;
+	int numTiles;
+};
+
+struct LandmarksTileHeader
+{
+	dtTileRef tileRef;
+	int tileIndex;
+	int polyCount;
+};
+
+struct ReadCursor {
+	const char* data;
+	size_t length;
+};
+
+bool FillData(ReadCursor& cursor, void* data, size_t length)
+{
+	if (length > cursor.length)
+		return false;
+
+	memcpy(data, cursor.data, length);
+	cursor.data += length;
+	cursor.length -= length;
+	return true;
+}
+
+void AppendData(std::vector<char>& buffer, const void* data, size_t length)
+{
+	const char* bytes = static_cast<const char*>(data);
+	buffer.insert(buffer.end(), bytes, bytes + length);
+}
+
+// The point where a link crosses from one poly to the next, the same place
+// that dtNavMeshQuery puts it. For off-mesh connections it's the point where
+// the connection meets the ground.
+bool GetLinkPoint(const dtNavMesh* mesh, const dtMeshTile* tile, const dtPoly* poly,
+	dtPolyRef ref, const dtLink& link, float* pos)
+{
+	if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		dtVcopy(pos, &tile->verts[poly->verts[link.edge] * 3]);
+		return true;
+	}
+
+	const dtMeshTile* toTile = nullptr;
+	const dtPoly* toPoly = nullptr;
+	mesh->getTileAndPolyByRefUnsafe(link.ref, &toTile, &toPoly);
+
+	if (toPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		for (unsigned int l = toPoly->firstLink; l != DT_NULL_LINK; l = toTile->links[l].next)
+		{
+			if (toTile->links[l].ref == ref)
+			{
+				dtVcopy(pos, &toTile->verts[toPoly->verts[toTile->links[l].edge] * 3]);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	const float* va = &tile->verts[poly->verts[link.edge] * 3];
+	const float* vb = &tile->verts[poly->verts[(link.edge + 1) % poly->vertCount] * 3];
+
+	// links between tiles might only cover part of the edge
+	float t = 0.5f;
+	if (link.side != 0xff)
+		t = (link.bmin + link.bmax) * 0.5f / 255.0f;
+	dtVlerp(pos, va, vb, t);
+
+	return true;
+}
+
+// The graph the distances are measured over. Its nodes are the portals
+// between polys (one for each link), and two portals are connected if they
+// are on the same poly. This is the same graph that findPath searches: it
+// moves from one portal's link point to the next, so its cost to the end of
+// a path is never less than the distance in this graph. Links are taken
+// both ways, which only makes distances shorter.
+struct PortalGraph
+{
+	// every poly in the mesh gets a number, starting from its tile's base
+	std::vector<int> tileBase;
+	int polyCount = 0;
+
+	// the two polys each portal is between
+	std::vector<std::pair<int, int>> portalPolys;
+
+	// portals of each poly, and the neighbors of each portal
+	std::vector<std::vector<int>> polyPortals;
+	std::vector<int> firstEdge;
+	std::vector<int> edgePortals;
+	std::vector<float> edgeCosts;
+
+	void Build(const dtNavMesh* mesh);
+
+	// distance to each portal from the portals of a poly
+	void Search(int sourcePoly, std::vector<float>& distances) const;
+
+	// distance from the portals of a poly to the nearest/furthest of the
+	// portals of every poly
+	void GetPolyDistances(const std::vector<float>& portalDistances,
+		std::vector<float>& minDistances, std::vector<float>& maxDistances) const;
+};
+
+void PortalGraph::Build(const dtNavMesh* mesh)
+{
+	tileBase.assign(mesh->getMaxTiles(), 0);
+	polyCount = 0;
+
+	for (int i = 0; i < mesh->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = mesh->getTile(i);
+		tileBase[i] = polyCount;
+		if (tile && tile->header)
+			polyCount += tile->header->polyCount;
+	}
+
+	std::vector<float> points;
+	polyPortals.assign(polyCount, std::vector<int>());
+
+	for (int i = 0; i < mesh->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = mesh->getTile(i);
+		if (!tile || !tile->header)
+			continue;
+
+		dtPolyRef base = mesh->getPolyRefBase(tile);
+
+		for (int p = 0; p < tile->header->polyCount; ++p)
+		{
+			const dtPoly* poly = &tile->polys[p];
+
+			for (unsigned int l = poly->firstLink; l != DT_NULL_LINK; l = tile->links[l].next)
+			{
+				const dtLink& link = tile->links[l];
+				if (!link.ref)
+					continue;
+
+				float pos[3];
+				if (!GetLinkPoint(mesh, tile, poly, base | static_cast<dtPolyRef>(p), link, pos))
+					continue;
+
+				int otherPoly = tileBase[mesh->decodePolyIdTile(link.ref)] + mesh->decodePolyIdPoly(link.ref);
+				int portal = static_cast<int>(portalPolys.size());
+
+				portalPolys.push_back(std::make_pair(tileBase[i] + p, otherPoly));
+				points.insert(points.end(), pos, pos + 3);
+				polyPortals[tileBase[i] + p].push_back(portal);
+				polyPortals[otherPoly].push_back(portal);
+			}
+		}
+	}
+
+	int portalCount = static_cast<int>(portalPolys.size());
+	firstEdge.assign(portalCount + 1, 0);
+
+	for (int portal = 0; portal < portalCount; ++portal)
+	{
+		firstEdge[portal] = static_cast<int>(edgePortals.size());
+		const float* pos = &points[portal * 3];
+
+		for (int poly : { portalPolys[portal].first, portalPolys[portal].second })
+		{
+			for (int other : polyPortals[poly])
+			{
+				if (other == portal)
+					continue;
+
+				edgePortals.push_back(other);
+				edgeCosts.push_back(dtVdist(pos, &points[other * 3]));
+			}
+		}
+	}
+
+	firstEdge[portalCount] = static_cast<int>(edgePortals.size());
+}
+
+void PortalGraph::Search(int sourcePoly, std::vector<float>& distances) const
+{
+	typedef std::pair<float, int> QueueEntry;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> open;
+
+	distances.assign(portalPolys.size(), NavMeshLandmarks::UNREACHABLE);
+
+	for (int portal : polyPortals[sourcePoly])
+	{
+		distances[portal] = 0;
+		open.push(QueueEntry(0.0f, portal));
+	}
+
+	while (!open.empty())
+	{
+		QueueEntry entry = open.top();
+		open.pop();
+
+		int portal = entry.second;
+		if (entry.first > distances[portal])
+			continue;
+
+		for (int e = firstEdge[portal]; e < firstEdge[portal + 1]; ++e)
+		{
+			float cost = entry.first + edgeCosts[e];
+			if (cost < distances[edgePortals[e]])
+			{
+				distances[edgePortals[e]] = cost;
+				open.push(QueueEntry(cost, edgePortals[e]));
+			}
+		}
+	}
+}
+
+void PortalGraph::GetPolyDistances(const std::vector<float>& portalDistances,
+	std::vector<float>& minDistances, std::vector<float>& maxDistances) const
+{
+	minDistances.assign(polyCount, NavMeshLandmarks::UNREACHABLE);
+	maxDistances.assign(polyCount, 0.0f);
+
+	for (int poly = 0; poly < polyCount; ++poly)
+	{
+		for (int portal : polyPortals[poly])
+		{
+			minDistances[poly] = std::min(minDistances[poly], portalDistances[portal]);
+			maxDistances[poly] = std::max(maxDistances[poly], portalDistances[portal]);
+		}
+	}
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+bool NavMeshLandmarks::Build(const dtNavMesh* mesh, int numLandmarks)
+{
+	m_tiles.clear();
+	m_landmarks.clear();
+
+	if (!mesh)
+		return false;
+
+	numLandmarks = dtClamp(numLandmarks, 1, MAX_LANDMARKS);
+
+	PortalGraph graph;
+	graph.Build(mesh);
+
+	// Landmarks only help in the part of the mesh they can reach, so put
+	// them all in the biggest connected part. The rest just doesn't get an
+	// estimate better than the straight line.
+	std::vector<int> parents(graph.polyCount);
+	std::iota(parents.begin(), parents.end(), 0);
+
+	auto find = [&](int i)
+	{
+		while (parents[i] != i)
+		{
+			parents[i] = parents[parents[i]];
+			i = parents[i];
+		}
+		return i;
+	};
+
+	for (const auto& polys : graph.portalPolys)
+	{
+		int a = find(polys.first);
+		int b = find(polys.second);
+		if (a != b)
+			parents[std::max(a, b)] = std::min(a, b);
+	}
+
+	std::vector<int> sizes(graph.polyCount, 0);
+	for (int poly = 0; poly < graph.polyCount; ++poly)
+	{
+		if (!graph.polyPortals[poly].empty())
+			sizes[find(poly)]++;
+	}
+
+	auto largest = std::max_element(sizes.begin(), sizes.end());
+	if (largest == sizes.end() || *largest == 0)
+		return false;
+
+	// Pick each landmark as far as possible from the ones before it. The
+	// first one goes as far as possible from somewhere in the middle.
+	std::vector<float> portalDistances, minDistances, maxDistances;
+	std::vector<float> nearestLandmark(graph.polyCount, UNREACHABLE);
+	std::vector<std::vector<float>> polyDistances;
+	std::vector<float> slack(graph.polyCount, 0.0f);
+
+	graph.Search(static_cast<int>(largest - sizes.begin()), portalDistances);
+	graph.GetPolyDistances(portalDistances, nearestLandmark, maxDistances);
+
+	std::vector<int> landmarkPolys;
+
+	for (int i = 0; i < numLandmarks; ++i)
+	{
+		int next = -1;
+		float nextDistance = 0;
+
+		for (int poly = 0; poly < graph.polyCount; ++poly)
+		{
+			if (nearestLandmark[poly] != UNREACHABLE && nearestLandmark[poly] > nextDistance)
+			{
+				next = poly;
+				nextDistance = nearestLandmark[poly];
+			}
+		}
+
+		// every poly is a landmark already
+		if (next == -1)
+			break;
+
+		graph.Search(next, portalDistances);
+		graph.GetPolyDistances(portalDistances, minDistances, maxDistances);
+
+		for (int poly = 0; poly < graph.polyCount; ++poly)
+		{
+			if (minDistances[poly] == UNREACHABLE)
+				continue;
+
+			// i == 0 replaces the distances from the starting point
+			nearestLandmark[poly] = i == 0 ? minDistances[poly] : std::min(nearestLandmark[poly], minDistances[poly]);
+			slack[poly] = std::max(slack[poly], maxDistances[poly] - minDistances[poly]);
+		}
+
+		landmarkPolys.push_back(next);
+		polyDistances.push_back(minDistances);
+	}
+
+	// and lay them out by tile, with each poly's distances together
+	int count = static_cast<int>(landmarkPolys.size());
+	m_tiles.resize(mesh->getMaxTiles());
+
+	for (int i = 0; i < mesh->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = mesh->getTile(i);
+		if (!tile || !tile->header)
+			continue;
+
+		TileTable& table = m_tiles[i];
+		table.tileRef = mesh->getTileRef(tile);
+		table.polyCount = tile->header->polyCount;
+		table.slack.resize(table.polyCount);
+		table.distances.resize(table.polyCount * count);
+
+		for (int p = 0; p < table.polyCount; ++p)
+		{
+			int poly = graph.tileBase[i] + p;
+			table.slack[p] = slack[poly];
+
+			for (int l = 0; l < count; ++l)
+				table.distances[p * count + l] = polyDistances[l][poly];
+		}
+	}
+
+	// refs of the landmark polys, for showing where they are
+	m_landmarks.resize(count);
+	for (int l = 0; l < count; ++l)
+	{
+		int poly = landmarkPolys[l];
+		int tileIndex = static_cast<int>(std::upper_bound(graph.tileBase.begin(), graph.tileBase.end(), poly)
+			- graph.tileBase.begin()) - 1;
+
+		m_landmarks[l] = mesh->getPolyRefBase(mesh->getTile(tileIndex))
+			| static_cast<dtPolyRef>(poly - graph.tileBase[tileIndex]);
+	}
+
+	return true;
+}
+
+bool NavMeshLandmarks::Read(const char* data, size_t size)
+{
+	m_tiles.clear();
+	m_landmarks.clear();
+
+	ReadCursor cursor{ data, size };
+
+	LandmarksHeader header;
+	if (!FillData(cursor, &header, sizeof(header)))
+		return false;
+	if (header.magic != NAVMESHLANDMARKS_MAGIC || header.version != NAVMESHLANDMARKS_VERSION)
+		return false;
+	if (header.numLandmarks <= 0 || header.numLandmarks > MAX_LANDMARKS || header.numTiles < 0)
+		return false;
+
+	std::vector<dtPolyRef> landmarks(header.numLandmarks);
+	if (!FillData(cursor, landmarks.data(), landmarks.size() * sizeof(dtPolyRef)))
+		return false;
+
+	// there are at most 22 bits for the tile index
+	const int MAX_TILE_INDEX = 1 << 22;
+
+	for (int i = 0; i < header.numTiles; ++i)
+	{
+		LandmarksTileHeader tileHeader;
+		if (!FillData(cursor, &tileHeader, sizeof(tileHeader)))
+			return false;
+		if (tileHeader.tileIndex < 0 || tileHeader.tileIndex >= MAX_TILE_INDEX || tileHeader.polyCount < 0)
+			return false;
+
+		if (tileHeader.tileIndex >= static_cast<int>(m_tiles.size()))
+			m_tiles.resize(tileHeader.tileIndex + 1);
+
+		TileTable& table = m_tiles[tileHeader.tileIndex];
+		table.tileRef = tileHeader.tileRef;
+		table.polyCount = tileHeader.polyCount;
+		table.slack.resize(table.polyCount);
+		table.distances.resize(table.polyCount * header.numLandmarks);
+
+		if (!FillData(cursor, table.slack.data(), table.slack.size() * sizeof(float))
+			|| !FillData(cursor, table.distances.data(), table.distances.size() * sizeof(float)))
+		{
+			m_tiles.clear();
+			return false;
+		}
+	}
+
+	m_landmarks = std::move(landmarks);
+	return true;
+}
+
+void NavMeshLandmarks::Write(std::vector<char>& buffer) const
+{
+	buffer.clear();
+
+	LandmarksHeader header;
+	header.magic = NAVMESHLANDMARKS_MAGIC;
+	header.version = NAVMESHLANDMARKS_VERSION;
+	header.numLandmarks = GetLandmarkCount();
+	header.numTiles = GetTileCount();
+	AppendData(buffer, &header, sizeof(header));
+	AppendData(buffer, m_landmarks.data(), m_landmarks.size() * sizeof(dtPolyRef));
+
+	for (size_t i = 0; i < m_tiles.size(); ++i)
+	{
+		const TileTable& table = m_tiles[i];
+		if (!table.tileRef)
+			continue;
+
+		LandmarksTileHeader tileHeader;
+		tileHeader.tileRef = table.tileRef;
+		tileHeader.tileIndex = static_cast<int>(i);
+		tileHeader.polyCount = table.polyCount;
+		AppendData(buffer, &tileHeader, sizeof(tileHeader));
+		AppendData(buffer, table.slack.data(), table.slack.size() * sizeof(float));
+		AppendData(buffer, table.distances.data(), table.distances.size() * sizeof(float));
+	}
+}
+
+int NavMeshLandmarks::GetTileCount() const
+{
+	return static_cast<int>(std::count_if(m_tiles.begin(), m_tiles.end(),
+		[](const TileTable& table) { return table.tileRef != 0; }));
+}
+
+const float* NavMeshLandmarks::GetDistances(const dtNavMesh* mesh, dtPolyRef ref, float& slack) const
+{
+	unsigned int salt, tileIndex, polyIndex;
+	mesh->decodePolyId(ref, salt, tileIndex, polyIndex);
+
+	if (tileIndex >= m_tiles.size())
+		return nullptr;
+
+	// the tile might have been replaced since the tables were built
+	const TileTable& table = m_tiles[tileIndex];
+	if (!table.tileRef || mesh->decodePolyIdSalt(table.tileRef) != salt
+		|| polyIndex >= static_cast<unsigned int>(table.polyCount))
+	{
+		return nullptr;
+	}
+
+	slack = table.slack[polyIndex];
+	return &table.distances[polyIndex * m_landmarks.size()];
+}
+
+//----------------------------------------------------------------------------
+
+NavMeshLandmarkHeuristic::NavMeshLandmarkHeuristic(const NavMeshLandmarks* landmarks,
+	const dtNavMesh* mesh)
+	: m_landmarks(landmarks)
+	, m_navMesh(mesh)
+{
+}
+
+float NavMeshLandmarkHeuristic::getCost(dtPolyRef ref, const float* pos,
+	dtPolyRef endRef, const float* endPos) const
+{
+	float cost = dtVdist(pos, endPos) * DT_HEURISTIC_SCALE;
+
+	if (endRef != m_endRef)
+	{
+		m_endRef = endRef;
+		m_endDistances = m_landmarks->GetDistances(m_navMesh, endRef, m_endSlack);
+	}
+
+	float slack;
+	const float* distances = m_endDistances ? m_landmarks->GetDistances(m_navMesh, ref, slack) : nullptr;
+	if (!distances)
+		return cost;
+
+	// The table has the distance to the nearest portal of each poly, and
+	// the path might leave through any of them. Take off how far apart
+	// those can be on the side that is closer to the landmark.
+	for (int l = 0; l < m_landmarks->GetLandmarkCount(); ++l)
+	{
+		if (distances[l] == NavMeshLandmarks::UNREACHABLE || m_endDistances[l] == NavMeshLandmarks::UNREACHABLE)
+			continue;
+
+		float diff = m_endDistances[l] - distances[l];
+		float bound = diff > 0 ? diff - slack : -diff - m_endSlack;
+		if (bound > cost)
+			cost = bound;
+	}
+
+	return cost;
+}
@@ -0,0 +1,97 @@
+//
+// NavMeshLandmarks.h
+//
+// Landmark distance tables for the path search heuristic (ALT). A few polys
+// far apart from each other are picked as landmarks, and the distance from
+// each one to every poly is stored. By the triangle inequality, the
+// difference between two polys' distances to a landmark can't be more than
+// the distance between them, and in winding zones that is a much better
+// estimate than the straight line.
+//
+// The tables are built by the mesh generator and saved in the mesh file.
+// This is shared by the plugin and the mesh generator, so it shouldn't
+// depend on either.
+//
+
+#pragma once
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+static const int NAVMESHLANDMARKS_MAGIC = 'L' << 24 | 'M' << 16 | 'R' << 8 | 'K'; //'LMRK';
+static const int NAVMESHLANDMARKS_VERSION = 1;
+
+//----------------------------------------------------------------------------
+
+class NavMeshLandmarks
+{
+public:
+	// Pick landmarks and compute the tables for all of the tiles in a mesh.
+	// This is a search over the whole mesh for every landmark, so it belongs
+	// in the mesh generator. Returns false if the mesh has no polys.
+	bool Build(const dtNavMesh* mesh, int numLandmarks = DEFAULT_LANDMARKS);
+
+	// Read from or write to a mesh file section (SECTION_LANDMARKS).
+	bool Read(const char* data, size_t size);
+	void Write(std::vector<char>& buffer) const;
+
+	bool IsEmpty() const { return m_landmarks.empty(); }
+	int GetLandmarkCount() const { return static_cast<int>(m_landmarks.size()); }
+	dtPolyRef GetLandmark(int index) const { return m_landmarks[index]; }
+	int GetTileCount() const;
+
+	// The distances from each landmark to a poly, or null if the tables
+	// don't have it (or it's from a different version of the tile). slack
+	// is how much the distance to any point of the poly can differ from
+	// the ones in the table.
+	const float* GetDistances(const dtNavMesh* mesh, dtPolyRef ref, float& slack) const;
+
+	static const int DEFAULT_LANDMARKS = 8;
+	static const int MAX_LANDMARKS = 32;
+
+	// polys that a landmark can't reach
+	static const float UNREACHABLE;
+
+private:
+	struct TileTable
+	{
+		dtTileRef tileRef = 0;
+		int polyCount = 0;
+
+		// per poly
+		std::vector<float> slack;
+
+		// per poly, per landmark
+		std::vector<float> distances;
+	};
+
+	// tables are indexed by the tile's index in the mesh
+	std::vector<TileTable> m_tiles;
+	std::vector<dtPolyRef> m_landmarks;
+};
+
+//----------------------------------------------------------------------------
+
+// Query heuristic using the landmark tables. Falls back to the straight line
+// distance (whichever is larger is used) for polys that aren't in the tables.
+class NavMeshLandmarkHeuristic : public dtQueryHeuristic
+{
+public:
+	NavMeshLandmarkHeuristic(const NavMeshLandmarks* landmarks, const dtNavMesh* mesh);
+
+	virtual float getCost(dtPolyRef ref, const float* pos,
+		dtPolyRef endRef, const float* endPos) const override;
+
+private:
+	const NavMeshLandmarks* m_landmarks;
+	const dtNavMesh* m_navMesh;
+
+	// distances for the end of the path, which is the same for a whole search
+	mutable dtPolyRef m_endRef = 0;
+	mutable const float* m_endDistances = nullptr;
+	mutable float m_endSlack = 0;
+};
@@ -5,6 +5,10 @@
 #include "NavMeshLoader.h"
 #include "MQ2Nav_Util.h"
 #include "MQ2Navigation.h"
+#include "MQ2Nav_Settings.h"
+#include "NavMeshLandmarks.h"
+#include "NavMeshOffMeshLinks.h"
+#include "NavMeshTileCache.h"
 
 // nav mesh definitions
 #include "DetourNavMesh.h"
@@ -12,6 +16,11 @@
 
 #include <ctime>
 
+NavMeshLoader::~NavMeshLoader()
+{
+	CancelLoad();
+}
+
 void NavMeshLoader::SetZoneId(DWORD zoneId)
 {
 	if (m_zoneId != zoneId)
@@ -47,49 +56,6 @@ void NavMeshLoader::SetAutoLoad(bool autoLoad)
 	m_autoLoad = autoLoad;
 }
 
-// Given a filename, return a buffer of data. Returns nullptr if
-// the file does not exist.
-static std::pair<std::shared_ptr<char>, DWORD> ReadFile(const std::string& filename)
-{
-	FILE* file = fopen(filename.c_str(), "rb");
-	if (file != 0)
-	{
-		scope_guard g = [file]() { fclose(file); };
-
-		// find the file size
-		DWORD size = 0;
-		fseek(file, 0, SEEK_END);
-		size = ftell(file);
-		rewind(file);
-
-		// allocate memory to contain the whole file
-		std::shared_ptr<char> buffer(new char[size], [](char* p) { delete[] p; });
-
-		// copy the file into the buffer
-		size_t result = fread(buffer.get(), 1, size, file);
-		if (result == size)
-		{
-			return std::make_pair(buffer, size);
-		}
-	}
-
-	return std::make_pair(nullptr, 0);
-}
-
-static std::pair<std::shared_ptr<char>, DWORD> ReadRarFile(const std::string& filename, const std::string& contentsFile)
-{
-	char* outbuf = nullptr;
-	DWORD outsize = 0;
-
-	char outfile[MAX_PATH];
-	strcpy_s(outfile, contentsFile.c_str());
-
-	char rarfile[MAX_PATH];
-	strcpy_s(rarfile, filename.c_str());
-
-	return std::make_pair(std::shared_ptr<char>(outbuf, free), outsize);
-}
-
 std::string NavMeshLoader::GetMeshDirectory() const
 {
 	// the root path is where we look for all of our mesh files
@@ -97,16 +63,27 @@ std::string NavMeshLoader::GetMeshDirectory() const
 }
 
 bool NavMeshLoader::LoadNavMesh()
+{
+	return StartLoad(false);
+}
+
+bool NavMeshLoader::StartLoad(bool updateTiles)
 {
 	// At this point, we expect the zone short name to be set, so we know
 	// which map file we need to load.
 
-	// Upon successful completion of this load, we will have set the dtNavMesh
-	// and the filename that we loaded.
+	// The mesh is built on a worker thread. Once it is complete, Process()
+	// swaps it in and fires OnNavMeshChanged. Until then, any mesh that is
+	// already loaded stays active.
+
+	// If updateTiles is set, only the tiles that changed are loaded, and
+	// they are swapped into the current mesh instead.
 
 	if (m_zoneShortName.empty())
 		return false;
 
+	CancelLoad();
+
 	// the root path is where we look for all of our mesh files
 	std::string root_path = GetMeshDirectory() + "\\";
 
@@ -114,212 +91,222 @@ bool NavMeshLoader::LoadNavMesh()
 	std::string mesh_filename = m_zoneShortName + ".bin";
 	std::string data_file = root_path + mesh_filename;
 
-	// this is what we do after we successfully read from a file. We are given the
-	// data, its length, and the file that provided the data. If the load succeeds,
-	// we'll store the filename and process the mesh. If the load fails, we'll move
-	// onto the next file.
+	NavMeshFileLoader::LoadOptions options;
+	options.mapFile = mq2nav::GetSettings().map_mesh_files;
+	options.lazyTiles = mq2nav::GetSettings().lazy_tile_loading;
 
-	// The code is broken up this way to maintain consistency between loading from a
-	// rar file, and loading from a plain .bin file
-	auto next_load_stage = [&](const auto& load_ret_val, const std::string& load_filename) -> bool
-	{
-		std::shared_ptr<char> data = load_ret_val.first;
-		DWORD dataLen = load_ret_val.second;
+	m_pendingFileTime = 0;
+	GetFileWriteTime(data_file, m_pendingFileTime);
 
-		LoadResult result = LoadZoneMeshData(data, dataLen);
-		if (result == SUCCESS)
-		{
-			WriteChatf(PLUGIN_MSG "\agSuccessfully loaded mesh for \am%s\ax (%s)", m_zoneShortName.c_str(),
-				load_filename.c_str());
-			m_loadedDataFile = load_filename;
-
-			// Get filetime
-			HANDLE hFile = CreateFile(m_loadedDataFile.c_str(), GENERIC_READ, FILE_SHARE_READ,
-				NULL, OPEN_EXISTING, 0, NULL);
-			if (hFile != INVALID_HANDLE_VALUE)
-			{
-				GetFileTime(hFile, NULL, NULL, &m_fileTime);
-			}
-			CloseHandle(hFile);
+	// lazily loaded meshes don't track tile hashes, so they always get a
+	// full reload.
+	if (updateTiles && m_mesh && !IsLazyLoading() && !m_tileHashes.empty())
+		m_fileLoader.StartUpdate(data_file, m_tileHashes, *m_mesh->getParams(), options);
+	else
+		m_fileLoader.StartLoad(data_file, options);
 
-			return true;
-		}
-		if (result == CORRUPT)
-		{
-			WriteChatf(PLUGIN_MSG "\arFailed to load mesh file, the file is corrupt (%s)", load_filename.c_str());
-		}
-		else if (result == VERSION_MISMATCH)
-		{
-			WriteChatf(PLUGIN_MSG "\arCouldn't load mesh file due to version mismatch (%s)", load_filename.c_str());
-		}
+	return true;
+}
 
-		return false;
-	};
+void NavMeshLoader::FinishLoad(const std::shared_ptr<LoadedMesh>& loaded)
+{
+	for (const std::string& message : loaded->messages)
+		DebugSpewAlways("[MQ2Nav] %s", message.c_str());
 
-	// load raw mesh file first
-	auto file_data = ReadFile(data_file);
-	if (file_data.first)
+	if (loaded->update && loaded->result == NavMeshFileLoader::SUCCESS)
 	{
-		if (next_load_stage(file_data, data_file))
-			return true;
+		FinishUpdate(loaded);
+		return;
 	}
 
-	WriteChatf(PLUGIN_MSG "\ayNo nav mesh available for \am%s\ax", m_zoneShortName.c_str());
-	return false;
-}
-
-//----------------------------------------------------------------------------
-
-static const int NAVMESHSET_MAGIC = 'M' << 24 | 'S' << 16 | 'E' << 8 | 'T';
-
-static const int NAVMESHSET_VERSION = 2;
+	switch (loaded->result)
+	{
+	case NavMeshFileLoader::SUCCESS:
+		WriteChatf(PLUGIN_MSG "\agSuccessfully loaded mesh for \am%s\ax (%s)", m_zoneShortName.c_str(),
+			loaded->filename.c_str());
+
+		// these values shouldn't be set until we have a successful load
+		m_loadedDataFile = loaded->filename;
+		m_fileWatcher.Watch(m_loadedDataFile, m_pendingFileTime);
+		m_loadedTiles = loaded->loadedTiles;
+		m_tileHashes = std::move(loaded->tileHashes);
+		m_mesh = std::move(loaded->mesh);
+		m_landmarks = std::move(loaded->landmarks);
+		m_tileCacheData = std::move(loaded->tileCacheData);
+		m_offMeshLinks = std::move(loaded->offMeshLinks);
+		m_meshReader = std::move(loaded->reader);
+		m_meshData = std::move(loaded->data);
+
+		m_residency.Reset();
+
+		// bring in the tiles around us before anyone tries to use the mesh.
+		// OnNavMeshChanged covers these, so OnTilesChanging/Changed aren't fired.
+		if (loaded->lazy)
+		{
+			m_residency.Attach(m_mesh.get(), m_meshReader.get(),
+				std::move(loaded->tiles), std::move(loaded->tileGrid));
 
-// header (the same across all versions)
-struct NavMeshSetHeader
-{
-	int magic;
-	int version;
-	int numTiles;
-	dtNavMeshParams params;
-};
+			m_tilesChanging = true;
+			UpdateResidentTiles();
+			m_tilesChanging = false;
+		}
 
-struct NavMeshTileHeader
-{
-	dtTileRef tileRef;
-	int dataSize;
-};
+		OnNavMeshChanged(m_mesh.get());
+		break;
 
-struct ReadCursor {
-	char* data;
-	DWORD length;
-};
+	case NavMeshFileLoader::CORRUPT:
+		WriteChatf(PLUGIN_MSG "\arFailed to load mesh file, the file is corrupt (%s)", loaded->filename.c_str());
+		break;
 
-template <typename T>
-bool FillStructure(ReadCursor& cursor, T& data)
-{
-	DWORD l = sizeof(T);
-	if (l > cursor.length)
-		return false;
+	case NavMeshFileLoader::VERSION_MISMATCH:
+		WriteChatf(PLUGIN_MSG "\arCouldn't load mesh file due to version mismatch (%s)", loaded->filename.c_str());
+		break;
 
-	memcpy(&data, cursor.data, l);
-	cursor.data += l;
-	cursor.length -= l;
-	return true;
+	case NavMeshFileLoader::NOT_FOUND:
+		WriteChatf(PLUGIN_MSG "\ayNo nav mesh available for \am%s\ax", m_zoneShortName.c_str());
+		break;
+	}
 }
 
-NavMeshLoader::LoadResult NavMeshLoader::LoadZoneMeshData(const std::shared_ptr<char>& data, DWORD length)
+void NavMeshLoader::FinishUpdate(const std::shared_ptr<LoadedMesh>& loaded)
 {
-	ReadCursor cursor{ data.get(), length };
-
-	//------------------------------------------------------------------------
-	// Read the header
-	NavMeshSetHeader header;
-	if (!FillStructure(cursor, header)) {
-		DebugSpewAlways("Failed to read header from mesh file!");
-		return CORRUPT;
-	}
+	// the tables are checked against each tile as they are used, so they
+	// can be swapped for the new ones before the tiles are.
+	m_landmarks = std::move(loaded->landmarks);
 
-	if (header.magic != NAVMESHSET_MAGIC) {
-		DebugSpewAlways("Header Magic value mismatch!");
-		return CORRUPT;
-	}
-	if (header.version != NAVMESHSET_VERSION) {
-		DebugSpewAlways("Header version mismatch!");
-		return VERSION_MISMATCH;
-	}
+	// the tile cache is rebuilt from the new layers when the tiles change
+	m_tileCacheData = std::move(loaded->tileCacheData);
+	m_offMeshLinks = std::move(loaded->offMeshLinks);
 
-	std::unique_ptr<dtNavMesh> navMesh(new dtNavMesh);
-	if (!navMesh->init(&header.params)) {
-		DebugSpewAlways("Header params are bad!");
-		return CORRUPT;
+	if (loaded->changedTiles.empty() && loaded->removedTiles.empty())
+	{
+		DebugSpewAlways("[MQ2Nav] Mesh file changed, but none of its tiles did");
+		return;
 	}
 
-	//------------------------------------------------------------------------
-	// Read the tiles
-	int passtile = 0, failtile = 0;
+	BeginTileChanges();
 
-	for (int i = 0; i < header.numTiles; ++i)
-	{
-		NavMeshTileHeader tileHeader;
-		if (!FillStructure(cursor, tileHeader)) {
-			DebugSpewAlways("Failed to read tile header for tile %d!", i);
-			return CORRUPT;
-		}
+	std::vector<std::string> messages;
+	int updatedTiles = NavMeshFileLoader::ApplyTileUpdate(*m_mesh, *loaded, m_tileHashes, messages);
 
-		if (!tileHeader.tileRef || !tileHeader.dataSize) {
-			continue;
-		}
+	for (const std::string& message : messages)
+		DebugSpewAlways("[MQ2Nav] %s", message.c_str());
 
-		// validate the size. For sure it should not exceed the remainder of the
-		// file size.
-		if (tileHeader.dataSize < 0 || tileHeader.dataSize > cursor.length) {
-			DebugSpewAlways("tileHeader's dataSize has invalid size %d for tile %d",
-				tileHeader.dataSize, i);
-			return CORRUPT;
-		}
-
-		unsigned char* tileData = (unsigned char*)dtAlloc(tileHeader.dataSize, DT_ALLOC_PERM);
-		memcpy(tileData, cursor.data, tileHeader.dataSize);
-		cursor.length -= tileHeader.dataSize;
-		cursor.data += tileHeader.dataSize;
+	m_loadedTiles = static_cast<int>(m_tileHashes.size());
 
-		if (navMesh->addTile(tileData, tileHeader.dataSize, DT_TILE_FREE_DATA, tileHeader.tileRef, 0))
-			passtile++;
-		else
-		{
-			DebugSpewAlways("Failed to load tile %d", i);
-			failtile++;
-		}
-	}
+	EndTileChanges();
 
-	// these values shouldn't be set until we have a successful load
-	m_loadedTiles = passtile;
-	m_mesh = std::move(navMesh);
-	OnNavMeshChanged(m_mesh.get());
+	WriteChatf(PLUGIN_MSG "\agUpdated \ay%d\ag tiles of mesh for \am%s\ax (%d removed)", updatedTiles,
+		m_zoneShortName.c_str(), static_cast<int>(loaded->removedTiles.size()));
+}
 
-	return SUCCESS;
+void NavMeshLoader::CancelLoad()
+{
+	// doesn't wait for the worker, it finishes on its own and its result
+	// is thrown away.
+	m_fileLoader.Cancel();
 }
 
 void NavMeshLoader::Reset()
 {
+	CancelLoad();
+
 	OnNavMeshChanged(nullptr);
+	m_residency.Reset();
 	m_mesh.reset();
+	m_landmarks.reset();
+	m_tileCacheData.reset();
+	m_offMeshLinks.reset();
+	m_meshReader.reset();
+	m_meshData.reset();
+
+	m_tileHashes.clear();
 	m_zoneShortName.clear();
 	m_loadedDataFile.clear();
+	m_fileWatcher.Stop();
 	m_loadedTiles = 0;
 }
 
 void NavMeshLoader::Process()
 {
-	if (m_autoReload)
+	// swap in a mesh that finished loading in the background
+	if (auto loaded = m_fileLoader.Poll())
+	{
+		FinishLoad(loaded);
+	}
+
+	if (IsLazyLoading())
 	{
 		clock::time_point now = clock::now();
-		if (now - m_lastUpdate > std::chrono::seconds(1))
+		if (now - m_lastTileUpdate > std::chrono::milliseconds(250))
 		{
-			m_lastUpdate = now;
+			m_lastTileUpdate = now;
 
-			if (!m_loadedDataFile.empty())
-			{
-				// Get the current filetime
-				FILETIME currentFileTime;
-
-				HANDLE hFile = CreateFile(m_loadedDataFile.c_str(), GENERIC_READ, FILE_SHARE_READ,
-					NULL, OPEN_EXISTING, 0, NULL);
-				if (hFile != INVALID_HANDLE_VALUE)
-				{
-					GetFileTime(hFile, NULL, NULL, &currentFileTime);
-
-					// Reload file *if* it is 5 seconds old AND newer than existing
-					if (CompareFileTime(&currentFileTime, &m_fileTime))
-					{
-						DebugSpewAlways("Current file time is newer than old file time, refreshing");
-						LoadNavMesh();
-					}
-				}
-				CloseHandle(hFile);
-			}
+			UpdateResidentTiles();
+			EndTileChanges();
 		}
 	}
+
+	// the watcher only reports a change once the file has been completely
+	// written, so the reload doesn't pick up a half saved mesh.
+	if (m_autoReload && !m_fileLoader.IsLoading() && m_fileWatcher.Poll())
+	{
+		DebugSpewAlways("[MQ2Nav] Mesh file was modified, refreshing");
+		StartLoad(true);
+	}
+}
+
+//----------------------------------------------------------------------------
+
+void NavMeshLoader::UpdateResidentTiles()
+{
+	PCHARINFO pChar = GetCharInfo();
+	if (!pChar || !pChar->pSpawn)
+		return;
+
+	// note: X, Z, Y
+	float pos[3] = { pChar->pSpawn->X, pChar->pSpawn->Z, pChar->pSpawn->Y };
+	m_residency.RequestArea(pos, mq2nav::GetSettings().tile_load_radius);
+
+	EvictTiles();
+}
+
+void NavMeshLoader::RequestTiles(const float* points, int count)
+{
+	if (!IsLazyLoading())
+		return;
+
+	m_residency.RequestLine(points, count);
+
+	EvictTiles();
+	EndTileChanges();
+}
+
+void NavMeshLoader::EvictTiles()
+{
+	size_t budget = static_cast<size_t>(mq2nav::GetSettings().tile_memory_budget) * 1024 * 1024;
+	m_residency.Evict(budget);
+
+	for (const std::string& message : m_residency.TakeMessages())
+		DebugSpewAlways("[MQ2Nav] %s", message.c_str());
+}
+
+void NavMeshLoader::BeginTileChanges()
+{
+	if (!m_tilesChanging)
+	{
+		m_tilesChanging = true;
+		OnTilesChanging();
+	}
+}
+
+void NavMeshLoader::EndTileChanges()
+{
+	if (m_tilesChanging)
+	{
+		m_tilesChanging = false;
+		OnTilesChanged();
+	}
 }
 
 //----------------------------------------------------------------------------
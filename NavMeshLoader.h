@@ -5,19 +5,27 @@
 #pragma once
 
 #include "MQ2Plugin.h"
+#include "FileWatcher.h"
+#include "NavMeshFileLoader.h"
+#include "NavMeshTileResidency.h"
 #include "Signal.h"
 
 #include <chrono>
 #include <string>
 #include <memory>
+#include <vector>
 
 class dtNavMesh;
 class MQ2NavigationPlugin;
+class NavMeshLandmarks;
+class NavMeshTileCacheData;
+class NavMeshOffMeshLinks;
 
 class NavMeshLoader
 {
 public:
 	NavMeshLoader() {}
+	~NavMeshLoader();
 
 	// called from OnPulse, will do actions on specific intervals
 	void Process();
@@ -33,18 +41,23 @@ public:
 	bool GetAutoLoad() const { return m_autoLoad; }
 
 	// turns autoreload on or off. A navmesh will be reloaded when the file changes
-	// if this is true.
+	// if this is true. Only the tiles that changed are replaced, so the mesh
+	// and the poly refs in the rest of it stay valid.
 	void SetAutoReload(bool autoReload);
 	bool GetAutoReload() const { return m_autoReload; }
 
 	// returns if a navmesh is currently loaded or not.
 	bool IsNavMeshLoaded() const { return m_mesh != nullptr; }
 
+	// returns true while a navmesh is being loaded in the background.
+	bool IsLoading() const { return m_fileLoader.IsLoading(); }
+
 	// returns the name of the file that the navmesh was loaded from.
 	std::string GetDataFileName() const { return m_loadedDataFile; }
 	
-	// try to reload the navmesh for the current zone. Returns true if the
-	// navmesh successfully loads
+	// try to reload the navmesh for the current zone. The mesh is loaded on a
+	// worker thread and swapped in on a later call to Process(). Returns true
+	// if a load was started.
 	bool LoadNavMesh();
 
 	// unload all existing data and clean up all state
@@ -53,17 +66,71 @@ public:
 	// get the currently loaded navmesh
 	inline dtNavMesh* GetNavMesh() const { return m_mesh.get(); }
 
+	// landmark tables that were saved with the mesh, or null if it doesn't
+	// have any. Replaced (not modified) when the mesh is reloaded.
+	std::shared_ptr<const NavMeshLandmarks> GetLandmarks() const { return m_landmarks; }
+
+	// tile cache layers for dynamic obstacles that were saved with the mesh,
+	// or null if it doesn't have any. Replaced when the mesh is reloaded.
+	std::shared_ptr<const NavMeshTileCacheData> GetTileCacheData() const { return m_tileCacheData; }
+
+	// off-mesh links that were built into the tiles, with the actions that
+	// go with them, or null if the mesh doesn't have any. Replaced when the
+	// mesh is reloaded.
+	std::shared_ptr<const NavMeshOffMeshLinks> GetOffMeshLinks() const { return m_offMeshLinks; }
+
+	//----------------------------------------------------------------------------
+	// lazy tile loading
+
+	// returns true if the loaded mesh only keeps some of its tiles resident.
+	bool IsLazyLoading() const { return m_residency.IsAttached(); }
+
+	typedef NavMeshTileResidency::Stats TileStats;
+	const TileStats& GetTileStats() const { return m_residency.GetStats(); }
+
+	// make sure that the tiles along a line of points (in detour coordinates)
+	// are loaded, and mark them as recently used so they won't be evicted.
+	// Does nothing unless lazy loading is active.
+	void RequestTiles(const float* points, int count);
+
 	Signal<dtNavMesh*> OnNavMeshChanged;
 
+	// fired before and after tiles are added to or removed from the current
+	// mesh. Nothing may read the mesh from another thread in between.
+	Signal<> OnTilesChanging;
+	Signal<> OnTilesChanged;
+
+	// Fire the signals above around changes to the mesh's tiles. Anything
+	// else that rebuilds tiles in place (dynamic obstacles) needs to do the
+	// same. Nested calls are only signalled once.
+	void BeginTileChanges();
+	void EndTileChanges();
+
 private:
-	enum LoadResult { SUCCESS, CORRUPT, VERSION_MISMATCH };
+	typedef NavMeshFileLoader::LoadedMesh LoadedMesh;
+	typedef NavMeshFileLoader::TileHashMap TileHashMap;
 
-	LoadResult LoadZoneMeshData(const std::shared_ptr<char>& data, DWORD length);
+	// runs on the game thread
+	bool StartLoad(bool updateTiles);
+	void FinishLoad(const std::shared_ptr<LoadedMesh>& loaded);
+	void FinishUpdate(const std::shared_ptr<LoadedMesh>& loaded);
+	void CancelLoad();
+
+	// lazy tile loading, runs on the game thread
+	void UpdateResidentTiles();
+	void EvictTiles();
 
 	std::string GetMeshDirectory() const;
 
 private:
+	// backing storage for the loaded tiles. The mesh references this memory
+	// directly, so it must outlive m_mesh (declared first, destroyed last).
+	std::shared_ptr<char> m_meshData;
+	std::unique_ptr<NavMeshFileReader> m_meshReader;
 	std::unique_ptr<dtNavMesh> m_mesh;
+	std::shared_ptr<const NavMeshLandmarks> m_landmarks;
+	std::shared_ptr<const NavMeshTileCacheData> m_tileCacheData;
+	std::shared_ptr<const NavMeshOffMeshLinks> m_offMeshLinks;
 
 	std::string m_zoneShortName;
 	DWORD m_zoneId = (DWORD)-1;
@@ -71,11 +138,22 @@ private:
 	bool m_autoLoad = true;
 	std::string m_loadedDataFile;
 	int m_loadedTiles = 0;
+	TileHashMap m_tileHashes;
+
+	// background loading. The result is picked up by Process(). The file
+	// time is taken when the load starts, so a change made while it was
+	// loading still counts as a change.
+	NavMeshFileLoader m_fileLoader;
+	FileWriteTime m_pendingFileTime = 0;
 
 	// auto reloading
 	bool m_autoReload = true;
-	FILETIME m_fileTime = { 0, 0 };
+	FileWatcher m_fileWatcher;
 
 	typedef std::chrono::high_resolution_clock clock;
-	clock::time_point m_lastUpdate = clock::now();
+
+	// lazy tile loading
+	NavMeshTileResidency m_residency{ [this]() { BeginTileChanges(); } };
+	bool m_tilesChanging = false;
+	clock::time_point m_lastTileUpdate = clock::now();
 };
@@ -0,0 +1,237 @@
+//
+// NavMeshObstacles.cpp
+//
+
+#include "NavMeshObstacles.h"
+#include "NavMeshLoader.h"
+
+#include "MQ2Plugin.h"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+
+#include <algorithm>
+#include <chrono>
+
+//----------------------------------------------------------------------------
+
+namespace {
+
+// dtTileCache queues up to 64 tiles to rebuild (MAX_UPDATE) and drops the
+// rest, and an obstacle can touch up to DT_MAX_TOUCHED_TILES of them.
+const int REQUESTS_PER_BATCH = 64 / DT_MAX_TOUCHED_TILES;
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+NavMeshObstacles::NavMeshObstacles(NavMeshLoader* loader)
+	: m_loader(loader)
+{
+	m_meshConn = loader->OnNavMeshChanged.Connect([this](dtNavMesh* navMesh)
+	{
+		// obstacles belong to a zone, forget them when the mesh goes away
+		if (!navMesh)
+		{
+			m_obstacles.clear();
+		}
+
+		Reset();
+	});
+
+	Reset();
+}
+
+NavMeshObstacles::~NavMeshObstacles()
+{
+}
+
+void NavMeshObstacles::Reset()
+{
+	m_tileCache.reset();
+	m_updating = false;
+	m_pendingAdds.clear();
+	m_pendingRemoves.clear();
+
+	m_navMesh = m_loader->GetNavMesh();
+	m_tileCacheData = m_loader->GetTileCacheData();
+
+	// rebuilt tiles need the links that were built into them in the first place
+	m_offMeshLinks = m_loader->GetOffMeshLinks();
+	m_meshProcess.SetOffMeshLinks(m_offMeshLinks.get());
+
+	m_stats.layers = m_tileCacheData ? m_tileCacheData->GetLayerCount() : 0;
+	m_stats.layerBytes = m_tileCacheData ? m_tileCacheData->GetDataSize() : 0;
+	m_stats.pending = 0;
+
+	for (auto& obstacle : m_obstacles)
+		obstacle.second.ref = 0;
+
+	if (!m_navMesh || !m_tileCacheData || m_loader->IsLazyLoading())
+		return;
+
+	m_tileCache = std::unique_ptr<dtTileCache, std::function<void(dtTileCache*)>>(
+		dtAllocTileCache(), [](dtTileCache* tc) { dtFreeTileCache(tc); });
+
+	dtStatus status = m_tileCacheData->InitTileCache(m_tileCache.get(), MAX_OBSTACLES,
+		&m_alloc, &m_compressor, &m_meshProcess);
+	if (dtStatusFailed(status))
+	{
+		DebugSpewAlways("[MQ2Nav] Failed to set up the tile cache, no dynamic obstacles (status %x)", status);
+		m_tileCache.reset();
+		return;
+	}
+
+	// the tiles from the file don't have any of the obstacles in them yet
+	for (const auto& obstacle : m_obstacles)
+		m_pendingAdds.push_back(obstacle.first);
+	m_stats.pending = static_cast<int>(m_pendingAdds.size());
+}
+
+uint32_t NavMeshObstacles::AddCylinder(const float* pos, float radius, float height)
+{
+	if (!m_tileCache || m_obstacles.size() >= MAX_OBSTACLES)
+		return 0;
+
+	uint32_t id = m_nextId++;
+	Obstacle& obstacle = m_obstacles[id];
+	obstacle.box = false;
+	dtVcopy(obstacle.pos, pos);
+	dtVset(obstacle.size, radius, height, 0);
+
+	m_pendingAdds.push_back(id);
+	m_stats.pending++;
+	return id;
+}
+
+uint32_t NavMeshObstacles::AddBox(const float* bmin, const float* bmax)
+{
+	if (!m_tileCache || m_obstacles.size() >= MAX_OBSTACLES)
+		return 0;
+
+	uint32_t id = m_nextId++;
+	Obstacle& obstacle = m_obstacles[id];
+	obstacle.box = true;
+	dtVcopy(obstacle.pos, bmin);
+	dtVmin(obstacle.pos, bmax);
+	dtVcopy(obstacle.size, bmax);
+	dtVmax(obstacle.size, bmin);
+
+	m_pendingAdds.push_back(id);
+	m_stats.pending++;
+	return id;
+}
+
+bool NavMeshObstacles::Remove(uint32_t id)
+{
+	auto iter = m_obstacles.find(id);
+	if (iter == m_obstacles.end())
+		return false;
+
+	if (iter->second.ref)
+	{
+		m_pendingRemoves.push_back(iter->second.ref);
+		m_stats.pending++;
+	}
+	else
+	{
+		// it never made it into the tile cache
+		auto pending = std::find(m_pendingAdds.begin(), m_pendingAdds.end(), id);
+		if (pending != m_pendingAdds.end())
+		{
+			m_pendingAdds.erase(pending);
+			m_stats.pending--;
+		}
+	}
+
+	m_obstacles.erase(iter);
+	return true;
+}
+
+void NavMeshObstacles::Clear()
+{
+	while (!m_obstacles.empty())
+		Remove(m_obstacles.begin()->first);
+}
+
+bool NavMeshObstacles::SubmitObstacle(Obstacle& obstacle)
+{
+	dtStatus status = obstacle.box
+		? m_tileCache->addBoxObstacle(obstacle.pos, obstacle.size, &obstacle.ref)
+		: m_tileCache->addObstacle(obstacle.pos, obstacle.size[0], obstacle.size[1], &obstacle.ref);
+
+	if (dtStatusFailed(status))
+	{
+		obstacle.ref = 0;
+		return false;
+	}
+
+	return true;
+}
+
+void NavMeshObstacles::Process()
+{
+	// the loader can swap in new layers without the tiles changing
+	if (m_loader->GetTileCacheData() != m_tileCacheData
+		|| m_loader->GetOffMeshLinks() != m_offMeshLinks)
+	{
+		Reset();
+	}
+
+	if (!m_tileCache)
+		return;
+
+	if (!m_updating)
+	{
+		// removes go first, so the obstacles they free up can be reused
+		int requests = 0;
+		while (!m_pendingRemoves.empty() && requests < REQUESTS_PER_BATCH)
+		{
+			m_tileCache->removeObstacle(m_pendingRemoves.back());
+			m_pendingRemoves.pop_back();
+			requests++;
+		}
+
+		while (!m_pendingAdds.empty() && requests < REQUESTS_PER_BATCH)
+		{
+			// an obstacle that is still being removed can fill up the tile
+			// cache for a moment. Try again with the next batch.
+			if (!SubmitObstacle(m_obstacles[m_pendingAdds.front()]))
+				break;
+
+			m_pendingAdds.pop_front();
+			requests++;
+		}
+
+		m_stats.pending = static_cast<int>(m_pendingAdds.size() + m_pendingRemoves.size());
+		m_updating = requests > 0;
+	}
+
+	if (!m_updating)
+		return;
+
+	auto start = std::chrono::steady_clock::now();
+
+	// Each update rebuilds one tile. Everything that holds on to polys is
+	// told about it once for the whole pulse.
+	m_loader->BeginTileChanges();
+
+	for (int i = 0; i < MAX_TILE_UPDATES_PER_PULSE && m_updating; ++i)
+	{
+		bool upToDate = false;
+		dtStatus status = m_tileCache->update(0, m_navMesh, &upToDate);
+		if (dtStatusFailed(status))
+		{
+			DebugSpewAlways("[MQ2Nav] Failed to rebuild a tile for dynamic obstacles (status %x)", status);
+		}
+
+		m_stats.tileUpdates++;
+		m_updating = !upToDate;
+	}
+
+	m_loader->EndTileChanges();
+
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	m_stats.lastPulseMs = elapsed.count();
+	m_stats.maxPulseMs = dtMax(m_stats.maxPulseMs, m_stats.lastPulseMs);
+}
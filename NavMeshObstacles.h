@@ -0,0 +1,108 @@
+//
+// NavMeshObstacles.h
+//
+// Dynamic obstacles (closed doors, spawns standing in the way) that are cut
+// out of the mesh at runtime. Needs a mesh that was built with tile cache
+// layers: the tiles under an obstacle are rebuilt from their layers with the
+// obstacle marked as unwalkable. Rebuilding a tile takes a while, so only a
+// few are rebuilt per pulse.
+//
+
+#pragma once
+
+#include "NavMeshTileCache.h"
+#include "Signal.h"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+class dtNavMesh;
+class NavMeshLoader;
+
+//----------------------------------------------------------------------------
+
+class NavMeshObstacles
+{
+public:
+	NavMeshObstacles(NavMeshLoader* loader);
+	~NavMeshObstacles();
+
+	// called from OnPulse, after the mesh loader. Hands queued obstacles to
+	// the tile cache and rebuilds up to MAX_TILE_UPDATES_PER_PULSE tiles.
+	void Process();
+
+	// true if the loaded mesh has layers to rebuild tiles from. Lazily loaded
+	// meshes swap tiles in and out from the file, so they can't have any.
+	bool IsAvailable() const { return m_tileCache != nullptr; }
+
+	// Add an obstacle (in detour coordinates). Returns an id for removing it,
+	// or 0 if obstacles aren't available or there are too many already.
+	uint32_t AddCylinder(const float* pos, float radius, float height);
+	uint32_t AddBox(const float* bmin, const float* bmax);
+
+	bool Remove(uint32_t id);
+	void Clear();
+
+	int GetObstacleCount() const { return static_cast<int>(m_obstacles.size()); }
+
+	struct Stats
+	{
+		int pending = 0;             // obstacle adds and removes not handed over yet
+		uint32_t tileUpdates = 0;    // calls to update the tile cache
+		float lastPulseMs = 0;       // time spent updating tiles in the last busy pulse
+		float maxPulseMs = 0;
+		size_t layerBytes = 0;       // size of the compressed layers
+		int layers = 0;
+	};
+	const Stats& GetStats() const { return m_stats; }
+
+	static const int MAX_OBSTACLES = 1024;
+
+	// each tile rebuild costs about a millisecond, and fires OnTilesChanged
+	// for everything that depends on the mesh.
+	static const int MAX_TILE_UPDATES_PER_PULSE = 4;
+
+private:
+	struct Obstacle
+	{
+		bool box = false;
+		float pos[3];        // cylinder: center of the base; box: bmin
+		float size[3];       // cylinder: radius, height; box: bmax
+
+		// 0 until it has been handed to the tile cache
+		dtObstacleRef ref = 0;
+	};
+
+	// recreate the tile cache for the current mesh, and queue up the
+	// obstacles we have again.
+	void Reset();
+	bool SubmitObstacle(Obstacle& obstacle);
+
+	NavMeshLoader* m_loader;
+	dtNavMesh* m_navMesh = nullptr;
+	std::shared_ptr<const NavMeshTileCacheData> m_tileCacheData;
+	std::shared_ptr<const NavMeshOffMeshLinks> m_offMeshLinks;
+
+	dtTileCacheAlloc m_alloc;
+	NavMeshTileCacheCompressor m_compressor;
+	NavMeshTileCacheMeshProcess m_meshProcess;
+	std::unique_ptr<dtTileCache, std::function<void(dtTileCache*)>> m_tileCache;
+
+	std::map<uint32_t, Obstacle> m_obstacles;
+	uint32_t m_nextId = 1;
+
+	// The tile cache can only take so many requests at once, and silently
+	// skips tiles once too many are waiting to be rebuilt. Requests are held
+	// here and handed over a batch at a time, once it is done with the last.
+	std::deque<uint32_t> m_pendingAdds;
+	std::vector<dtObstacleRef> m_pendingRemoves;
+	bool m_updating = false;
+
+	Stats m_stats;
+
+	Signal<dtNavMesh*>::ScopedConnection m_meshConn;
+};
@@ -0,0 +1,316 @@
+//
+// NavMeshOffMeshLinks.cpp
+//
+
+#include "NavMeshOffMeshLinks.h"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+
+#include <algorithm>
+#include <cstring>
+
+//----------------------------------------------------------------------------
+
+namespace {
+
+const char* s_actionNames[NavLinkAction_Count] = {
+	"walk",
+	"door",
+	"command",
+};
+
+struct LinksHeader
+{
+	int magic;
+	int version;
+	uint32_t nextId;
+	int numLinks;
+};
+
+// followed by dataLength bytes of action data
+struct LinkEntry
+{
+	uint32_t id;
+	float start[3];
+	float end[3];
+	float radius;
+	uint16_t flags;
+	uint8_t bidirectional;
+	uint8_t area;
+	uint8_t action;
+	uint8_t dataLength;
+	uint8_t reserved[2];
+};
+
+struct ReadCursor {
+	const char* data;
+	size_t length;
+};
+
+bool FillData(ReadCursor& cursor, void* data, size_t length)
+{
+	if (length > cursor.length)
+		return false;
+
+	memcpy(data, cursor.data, length);
+	cursor.data += length;
+	cursor.length -= length;
+	return true;
+}
+
+void AppendData(std::vector<char>& buffer, const void* data, size_t length)
+{
+	const char* bytes = static_cast<const char*>(data);
+	buffer.insert(buffer.end(), bytes, bytes + length);
+}
+
+} // namespace
+
+const char* GetLinkActionName(int action)
+{
+	if (action < 0 || action >= NavLinkAction_Count)
+		return "";
+	return s_actionNames[action];
+}
+
+//----------------------------------------------------------------------------
+
+void NavMeshOffMeshLinkSet::Clear()
+{
+	verts.clear();
+	radii.clear();
+	dirs.clear();
+	areas.clear();
+	flags.clear();
+	ids.clear();
+}
+
+void NavMeshOffMeshLinkSet::Apply(dtNavMeshCreateParams& params) const
+{
+	params.offMeshConVerts = verts.data();
+	params.offMeshConRad = radii.data();
+	params.offMeshConDir = dirs.data();
+	params.offMeshConAreas = areas.data();
+	params.offMeshConFlags = flags.data();
+	params.offMeshConUserID = ids.data();
+	params.offMeshConCount = GetCount();
+}
+
+//----------------------------------------------------------------------------
+
+uint32_t NavMeshOffMeshLinks::Add(const float* start, const float* end, float radius,
+	bool bidirectional, uint8_t area, uint16_t flags, NavMeshLinkAction action,
+	const std::string& actionData)
+{
+	NavMeshOffMeshLink link;
+	link.id = m_nextId++;
+	dtVcopy(link.start, start);
+	dtVcopy(link.end, end);
+	link.radius = radius;
+	link.bidirectional = bidirectional;
+	link.area = area;
+	link.flags = flags;
+	link.action = action;
+	link.actionData = actionData.substr(0, MAX_ACTION_DATA);
+
+	// ids only go up, so this keeps them in order
+	m_links.push_back(std::move(link));
+	AddToIndex(GetCount() - 1);
+
+	return m_links.back().id;
+}
+
+bool NavMeshOffMeshLinks::Remove(uint32_t id)
+{
+	auto iter = std::lower_bound(m_links.begin(), m_links.end(), id,
+		[](const NavMeshOffMeshLink& link, uint32_t id) { return link.id < id; });
+	if (iter == m_links.end() || iter->id != id)
+		return false;
+
+	// the indices after it all move down one
+	int index = static_cast<int>(iter - m_links.begin());
+	m_links.erase(iter);
+
+	for (std::vector<int>* sorted : { &m_byStartX, &m_byEndX })
+	{
+		sorted->erase(std::remove(sorted->begin(), sorted->end(), index), sorted->end());
+		for (int& i : *sorted)
+		{
+			if (i > index)
+				--i;
+		}
+	}
+
+	return true;
+}
+
+void NavMeshOffMeshLinks::Clear()
+{
+	m_links.clear();
+	m_byStartX.clear();
+	m_byEndX.clear();
+}
+
+const NavMeshOffMeshLink* NavMeshOffMeshLinks::FindLink(uint32_t id) const
+{
+	auto iter = std::lower_bound(m_links.begin(), m_links.end(), id,
+		[](const NavMeshOffMeshLink& link, uint32_t id) { return link.id < id; });
+	if (iter == m_links.end() || iter->id != id)
+		return nullptr;
+
+	return &*iter;
+}
+
+void NavMeshOffMeshLinks::UpdateIndex()
+{
+	m_byStartX.resize(m_links.size());
+	for (size_t i = 0; i < m_links.size(); ++i)
+		m_byStartX[i] = static_cast<int>(i);
+	m_byEndX = m_byStartX;
+
+	std::sort(m_byStartX.begin(), m_byStartX.end(),
+		[this](int a, int b) { return m_links[a].start[0] < m_links[b].start[0]; });
+	std::sort(m_byEndX.begin(), m_byEndX.end(),
+		[this](int a, int b) { return m_links[a].end[0] < m_links[b].end[0]; });
+}
+
+void NavMeshOffMeshLinks::AddToIndex(int index)
+{
+	const NavMeshOffMeshLink& link = m_links[index];
+
+	auto startPos = std::upper_bound(m_byStartX.begin(), m_byStartX.end(), link.start[0],
+		[this](float x, int i) { return x < m_links[i].start[0]; });
+	m_byStartX.insert(startPos, index);
+
+	auto endPos = std::upper_bound(m_byEndX.begin(), m_byEndX.end(), link.end[0],
+		[this](float x, int i) { return x < m_links[i].end[0]; });
+	m_byEndX.insert(endPos, index);
+}
+
+static bool InBounds(const float* pos, const float* bmin, const float* bmax)
+{
+	return pos[0] >= bmin[0] && pos[0] <= bmax[0]
+		&& pos[2] >= bmin[2] && pos[2] <= bmax[2];
+}
+
+static void AppendLink(const NavMeshOffMeshLink& link, NavMeshOffMeshLinkSet& links)
+{
+	links.verts.insert(links.verts.end(), link.start, link.start + 3);
+	links.verts.insert(links.verts.end(), link.end, link.end + 3);
+	links.radii.push_back(link.radius);
+	links.dirs.push_back(link.bidirectional ? DT_OFFMESH_CON_BIDIR : 0);
+	links.areas.push_back(link.area);
+	links.flags.push_back(link.flags);
+	links.ids.push_back(link.id);
+}
+
+void NavMeshOffMeshLinks::GetLinksInBounds(const float* bmin, const float* bmax,
+	NavMeshOffMeshLinkSet& links) const
+{
+	links.Clear();
+
+	auto iter = std::lower_bound(m_byStartX.begin(), m_byStartX.end(), bmin[0],
+		[this](int index, float x) { return m_links[index].start[0] < x; });
+
+	for (; iter != m_byStartX.end() && m_links[*iter].start[0] <= bmax[0]; ++iter)
+	{
+		if (InBounds(m_links[*iter].start, bmin, bmax))
+			AppendLink(m_links[*iter], links);
+	}
+
+	// the ones that end here, and weren't already added for starting here
+	iter = std::lower_bound(m_byEndX.begin(), m_byEndX.end(), bmin[0],
+		[this](int index, float x) { return m_links[index].end[0] < x; });
+
+	for (; iter != m_byEndX.end() && m_links[*iter].end[0] <= bmax[0]; ++iter)
+	{
+		const NavMeshOffMeshLink& link = m_links[*iter];
+		if (InBounds(link.end, bmin, bmax) && !InBounds(link.start, bmin, bmax))
+			AppendLink(link, links);
+	}
+}
+
+//----------------------------------------------------------------------------
+
+bool NavMeshOffMeshLinks::Read(const char* data, size_t size)
+{
+	Clear();
+
+	ReadCursor cursor{ data, size };
+
+	LinksHeader header;
+	if (!FillData(cursor, &header, sizeof(header)))
+		return false;
+	if (header.magic != NAVMESHLINKS_MAGIC || header.version != NAVMESHLINKS_VERSION)
+		return false;
+	if (header.numLinks < 0 || header.numLinks > static_cast<int>(cursor.length / sizeof(LinkEntry)))
+		return false;
+
+	std::vector<NavMeshOffMeshLink> links(header.numLinks);
+
+	for (int i = 0; i < header.numLinks; ++i)
+	{
+		NavMeshOffMeshLink& link = links[i];
+
+		LinkEntry entry;
+		if (!FillData(cursor, &entry, sizeof(entry)))
+			return false;
+		if (entry.action >= NavLinkAction_Count || entry.dataLength > cursor.length)
+			return false;
+
+		link.id = entry.id;
+		dtVcopy(link.start, entry.start);
+		dtVcopy(link.end, entry.end);
+		link.radius = entry.radius;
+		link.bidirectional = entry.bidirectional != 0;
+		link.area = entry.area;
+		link.flags = entry.flags;
+		link.action = static_cast<NavMeshLinkAction>(entry.action);
+		link.actionData.assign(cursor.data, entry.dataLength);
+		cursor.data += entry.dataLength;
+		cursor.length -= entry.dataLength;
+
+		// has to stay in order to look links up by id
+		if (i > 0 && links[i - 1].id >= link.id)
+			return false;
+	}
+
+	if (!links.empty() && header.nextId <= links.back().id)
+		return false;
+
+	m_links = std::move(links);
+	m_nextId = header.nextId;
+	UpdateIndex();
+	return true;
+}
+
+void NavMeshOffMeshLinks::Write(std::vector<char>& buffer) const
+{
+	buffer.clear();
+
+	LinksHeader header;
+	header.magic = NAVMESHLINKS_MAGIC;
+	header.version = NAVMESHLINKS_VERSION;
+	header.nextId = m_nextId;
+	header.numLinks = GetCount();
+	AppendData(buffer, &header, sizeof(header));
+
+	for (const NavMeshOffMeshLink& link : m_links)
+	{
+		LinkEntry entry;
+		memset(&entry, 0, sizeof(entry));
+		entry.id = link.id;
+		dtVcopy(entry.start, link.start);
+		dtVcopy(entry.end, link.end);
+		entry.radius = link.radius;
+		entry.flags = link.flags;
+		entry.bidirectional = link.bidirectional ? 1 : 0;
+		entry.area = link.area;
+		entry.action = link.action;
+		entry.dataLength = static_cast<uint8_t>(link.actionData.size());
+		AppendData(buffer, &entry, sizeof(entry));
+		AppendData(buffer, link.actionData.data(), link.actionData.size());
+	}
+}
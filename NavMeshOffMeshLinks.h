@@ -0,0 +1,123 @@
+//
+// NavMeshOffMeshLinks.h
+//
+// Off-mesh links (detour's off-mesh connections) between points that can't
+// be walked between: ledges to jump down, teleporters, clickies. Each link
+// can have an action that the plugin performs when it gets to the start of
+// it (click a door, run a command) before going on from the other end.
+// Zone lines are plain walk links, there is nothing to do but walk in.
+//
+// The links are authored in the mesh generator, built into the tiles they
+// start in, and saved in the mesh file so the plugin knows what to do with
+// them. This is shared by the plugin and the mesh generator, so it shouldn't
+// depend on either.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+static const int NAVMESHLINKS_MAGIC = 'O' << 24 | 'M' << 16 | 'L' << 8 | 'K'; //'OMLK';
+static const int NAVMESHLINKS_VERSION = 1;
+
+//----------------------------------------------------------------------------
+
+enum NavMeshLinkAction : uint8_t
+{
+	NavLinkAction_Walk = 0,    // walk (or jump) to the other end
+	NavLinkAction_Door,        // click the door (or teleporter) named in the link
+	NavLinkAction_Command,     // run the command in the link (e.g. /useitem)
+
+	NavLinkAction_Count
+};
+
+// name of an action, for the ui
+const char* GetLinkActionName(int action);
+
+struct NavMeshOffMeshLink
+{
+	uint32_t id = 0;           // detour's user id for the connection
+	float start[3];            // detour coordinates
+	float end[3];
+	float radius = 0;
+	bool bidirectional = false;
+	uint8_t area = 0;
+	uint16_t flags = 0;
+
+	NavMeshLinkAction action = NavLinkAction_Walk;
+
+	// door name or command, depending on the action
+	std::string actionData;
+};
+
+// The links that start in one tile, laid out the way dtNavMeshCreateParams
+// wants them.
+struct NavMeshOffMeshLinkSet
+{
+	std::vector<float> verts;
+	std::vector<float> radii;
+	std::vector<unsigned char> dirs;
+	std::vector<unsigned char> areas;
+	std::vector<unsigned short> flags;
+	std::vector<unsigned int> ids;
+
+	int GetCount() const { return static_cast<int>(ids.size()); }
+	void Clear();
+
+	// point the off-mesh connection params at these
+	void Apply(struct dtNavMeshCreateParams& params) const;
+};
+
+//----------------------------------------------------------------------------
+
+class NavMeshOffMeshLinks
+{
+public:
+	// Add a link and return its id. Ids aren't reused, so the plugin can
+	// keep track of links by them.
+	uint32_t Add(const float* start, const float* end, float radius, bool bidirectional,
+		uint8_t area, uint16_t flags, NavMeshLinkAction action = NavLinkAction_Walk,
+		const std::string& actionData = std::string());
+
+	bool Remove(uint32_t id);
+	void Clear();
+
+	bool IsEmpty() const { return m_links.empty(); }
+	int GetCount() const { return static_cast<int>(m_links.size()); }
+	const NavMeshOffMeshLink& GetLink(int index) const { return m_links[index]; }
+
+	// the link with the given id, or null
+	const NavMeshOffMeshLink* FindLink(uint32_t id) const;
+
+	// Collect the links that start or end within the xz bounds of a tile.
+	// Detour stores a connection in the tile it starts in, but the tile it
+	// ends in needs room for the link back. This looks at just the links in
+	// that stretch of x, rather than every link for every tile.
+	void GetLinksInBounds(const float* bmin, const float* bmax, NavMeshOffMeshLinkSet& links) const;
+
+	// Read from or write to a mesh file section (SECTION_OFFMESHLINKS).
+	bool Read(const char* data, size_t size);
+	void Write(std::vector<char>& buffer) const;
+
+	// ids of the links built into tiles start here
+	static const uint32_t FIRST_LINK_ID = 1000;
+
+	// longest action data that is saved
+	static const int MAX_ACTION_DATA = 255;
+
+private:
+	void UpdateIndex();
+	void AddToIndex(int index);
+
+	// in order of id
+	std::vector<NavMeshOffMeshLink> m_links;
+
+	// indices of m_links in order of start x, and of end x
+	std::vector<int> m_byStartX;
+	std::vector<int> m_byEndX;
+
+	uint32_t m_nextId = FIRST_LINK_ID;
+};
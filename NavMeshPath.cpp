@@ -0,0 +1,1013 @@
+//
+// NavMeshPath.cpp
+//
+
+#include "NavMeshPath.h"
+#include "NavMeshClusterGraph.h"
+#include "NavMeshFilter.h"
+#include "NavMeshLandmarks.h"
+#include "NavMeshPolyIndex.h"
+#include "NavMeshQueryPool.h"
+
+#include "DetourNavMesh.h"
+#include "DetourCommon.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdarg>
+#include <cstdio>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// Scratch space for path searches. These are too big to put on the stack,
+// so each thread gets one set that is reused from one search to the next.
+struct PathScratch
+{
+	std::vector<dtPolyRef> polys;
+	std::vector<float> straightPath;
+	std::vector<unsigned char> straightPathFlags;
+	std::vector<dtPolyRef> straightPathRefs;
+
+	PathScratch()
+		: polys(NavMeshPath::MAX_POLYS)
+		, straightPath(NavMeshPath::MAX_POLYS * 3)
+		, straightPathFlags(NavMeshPath::MAX_POLYS)
+		, straightPathRefs(NavMeshPath::MAX_POLYS)
+	{
+	}
+};
+
+PathScratch& GetPathScratch()
+{
+	thread_local PathScratch scratch;
+	return scratch;
+}
+
+// Where a search crosses from one poly into its neighbor: the middle of the
+// shared part of their edge, or the end of an off-mesh connection.
+bool GetLinkPoint(const dtMeshTile* tile, const dtPoly* poly, const dtLink& link,
+	dtPolyRef fromRef, const dtMeshTile* toTile, const dtPoly* toPoly, float* pos)
+{
+	if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		dtVcopy(pos, &tile->verts[poly->verts[link.edge] * 3]);
+		return true;
+	}
+
+	if (toPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		for (unsigned int l = toPoly->firstLink; l != DT_NULL_LINK; l = toTile->links[l].next)
+		{
+			if (toTile->links[l].ref == fromRef)
+			{
+				dtVcopy(pos, &toTile->verts[toPoly->verts[toTile->links[l].edge] * 3]);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	const float* va = &tile->verts[poly->verts[link.edge] * 3];
+	const float* vb = &tile->verts[poly->verts[(link.edge + 1) % poly->vertCount] * 3];
+
+	// links between tiles might only cover part of the edge
+	float t = 0.5f;
+	if (link.side != 0xff)
+		t = (link.bmin + link.bmax) * 0.5f / 255.0f;
+	dtVlerp(pos, va, vb, t);
+
+	return true;
+}
+
+} // namespace
+
+NavMeshPath::NavMeshPath(NavMeshQueryPool* queryPool)
+	: m_navMesh(queryPool->GetNavMesh())
+	, m_queryPool(queryPool)
+{
+	SetFilter(NavigationFilter());
+}
+
+NavMeshPath::~NavMeshPath()
+{
+}
+
+void NavMeshPath::Message(bool important, const char* format, ...)
+{
+	char message[512];
+
+	va_list args;
+	va_start(args, format);
+	vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+
+	OnMessage(important, message);
+}
+
+//----------------------------------------------------------------------------
+
+void NavMeshPath::SetLandmarks(std::shared_ptr<const NavMeshLandmarks> landmarks)
+{
+	m_landmarks = landmarks;
+
+	if (m_query)
+		m_query->setHeuristic(nullptr);
+	m_heuristic.reset();
+
+	if (m_landmarks && !m_landmarks->IsEmpty())
+	{
+		m_heuristic.reset(new NavMeshLandmarkHeuristic(m_landmarks.get(), m_navMesh));
+		if (m_query)
+			m_query->setHeuristic(m_heuristic.get());
+	}
+}
+
+void NavMeshPath::SetFilter(const NavigationFilter& filter)
+{
+	m_navFilter = filter;
+	m_navFilter.Apply(m_filter);
+
+	// the path we have might go through polys that aren't allowed anymore
+	CancelSearch();
+	m_needsReplan = true;
+}
+
+bool NavMeshPath::FindPath(const glm::vec3& pos)
+{
+	if (nullptr != m_navMesh)
+	{
+		// WriteChatf("MQ2Navigation::FindPath - %.1f %.1f %.1f", X, Y, Z);
+		FindPathInternal(pos);
+
+		if (m_currentPathSize > 0)
+		{
+			// DebugSpewAlways("FindPath - cursor = %d, size = %d", m_currentPathCursor , m_currentPathSize);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool NavMeshPath::AcquireQuery()
+{
+	if (m_query)
+		return true;
+
+	m_query = m_queryPool->Acquire();
+	if (!m_query)
+		return false;
+
+	// use the landmark tables to guide the search, if we have them
+	if (m_heuristic)
+		m_query->setHeuristic(m_heuristic.get());
+
+	return true;
+}
+
+bool NavMeshPath::FindEndpoints(const glm::vec3& pos, dtPolyRef& startRef, dtPolyRef& endRef)
+{
+	startRef = 0;
+	endRef = 0;
+
+	if (nullptr == m_navMesh)
+		return false;
+
+	if (!AcquireQuery())
+		return false;
+
+	glm::vec3 me;
+	if (!GetStartPosition(me))
+		return false;
+
+	float startOffset[3] = { me.x, me.z, me.y };
+	float endOffset[3] = { pos.x, pos.z, pos.y };
+
+	startRef = FindNearestPoly(startOffset, m_searchStartRef, m_searchStart);
+	endRef = FindNearestPoly(endOffset, m_searchEndRef, m_searchEnd);
+
+	// FollowPolys starts from here
+	m_searchStartRef = startRef;
+	m_searchEndRef = endRef;
+	m_destination = pos;
+
+	return startRef != 0 && endRef != 0;
+}
+
+bool NavMeshPath::FollowPolys(const glm::vec3& pos, const dtPolyRef* polys, int count, bool partial)
+{
+	if (nullptr == m_navMesh || !m_query || count <= 0)
+		return false;
+
+	if (m_destination != pos || polys[0] != m_searchStartRef)
+		return false;
+
+	CancelSearch();
+	m_needsReplan = false;
+
+	return SetupCorridor(polys, count, partial);
+}
+
+dtPolyRef NavMeshPath::FindNearestPoly(const float* pos, dtPolyRef hint, float* nearest)
+{
+	if (m_polyIndex && m_polyIndex->IsValid())
+		return m_polyIndex->FindNearestPoly(m_query.get(), pos, m_extents, m_filter, nearest, hint);
+
+	dtPolyRef ref = 0;
+	m_query->findNearestPoly(pos, m_extents, &m_filter, &ref, nearest);
+	return ref;
+}
+
+bool NavMeshPath::MayReach(dtPolyRef startRef, dtPolyRef endRef) const
+{
+	// Not when tiles are loaded lazily, the graph doesn't know about the
+	// tiles that aren't resident. Two parts of the mesh may just be joined
+	// by tiles that aren't loaded yet.
+	if (!m_clusterGraph || !m_clusterGraph->IsValid() || IsLazyLoading())
+		return true;
+
+	return m_clusterGraph->MayBeConnected(startRef, endRef);
+}
+
+float NavMeshPath::GetPathLength() const
+{
+	float result = 0;
+
+	for (int i = 0; i < m_currentPathSize - 1; ++i)
+	{
+		result += dtVdist(GetRawPosition(i), GetRawPosition(i + 1));
+	}
+
+	return result;
+}
+
+int NavMeshPath::FindPathLengths(const glm::vec3* destinations, int count, float* lengths,
+	float maxCost)
+{
+	std::fill(lengths, lengths + count, -1.0f);
+
+	if (nullptr == m_navMesh || count <= 0)
+		return 0;
+
+	if (!AcquireQuery())
+		return 0;
+
+	glm::vec3 me;
+	if (!GetStartPosition(me))
+		return 0;
+
+	float startOffset[3] = { me.x, me.z, me.y };
+
+	float startPos[3];
+	dtPolyRef startRef = FindNearestPoly(startOffset, m_searchStartRef, startPos);
+	if (!startRef)
+		return 0;
+
+	// the polys the destinations are on
+	std::vector<dtPolyRef> endRefs(count, 0);
+	std::vector<float> endPositions(count * 3);
+	std::unordered_set<dtPolyRef> unsettled;
+
+	for (int i = 0; i < count; ++i)
+	{
+		float endOffset[3] = { destinations[i].x, destinations[i].z, destinations[i].y };
+
+		float line[6] = { startOffset[0], startOffset[1], startOffset[2],
+			endOffset[0], endOffset[1], endOffset[2] };
+		RequestTiles(line, 2);
+
+		endRefs[i] = FindNearestPoly(endOffset, 0, &endPositions[i * 3]);
+
+		// don't wait for ones that we can't reach, or we'd search everything
+		// that we can.
+		if (!MayReach(startRef, endRefs[i]))
+			endRefs[i] = 0;
+
+		if (endRefs[i])
+			unsettled.insert(endRefs[i]);
+	}
+
+	// Dijkstra out from the start until every destination poly is settled,
+	// or we go past the cost limit. Costs are measured between edge
+	// midpoints, the same as findPath.
+	struct SearchNode
+	{
+		dtPolyRef ref;
+		int parent;
+		float cost;
+		float pos[3];
+		bool closed;
+	};
+	std::vector<SearchNode> nodes;
+	std::unordered_map<dtPolyRef, int> nodeIndex;
+
+	typedef std::pair<float, int> OpenNode;
+	std::priority_queue<OpenNode, std::vector<OpenNode>, std::greater<OpenNode>> open;
+
+	SearchNode startNode = { startRef, -1, 0.0f, { startPos[0], startPos[1], startPos[2] }, false };
+	nodes.push_back(startNode);
+	nodeIndex[startRef] = 0;
+	open.push(OpenNode(0.0f, 0));
+
+	while (!open.empty() && !unsettled.empty())
+	{
+		int index = open.top().second;
+		open.pop();
+
+		if (nodes[index].closed)
+			continue;
+		nodes[index].closed = true;
+
+		// copy it, adding neighbors can move the nodes around
+		SearchNode node = nodes[index];
+		if (maxCost > 0 && node.cost > maxCost)
+			break;
+
+		unsettled.erase(node.ref);
+
+		const dtMeshTile* tile = nullptr;
+		const dtPoly* poly = nullptr;
+		m_navMesh->getTileAndPolyByRefUnsafe(node.ref, &tile, &poly);
+
+		dtPolyRef parentRef = node.parent >= 0 ? nodes[node.parent].ref : 0;
+
+		for (unsigned int l = poly->firstLink; l != DT_NULL_LINK; l = tile->links[l].next)
+		{
+			const dtLink& link = tile->links[l];
+			dtPolyRef neighborRef = link.ref;
+			if (!neighborRef || neighborRef == parentRef)
+				continue;
+
+			const dtMeshTile* neighborTile = nullptr;
+			const dtPoly* neighborPoly = nullptr;
+			m_navMesh->getTileAndPolyByRefUnsafe(neighborRef, &neighborTile, &neighborPoly);
+
+			if (!PassFilter(m_filter, neighborPoly))
+				continue;
+
+			float pos[3];
+			if (!GetLinkPoint(tile, poly, link, node.ref, neighborTile, neighborPoly, pos))
+				continue;
+
+			float cost = node.cost + GetCost(m_filter, node.pos, pos, poly);
+
+			auto iter = nodeIndex.find(neighborRef);
+			if (iter == nodeIndex.end())
+			{
+				if (static_cast<int>(nodes.size()) >= MAX_NODES)
+					continue;
+
+				SearchNode neighbor = { neighborRef, index, cost, { pos[0], pos[1], pos[2] }, false };
+				nodeIndex[neighborRef] = static_cast<int>(nodes.size());
+				open.push(OpenNode(cost, static_cast<int>(nodes.size())));
+				nodes.push_back(neighbor);
+			}
+			else
+			{
+				SearchNode& neighbor = nodes[iter->second];
+				if (neighbor.closed || cost >= neighbor.cost)
+					continue;
+
+				neighbor.parent = index;
+				neighbor.cost = cost;
+				dtVcopy(neighbor.pos, pos);
+				open.push(OpenNode(cost, iter->second));
+			}
+		}
+	}
+
+	// walk back from each destination and measure its straight path
+	PathScratch& scratch = GetPathScratch();
+	std::vector<dtPolyRef> polys;
+	int reached = 0;
+
+	for (int i = 0; i < count; ++i)
+	{
+		auto iter = nodeIndex.find(endRefs[i]);
+		if (!endRefs[i] || iter == nodeIndex.end() || !nodes[iter->second].closed)
+			continue;
+		if (maxCost > 0 && nodes[iter->second].cost > maxCost)
+			continue;
+
+		polys.clear();
+		for (int index = iter->second; index != -1; index = nodes[index].parent)
+			polys.push_back(nodes[index].ref);
+		std::reverse(polys.begin(), polys.end());
+
+		int numPoints = 0;
+		m_query->findStraightPath(startPos, &endPositions[i * 3], polys.data(),
+			static_cast<int>(polys.size()), scratch.straightPath.data(), nullptr, nullptr,
+			&numPoints, MAX_POLYS);
+
+		float length = 0;
+		for (int p = 0; p < numPoints - 1; ++p)
+			length += dtVdist(&scratch.straightPath[p * 3], &scratch.straightPath[p * 3 + 3]);
+
+		lengths[i] = length;
+		++reached;
+	}
+
+	return reached;
+}
+
+void NavMeshPath::FindPathInternal(const glm::vec3& pos)
+{
+	if (nullptr == m_navMesh)
+		return;
+
+	m_currentPathCursor = 0;
+	m_currentPathSize = 0;
+	m_destination = pos;
+
+	AcquireQuery();
+
+	m_needsReplan = true;
+	UpdatePath();
+}
+
+void NavMeshPath::UpdatePath()
+{
+	if (m_navMesh == nullptr)
+		return;
+	if (m_query == nullptr)
+		return;
+
+	glm::vec3 me;
+	if (!GetStartPosition(me))
+		return;
+
+	float startOffset[3] = { me.x, me.z, me.y };
+
+	glm::vec3 thisPos(startOffset[0], startOffset[1], startOffset[2]);
+
+	if (!m_needsReplan && thisPos == m_lastPos)
+		return;
+	m_lastPos = thisPos;
+
+	m_currentPathCursor = 0;
+
+	// Follow the corridor we already have if we can. This keeps us moving
+	// along the last good path while a new search is in progress.
+	bool following = m_corridor && UpdateCorridor(startOffset);
+	if (!following)
+	{
+		m_currentPathSize = 0;
+		m_currentPath.clear();
+		m_needsReplan = true;
+	}
+
+	if (m_needsReplan && !m_searching)
+	{
+		if (!StartSearch(startOffset) && !following)
+			return;
+	}
+
+	if (m_searching)
+	{
+		// finishing the search updates the path
+		if (ContinueSearch())
+			return;
+	}
+
+	if (following)
+	{
+		// if the corridor went stale, search again on the next update
+		if (!UpdateStraightPath())
+			m_needsReplan = true;
+	}
+
+	OnPathChanged();
+}
+
+bool NavMeshPath::StartSearch(const float* startOffset)
+{
+	float endOffset[3] = { m_destination.x, m_destination.z, m_destination.y };
+
+	m_needsReplan = false;
+
+	// with lazy tile loading, make sure the tiles between here and the
+	// destination are loaded before searching.
+	float line[6] = { startOffset[0], startOffset[1], startOffset[2],
+		endOffset[0], endOffset[1], endOffset[2] };
+	RequestTiles(line, 2);
+
+	// start from where we were the last time we searched, or from where we
+	// are along the corridor
+	dtPolyRef startHint = m_corridor ? m_corridor->getFirstPoly() : m_searchStartRef;
+	m_searchStartRef = FindNearestPoly(startOffset, startHint, m_searchStart);
+
+	if (!m_searchStartRef)
+	{
+		Message(true, "No start reference");
+		return false;
+	}
+
+	m_searchEndRef = FindNearestPoly(endOffset, m_searchEndRef, m_searchEnd);
+
+	if (!m_searchEndRef)
+	{
+		Message(true, "No end reference");
+		return false;
+	}
+
+	// Long routes are planned across the tile clusters first, and then
+	// searched a few clusters at a time. A single search over the whole
+	// route would run out of nodes.
+	m_route.clear();
+	m_routeIndex = 0;
+	m_searchPolys.clear();
+
+	if (m_clusterGraph && m_clusterGraph->IsValid())
+	{
+		m_clusterGraph->FindRoute(m_searchStartRef, m_searchStart, m_searchEndRef, m_searchEnd, m_route);
+
+		if (static_cast<int>(m_route.size()) < HIERARCHICAL_MIN_CROSSINGS)
+			m_route.clear();
+	}
+
+	m_stats.lastRouteSize = static_cast<int>(m_route.size());
+
+	if (!StartSegment(m_searchStartRef, m_searchStart))
+		return false;
+
+	m_searching = true;
+	m_stats.searchIterations = 0;
+	m_stats.searchPulses = 0;
+
+	return true;
+}
+
+bool NavMeshPath::StartSegment(dtPolyRef startRef, const float* startPos)
+{
+	dtPolyRef endRef = m_searchEndRef;
+	const float* endPos = m_searchEnd;
+
+	// the last segment goes to the destination, the rest stop at a tile
+	// border a few clusters along the route.
+	size_t firstCrossing = m_routeIndex;
+	m_finalSegment = m_routeIndex >= m_route.size();
+	if (!m_finalSegment)
+	{
+		m_routeIndex = std::min(m_routeIndex + CLUSTERS_PER_SEGMENT, m_route.size());
+
+		const NavMeshClusterGraph::Crossing& crossing = m_route[m_routeIndex - 1];
+		endRef = crossing.fromRef;
+		endPos = crossing.pos;
+	}
+
+	m_segmentEndRef = endRef;
+
+	// Keep the search to the clusters that this piece of the route goes
+	// through. Otherwise it only aims at the border crossing, and will go
+	// anywhere on the mesh that looks like a way to get there.
+	const dtQueryFilter* filter = &m_filter;
+
+	if (!m_route.empty() && m_clusterGraph && m_clusterGraph->IsValid())
+	{
+		std::vector<int> clusters;
+		clusters.push_back(m_clusterGraph->GetClusterIndex(startRef));
+		clusters.push_back(m_clusterGraph->GetClusterIndex(endRef));
+
+		// the far side of the last crossing is where the next segment starts
+		for (size_t i = firstCrossing; i < m_routeIndex; ++i)
+		{
+			clusters.push_back(m_clusterGraph->GetClusterIndex(m_route[i].fromRef));
+			if (i + 1 < m_routeIndex)
+				clusters.push_back(m_clusterGraph->GetClusterIndex(m_route[i].toRef));
+		}
+
+		m_segmentFilter.SetClusters(m_clusterGraph, clusters);
+		filter = &m_segmentFilter;
+	}
+
+	dtStatus status = m_query->initSlicedFindPath(startRef, endRef, startPos, endPos, filter);
+	m_segmentOpen = !dtStatusFailed(status);
+	return m_segmentOpen;
+}
+
+bool NavMeshPath::NextSegment()
+{
+	PathScratch& scratch = GetPathScratch();
+	dtPolyRef* polys = scratch.polys.data();
+	int numPolys = 0;
+
+	m_segmentOpen = false;
+	dtStatus status = m_query->finalizeSlicedFindPath(polys, &numPolys, MAX_POLYS);
+
+	if (dtStatusFailed(status) || numPolys == 0 || polys[numPolys - 1] != m_segmentEndRef)
+	{
+		// The clusters are connected, but not in a way this filter can use
+		// (or not the way the graph assumed). Search the whole way instead.
+		Message(false, "Segment %d of cluster route failed, searching without it",
+			static_cast<int>(m_routeIndex));
+
+		m_route.clear();
+		m_routeIndex = 0;
+		m_searchPolys.clear();
+
+		return StartSegment(m_searchStartRef, m_searchStart);
+	}
+
+	if (m_searchPolys.size() + numPolys > MAX_POLYS)
+	{
+		// too long to follow all at once. Partial paths are searched again
+		// as we go.
+		m_searchPolys.insert(m_searchPolys.end(), polys, polys + (MAX_POLYS - m_searchPolys.size()));
+		return false;
+	}
+
+	m_searchPolys.insert(m_searchPolys.end(), polys, polys + numPolys);
+
+	// pick up on the other side of the border
+	const NavMeshClusterGraph::Crossing& crossing = m_route[m_routeIndex - 1];
+	return StartSegment(crossing.toRef, crossing.pos);
+}
+
+bool NavMeshPath::ContinueSearch()
+{
+	if (!m_searching)
+		return false;
+
+	// run the search in small steps until it finishes or we run out of time
+	// for this pulse. No budget means run it to completion.
+	clock::time_point start = clock::now();
+	std::chrono::microseconds budget(m_searchBudget);
+
+	dtStatus status;
+	int iterations = 0;
+
+	for (;;)
+	{
+		int doneIters = 0;
+		status = m_query->updateSlicedFindPath(SEARCH_ITERATIONS_PER_STEP, &doneIters);
+		iterations += doneIters;
+
+		// on to the next part of a long route
+		if (!dtStatusInProgress(status) && !m_finalSegment && NextSegment())
+			status = DT_IN_PROGRESS;
+
+		if (!dtStatusInProgress(status)
+			|| (m_searchBudget > 0 && clock::now() - start >= budget))
+			break;
+	}
+
+	m_stats.searchIterations += iterations;
+	m_stats.searchPulses++;
+	m_stats.totalSearchIterations += iterations;
+
+	if (dtStatusInProgress(status))
+		return false;
+
+	FinishSearch();
+	return true;
+}
+
+void NavMeshPath::FinishSearch()
+{
+	m_searching = false;
+
+	PathScratch& scratch = GetPathScratch();
+	dtPolyRef* polys = scratch.polys.data();
+	int numPolys = 0;
+
+	// If NextSegment already finalized the last segment (the route got too
+	// long, or the next segment couldn't be started), all there is to go on
+	// is what was collected from the segments before it.
+	dtStatus status = DT_FAILURE;
+	if (m_segmentOpen)
+	{
+		m_segmentOpen = false;
+		status = m_query->finalizeSlicedFindPath(polys, &numPolys, MAX_POLYS);
+	}
+
+	if (status & DT_OUT_OF_NODES)
+		Message(false, "findPath from %.2f,%.2f,%.2f to %.2f,%.2f,%.2f failed: out of nodes",
+			m_searchStart[0], m_searchStart[1], m_searchStart[2],
+			m_searchEnd[0], m_searchEnd[1], m_searchEnd[2]);
+	if (status & DT_PARTIAL_RESULT)
+		Message(false, "findPath from %.2f,%.2f,%.2f to %.2f,%.2f,%.2f returned a partial result.",
+			m_searchStart[0], m_searchStart[1], m_searchStart[2],
+			m_searchEnd[0], m_searchEnd[1], m_searchEnd[2]);
+
+	// stitch it on to the end of the segments that were already searched
+	if (!m_searchPolys.empty())
+	{
+		int count = std::min(numPolys, MAX_POLYS - static_cast<int>(m_searchPolys.size()));
+		if (count > 0)
+			m_searchPolys.insert(m_searchPolys.end(), polys, polys + count);
+
+		polys = m_searchPolys.data();
+		numPolys = static_cast<int>(m_searchPolys.size());
+
+		if (dtStatusFailed(status))
+			status = DT_SUCCESS | DT_PARTIAL_RESULT;
+	}
+
+	m_stats.lastSearchIterations = m_stats.searchIterations;
+	m_stats.lastSearchPulses = m_stats.searchPulses;
+
+	// nothing to follow without a valid poly at both ends
+	if (!dtStatusFailed(status) && numPolys > 0
+		&& (!m_navMesh->isValidPolyRef(polys[0]) || !m_navMesh->isValidPolyRef(polys[numPolys - 1])))
+	{
+		Message(false, "findPath from %.2f,%.2f,%.2f to %.2f,%.2f,%.2f returned an invalid poly, dropping the path",
+			m_searchStart[0], m_searchStart[1], m_searchStart[2],
+			m_searchEnd[0], m_searchEnd[1], m_searchEnd[2]);
+		status = DT_FAILURE;
+	}
+
+	if (dtStatusFailed(status) || numPolys == 0)
+	{
+		m_corridor.reset();
+		m_corridorCapacity = 0;
+		m_currentPathSize = 0;
+		m_currentPath.clear();
+		m_plannedPolys.clear();
+	}
+	else
+	{
+		SetupCorridor(polys, numPolys, (status & DT_PARTIAL_RESULT) != 0);
+	}
+
+	OnPathChanged();
+}
+
+bool NavMeshPath::SetupCorridor(const dtPolyRef* polys, int numPolys, bool partial)
+{
+	// kept for the TLO's path cache
+	m_plannedPolys.assign(polys, polys + numPolys);
+
+	// Leave some room for the corridor to grow as we move, but don't
+	// hold on to a full MAX_POLYS corridor for short paths.
+	int capacity = std::min(numPolys * 2 + 32, static_cast<int>(MAX_POLYS));
+	if (!m_corridor || m_corridorCapacity < capacity)
+	{
+		m_corridor.reset(new dtPathCorridor);
+		m_corridorCapacity = m_corridor->init(capacity) ? capacity : 0;
+	}
+
+	if (m_corridorCapacity == 0)
+	{
+		m_corridor.reset();
+		m_currentPathSize = 0;
+		m_currentPath.clear();
+		return false;
+	}
+
+	m_corridor->reset(m_searchStartRef, m_searchStart);
+	m_corridor->setCorridor(m_searchEnd, polys, numPolys);
+
+	m_partialPath = partial || polys[numPolys - 1] != m_searchEndRef;
+	m_lastReplan = GetTime();
+	m_lastTopologyUpdate = m_lastReplan;
+	m_stats.replans++;
+
+	// the search started from where we were a few pulses ago, catch
+	// up with where we are now.
+	glm::vec3 me;
+	if (GetStartPosition(me))
+	{
+		float pos[3] = { me.x, me.z, me.y };
+		m_corridor->movePosition(pos, m_query.get(), &m_filter);
+	}
+
+	m_currentPathCursor = 0;
+	if (!UpdateStraightPath(true))
+	{
+		m_corridor.reset();
+		return false;
+	}
+
+	return true;
+}
+
+void NavMeshPath::CancelSearch()
+{
+	if (m_searching)
+	{
+		// the search state is thrown away by the next initSlicedFindPath
+		m_searching = false;
+		m_segmentOpen = false;
+		m_needsReplan = true;
+	}
+}
+
+bool NavMeshPath::MoveOverOffMeshLink(dtPolyRef ref)
+{
+	// a search in progress started before the link, it'd only bring us back
+	CancelSearch();
+
+	dtPolyRef refs[2];
+	float startPos[3], endPos[3];
+	if (m_corridor && m_query
+		&& m_corridor->moveOverOffmeshConnection(ref, refs, startPos, endPos, m_query.get()))
+	{
+		return true;
+	}
+
+	m_needsReplan = true;
+	return false;
+}
+
+bool NavMeshPath::UpdateCorridor(const float* pos)
+{
+	if (!m_corridor || m_corridor->getPathCount() == 0)
+		return false;
+
+	// the polys just ahead of us went away (tiles were reloaded or evicted)
+	if (!m_corridor->isValid(CORRIDOR_LOOKAHEAD, m_query.get(), &m_filter))
+		return false;
+
+	if (!m_corridor->movePosition(pos, m_query.get(), &m_filter))
+		return false;
+
+	// moving along the surface didn't get us there. We were moved by
+	// something other than walking (knockback, teleport, fell off a ledge).
+	if (dtVdist2DSqr(m_corridor->getPos(), pos) > dtSqr(CORRIDOR_MAX_DEVIATION))
+		return false;
+
+	clock::time_point now = GetTime();
+
+	// a partial path ends short of the destination. Try again every so
+	// often, the rest of the way might be loaded by now. Keep following
+	// this one in the meantime.
+	if (m_partialPath && !m_searching && now - m_lastReplan > std::chrono::milliseconds(PARTIAL_REPLAN_MS))
+		m_needsReplan = true;
+
+	// shortcut to the furthest corner that we can see, and occasionally look
+	// for a shorter way around nearby polys. Both are bounded in cost.
+	float corners[MAX_OPTIMIZE_CORNERS * 3];
+	unsigned char cornerFlags[MAX_OPTIMIZE_CORNERS];
+	dtPolyRef cornerPolys[MAX_OPTIMIZE_CORNERS];
+
+	int numCorners = m_corridor->findCorners(corners, cornerFlags, cornerPolys,
+		MAX_OPTIMIZE_CORNERS, m_query.get(), &m_filter);
+	if (numCorners > 0)
+	{
+		m_corridor->optimizePathVisibility(&corners[(numCorners - 1) * 3],
+			CORRIDOR_OPTIMIZE_RANGE, m_query.get(), &m_filter);
+	}
+
+	// this runs its own small sliced search, which would clobber ours
+	if (!m_searching && now - m_lastTopologyUpdate > std::chrono::milliseconds(TOPOLOGY_OPTIMIZE_MS))
+	{
+		m_corridor->optimizePathTopology(m_query.get(), &m_filter);
+		m_lastTopologyUpdate = now;
+	}
+
+	m_stats.corridorUpdates++;
+	return true;
+}
+
+bool NavMeshPath::UpdateStraightPath(bool planned)
+{
+	PathScratch& scratch = GetPathScratch();
+
+	m_currentPathSize = 0;
+
+	dtStatus status = m_query->findStraightPath(m_corridor->getPos(), m_corridor->getTarget(),
+		m_corridor->getPath(), m_corridor->getPathCount(), scratch.straightPath.data(),
+		scratch.straightPathFlags.data(), scratch.straightPathRefs.data(),
+		&m_currentPathSize, MAX_POLYS, 0);
+	if (dtStatusFailed(status))
+	{
+		m_currentPathSize = 0;
+		m_currentPath.clear();
+		return false;
+	}
+
+	m_stats.lastPathCorners = m_currentPathSize;
+
+	// The raycasts are only paid for once per search. After that, the same
+	// corners are dropped again as the path is rebuilt from the corridor.
+	if (planned)
+	{
+		m_stats.shortcutCorners = 0;
+		m_skippedCorners.clear();
+
+		if (m_shortcutPaths)
+		{
+			m_currentPathSize = ShortcutPath(scratch.straightPath.data(),
+				scratch.straightPathFlags.data(), scratch.straightPathRefs.data(), m_currentPathSize);
+		}
+	}
+	else if (!m_skippedCorners.empty())
+	{
+		m_currentPathSize = SkipCorners(scratch.straightPath.data(),
+			scratch.straightPathFlags.data(), scratch.straightPathRefs.data(), m_currentPathSize);
+	}
+
+	// keep only as much as the path needs. Replanning reuses the
+	// capacity, so this doesn't allocate once the path has settled.
+	m_currentPath.assign(scratch.straightPath.begin(),
+		scratch.straightPath.begin() + m_currentPathSize * 3);
+	m_currentPathFlags.assign(scratch.straightPathFlags.begin(),
+		scratch.straightPathFlags.begin() + m_currentPathSize);
+	m_currentPathRefs.assign(scratch.straightPathRefs.begin(),
+		scratch.straightPathRefs.begin() + m_currentPathSize);
+
+	// keep the tiles that the path goes through loaded
+	RequestTiles(m_currentPath.data(), m_currentPathSize);
+
+	return true;
+}
+
+int NavMeshPath::ShortcutPath(float* path, unsigned char* flags, dtPolyRef* refs, int count)
+{
+	// Corners are only dropped near the front of the path, to bound the
+	// cost of a search. Long paths are searched again as we go (partial
+	// paths, stale corridors), which looks at the next stretch.
+	int limit = std::min(count, SHORTCUT_CORNERS);
+
+	// the start is always kept. anchor is the last corner that was kept.
+	int kept = 1;
+	int anchor = 0;
+
+	for (int i = 1; i < count; ++i)
+	{
+		bool keep = i >= limit - 1
+			// both ends of an off-mesh connection have to be walked to
+			|| (flags[i] & DT_STRAIGHTPATH_OFFMESH_CONNECTION) != 0
+			|| (flags[anchor] & DT_STRAIGHTPATH_OFFMESH_CONNECTION) != 0
+			|| !CanWalkStraight(refs[anchor], &path[anchor * 3], &path[(i + 1) * 3]);
+
+		if (keep)
+		{
+			if (kept != i)
+			{
+				dtVcopy(&path[kept * 3], &path[i * 3]);
+				flags[kept] = flags[i];
+				refs[kept] = refs[i];
+			}
+
+			anchor = kept++;
+		}
+		else
+		{
+			m_skippedCorners.emplace_back(path[i * 3], path[i * 3 + 1], path[i * 3 + 2]);
+		}
+	}
+
+	m_stats.shortcutCorners = count - kept;
+	return kept;
+}
+
+int NavMeshPath::SkipCorners(float* path, unsigned char* flags, dtPolyRef* refs, int count) const
+{
+	// Corners are portal vertices, so a corner that is still in the path
+	// comes back with exactly the same position. The ends are always kept.
+	int kept = 1;
+
+	for (int i = 1; i < count; ++i)
+	{
+		glm::vec3 corner(path[i * 3], path[i * 3 + 1], path[i * 3 + 2]);
+
+		bool skip = i < count - 1
+			&& (flags[i] & DT_STRAIGHTPATH_OFFMESH_CONNECTION) == 0
+			&& std::find(m_skippedCorners.begin(), m_skippedCorners.end(), corner) != m_skippedCorners.end();
+		if (skip)
+			continue;
+
+		if (kept != i)
+		{
+			dtVcopy(&path[kept * 3], &path[i * 3]);
+			flags[kept] = flags[i];
+			refs[kept] = refs[i];
+		}
+		kept++;
+	}
+
+	return kept;
+}
+
+bool NavMeshPath::CanWalkStraight(dtPolyRef startRef, const float* start, const float* end)
+{
+	if (!startRef)
+		return false;
+
+	float t = 0;
+	float hitNormal[3];
+	dtPolyRef visited[SHORTCUT_MAX_POLYS];
+	int numVisited = 0;
+
+	dtStatus status = m_query->raycast(startRef, start, end, &m_filter, &t, hitNormal,
+		visited, &numVisited, SHORTCUT_MAX_POLYS);
+	if (dtStatusFailed(status) || (status & DT_BUFFER_TOO_SMALL) || t != FLT_MAX || numVisited == 0)
+		return false;
+
+	// The ray only checks in 2D, so make sure it ends up on the same level as
+	// the corner it was aimed at, and not on a floor above or below it.
+	const dtMeshTile* tile = nullptr;
+	const dtPoly* poly = nullptr;
+	if (dtStatusFailed(m_navMesh->getTileAndPolyByRef(visited[numVisited - 1], &tile, &poly)))
+		return false;
+
+	float closest[3];
+	if (dtStatusFailed(m_query->closestPointOnPoly(visited[numVisited - 1], end, closest, nullptr)))
+		return false;
+
+	return dtAbs(closest[1] - end[1]) <= tile->header->walkableClimb;
+}
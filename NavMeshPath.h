@@ -0,0 +1,352 @@
+//
+// NavMeshPath.h
+//
+// A path across the navmesh to a destination, and the search that finds it.
+// It knows nothing about the game: whoever follows the path says where it
+// starts from, and which of the mesh helpers (cluster graph, poly index,
+// landmarks) to use. NavigationPath is the one the plugin follows.
+//
+
+#pragma once
+
+#include "NavMeshClusterGraph.h"
+#include "NavigationFilter.h"
+
+#include "DetourNavMeshQuery.h"
+#include "DetourPathCorridor.h"
+
+#define GLM_FORCE_RADIANS
+#include <glm.hpp>
+
+#include <cassert>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+//----------------------------------------------------------------------------
+
+class NavMeshLandmarks;
+class NavMeshLandmarkHeuristic;
+class NavMeshPolyIndex;
+class NavMeshQueryPool;
+
+class NavMeshPath
+{
+public:
+	NavMeshPath(NavMeshQueryPool* queryPool);
+	virtual ~NavMeshPath();
+
+	//----------------------------------------------------------------------------
+	// constants
+
+	static const int MAX_POLYS = 4028 * 4;
+
+	static const int MAX_NODES = 2048 * 4;
+
+	static const int MAX_PATH_SIZE = 2048 * 4;
+
+	// corridor following: number of polys ahead of us to check are still
+	// valid on each update.
+	static const int CORRIDOR_LOOKAHEAD = 16;
+
+	// if following the corridor leaves us further than this from where we
+	// actually are, do a full search instead.
+	static constexpr float CORRIDOR_MAX_DEVIATION = 10.0f;
+
+	// how far ahead to look for shortcuts, and how many corners to consider
+	static constexpr float CORRIDOR_OPTIMIZE_RANGE = 300.0f;
+	static const int MAX_OPTIMIZE_CORNERS = 3;
+
+	// how often to look for shorter routes around nearby polys (ms)
+	static const int TOPOLOGY_OPTIMIZE_MS = 500;
+
+	// how often to retry a search that only found a partial path (ms)
+	static const int PARTIAL_REPLAN_MS = 2000;
+
+	// search iterations to run between checks of the time budget
+	static const int SEARCH_ITERATIONS_PER_STEP = 32;
+
+	// routes that cross at least this many tile borders are planned over the
+	// cluster graph first, then searched this many clusters at a time.
+	static const int HIERARCHICAL_MIN_CROSSINGS = 4;
+	static const int CLUSTERS_PER_SEGMENT = 3;
+
+	// corners near the front of the straight path that are checked for
+	// shortcuts when a path is planned, and the most polys a shortcut can
+	// cross.
+	static const int SHORTCUT_CORNERS = 16;
+	static const int SHORTCUT_MAX_POLYS = 64;
+
+	//----------------------------------------------------------------------------
+	// the mesh helpers to use, none of them are required
+
+	// plan long routes over the cluster graph, and rule out unreachable
+	// destinations with its components
+	void SetClusterGraph(NavMeshClusterGraph* clusterGraph) { m_clusterGraph = clusterGraph; }
+
+	// find the polys at the ends of the path with the poly index
+	void SetPolyIndex(NavMeshPolyIndex* polyIndex) { m_polyIndex = polyIndex; }
+
+	// guide the search with the landmark tables
+	void SetLandmarks(std::shared_ptr<const NavMeshLandmarks> landmarks);
+
+	// drop corners that can be walked past in a straight line when a path is
+	// planned
+	void SetShortcutPaths(bool shortcutPaths) { m_shortcutPaths = shortcutPaths; }
+
+	//----------------------------------------------------------------------------
+
+	const glm::vec3& GetDestination() const { return m_destination; }
+
+	int GetPathSize() const { return m_currentPathSize; }
+	int GetPathIndex() const { return m_currentPathCursor; }
+
+	bool FindPath(const glm::vec3& pos);
+
+	// find the polys that a path from here to pos would start and end on,
+	// without searching for the path.
+	bool FindEndpoints(const glm::vec3& pos, dtPolyRef& startRef, dtPolyRef& endRef);
+
+	// Follow polys that an earlier search found, instead of searching. The
+	// straight path is built from where we are to pos the same way it is
+	// after a search, so it comes out the same. FindEndpoints(pos) has to be
+	// called first, and polys have to start on the start poly it found.
+	bool FollowPolys(const glm::vec3& pos, const dtPolyRef* polys, int count, bool partial);
+
+	// the polys that the last search found (or that were followed), and
+	// whether they stop short of the destination
+	const std::vector<dtPolyRef>& GetPlannedPolys() const { return m_plannedPolys; }
+	bool IsPartialPath() const { return m_partialPath; }
+
+	// Returns false if the cluster graph says there is no way from one poly
+	// to the other. True if there might be, or if we can't tell.
+	bool MayReach(dtPolyRef startRef, dtPolyRef endRef) const;
+
+	// length of the straight path
+	float GetPathLength() const;
+
+	// Find the path lengths from where we are to each of the destinations,
+	// with a single search outward from the start. Destinations that can't be
+	// reached, or that cost more than maxCost to get to (if it isn't zero),
+	// get a length of -1. Returns the number of destinations reached.
+	int FindPathLengths(const glm::vec3* destinations, int count, float* lengths,
+		float maxCost = 0.0f);
+
+	void UpdatePath();
+
+	// Searches are run in slices, limited to this many microseconds per
+	// call. 0 means no limit, and FindPath finishes the search right away.
+	void SetSearchBudget(int microseconds) { m_searchBudget = microseconds; }
+
+	// true if a search is in progress. The previous path (if any) is kept
+	// until it completes.
+	bool IsSearching() const { return m_searching; }
+
+	// run the search in progress for up to the search budget. Returns true
+	// if the search finished and the path was updated.
+	bool ContinueSearch();
+
+	// Check if we are at the end if our path
+	inline bool IsAtEnd() const { return m_currentPathCursor >= m_currentPathSize; }
+
+	inline glm::vec3 GetNextPosition() const
+	{
+		return GetPosition(m_currentPathCursor);
+	}
+	inline const float* GetRawPosition(int index) const
+	{
+		assert(index < m_currentPathSize);
+		return &m_currentPath[index * 3];
+	}
+	inline glm::vec3 GetPosition(int index) const
+	{
+		const float* rawcoord = GetRawPosition(index);
+		return glm::vec3(rawcoord[0], rawcoord[1], rawcoord[2]);
+	}
+
+	// DT_STRAIGHTPATH_* flags of a corner, and the poly that starts there.
+	// For the start of an off-mesh link, that is the link's poly.
+	inline unsigned char GetFlags(int index) const { return m_currentPathFlags[index]; }
+	inline dtPolyRef GetPolyRef(int index) const { return m_currentPathRefs[index]; }
+
+	inline void Increment() { ++m_currentPathCursor; }
+
+	// Move the corridor over an off-mesh link that we're about to cross, so
+	// that the path is picked up from the other end. If the link isn't in
+	// the corridor, the path is searched for again on the next update.
+	bool MoveOverOffMeshLink(dtPolyRef ref);
+
+	const float* GetCurrentPath() const { return m_currentPath.data(); }
+
+	dtNavMesh* GetNavMesh() const { return m_navMesh; }
+	dtNavMeshQuery* GetNavMeshQuery() const { return m_query.get(); }
+	const dtQueryFilter& GetFilter() const { return m_filter; }
+
+	// which polys the path can go through and what they cost. Paths start
+	// out with the default filter.
+	void SetFilter(const NavigationFilter& filter);
+	const NavigationFilter& GetNavigationFilter() const { return m_navFilter; }
+
+	struct Stats
+	{
+		int replans = 0;                // searches that set up a corridor
+		int corridorUpdates = 0;        // updates that followed the corridor
+		int lastPathCorners = 0;        // corners before shortcuts
+		int shortcutCorners = 0;        // corners dropped by shortcuts
+
+		int searchIterations = 0;       // of the search in progress
+		int searchPulses = 0;
+		int lastSearchIterations = 0;   // of the last search that finished
+		int lastSearchPulses = 0;
+		int totalSearchIterations = 0;
+
+		int lastRouteSize = 0;          // crossings in the last cluster route
+	};
+	const Stats& GetStats() const { return m_stats; }
+
+protected:
+	typedef std::chrono::high_resolution_clock clock;
+
+	// The time to go by for when to replan and when to look for better
+	// routes. The search budget is always real time.
+	virtual clock::time_point GetTime() const { return clock::now(); }
+
+	// Where the path starts: where whoever is following it is now, in game
+	// coordinates (z up) like the destination. Returns false if that isn't
+	// known.
+	virtual bool GetStartPosition(glm::vec3& pos) const = 0;
+
+	// the straight path was rebuilt
+	virtual void OnPathChanged() {}
+
+	// The path is about to go along the line through points (count of them,
+	// in recast coordinates), so the tiles there need to be loaded.
+	virtual void RequestTiles(const float* points, int count) {}
+
+	// true if tiles are loaded as they're needed. The cluster graph only
+	// knows about the tiles that are loaded, so it can't rule out paths.
+	virtual bool IsLazyLoading() const { return false; }
+
+	// something went wrong with a search. Important messages are for the
+	// user, the rest are for the log.
+	virtual void OnMessage(bool important, const char* message) {}
+
+	// throw away the search in progress. It holds on to polys from all over
+	// the mesh, so it can't continue if tiles come or go.
+	void CancelSearch();
+
+private:
+	void FindPathInternal(const glm::vec3& pos);
+
+	void Message(bool important, const char* format, ...);
+
+	// full search, sets up a new corridor when it finishes
+	bool StartSearch(const float* startOffset);
+	void FinishSearch();
+
+	// start following polys from the search start to the search end. Returns
+	// false if there is no path to follow.
+	bool SetupCorridor(const dtPolyRef* polys, int numPolys, bool partial);
+
+	// search one piece of a cluster route
+	bool StartSegment(dtPolyRef startRef, const float* startPos);
+	bool NextSegment();
+
+	// borrow a query from the pool, if we don't have one yet
+	bool AcquireQuery();
+
+	// find the poly nearest to pos. hint is where we were last time, if we
+	// know.
+	dtPolyRef FindNearestPoly(const float* pos, dtPolyRef hint, float* nearest);
+
+	// move the corridor to our new position. Returns false if it can't be
+	// followed anymore and needs a full search.
+	bool UpdateCorridor(const float* pos);
+
+	// rebuild the straight path from the corridor. planned is true right
+	// after a search, which is when the path is checked for shortcuts.
+	bool UpdateStraightPath(bool planned = false);
+
+	// drop corners of the straight path that can be walked past in a straight
+	// line, and remember them in m_skippedCorners. Returns the new number of
+	// corners.
+	int ShortcutPath(float* path, unsigned char* flags, dtPolyRef* refs, int count);
+
+	// drop the corners that ShortcutPath found when the path was planned,
+	// without checking them again. Returns the new number of corners.
+	int SkipCorners(float* path, unsigned char* flags, dtPolyRef* refs, int count) const;
+
+	// true if we can walk in a straight line from start to end
+	bool CanWalkStraight(dtPolyRef startRef, const float* start, const float* end);
+
+	glm::vec3 m_destination;
+
+	// the straight path, sized to the number of corners in it
+	std::vector<float> m_currentPath;
+	std::vector<unsigned char> m_currentPathFlags;
+	std::vector<dtPolyRef> m_currentPathRefs;
+
+	int m_currentPathCursor = 0;
+	int m_currentPathSize = 0;
+
+	// whoever made the path owns the mesh and the helpers
+	dtNavMesh* m_navMesh;
+	NavMeshClusterGraph* m_clusterGraph = nullptr;
+	NavMeshPolyIndex* m_polyIndex = nullptr;
+	bool m_shortcutPaths = false;
+
+	// landmark heuristic for the query, if the mesh has landmark tables.
+	// Declared first so they outlive m_query, which points to them.
+	std::shared_ptr<const NavMeshLandmarks> m_landmarks;
+	std::unique_ptr<NavMeshLandmarkHeuristic> m_heuristic;
+
+	// the query is borrowed from the pool, and goes back when we're done
+	NavMeshQueryPool* m_queryPool;
+	std::shared_ptr<dtNavMeshQuery> m_query;
+
+	// the polys between us and the destination, followed as we move
+	std::unique_ptr<dtPathCorridor> m_corridor;
+	int m_corridorCapacity = 0;
+	bool m_partialPath = false;
+	bool m_needsReplan = true;
+
+	// the polys that the corridor was last set up with
+	std::vector<dtPolyRef> m_plannedPolys;
+	glm::vec3 m_lastPos;
+
+	clock::time_point m_lastReplan;
+	clock::time_point m_lastTopologyUpdate;
+
+	Stats m_stats;
+
+	// corners dropped by ShortcutPath when the path was last planned
+	std::vector<glm::vec3> m_skippedCorners;
+
+	// sliced search state
+	bool m_searching = false;
+	int m_searchBudget = 0;
+	dtPolyRef m_searchStartRef = 0;
+	dtPolyRef m_searchEndRef = 0;
+	float m_searchStart[3];
+	float m_searchEnd[3];
+
+	// the cluster route being searched, and the polys found along it so far
+	std::vector<NavMeshClusterGraph::Crossing> m_route;
+	size_t m_routeIndex = 0;
+	bool m_finalSegment = true;
+	dtPolyRef m_segmentEndRef = 0;
+
+	// keeps the search for each piece of the route in its clusters. The
+	// query holds on to it until the segment is finalized.
+	NavMeshClusterFilter m_segmentFilter{ &m_filter };
+
+	// true while the query holds a segment that hasn't been finalized. The
+	// query forgets the search once it is finalized, so a second finalize
+	// would hand back garbage.
+	bool m_segmentOpen = false;
+	std::vector<dtPolyRef> m_searchPolys;
+
+	NavigationFilter m_navFilter;
+	dtQueryFilter m_filter;
+	float m_extents[3] = { 50, 400, 50 }; // note: X, Z, Y
+};
@@ -0,0 +1,359 @@
+//
+// NavMeshPolyIndex.cpp
+//
+
+#include "NavMeshPolyIndex.h"
+#include "NavMeshFilter.h"
+
+#include "DetourCommon.h"
+#include "DetourNavMeshQuery.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+
+//----------------------------------------------------------------------------
+
+NavMeshPolyIndex::NavMeshPolyIndex(dtNavMesh* navMesh)
+	: m_navMesh(navMesh)
+{
+	Rebuild();
+}
+
+NavMeshPolyIndex::~NavMeshPolyIndex()
+{
+}
+
+void NavMeshPolyIndex::SetNavMesh(dtNavMesh* navMesh)
+{
+	m_navMesh = navMesh;
+	Rebuild();
+}
+
+void NavMeshPolyIndex::Rebuild()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	m_cells.clear();
+	m_width = 0;
+	m_height = 0;
+	m_maxClimb = 0;
+	m_stats.cells = 0;
+	m_stats.entries = 0;
+
+	if (!m_navMesh)
+		return;
+
+	const dtNavMesh* navMesh = m_navMesh;
+
+	// the area covered by the loaded tiles
+	float bmin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float bmax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+	for (int i = 0; i < navMesh->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = navMesh->getTile(i);
+		if (!tile || !tile->header)
+			continue;
+
+		dtVmin(bmin, tile->header->bmin);
+		dtVmax(bmax, tile->header->bmax);
+	}
+
+	if (bmin[0] > bmax[0])
+		return;
+
+	m_origin[0] = bmin[0];
+	m_origin[1] = bmin[2];
+	m_width = static_cast<int>((bmax[0] - bmin[0]) / CELL_SIZE) + 1;
+	m_height = static_cast<int>((bmax[2] - bmin[2]) / CELL_SIZE) + 1;
+	m_cells.resize(m_width * m_height);
+
+	for (int i = 0; i < navMesh->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = navMesh->getTile(i);
+		if (!tile || !tile->header)
+			continue;
+
+		dtPolyRef base = navMesh->getPolyRefBase(tile);
+
+		for (int p = 0; p < tile->header->polyCount; ++p)
+		{
+			const dtPoly& poly = tile->polys[p];
+
+			// findNearestPoly doesn't return these either
+			if (poly.getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+				continue;
+
+			// bounds of the poly, including the detail mesh, which is where
+			// the closest point is measured.
+			Entry entry;
+			entry.ref = base | static_cast<dtPolyRef>(p);
+			entry.climb = tile->header->walkableClimb;
+			m_maxClimb = dtMax(m_maxClimb, entry.climb);
+			dtVcopy(entry.bmin, &tile->verts[poly.verts[0] * 3]);
+			dtVcopy(entry.bmax, entry.bmin);
+
+			for (int v = 1; v < poly.vertCount; ++v)
+			{
+				dtVmin(entry.bmin, &tile->verts[poly.verts[v] * 3]);
+				dtVmax(entry.bmax, &tile->verts[poly.verts[v] * 3]);
+			}
+
+			if (tile->detailMeshes)
+			{
+				const dtPolyDetail& detail = tile->detailMeshes[p];
+				for (unsigned int v = 0; v < detail.vertCount; ++v)
+				{
+					const float* vert = &tile->detailVerts[(detail.vertBase + v) * 3];
+					dtVmin(entry.bmin, vert);
+					dtVmax(entry.bmax, vert);
+				}
+			}
+
+			int x0 = dtClamp(static_cast<int>((entry.bmin[0] - m_origin[0]) / CELL_SIZE), 0, m_width - 1);
+			int x1 = dtClamp(static_cast<int>((entry.bmax[0] - m_origin[0]) / CELL_SIZE), 0, m_width - 1);
+			int z0 = dtClamp(static_cast<int>((entry.bmin[2] - m_origin[1]) / CELL_SIZE), 0, m_height - 1);
+			int z1 = dtClamp(static_cast<int>((entry.bmax[2] - m_origin[1]) / CELL_SIZE), 0, m_height - 1);
+
+			for (int z = z0; z <= z1; ++z)
+			{
+				for (int x = x0; x <= x1; ++x)
+				{
+					m_cells[z * m_width + x].entries.push_back(entry);
+					m_stats.entries++;
+				}
+			}
+		}
+	}
+
+	for (Cell& cell : m_cells)
+	{
+		std::sort(cell.entries.begin(), cell.entries.end(),
+			[](const Entry& a, const Entry& b) { return a.bmin[1] < b.bmin[1]; });
+
+		for (const Entry& entry : cell.entries)
+			cell.maxHeight = dtMax(cell.maxHeight, entry.bmax[1] - entry.bmin[1]);
+	}
+
+	m_stats.cells = static_cast<int>(m_cells.size());
+	m_stats.buildTimeMs = std::chrono::duration<float, std::milli>(
+		std::chrono::steady_clock::now() - start).count();
+}
+
+float NavMeshPolyIndex::Measure(const dtNavMeshQuery* query, dtPolyRef ref,
+	const float* pos, float* closest) const
+{
+	const dtMeshTile* tile = nullptr;
+	const dtPoly* poly = nullptr;
+	m_navMesh->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+
+	float diff[3];
+	bool posOverPoly = false;
+	query->closestPointOnPoly(ref, pos, closest, &posOverPoly);
+	dtVsub(diff, pos, closest);
+
+	// If a point is directly over a polygon and closer than climb height,
+	// favor that instead of straight line nearest point (findNearestPoly
+	// does the same).
+	if (posOverPoly)
+	{
+		float d = dtAbs(diff[1]) - tile->header->walkableClimb;
+		return d > 0 ? d * d : 0;
+	}
+
+	return dtVlenSqr(diff);
+}
+
+dtPolyRef NavMeshPolyIndex::FindNearestPoly(const dtNavMeshQuery* query, const float* center,
+	const float* extents, const dtQueryFilter& filter, float* nearestPt, dtPolyRef hint)
+{
+	if (!m_navMesh || m_cells.empty())
+		return 0;
+
+	m_stats.queries++;
+
+	float qmin[3], qmax[3];
+	dtVsub(qmin, center, extents);
+	dtVadd(qmax, center, extents);
+
+	dtPolyRef nearest = 0;
+	float nearestDistanceSqr = FLT_MAX;
+	float closest[3];
+
+	auto check = [&](dtPolyRef ref)
+	{
+		m_stats.polysChecked++;
+
+		float d = Measure(query, ref, center, closest);
+		if (d < nearestDistanceSqr)
+		{
+			if (nearestPt)
+				dtVcopy(nearestPt, closest);
+			nearestDistanceSqr = d;
+			nearest = ref;
+		}
+	};
+
+	// We usually haven't moved far since the last search, so the last poly
+	// or one of its neighbors is a good first guess. If we're standing on
+	// it, nothing else can be closer.
+	if (hint && m_navMesh->isValidPolyRef(hint))
+	{
+		const dtMeshTile* tile = nullptr;
+		const dtPoly* poly = nullptr;
+		m_navMesh->getTileAndPolyByRefUnsafe(hint, &tile, &poly);
+
+		if (IsCandidate(hint, qmin, qmax, filter))
+			check(hint);
+
+		for (unsigned int l = poly->firstLink; l != DT_NULL_LINK && nearestDistanceSqr > 0;
+			l = tile->links[l].next)
+		{
+			dtPolyRef ref = tile->links[l].ref;
+			if (ref && IsCandidate(ref, qmin, qmax, filter))
+				check(ref);
+		}
+
+		if (nearest && nearestDistanceSqr == 0)
+		{
+			m_stats.hintHits++;
+			return nearest;
+		}
+	}
+
+	int x0 = dtClamp(static_cast<int>((qmin[0] - m_origin[0]) / CELL_SIZE), 0, m_width - 1);
+	int x1 = dtClamp(static_cast<int>((qmax[0] - m_origin[0]) / CELL_SIZE), 0, m_width - 1);
+	int z0 = dtClamp(static_cast<int>((qmin[2] - m_origin[1]) / CELL_SIZE), 0, m_height - 1);
+	int z1 = dtClamp(static_cast<int>((qmax[2] - m_origin[1]) / CELL_SIZE), 0, m_height - 1);
+
+	typedef std::pair<float, dtPolyRef> Candidate;
+	thread_local std::vector<Candidate> candidates;
+
+	auto compare = [](const Candidate& a, const Candidate& b) { return a.first > b.first; };
+
+	// Collect the polys that could be closer than what we have, along with
+	// the least distance that they could possibly be.
+	auto collect = [&](std::vector<Entry>::const_iterator iter, std::vector<Entry>::const_iterator end,
+		float maxBottom)
+	{
+		for (; iter != end && iter->bmin[1] <= maxBottom; ++iter)
+		{
+			const Entry& entry = *iter;
+			m_stats.entriesScanned++;
+
+			if (!dtOverlapBounds(qmin, qmax, entry.bmin, entry.bmax))
+				continue;
+
+			// distance to the bounds, measured the same way as Measure()
+			float dx = dtMax(0.0f, dtMax(entry.bmin[0] - center[0], center[0] - entry.bmax[0]));
+			float dy = dtMax(0.0f, dtMax(entry.bmin[1] - center[1], center[1] - entry.bmax[1]));
+			float dz = dtMax(0.0f, dtMax(entry.bmin[2] - center[2], center[2] - entry.bmax[2]));
+			dy = dtMax(0.0f, dy - entry.climb);
+
+			float bound = dx * dx + dy * dy + dz * dz;
+			if (bound < nearestDistanceSqr)
+				candidates.push_back(Candidate(bound, entry.ref));
+		}
+	};
+
+	auto bottomBelow = [](const Entry& entry, float y) { return entry.bmin[1] < y; };
+	auto bottomAbove = [](float y, const Entry& entry) { return y < entry.bmin[1]; };
+
+	// Look at the polys within a band of heights around the point first, and
+	// make it taller until the nearest one we found is inside of it. Nothing
+	// outside of the band can be closer than that. Each time, only the polys
+	// that the band didn't cover before have to be looked at.
+	float searchHeight = SEARCH_HEIGHT;
+	float lastMin = 0;
+	float lastMax = 0;
+	bool first = true;
+
+	for (;;)
+	{
+		// entries are sorted by their bottom, which is at most the cell's
+		// tallest entry below their top.
+		float bandMin = dtMax(center[1] - searchHeight - m_maxClimb, qmin[1]);
+		float bandMax = dtMin(center[1] + searchHeight + m_maxClimb, qmax[1]);
+		bool wholeBox = bandMin <= qmin[1] && bandMax >= qmax[1];
+
+		candidates.clear();
+
+		for (int z = z0; z <= z1; ++z)
+		{
+			for (int x = x0; x <= x1; ++x)
+			{
+				const Cell& cell = m_cells[z * m_width + x];
+				auto begin = cell.entries.begin();
+				auto end = cell.entries.end();
+
+				auto below = std::lower_bound(begin, end, bandMin - cell.maxHeight, bottomBelow);
+				if (first)
+				{
+					collect(below, end, bandMax);
+				}
+				else
+				{
+					collect(below, std::lower_bound(below, end, lastMin - cell.maxHeight, bottomBelow), bandMax);
+					collect(std::upper_bound(below, end, lastMax, bottomAbove), end, bandMax);
+				}
+			}
+		}
+
+		// Check them nearest first, until the rest can't be any closer. Polys
+		// that span cells show up once for each, next to each other since
+		// they have the same bounds.
+		std::make_heap(candidates.begin(), candidates.end(), compare);
+		dtPolyRef lastRef = 0;
+
+		while (!candidates.empty() && candidates.front().first < nearestDistanceSqr)
+		{
+			dtPolyRef ref = candidates.front().second;
+			std::pop_heap(candidates.begin(), candidates.end(), compare);
+			candidates.pop_back();
+
+			if (ref == nearest || ref == lastRef)
+				continue;
+			lastRef = ref;
+
+			const dtMeshTile* tile = nullptr;
+			const dtPoly* poly = nullptr;
+			m_navMesh->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+			if (PassFilter(filter, poly))
+				check(ref);
+		}
+
+		if (wholeBox || (nearest && nearestDistanceSqr <= searchHeight * searchHeight))
+			break;
+
+		lastMin = bandMin;
+		lastMax = bandMax;
+		first = false;
+		searchHeight *= SEARCH_GROWTH;
+	}
+
+	return nearest;
+}
+
+bool NavMeshPolyIndex::IsCandidate(dtPolyRef ref, const float* qmin, const float* qmax,
+	const dtQueryFilter& filter) const
+{
+	const dtMeshTile* tile = nullptr;
+	const dtPoly* poly = nullptr;
+	if (dtStatusFailed(m_navMesh->getTileAndPolyByRef(ref, &tile, &poly)))
+		return false;
+	if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION || !PassFilter(filter, poly))
+		return false;
+
+	// it has to be in the search box, like any other
+	float bmin[3], bmax[3];
+	dtVcopy(bmin, &tile->verts[poly->verts[0] * 3]);
+	dtVcopy(bmax, bmin);
+	for (int v = 1; v < poly->vertCount; ++v)
+	{
+		dtVmin(bmin, &tile->verts[poly->verts[v] * 3]);
+		dtVmax(bmax, &tile->verts[poly->verts[v] * 3]);
+	}
+
+	return dtOverlapBounds(qmin, qmax, bmin, bmax);
+}
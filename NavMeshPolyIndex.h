@@ -0,0 +1,106 @@
+//
+// NavMeshPolyIndex.h
+//
+// A grid over the navmesh for finding the nearest poly to a point. Our
+// search extents are very tall, and in zones with a lot of levels stacked
+// on top of each other, findNearestPoly has to look at (and can run out of
+// room for) a lot of polys that are nowhere near the closest one. The polys
+// in each cell are sorted by height, so a search only looks at the levels
+// near the point until it knows it can't find anything closer further out.
+// Whoever loads the mesh calls SetNavMesh when it changes, and Rebuild when
+// tiles come or go.
+//
+
+#pragma once
+
+#include "DetourNavMesh.h"
+
+#include <cstdint>
+#include <vector>
+
+class dtNavMeshQuery;
+class dtQueryFilter;
+
+//----------------------------------------------------------------------------
+
+class NavMeshPolyIndex
+{
+public:
+	NavMeshPolyIndex(dtNavMesh* navMesh);
+	~NavMeshPolyIndex();
+
+	void SetNavMesh(dtNavMesh* navMesh);
+
+	// index the polys of the tiles that are loaded now
+	void Rebuild();
+
+	// Same as dtNavMeshQuery::findNearestPoly, but polys are checked from
+	// nearest to furthest and the search stops once none of the remaining
+	// ones can be closer. If hint is given (usually the poly from the last
+	// search), it and its neighbors are checked first.
+	dtPolyRef FindNearestPoly(const dtNavMeshQuery* query, const float* center,
+		const float* extents, const dtQueryFilter& filter, float* nearestPt,
+		dtPolyRef hint = 0);
+
+	bool IsValid() const { return m_navMesh != nullptr; }
+
+	struct Stats
+	{
+		int cells = 0;
+		int entries = 0;
+		float buildTimeMs = 0;
+
+		uint32_t queries = 0;
+		uint32_t hintHits = 0;       // answered by the hint poly or its neighbors
+		uint32_t entriesScanned = 0; // entries whose bounds were looked at
+		uint32_t polysChecked = 0;   // polys that had to be measured
+	};
+	const Stats& GetStats() const { return m_stats; }
+
+	// width of a grid cell
+	static constexpr float CELL_SIZE = 32.0f;
+
+	// how far above and below the point to look at first. Each time nothing
+	// is found that close, this grows by SEARCH_GROWTH.
+	static constexpr float SEARCH_HEIGHT = 8.0f;
+	static constexpr float SEARCH_GROWTH = 4.0f;
+
+private:
+	// distance from pos to the poly, the same way findNearestPoly measures it
+	float Measure(const dtNavMeshQuery* query, dtPolyRef ref, const float* pos,
+		float* closest) const;
+
+	// true if findNearestPoly would consider this poly
+	bool IsCandidate(dtPolyRef ref, const float* qmin, const float* qmax,
+		const dtQueryFilter& filter) const;
+
+	struct Entry
+	{
+		dtPolyRef ref;
+		float bmin[3];
+		float bmax[3];
+		float climb;
+	};
+
+	struct Cell
+	{
+		// sorted by bmin[1]
+		std::vector<Entry> entries;
+
+		// the tallest entry, so we know how far below the point to start
+		float maxHeight = 0;
+	};
+
+	dtNavMesh* m_navMesh = nullptr;
+
+	// cells are laid out in rows along z
+	float m_origin[2] = { 0, 0 };
+	int m_width = 0;
+	int m_height = 0;
+	std::vector<Cell> m_cells;
+
+	// the most climb of any tile
+	float m_maxClimb = 0;
+
+	Stats m_stats;
+};
@@ -0,0 +1,129 @@
+//
+// NavMeshQueryPool.cpp
+//
+
+#include "NavMeshQueryPool.h"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+
+//----------------------------------------------------------------------------
+
+NavMeshQueryPool::NavMeshQueryPool(dtNavMesh* navMesh, int maxNodes)
+	: m_state(std::make_shared<State>())
+{
+	m_state->maxNodes = maxNodes;
+	m_state->navMesh = navMesh;
+}
+
+NavMeshQueryPool::~NavMeshQueryPool()
+{
+}
+
+std::shared_ptr<dtNavMeshQuery> NavMeshQueryPool::Acquire()
+{
+	std::unique_lock<std::mutex> lock(m_state->mutex);
+
+	if (!m_state->navMesh)
+		return nullptr;
+
+	m_state->stats.acquired++;
+
+	std::unique_ptr<dtNavMeshQuery> query;
+
+	if (!m_state->queries.empty())
+	{
+		Entry& entry = m_state->queries.back();
+		query = std::move(entry.query);
+
+		// queries that were pooled while there was no mesh haven't been
+		// moved over yet.
+		if (entry.generation != m_state->generation)
+		{
+			query->init(m_state->navMesh, m_state->maxNodes);
+			m_state->stats.reinitialized++;
+		}
+
+		m_state->queries.pop_back();
+	}
+	else
+	{
+		query.reset(new dtNavMeshQuery);
+		if (dtStatusFailed(query->init(m_state->navMesh, m_state->maxNodes)))
+			return nullptr;
+
+		m_state->stats.created++;
+	}
+
+	std::weak_ptr<State> weakState = m_state;
+	uint32_t generation = m_state->generation;
+
+	return std::shared_ptr<dtNavMeshQuery>(query.release(),
+		[weakState, generation](dtNavMeshQuery* query)
+	{
+		if (auto state = weakState.lock())
+			state->Release(query, generation);
+		else
+			delete query;
+	});
+}
+
+dtNavMesh* NavMeshQueryPool::GetNavMesh() const
+{
+	std::unique_lock<std::mutex> lock(m_state->mutex);
+	return m_state->navMesh;
+}
+
+NavMeshQueryPool::Stats NavMeshQueryPool::GetStats() const
+{
+	std::unique_lock<std::mutex> lock(m_state->mutex);
+	return m_state->stats;
+}
+
+void NavMeshQueryPool::SetNavMesh(dtNavMesh* navMesh)
+{
+	std::unique_lock<std::mutex> lock(m_state->mutex);
+
+	m_state->navMesh = navMesh;
+	m_state->generation++;
+
+	// init reuses the node pool and open list, so this is cheap. Without a
+	// mesh, they get moved over when they are next acquired.
+	if (navMesh)
+	{
+		for (Entry& entry : m_state->queries)
+		{
+			entry.query->init(navMesh, m_state->maxNodes);
+			entry.generation = m_state->generation;
+			m_state->stats.reinitialized++;
+		}
+	}
+}
+
+void NavMeshQueryPool::State::Release(dtNavMeshQuery* query, uint32_t queryGeneration)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	if (queries.size() >= MAX_POOLED_QUERIES)
+	{
+		delete query;
+		return;
+	}
+
+	// whoever had it might have set a heuristic that doesn't outlive them
+	query->setHeuristic(nullptr);
+
+	Entry entry;
+	entry.query.reset(query);
+	entry.generation = queryGeneration;
+
+	// a query from an older mesh still points at it, which might be gone
+	if (queryGeneration != generation && navMesh)
+	{
+		query->init(navMesh, maxNodes);
+		entry.generation = generation;
+		stats.reinitialized++;
+	}
+
+	queries.push_back(std::move(entry));
+}
@@ -0,0 +1,72 @@
+//
+// NavMeshQueryPool.h
+//
+// Hands out dtNavMeshQuery objects that are already initialized for the
+// loaded navmesh, so that finding a path doesn't have to allocate a new
+// node pool and open list every time. Whoever loads the mesh calls
+// SetNavMesh when it changes.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class dtNavMesh;
+class dtNavMeshQuery;
+
+//----------------------------------------------------------------------------
+
+class NavMeshQueryPool
+{
+public:
+	NavMeshQueryPool(dtNavMesh* navMesh, int maxNodes = 10000);
+	~NavMeshQueryPool();
+
+	// Get a query for the current navmesh. The query goes back to the pool
+	// when the last reference to it is released. Returns nullptr if there
+	// is no navmesh loaded.
+	std::shared_ptr<dtNavMeshQuery> Acquire();
+
+	dtNavMesh* GetNavMesh() const;
+
+	// Move the pooled queries to a new mesh, or none. Queries that are out
+	// are moved when they come back.
+	void SetNavMesh(dtNavMesh* navMesh);
+
+	struct Stats
+	{
+		uint32_t acquired = 0;       // queries handed out
+		uint32_t created = 0;        // queries that had to be allocated
+		uint32_t reinitialized = 0;  // queries that were moved to a new mesh
+	};
+	Stats GetStats() const;
+
+	// the number of unused queries to hold on to
+	static const int MAX_POOLED_QUERIES = 4;
+
+private:
+	struct Entry
+	{
+		std::unique_ptr<dtNavMeshQuery> query;
+		uint32_t generation;
+	};
+
+	// shared with the queries that are handed out, so that they can find
+	// their way back even if they outlive the pool.
+	struct State
+	{
+		mutable std::mutex mutex;
+		dtNavMesh* navMesh = nullptr;
+		uint32_t generation = 0;
+		int maxNodes = 0;
+		std::vector<Entry> queries;
+		Stats stats;
+
+		void Release(dtNavMeshQuery* query, uint32_t generation);
+	};
+
+	std::shared_ptr<State> m_state;
+};
@@ -33,6 +33,11 @@ NavMeshRenderer::NavMeshRenderer(NavMeshLoader* loader, IDirect3DDevice9* device
 	auto conn = [this](dtNavMesh* m) { m_navMesh = m; UpdateNavMesh(); };
 	m_meshConn = loader->OnNavMeshChanged.Connect(conn);
 
+	// the geometry is built from the mesh on another thread, so stop it
+	// while tiles are swapped in and out, and rebuild afterwards.
+	m_tilesChangingConn = loader->OnTilesChanging.Connect([this]() { StopLoad(); });
+	m_tilesChangedConn = loader->OnTilesChanged.Connect([this]() { UpdateNavMesh(); });
+
 	m_primGroup = std::make_unique<RenderGroup>(device);
 	//m_enabled = mq2nav::GetSettings().show_navmesh_overlay;
 }
@@ -198,7 +203,9 @@ void NavMeshRenderer::UpdateNavMesh()
 
 void NavMeshRenderer::OnUpdateUI()
 {
-	if (!m_navMesh)
+	if (m_meshLoader->IsLoading())
+		ImGui::TextColored(ImColor(255, 255, 0), "Loading navmesh...");
+	else if (!m_navMesh)
 		ImGui::TextColored(ImColor(255, 255, 0), "No navmesh loaded");
 	else
 		ImGui::TextColored(ImColor(0, 255, 0), "Navmesh loaded");
@@ -206,6 +213,16 @@ void NavMeshRenderer::OnUpdateUI()
 	if (ImGui::Button("Reload"))
 		m_meshLoader->LoadNavMesh();
 
+	if (m_navMesh && m_meshLoader->IsLazyLoading())
+	{
+		const auto& stats = m_meshLoader->GetTileStats();
+		ImGui::LabelText("Resident Tiles", "%d / %d (%.1f MB)", stats.residentTiles, stats.totalTiles,
+			stats.residentBytes / (1024.0f * 1024.0f));
+		ImGui::LabelText("Tile Hits", "%u", stats.hits);
+		ImGui::LabelText("Tile Misses", "%u", stats.misses);
+		ImGui::LabelText("Tile Evictions", "%u", stats.evictions);
+	}
+
 	if (ImGui::Checkbox("Show navmesh", &m_enabled)) {
 		//mq2nav::GetSettings().show_navmesh_overlay = m_enabled;
 		//mq2nav::SaveSettings(false);
@@ -51,6 +51,8 @@ private:
 
 	std::unique_ptr<RenderGroup> m_primGroup;
 	Signal<dtNavMesh*>::ScopedConnection m_meshConn;
+	Signal<>::ScopedConnection m_tilesChangingConn;
+	Signal<>::ScopedConnection m_tilesChangedConn;
 
 	std::unique_ptr<ConfigurableRenderState> m_state;
 	bool m_useStateEditor = false;
@@ -0,0 +1,262 @@
+//
+// NavMeshTileCache.cpp
+//
+
+#include "NavMeshTileCache.h"
+
+#include "DetourNavMeshBuilder.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
+//----------------------------------------------------------------------------
+
+namespace {
+
+// these have to match SamplePolyAreas and SamplePolyFlags in
+// MeshGenerator/Sample.h
+enum
+{
+	POLYAREA_GROUND = 0,
+	POLYAREA_WATER,
+	POLYAREA_ROAD,
+	POLYAREA_DOOR,
+	POLYAREA_GRASS,
+};
+
+enum
+{
+	POLYFLAGS_WALK = 0x01,
+	POLYFLAGS_SWIM = 0x02,
+	POLYFLAGS_DOOR = 0x04,
+};
+
+struct TileCacheHeader
+{
+	int magic;
+	int version;
+	dtTileCacheParams params;
+	int numLayers;
+};
+
+struct ReadCursor {
+	const char* data;
+	size_t length;
+};
+
+bool FillData(ReadCursor& cursor, void* data, size_t length)
+{
+	if (length > cursor.length)
+		return false;
+
+	memcpy(data, cursor.data, length);
+	cursor.data += length;
+	cursor.length -= length;
+	return true;
+}
+
+void AppendData(std::vector<char>& buffer, const void* data, size_t length)
+{
+	const char* bytes = static_cast<const char*>(data);
+	buffer.insert(buffer.end(), bytes, bytes + length);
+}
+
+// the tile cache reads the layer header in place, so keep each layer aligned
+size_t AlignLayer(size_t offset)
+{
+	return (offset + 3) & ~size_t(3);
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+
+int NavMeshTileCacheCompressor::maxCompressedSize(const int bufferSize)
+{
+	return static_cast<int>(compressBound(bufferSize));
+}
+
+dtStatus NavMeshTileCacheCompressor::compress(const unsigned char* buffer, const int bufferSize,
+	unsigned char* compressed, const int maxCompressedSize, int* compressedSize)
+{
+	uLongf destLen = maxCompressedSize;
+	if (compress2(compressed, &destLen, buffer, bufferSize, Z_BEST_SPEED) != Z_OK)
+		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+
+	*compressedSize = static_cast<int>(destLen);
+	return DT_SUCCESS;
+}
+
+dtStatus NavMeshTileCacheCompressor::decompress(const unsigned char* compressed, const int compressedSize,
+	unsigned char* buffer, const int maxBufferSize, int* bufferSize)
+{
+	uLongf destLen = maxBufferSize;
+	if (uncompress(buffer, &destLen, compressed, compressedSize) != Z_OK)
+		return DT_FAILURE;
+
+	*bufferSize = static_cast<int>(destLen);
+	return DT_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+
+void NavMeshTileCacheMeshProcess::process(dtNavMeshCreateParams* params,
+	unsigned char* polyAreas, unsigned short* polyFlags)
+{
+	for (int i = 0; i < params->polyCount; ++i)
+	{
+		if (polyAreas[i] == DT_TILECACHE_WALKABLE_AREA)
+			polyAreas[i] = POLYAREA_GROUND;
+
+		if (polyAreas[i] == POLYAREA_GROUND ||
+			polyAreas[i] == POLYAREA_GRASS ||
+			polyAreas[i] == POLYAREA_ROAD)
+		{
+			polyFlags[i] = POLYFLAGS_WALK;
+		}
+		else if (polyAreas[i] == POLYAREA_WATER)
+		{
+			polyFlags[i] = POLYFLAGS_SWIM;
+		}
+		else if (polyAreas[i] == POLYAREA_DOOR)
+		{
+			polyFlags[i] = POLYFLAGS_WALK | POLYFLAGS_DOOR;
+		}
+	}
+
+	// the tile cache leaves this off to build faster, but these tiles stay
+	// around and get queried a lot more than they get rebuilt.
+	params->buildBvTree = true;
+
+	if (m_links)
+	{
+		m_links->GetLinksInBounds(params->bmin, params->bmax, m_tileLinks);
+		m_tileLinks.Apply(*params);
+	}
+}
+
+//----------------------------------------------------------------------------
+
+void NavMeshTileCacheData::Build(const dtTileCache* tileCache)
+{
+	m_params = *tileCache->getParams();
+	m_layers.clear();
+	m_data.clear();
+
+	// In location order rather than tile cache slot order, which depends on
+	// the order the layers were built in.
+	std::vector<const dtCompressedTile*> tiles;
+	for (int i = 0; i < tileCache->getTileCount(); ++i)
+	{
+		const dtCompressedTile* tile = tileCache->getTile(i);
+		if (tile->header && tile->data)
+			tiles.push_back(tile);
+	}
+
+	std::sort(tiles.begin(), tiles.end(), [](const dtCompressedTile* a, const dtCompressedTile* b)
+	{
+		const dtTileCacheLayerHeader& ha = *a->header;
+		const dtTileCacheLayerHeader& hb = *b->header;
+		return std::tie(ha.ty, ha.tx, ha.tlayer) < std::tie(hb.ty, hb.tx, hb.tlayer);
+	});
+
+	for (const dtCompressedTile* tile : tiles)
+	{
+		Layer layer;
+		layer.offset = AlignLayer(m_data.size());
+		layer.size = tile->dataSize;
+		m_layers.push_back(layer);
+
+		m_data.resize(layer.offset + layer.size);
+		memcpy(&m_data[layer.offset], tile->data, layer.size);
+	}
+}
+
+bool NavMeshTileCacheData::Read(const char* data, size_t size)
+{
+	m_layers.clear();
+	m_data.clear();
+
+	ReadCursor cursor{ data, size };
+
+	TileCacheHeader header;
+	if (!FillData(cursor, &header, sizeof(header)))
+		return false;
+	if (header.magic != NAVMESHTILECACHE_MAGIC || header.version != NAVMESHTILECACHE_VERSION)
+		return false;
+	if (header.numLayers < 0 || header.numLayers > header.params.maxTiles)
+		return false;
+
+	std::vector<Layer> layers(header.numLayers);
+	std::vector<unsigned char> layerData;
+
+	for (Layer& layer : layers)
+	{
+		if (!FillData(cursor, &layer.size, sizeof(layer.size)))
+			return false;
+		if (layer.size < static_cast<int>(sizeof(dtTileCacheLayerHeader))
+			|| static_cast<size_t>(layer.size) > cursor.length)
+		{
+			return false;
+		}
+
+		layer.offset = AlignLayer(layerData.size());
+		layerData.resize(layer.offset + layer.size);
+		FillData(cursor, &layerData[layer.offset], layer.size);
+
+		const dtTileCacheLayerHeader* layerHeader =
+			reinterpret_cast<const dtTileCacheLayerHeader*>(&layerData[layer.offset]);
+		if (layerHeader->magic != DT_TILECACHE_MAGIC || layerHeader->version != DT_TILECACHE_VERSION)
+			return false;
+	}
+
+	m_params = header.params;
+	m_layers = std::move(layers);
+	m_data = std::move(layerData);
+	return true;
+}
+
+void NavMeshTileCacheData::Write(std::vector<char>& buffer) const
+{
+	buffer.clear();
+
+	TileCacheHeader header;
+	header.magic = NAVMESHTILECACHE_MAGIC;
+	header.version = NAVMESHTILECACHE_VERSION;
+	header.params = m_params;
+	header.numLayers = GetLayerCount();
+	AppendData(buffer, &header, sizeof(header));
+
+	for (const Layer& layer : m_layers)
+	{
+		AppendData(buffer, &layer.size, sizeof(layer.size));
+		AppendData(buffer, &m_data[layer.offset], layer.size);
+	}
+}
+
+dtStatus NavMeshTileCacheData::InitTileCache(dtTileCache* tileCache, int maxObstacles,
+	dtTileCacheAlloc* alloc, dtTileCacheCompressor* compressor, dtTileCacheMeshProcess* meshProcess) const
+{
+	dtTileCacheParams params = m_params;
+	params.maxObstacles = maxObstacles;
+
+	dtStatus status = tileCache->init(&params, alloc, compressor, meshProcess);
+	if (dtStatusFailed(status))
+		return status;
+
+	for (const Layer& layer : m_layers)
+	{
+		// without DT_COMPRESSEDTILE_FREE_DATA the tile cache only reads the
+		// layer, it doesn't take it over.
+		unsigned char* data = const_cast<unsigned char*>(&m_data[layer.offset]);
+
+		status = tileCache->addTile(data, layer.size, 0, 0);
+		if (dtStatusFailed(status))
+			return status;
+	}
+
+	return DT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+//
+// NavMeshTileCache.h
+//
+// Compressed heightfield layers for rebuilding tiles at runtime with
+// DetourTileCache. The mesh generator can build the mesh out of these layers
+// and save them with it, and the plugin then stamps dynamic obstacles (doors,
+// spawns) into them and rebuilds just the tiles they touch.
+//
+// This is shared by the plugin and the mesh generator, so it shouldn't
+// depend on either.
+//
+
+#pragma once
+
+#include "NavMeshOffMeshLinks.h"
+
+#include "DetourTileCache.h"
+#include "DetourTileCacheBuilder.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+static const int NAVMESHTILECACHE_MAGIC = 'T' << 24 | 'C' << 16 | 'C' << 8 | 'H'; //'TCCH';
+static const int NAVMESHTILECACHE_VERSION = 1;
+
+//----------------------------------------------------------------------------
+
+// zlib, the same as the tiles in the mesh file
+class NavMeshTileCacheCompressor : public dtTileCacheCompressor
+{
+public:
+	virtual int maxCompressedSize(const int bufferSize) override;
+	virtual dtStatus compress(const unsigned char* buffer, const int bufferSize,
+		unsigned char* compressed, const int maxCompressedSize, int* compressedSize) override;
+	virtual dtStatus decompress(const unsigned char* compressed, const int compressedSize,
+		unsigned char* buffer, const int maxBufferSize, int* bufferSize) override;
+};
+
+// Sets poly flags from the areas the same way the mesh generator does for
+// the static tiles, so tiles rebuilt from the layers get the same flags, and
+// adds the off-mesh links that start in the tile.
+class NavMeshTileCacheMeshProcess : public dtTileCacheMeshProcess
+{
+public:
+	virtual void process(struct dtNavMeshCreateParams* params,
+		unsigned char* polyAreas, unsigned short* polyFlags) override;
+
+	// links to build into the tiles, or null for none. Has to outlive the
+	// tile cache updates.
+	void SetOffMeshLinks(const NavMeshOffMeshLinks* links) { m_links = links; }
+
+private:
+	const NavMeshOffMeshLinks* m_links = nullptr;
+
+	// the links for the tile being built, until the tile has been created
+	NavMeshOffMeshLinkSet m_tileLinks;
+};
+
+//----------------------------------------------------------------------------
+
+class NavMeshTileCacheData
+{
+public:
+	// Copy the layers out of a tile cache (in the mesh generator).
+	void Build(const dtTileCache* tileCache);
+
+	// Read from or write to a mesh file section (SECTION_TILECACHE).
+	bool Read(const char* data, size_t size);
+	void Write(std::vector<char>& buffer) const;
+
+	bool IsEmpty() const { return m_layers.empty(); }
+	int GetLayerCount() const { return static_cast<int>(m_layers.size()); }
+	size_t GetDataSize() const { return m_data.size(); }
+	const dtTileCacheParams& GetParams() const { return m_params; }
+
+	// Init a tile cache with these params and add all of the layers to it.
+	// The tile cache points at our copy of the layers, so this has to
+	// outlive it.
+	dtStatus InitTileCache(dtTileCache* tileCache, int maxObstacles, dtTileCacheAlloc* alloc,
+		dtTileCacheCompressor* compressor, dtTileCacheMeshProcess* meshProcess) const;
+
+	// the most layers that a tile can have (getTilesAt only returns this many)
+	static const int MAX_LAYERS_PER_TILE = 32;
+
+private:
+	struct Layer
+	{
+		size_t offset = 0;
+		int size = 0;
+	};
+
+	dtTileCacheParams m_params;
+	std::vector<Layer> m_layers;
+	std::vector<unsigned char> m_data;
+};
@@ -0,0 +1,219 @@
+//
+// NavMeshTileResidency.cpp
+//
+
+#include "NavMeshTileResidency.h"
+
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+
+#include <cmath>
+#include <cstdio>
+
+//----------------------------------------------------------------------------
+
+void NavMeshTileResidency::Attach(dtNavMesh* mesh, const NavMeshFileReader* reader,
+	std::vector<TileSlot> tiles, TileGrid tileGrid)
+{
+	m_mesh = mesh;
+	m_reader = reader;
+	m_tiles = std::move(tiles);
+	m_tileGrid = std::move(tileGrid);
+
+	m_stats = Stats();
+	m_stats.totalTiles = static_cast<int>(m_tiles.size());
+	m_lruHead = m_lruTail = -1;
+}
+
+void NavMeshTileResidency::Reset()
+{
+	m_mesh = nullptr;
+	m_reader = nullptr;
+	m_tiles.clear();
+	m_tileGrid.clear();
+	m_stats = Stats();
+	m_messages.clear();
+	m_lruHead = m_lruTail = -1;
+}
+
+void NavMeshTileResidency::RequestArea(const float* pos, float radius)
+{
+	if (!m_mesh)
+		return;
+
+	float bmin[3] = { pos[0] - radius, pos[1], pos[2] - radius };
+	float bmax[3] = { pos[0] + radius, pos[1], pos[2] + radius };
+
+	int minx, miny, maxx, maxy;
+	m_mesh->calcTileLoc(bmin, &minx, &miny);
+	m_mesh->calcTileLoc(bmax, &maxx, &maxy);
+
+	++m_tick;
+
+	for (int ty = miny; ty <= maxy; ++ty)
+	{
+		for (int tx = minx; tx <= maxx; ++tx)
+		{
+			MakeTilesResident(tx, ty);
+		}
+	}
+}
+
+void NavMeshTileResidency::RequestLine(const float* points, int count)
+{
+	if (!m_mesh || count <= 0)
+		return;
+
+	++m_tick;
+
+	// step along each segment at half a tile at a time so that no tile that
+	// the line crosses gets skipped.
+	const dtNavMeshParams* params = m_mesh->getParams();
+	float step = dtMin(params->tileWidth, params->tileHeight) * 0.5f;
+
+	int tx, ty;
+	m_mesh->calcTileLoc(&points[0], &tx, &ty);
+	MakeTilesResident(tx, ty);
+
+	for (int i = 1; i < count; ++i)
+	{
+		const float* a = &points[(i - 1) * 3];
+		const float* b = &points[i * 3];
+
+		int steps = static_cast<int>(ceilf(dtVdist2D(a, b) / step));
+
+		for (int j = 1; j <= steps; ++j)
+		{
+			float pt[3];
+			dtVlerp(pt, a, b, static_cast<float>(j) / steps);
+
+			m_mesh->calcTileLoc(pt, &tx, &ty);
+			MakeTilesResident(tx, ty);
+		}
+	}
+}
+
+void NavMeshTileResidency::MakeTilesResident(int tx, int ty)
+{
+	auto iter = m_tileGrid.find(std::make_pair(tx, ty));
+	if (iter == m_tileGrid.end())
+		return;
+
+	for (int index : iter->second)
+	{
+		TileSlot& slot = m_tiles[index];
+		slot.lastUsed = m_tick;
+
+		if (slot.resident)
+		{
+			m_stats.hits++;
+			Unlink(index);
+			LinkUsed(index);
+			continue;
+		}
+
+		m_stats.misses++;
+
+		// Always take a copy. Detour writes its links into the tile data, so
+		// a tile used in place wouldn't match its checksum the next time it
+		// was read from the file.
+		NavMeshFileTile tile;
+		if (m_reader->ReadTile(slot.fileIndex, tile, true) != NavMeshFileReader::SUCCESS)
+		{
+			char message[64];
+			snprintf(message, sizeof(message), "Tile %d is corrupt!", slot.fileIndex);
+			m_messages.push_back(message);
+			continue;
+		}
+
+		TilesChanging();
+
+		// add it back with its original ref so that poly refs stay the same
+		// no matter how many times the tile comes and goes.
+		if (dtStatusFailed(m_mesh->addTile(tile.data, tile.dataSize, DT_TILE_FREE_DATA, tile.tileRef, 0)))
+		{
+			char message[64];
+			snprintf(message, sizeof(message), "Failed to load tile %d", slot.fileIndex);
+			m_messages.push_back(message);
+
+			dtFree(tile.data);
+			continue;
+		}
+
+		slot.resident = true;
+		LinkUsed(index);
+		m_stats.residentTiles++;
+		m_stats.residentBytes += slot.dataSize;
+	}
+}
+
+void NavMeshTileResidency::Evict(size_t budget)
+{
+	if (!m_mesh)
+		return;
+
+	while (m_stats.residentBytes > budget && m_lruHead != -1)
+	{
+		// evict the least recently used tile. Tiles used by the last request
+		// are kept even if that puts us over budget, and they are all at the
+		// end of the list.
+		TileSlot* oldest = &m_tiles[m_lruHead];
+		if (oldest->lastUsed == m_tick)
+			break;
+
+		TilesChanging();
+
+		dtTileRef ref = m_reader->GetTileRef(oldest->fileIndex);
+		m_mesh->removeTile(ref, 0, 0);
+
+		Unlink(m_lruHead);
+		oldest->resident = false;
+		m_stats.residentTiles--;
+		m_stats.residentBytes -= oldest->dataSize;
+		m_stats.evictions++;
+	}
+}
+
+void NavMeshTileResidency::LinkUsed(int index)
+{
+	TileSlot& slot = m_tiles[index];
+	slot.lruPrev = m_lruTail;
+	slot.lruNext = -1;
+
+	if (m_lruTail != -1)
+		m_tiles[m_lruTail].lruNext = index;
+	else
+		m_lruHead = index;
+	m_lruTail = index;
+}
+
+void NavMeshTileResidency::Unlink(int index)
+{
+	TileSlot& slot = m_tiles[index];
+
+	if (slot.lruPrev != -1)
+		m_tiles[slot.lruPrev].lruNext = slot.lruNext;
+	else
+		m_lruHead = slot.lruNext;
+
+	if (slot.lruNext != -1)
+		m_tiles[slot.lruNext].lruPrev = slot.lruPrev;
+	else
+		m_lruTail = slot.lruPrev;
+
+	slot.lruPrev = slot.lruNext = -1;
+}
+
+void NavMeshTileResidency::TilesChanging()
+{
+	if (m_onTilesChanging)
+		m_onTilesChanging();
+}
+
+std::vector<std::string> NavMeshTileResidency::TakeMessages()
+{
+	std::vector<std::string> messages;
+	messages.swap(m_messages);
+	return messages;
+}
@@ -0,0 +1,99 @@
+//
+// NavMeshTileResidency.h
+//
+// Keeps some of the tiles of a lazily loaded mesh in the mesh. Tiles are
+// added from the file when they are asked for, and the ones that haven't
+// been used for the longest are removed to stay under a memory budget. This
+// doesn't know about the game, NavMeshLoader decides which tiles to ask for.
+//
+
+#pragma once
+
+#include "NavMeshFileLoader.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class dtNavMesh;
+
+class NavMeshTileResidency
+{
+public:
+	typedef NavMeshFileLoader::TileSlot TileSlot;
+	typedef NavMeshFileLoader::TileGrid TileGrid;
+
+	struct Stats
+	{
+		int residentTiles = 0;
+		int totalTiles = 0;
+		size_t residentBytes = 0;
+
+		uint32_t hits = 0;         // tile was needed and already resident
+		uint32_t misses = 0;       // tile was needed and had to be loaded
+		uint32_t evictions = 0;    // tile was removed to stay under budget
+	};
+
+	// onTilesChanging is called before a tile is added to or removed from
+	// the mesh.
+	explicit NavMeshTileResidency(std::function<void()> onTilesChanging = nullptr)
+		: m_onTilesChanging(std::move(onTilesChanging))
+	{
+	}
+
+	NavMeshTileResidency(const NavMeshTileResidency&) = delete;
+	NavMeshTileResidency& operator=(const NavMeshTileResidency&) = delete;
+
+	// Start managing the tiles of a mesh that was loaded lazily. The mesh and
+	// the reader (and the file data it reads from) must stay alive until
+	// Reset() is called.
+	void Attach(dtNavMesh* mesh, const NavMeshFileReader* reader,
+		std::vector<TileSlot> tiles, TileGrid tileGrid);
+
+	// Forget the mesh. Tiles are left as they are, the mesh is about to go.
+	void Reset();
+
+	bool IsAttached() const { return m_mesh != nullptr; }
+
+	// Make the tiles within radius of a point (in detour coordinates)
+	// resident, and mark them as used by this request.
+	void RequestArea(const float* pos, float radius);
+
+	// Make the tiles along a line of points (in detour coordinates)
+	// resident, and mark them as used by this request.
+	void RequestLine(const float* points, int count);
+
+	// Remove the least recently used tiles until the rest fit in budget
+	// bytes. The tiles of the last request are kept, even if that leaves
+	// the mesh over budget.
+	void Evict(size_t budget);
+
+	const Stats& GetStats() const { return m_stats; }
+
+	// Tiles that couldn't be read or added since the last call, for the
+	// caller to log.
+	std::vector<std::string> TakeMessages();
+
+private:
+	void MakeTilesResident(int tx, int ty);
+	void TilesChanging();
+
+	void LinkUsed(int index);
+	void Unlink(int index);
+
+	std::function<void()> m_onTilesChanging;
+
+	dtNavMesh* m_mesh = nullptr;
+	const NavMeshFileReader* m_reader = nullptr;
+	std::vector<TileSlot> m_tiles;
+	TileGrid m_tileGrid;
+	Stats m_stats;
+	uint32_t m_tick = 0;
+
+	// ends of the list of resident tiles, least recently used first
+	int m_lruHead = -1;
+	int m_lruTail = -1;
+
+	std::vector<std::string> m_messages;
+};
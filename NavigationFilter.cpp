@@ -0,0 +1,168 @@
+//
+// NavigationFilter.cpp
+//
+
+#include "NavigationFilter.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
+//----------------------------------------------------------------------------
+
+namespace {
+
+const char* s_areaNames[NavArea_Count] = {
+	"ground",
+	"water",
+	"road",
+	"door",
+	"grass",
+	"jump",
+};
+
+struct FlagName
+{
+	const char* name;
+	uint16_t flag;
+};
+
+const FlagName s_flagNames[] = {
+	{ "walk",     NavFlag_Walk },
+	{ "swim",     NavFlag_Swim },
+	{ "door",     NavFlag_Door },
+	{ "jump",     NavFlag_Jump },
+	{ "disabled", NavFlag_Disabled },
+};
+
+} // namespace
+
+const char* GetAreaName(int area)
+{
+	if (area < 0 || area >= NavArea_Count)
+		return "";
+	return s_areaNames[area];
+}
+
+std::string FormatFlags(uint16_t flags)
+{
+	if (flags == NavFlag_All)
+		return "all";
+
+	std::string result;
+	for (const FlagName& flagName : s_flagNames)
+	{
+		if (flags & flagName.flag)
+		{
+			if (!result.empty())
+				result += ",";
+			result += flagName.name;
+		}
+	}
+
+	return result.empty() ? "none" : result;
+}
+
+bool ParseFlags(const char* str, uint16_t& flags)
+{
+	uint16_t result = 0;
+
+	while (*str)
+	{
+		size_t length = strcspn(str, ",|");
+		std::string name(str, length);
+		str += length;
+		if (*str)
+			++str;
+
+		if (name.empty() || !_stricmp(name.c_str(), "none"))
+			continue;
+		if (!_stricmp(name.c_str(), "all"))
+		{
+			result = NavFlag_All;
+			continue;
+		}
+
+		bool found = false;
+		for (const FlagName& flagName : s_flagNames)
+		{
+			if (!_stricmp(name.c_str(), flagName.name))
+			{
+				result |= flagName.flag;
+				found = true;
+				break;
+			}
+		}
+
+		if (!found)
+			return false;
+	}
+
+	flags = result;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+void NavigationFilter::Apply(dtQueryFilter& filter) const
+{
+	filter.setIncludeFlags(includeFlags);
+	filter.setExcludeFlags(excludeFlags);
+
+	for (int i = 0; i < NavArea_Count; ++i)
+		filter.setAreaCost(i, areaCosts[i]);
+}
+
+bool NavigationFilter::ParseOption(const char* option)
+{
+	const char* value = strchr(option, '=');
+	if (!value)
+		return false;
+
+	std::string name(option, value - option);
+	++value;
+
+	if (!_stricmp(name.c_str(), "include"))
+		return ParseFlags(value, includeFlags);
+	if (!_stricmp(name.c_str(), "exclude"))
+		return ParseFlags(value, excludeFlags);
+
+	for (int i = 0; i < NavArea_Count; ++i)
+	{
+		if (!_stricmp(name.c_str(), s_areaNames[i]))
+		{
+			char* end = nullptr;
+			float cost = strtof(value, &end);
+			if (end == value || *end != 0 || !std::isfinite(cost) || cost < MIN_AREA_COST)
+				return false;
+
+			areaCosts[i] = cost;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+size_t NavigationFilter::Hash() const
+{
+	size_t hash = (includeFlags << 16) | excludeFlags;
+	for (float cost : areaCosts)
+		hash = hash * 31 + std::hash<float>()(cost);
+	return hash;
+}
+
+bool NavigationFilter::operator==(const NavigationFilter& other) const
+{
+	if (includeFlags != other.includeFlags || excludeFlags != other.excludeFlags)
+		return false;
+
+	for (int i = 0; i < NavArea_Count; ++i)
+	{
+		if (areaCosts[i] != other.areaCosts[i])
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,77 @@
+//
+// NavigationFilter.h
+//
+// Which polys a path is allowed to go through, and how much each kind of
+// area costs to cross. The mesh generator marks every poly with an area
+// type and flags, so the values here have to match SamplePolyAreas and
+// SamplePolyFlags in MeshGenerator/Sample.h.
+//
+
+#pragma once
+
+#include "DetourNavMeshQuery.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//----------------------------------------------------------------------------
+
+enum NavigationArea
+{
+	NavArea_Ground = 0,
+	NavArea_Water,
+	NavArea_Road,
+	NavArea_Door,
+	NavArea_Grass,
+	NavArea_Jump,
+
+	NavArea_Count
+};
+
+enum NavigationFlags : uint16_t
+{
+	NavFlag_Walk     = 0x01,
+	NavFlag_Swim     = 0x02,
+	NavFlag_Door     = 0x04,
+	NavFlag_Jump     = 0x08,
+	NavFlag_Disabled = 0x10,
+
+	NavFlag_All      = 0xffff
+};
+
+// name of an area, as used in options and the ini file
+const char* GetAreaName(int area);
+
+// flags as a list of names, like "walk,door"
+std::string FormatFlags(uint16_t flags);
+bool ParseFlags(const char* str, uint16_t& flags);
+
+//----------------------------------------------------------------------------
+
+struct NavigationFilter
+{
+	uint16_t includeFlags = NavFlag_Walk;
+	uint16_t excludeFlags = 0;
+
+	// cost to cross each area, per unit of distance. Costs below
+	// MIN_AREA_COST aren't allowed: the search heuristics assume that nothing
+	// is cheaper than open ground, and would miss shorter paths.
+	float areaCosts[NavArea_Count] = { 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f };
+
+	static constexpr float MIN_AREA_COST = 1.0f;
+
+	// set up a query filter to match
+	void Apply(dtQueryFilter& filter) const;
+
+	// Apply one option given as name=value. Recognized options are
+	// include=<flags>, exclude=<flags> and <area>=<cost>, for example
+	// "exclude=door" or "water=10". Returns false if the option isn't one of
+	// these or the value isn't valid.
+	bool ParseOption(const char* option);
+
+	size_t Hash() const;
+
+	bool operator==(const NavigationFilter& other) const;
+	bool operator!=(const NavigationFilter& other) const { return !(*this == other); }
+};
@@ -6,16 +6,20 @@
 #include "MQ2Navigation.h"
 #include "RenderHandler.h"
 #include "MQ2Nav_Settings.h"
+#include "NavMeshLoader.h"
 
-#include "DetourNavMesh.h"
-#include "DetourCommon.h"
-
-
-NavigationPath::NavigationPath(dtNavMesh* navMesh, bool renderPaths)
-	: m_navMesh(navMesh)
+NavigationPath::NavigationPath(NavMeshQueryPool* queryPool, bool renderPaths)
+	: NavMeshPath(queryPool)
 	, m_renderPaths(renderPaths)
 {
-	m_filter.setIncludeFlags(0x01); // walkable surface
+	SetFilter(mq2nav::GetSettings().filter);
+	SetShortcutPaths(mq2nav::GetSettings().shortcut_paths);
+
+	if (g_mq2Nav)
+	{
+		SetClusterGraph(g_mq2Nav->GetClusterGraph());
+		SetPolyIndex(g_mq2Nav->GetPolyIndex());
+	}
 
 	if (m_renderPaths)
 	{
@@ -24,6 +28,17 @@ NavigationPath::NavigationPath(dtNavMesh* navMesh, bool renderPaths)
 		g_renderHandler->AddRenderable(m_line);
 
 	}
+
+	if (NavMeshLoader* meshLoader = g_mq2Nav ? g_mq2Nav->GetMeshLoader() : nullptr)
+	{
+		// use the landmark tables to guide the search, if the mesh has them
+		if (mq2nav::GetSettings().use_landmarks)
+			SetLandmarks(meshLoader->GetLandmarks());
+
+		// a search in progress holds on to polys from all over the mesh, it
+		// can't continue if tiles come or go.
+		m_tilesConn = meshLoader->OnTilesChanging.Connect([this]() { CancelSearch(); });
+	}
 }
 
 NavigationPath::~NavigationPath()
@@ -36,126 +51,42 @@ NavigationPath::~NavigationPath()
 
 //----------------------------------------------------------------------------
 
-bool NavigationPath::FindPath(const glm::vec3& pos)
+bool NavigationPath::GetStartPosition(glm::vec3& pos) const
 {
-	if (nullptr != m_navMesh)
-	{
-		// WriteChatf("MQ2Navigation::FindPath - %.1f %.1f %.1f", X, Y, Z);
-		FindPathInternal(pos);
-
-		if (m_currentPathSize > 0)
-		{
-			// DebugSpewAlways("FindPath - cursor = %d, size = %d", m_currentPathCursor , m_currentPathSize);
-			return true;
-		}
-	}
-	return false;
-}
-
-void NavigationPath::FindPathInternal(const glm::vec3& pos)
-{
-	if (nullptr == m_navMesh)
-		return;
-
-	m_currentPathCursor = 0;
-	m_currentPathSize = 0;
-	m_destination = pos;
-
-	m_query.reset(new dtNavMeshQuery);
-	m_query->init(m_navMesh, 10000 /* MAX_NODES */);
-
-	UpdatePath();
-}
-
-static glm::vec3 lastPos;
-
-void NavigationPath::UpdatePath()
-{
-	if (m_navMesh == nullptr)
-		return;
-	if (m_query == nullptr)
-		return;
-
 	PSPAWNINFO me = GetCharInfo()->pSpawn;
 	if (me == nullptr)
-		return;
-
-	float startOffset[3] = { me->X, me->Z, me->Y };
-	float endOffset[3] = { m_destination.x, m_destination.z, m_destination.y };
-	float spos[3];
-	float epos[3];
-
-	glm::vec3 thisPos(startOffset[0], startOffset[1], startOffset[2]);
-
-	if (thisPos == lastPos)
-		return;
-	lastPos = thisPos;
-
-	m_currentPathCursor = 0;
-	m_currentPathSize = 0;
-
-	dtPolyRef startRef, endRef;
-	m_query->findNearestPoly(startOffset, m_extents, &m_filter, &startRef, spos);
-
-	if (!startRef)
-	{
-		WriteChatf(PLUGIN_MSG "No start reference");
-		return;
-	}
-
-	dtPolyRef polys[MAX_POLYS];
-	int numPolys = 0;
-
-
-	//if (!m_corridor)
-	{
-		// initialize planning
-		//m_corridor.reset(new dtPathCorridor);
-		//m_corridor->init(MAX_PATH_SIZE);
-
-		//m_corridor->reset(startRef, startOffset);
-
-		m_query->findNearestPoly(endOffset, m_extents, &m_filter, &endRef, epos);
+		return false;
 
-		if (!endRef)
-		{
-			WriteChatf(PLUGIN_MSG "No end reference");
-			return;
-		}
+	pos = glm::vec3(me->X, me->Y, me->Z);
+	return true;
+}
 
-		dtStatus status = m_query->findPath(startRef, endRef, spos, epos, &m_filter, polys, &numPolys, MAX_POLYS);
-		if (status & DT_OUT_OF_NODES)
-			DebugSpewAlways("findPath from %.2f,%.2f,%.2f to %.2f,%.2f,%.2f failed: out of nodes",
-				startOffset[0], startOffset[1], startOffset[2],
-				endOffset[0], endOffset[1], endOffset[2]);
-		if (status & DT_PARTIAL_RESULT)
-			DebugSpewAlways("findPath from %.2f,%.2f,%.2f to %.2f,%.2f,%.2f returned a partial result.",
-				startOffset[0], startOffset[1], startOffset[2],
-				endOffset[0], endOffset[1], endOffset[2]);
-
-		//m_corridor->setCorridor(endOffset, polys, numPolys);
-	}
-	//else
+void NavigationPath::OnPathChanged()
+{
+	if (m_line && mq2nav::GetSettings().show_nav_path)
 	{
-		// this is an update
-		//m_corridor->movePosition(startOffset, m_query.get(), &m_filter);
+		m_line->Update();
 	}
+}
 
-	//m_corridor->optimizePathTopology(m_query.get(), &m_filter);
-
-	//m_currentPathSize = m_corridor->findCorners(m_currentPath,
-	//	m_cornerFlags, polys, 10, m_query.get(), &m_filter);
+void NavigationPath::RequestTiles(const float* points, int count)
+{
+	if (NavMeshLoader* meshLoader = g_mq2Nav ? g_mq2Nav->GetMeshLoader() : nullptr)
+		meshLoader->RequestTiles(points, count);
+}
 
-	if (numPolys > 0)
-	{
-		m_query->findStraightPath(spos, epos, polys, numPolys, m_currentPath,
-			0, 0, &m_currentPathSize, MAX_POLYS, 0);
-	}
+bool NavigationPath::IsLazyLoading() const
+{
+	NavMeshLoader* meshLoader = g_mq2Nav ? g_mq2Nav->GetMeshLoader() : nullptr;
+	return meshLoader && meshLoader->IsLazyLoading();
+}
 
-	if (m_line && mq2nav::GetSettings().show_nav_path)
-	{
-		m_line->Update();
-	}
+void NavigationPath::OnMessage(bool important, const char* message)
+{
+	if (important)
+		WriteChatf(PLUGIN_MSG "%s", message);
+	else
+		DebugSpewAlways("[MQ2Nav] %s", message);
 }
 
 void NavigationPath::OnUpdateUI()
@@ -169,6 +100,20 @@ void NavigationPath::OnUpdateUI()
 		m_line->SetVisible(showPath);
 	}
 
+	const Stats& stats = GetStats();
+
+	ImGui::LabelText("Path Searches", "%d", stats.replans);
+	ImGui::LabelText("Corridor Updates", "%d", stats.corridorUpdates);
+	ImGui::LabelText("Waypoints", "%d of %d corners", GetPathSize(), stats.lastPathCorners);
+	ImGui::LabelText("Shortcut Corners", "%d", stats.shortcutCorners);
+
+	if (IsSearching())
+		ImGui::LabelText("Search", "%d iterations, %d pulses (in progress)", stats.searchIterations, stats.searchPulses);
+	else
+		ImGui::LabelText("Last Search", "%d iterations, %d pulses", stats.lastSearchIterations, stats.lastSearchPulses);
+	ImGui::LabelText("Total Iterations", "%d", stats.totalSearchIterations);
+	ImGui::LabelText("Cluster Route", "%d crossings", stats.lastRouteSize);
+
 	//float thickness = m_line->GetThickness();
 	//if (ImGui::DragFloat("Path Thickness", &thickness, 0.01f, 0.0f, FLT_MAX))
 	//	m_line->SetThickness(thickness);
@@ -327,7 +272,7 @@ void NavigationLine::Render(RenderPhase phase)
 
 void NavigationLine::GenerateBuffers()
 {
-	int size = m_path->m_currentPathSize;
+	int size = m_path->GetPathSize();
 
 	if (size == m_lastSize)
 	{
@@ -362,7 +307,7 @@ void NavigationLine::GenerateBuffers()
 		return;
 
 	// get the path as if it were a series of 3d points
-	D3DXVECTOR3* pt = (D3DXVECTOR3*)&m_path->m_currentPath[0];
+	D3DXVECTOR3* pt = (D3DXVECTOR3*)m_path->GetCurrentPath();
 
 	int index = 0;
 	m_commands.resize(size - 1);
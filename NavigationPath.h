@@ -4,102 +4,43 @@
 
 #pragma once
 
+#include "NavMeshPath.h"
 #include "Renderable.h"
 #include "RenderList.h"
-
-#include "DetourNavMeshQuery.h"
-#include "DetourPathCorridor.h"
-
-#define GLM_FORCE_RADIANS
-#include <glm.hpp>
+#include "Signal.h"
 
 #include <d3d9.h>
 #include <d3dx9.h>
 
 #include <memory>
+#include <string>
+#include <vector>
 
 //----------------------------------------------------------------------------
 
 class NavigationLine;
 
-class NavigationPath
+// The path that the character follows, drawn in the world while we follow it.
+class NavigationPath : public NavMeshPath
 {
-	friend class NavigationLine;
-
 public:
-	NavigationPath(dtNavMesh* navMesh, bool renderPaths = true);
+	NavigationPath(NavMeshQueryPool* queryPool, bool renderPaths = true);
 	~NavigationPath();
 
-	//----------------------------------------------------------------------------
-	// constants
-
-	static const int MAX_POLYS = 4028 * 4;
-
-	static const int MAX_NODES = 2048 * 4;
-
-	static const int MAX_PATH_SIZE = 2048 * 4;
-
-	//----------------------------------------------------------------------------
-
-	const glm::vec3& GetDestination() const { return m_destination; }
-
-	int GetPathSize() const { return m_currentPathSize; }
-	int GetPathIndex() const { return m_currentPathCursor; }
-
-	bool FindPath(const glm::vec3& pos);
-
-	void UpdatePath();
-
 	void OnUpdateUI();
 
-	// Check if we are at the end if our path
-	inline bool IsAtEnd() const { return m_currentPathCursor >= m_currentPathSize; }
-
-	inline glm::vec3 GetNextPosition() const
-	{
-		return GetPosition(m_currentPathCursor);
-	}
-	inline const float* GetRawPosition(int index) const
-	{
-		assert(index < m_currentPathSize);
-		return &m_currentPath[index * 3];
-	}
-	inline glm::vec3 GetPosition(int index) const
-	{
-		const float* rawcoord = GetRawPosition(index);
-		return glm::vec3(rawcoord[0], rawcoord[1], rawcoord[2]);
-	}
-
-	inline void Increment() { ++m_currentPathCursor; }
-
-	const float* GetCurrentPath() const { return &m_currentPath[0]; }
-
-	dtNavMesh* GetNavMesh() const { return m_navMesh; }
-	dtNavMeshQuery* GetNavMeshQuery() const { return m_query.get(); }
+protected:
+	virtual bool GetStartPosition(glm::vec3& pos) const override;
+	virtual void OnPathChanged() override;
+	virtual void RequestTiles(const float* points, int count) override;
+	virtual bool IsLazyLoading() const override;
+	virtual void OnMessage(bool important, const char* message) override;
 
 private:
-	void FindPathInternal(const glm::vec3& pos);
-
-	glm::vec3 m_destination;
-
-	float m_currentPath[MAX_POLYS * 3];
-	unsigned char m_cornerFlags[MAX_POLYS];
-
-	int m_currentPathCursor = 0;
-	int m_currentPathSize = 0;
-
-	// the plugin owns the mesh
-	dtNavMesh* m_navMesh;
-
-	// we own the query
-	std::unique_ptr<dtNavMeshQuery> m_query;
-	std::unique_ptr<dtPathCorridor> m_corridor;
+	Signal<>::ScopedConnection m_tilesConn;
 
 	bool m_renderPaths;
 	std::shared_ptr<NavigationLine> m_line;
-
-	dtQueryFilter m_filter;
-	float m_extents[3] = { 50, 400, 50 }; // note: X, Z, Y
 };
 
 class NavigationLine : public Renderable
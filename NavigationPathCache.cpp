@@ -0,0 +1,125 @@
+//
+// NavigationPathCache.cpp
+//
+
+#include "NavigationPathCache.h"
+#include "NavMeshPath.h"
+
+//----------------------------------------------------------------------------
+
+NavigationPathCache::NavigationPathCache(size_t capacity)
+	: m_capacity(capacity)
+{
+}
+
+NavigationPathCache::~NavigationPathCache()
+{
+}
+
+const NavigationPathCache::Result* NavigationPathCache::Lookup(const Key& key)
+{
+	auto iter = m_index.find(key);
+	if (iter == m_index.end())
+	{
+		m_stats.misses++;
+		return nullptr;
+	}
+
+	m_entries.splice(m_entries.begin(), m_entries, iter->second);
+
+	m_stats.hits++;
+	return &iter->second->second;
+}
+
+void NavigationPathCache::Insert(const Key& key, Result result)
+{
+	auto iter = m_index.find(key);
+	if (iter != m_index.end())
+	{
+		iter->second->second = std::move(result);
+		m_entries.splice(m_entries.begin(), m_entries, iter->second);
+		return;
+	}
+
+	if (m_capacity == 0)
+		return;
+
+	if (m_entries.size() >= m_capacity)
+	{
+		m_index.erase(m_entries.back().first);
+		m_entries.pop_back();
+	}
+
+	m_entries.emplace_front(key, std::move(result));
+	m_index[key] = m_entries.begin();
+}
+
+void NavigationPathCache::Clear()
+{
+	if (!m_entries.empty())
+		m_stats.invalidations++;
+
+	m_entries.clear();
+	m_index.clear();
+}
+
+bool NavigationPathCache::FindPath(NavMeshPath& path, const glm::vec3& pos, float& length)
+{
+	length = -1.f;
+
+	// The polys the path goes through only change when one of the ends moves
+	// to another poly. The straight path through them is built from the
+	// actual ends every time, so the length is close to what a search would
+	// give. A search from elsewhere on a big poly might take other polys.
+	Key key;
+	bool cacheable = path.FindEndpoints(pos, key.startRef, key.endRef);
+	if (cacheable)
+	{
+		key.filter = path.GetNavigationFilter();
+
+		const Result* cached = Lookup(key);
+		if (cached)
+		{
+			if (!cached->exists)
+				return false;
+
+			if (path.FollowPolys(pos, cached->polys.data(), static_cast<int>(cached->polys.size()),
+				cached->partial) && path.GetPathSize() > 0)
+			{
+				length = path.GetPathLength();
+				return true;
+			}
+
+			// the polys couldn't be followed, search again below
+		}
+
+		// if the ends are in different parts of the mesh, the search would
+		// only find a partial path, after looking at everything it can reach.
+		if (!cached && !path.MayReach(key.startRef, key.endRef))
+		{
+			Insert(key, Result());
+			return false;
+		}
+	}
+
+	path.FindPath(pos);
+
+	bool exists = path.GetPathSize() > 0;
+	if (exists)
+		length = path.GetPathLength();
+
+	if (cacheable)
+	{
+		Result result;
+		result.exists = exists;
+		if (exists)
+		{
+			result.polys = path.GetPlannedPolys();
+			result.partial = path.IsPartialPath();
+		}
+
+		Insert(key, std::move(result));
+	}
+
+	return exists;
+}
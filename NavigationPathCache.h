@@ -0,0 +1,106 @@
+//
+// NavigationPathCache.h
+//
+// Remembers the results of recent path queries from the Navigation TLO.
+// Macros tend to ask about the same destination over and over, and the polys
+// the path goes through don't change until one of its ends moves to a
+// different poly. The straight path through them does, so the cache keeps
+// the polys and the length is worked out from them for each query.
+//
+// Poly refs can be reused by a new mesh or by tiles that were reloaded, so
+// whoever loads the mesh calls Clear when the mesh or its tiles change.
+//
+
+#pragma once
+
+#include "NavigationFilter.h"
+
+#include "DetourNavMesh.h"
+
+#include <glm.hpp>
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+class NavMeshPath;
+
+//----------------------------------------------------------------------------
+
+class NavigationPathCache
+{
+public:
+	NavigationPathCache(size_t capacity = 64);
+	~NavigationPathCache();
+
+	struct Key
+	{
+		dtPolyRef startRef = 0;
+		dtPolyRef endRef = 0;
+
+		// the filter used for the search
+		NavigationFilter filter;
+
+		bool operator==(const Key& other) const
+		{
+			return startRef == other.startRef && endRef == other.endRef
+				&& filter == other.filter;
+		}
+	};
+
+	struct Result
+	{
+		bool exists = false;
+
+		// the polys that the search found, and whether they stop short of
+		// the end poly
+		std::vector<dtPolyRef> polys;
+		bool partial = false;
+	};
+
+	// returns the result for key if it is in the cache, or null. The result
+	// is only good until the next Insert() or Clear().
+	const Result* Lookup(const Key& key);
+
+	void Insert(const Key& key, Result result);
+
+	// Find a path to pos with the path's filter, following the polys from
+	// an earlier search if both ends are still on the same polys. Returns
+	// whether there is a path, and its length (or -1).
+	bool FindPath(NavMeshPath& path, const glm::vec3& pos, float& length);
+
+	// forget everything, the mesh changed
+	void Clear();
+
+	struct Stats
+	{
+		uint32_t hits = 0;
+		uint32_t misses = 0;
+		uint32_t invalidations = 0;
+	};
+	const Stats& GetStats() const { return m_stats; }
+
+	size_t GetSize() const { return m_entries.size(); }
+
+private:
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const
+		{
+			size_t hash = std::hash<dtPolyRef>()(key.startRef);
+			hash = hash * 31 + std::hash<dtPolyRef>()(key.endRef);
+			hash = hash * 31 + key.filter.Hash();
+			return hash;
+		}
+	};
+
+	typedef std::list<std::pair<Key, Result>> EntryList;
+
+	// most recently used at the front
+	EntryList m_entries;
+	std::unordered_map<Key, EntryList::iterator, KeyHash> m_index;
+	size_t m_capacity;
+
+	Stats m_stats;
+};
@@ -16,6 +16,8 @@ MQ2NavigationType::MQ2NavigationType(MQ2NavigationPlugin* nav_)
 	TypeMember(MeshLoaded);
 	TypeMember(PathExists);
 	TypeMember(PathLength);
+	TypeMember(PathLengths);
+	TypeMember(Loading);
 }
 
 MQ2NavigationType::~MQ2NavigationType()
@@ -46,6 +48,15 @@ bool MQ2NavigationType::GetMember(MQ2VARPTR VarPtr, PCHAR Member, PCHAR Index, M
 		Dest.Type = pFloatType;
 		Dest.Float = m_nav->GetNavigationPathLength(Index);
 		return true;
+	case PathLengths:
+		Dest.Type = pStringType;
+		m_nav->GetNavigationPathLengths(Index, DataTypeTemp, MAX_STRING);
+		Dest.Ptr = DataTypeTemp;
+		return true;
+	case Loading:
+		Dest.Type = pBoolType;
+		Dest.DWord = m_nav->IsMeshLoading();
+		return true;
 	}
 	Dest.Type = pStringType;
 	Dest.Ptr = "NULL";
@@ -21,6 +21,8 @@ public:
 		MeshLoaded = 3,
 		PathExists = 4,
 		PathLength = 5,
+		PathLengths = 6,
+		Loading = 7,
 	};
 
 	MQ2NavigationType(MQ2NavigationPlugin* nav_);
@@ -39,21 +39,22 @@ public:
 
 	static std::string GetZoneFile(ZoneData* zd)
 	{
-		return (boost::format("%s\\%s.eqg")
+		return (boost::format("%s/%s.eqg")
 			% zd->GetEQPath()
 			% zd->GetZoneName()).str();
 	}
 
 	static bool IsValid(ZoneData* zd)
 	{
-		return boost::filesystem::exists(GetZoneFile(zd), boost::system::error_code());
+		boost::system::error_code ec;
+		return boost::filesystem::exists(GetZoneFile(zd), ec);
 	}
 
 	virtual bool Load() override
 	{
 		bool loadedSomething = m_archive.Open(GetZoneFile(m_zd));
 
-		std::string base_filename = (boost::format("%s\\%s")
+		std::string base_filename = (boost::format("%s/%s")
 			% m_zd->GetEQPath()
 			% m_zd->GetZoneName()).str();
 
@@ -73,7 +74,7 @@ public:
 
 				for (auto& name : filenames)
 				{
-					std::string asset_file = (boost::format("%s\\%s") % m_zd->GetEQPath() % name).str();
+					std::string asset_file = (boost::format("%s/%s") % m_zd->GetEQPath() % name).str();
 					EQEmu::PFS::Archive archive;
 
 					if (!archive.Open(asset_file))
@@ -173,18 +174,19 @@ public:
 
 	static bool IsValid(ZoneData* zd)
 	{
-		std::string filename = (boost::format("%s\\%s.s3d")
+		std::string filename = (boost::format("%s/%s.s3d")
 			% zd->GetEQPath()
 			% zd->GetZoneName()).str();
 
-		return boost::filesystem::exists(filename, boost::system::error_code());
+		boost::system::error_code ec;
+		return boost::filesystem::exists(filename, ec);
 	}
 
 	virtual bool Load() override
 	{
 		std::vector<EQEmu::S3D::WLDFragment> zone_object_frags;
 
-		std::string base_filename = (boost::format("%s\\%s")
+		std::string base_filename = (boost::format("%s/%s")
 			% m_zd->GetEQPath()
 			% m_zd->GetZoneName()).str();
 		bool loadedSomething = false;
@@ -200,7 +202,7 @@ public:
 				suffix += std::to_string(i);
 
 			std::string wld_name = m_zd->GetZoneName() + suffix + ".wld";
-			std::string file_name = (boost::format("%s\\%s.s3d")
+			std::string file_name = (boost::format("%s/%s.s3d")
 				% m_zd->GetEQPath() % (m_zd->GetZoneName() + suffix)).str();
 
 			EQEmu::S3DLoader loader;
@@ -246,7 +248,7 @@ public:
 
 				for (auto& name : filenames)
 				{
-					std::string asset_file = (boost::format("%s\\%s") % m_zd->GetEQPath() % name).str();
+					std::string asset_file = (boost::format("%s/%s") % m_zd->GetEQPath() % name).str();
 					EQEmu::PFS::Archive archive;
 
 					if (!archive.Open(asset_file))
@@ -28,7 +28,8 @@
 // setting is to use non-virtual functions, the actual implementations of the functions
 // are declared as inline for maximum speed. 
 
-//#define DT_VIRTUAL_QUERYFILTER 1
+// MQ2Nav wraps filters to keep searches to part of the mesh (see NavMeshClusterFilter).
+#define DT_VIRTUAL_QUERYFILTER 1
 
 /// Defines polygon filtering and traversal costs for navigation mesh query operations.
 /// @ingroup detour
@@ -121,6 +122,31 @@ public:
 
 
 
+/// Scale applied to the straight line distance by the default heuristic.
+/// Custom heuristics that fall back on the distance should use the same
+/// scale so that they never estimate more than the default does.
+/// @ingroup detour
+static const float DT_HEURISTIC_SCALE = 0.999f;
+
+/// Estimates the remaining cost of a path during the A* searches.
+/// @ingroup detour
+class dtQueryHeuristic
+{
+public:
+	virtual ~dtQueryHeuristic() {}
+
+	/// Returns an estimate of the cost of the cheapest path from a point on
+	/// one polygon to the end of the path.
+	///  @param[in]		ref			The reference id of the polygon the point is on.
+	///  @param[in]		pos			The point. [(x, y, z)]
+	///  @param[in]		endRef		The reference id of the end polygon.
+	///  @param[in]		endPos		The end position. [(x, y, z)]
+	/// @returns The estimated cost. If this is ever more than the actual cost,
+	/// the path found might not be the shortest one.
+	virtual float getCost(dtPolyRef ref, const float* pos,
+						  dtPolyRef endRef, const float* endPos) const = 0;
+};
+
 /// Provides information about raycast hit
 /// filled by dtNavMeshQuery::raycast
 /// @ingroup detour
@@ -469,6 +495,17 @@ public:
 	/// @return The navigation mesh the query object is using.
 	const dtNavMesh* getAttachedNavMesh() const { return m_nav; }
 
+	/// Sets the heuristic used by findPath and the sliced path queries.
+	/// If none is set (the default), the straight line distance to the
+	/// end position is used.
+	///  @param[in]		heuristic	The heuristic to use, or null. It must stay
+	///  							valid while it is set.
+	void setHeuristic(const dtQueryHeuristic* heuristic) { m_heuristic = heuristic; }
+
+	/// Gets the heuristic used by the path queries.
+	/// @return The heuristic, or null if the default is being used.
+	const dtQueryHeuristic* getHeuristic() const { return m_heuristic; }
+
 	/// @}
 	
 private:
@@ -487,6 +524,9 @@ private:
 							 dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile,
 							 float* left, float* right) const;
 	
+	/// Returns the heuristic cost from a point on a polygon to the end of the path.
+	float getHeuristicCost(dtPolyRef ref, const float* pos, dtPolyRef endRef, const float* endPos) const;
+
 	/// Returns edge mid point between two polygons.
 	dtStatus getEdgeMidPoint(dtPolyRef from, dtPolyRef to, float* mid) const;
 	dtStatus getEdgeMidPoint(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
@@ -521,6 +561,8 @@ private:
 	class dtNodePool* m_tinyNodePool;	///< Pointer to small node pool.
 	class dtNodePool* m_nodePool;		///< Pointer to node pool.
 	class dtNodeQueue* m_openList;		///< Pointer to open list queue.
+
+	const dtQueryHeuristic* m_heuristic;	///< Heuristic for the path searches. [opt]
 };
 
 /// Allocates a query object using the Detour allocator.
@@ -100,8 +100,6 @@ inline float dtQueryFilter::getCost(const float* pa, const float* pb,
 }
 #endif	
 	
-static const float H_SCALE = 0.999f; // Search heuristic scale.
-
 
 dtNavMeshQuery* dtAllocNavMeshQuery()
 {
@@ -139,7 +137,8 @@ dtNavMeshQuery::dtNavMeshQuery() :
 	m_nav(0),
 	m_tinyNodePool(0),
 	m_nodePool(0),
-	m_openList(0)
+	m_openList(0),
+	m_heuristic(0)
 {
 	memset(&m_query, 0, sizeof(dtQueryData));
 }
@@ -954,7 +953,7 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 	dtVcopy(startNode->pos, startPos);
 	startNode->pidx = 0;
 	startNode->cost = 0;
-	startNode->total = dtVdist(startPos, endPos) * H_SCALE;
+	startNode->total = getHeuristicCost(startRef, startPos, endRef, endPos);
 	startNode->id = startRef;
 	startNode->flags = DT_NODE_OPEN;
 	m_openList->push(startNode);
@@ -1060,7 +1059,7 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 													  bestRef, bestTile, bestPoly,
 													  neighbourRef, neighbourTile, neighbourPoly);
 				cost = bestNode->cost + curCost;
-				heuristic = dtVdist(neighbourNode->pos, endPos)*H_SCALE;
+				heuristic = getHeuristicCost(neighbourRef, neighbourNode->pos, endRef, endPos);
 			}
 
 			const float total = cost + heuristic;
@@ -1192,7 +1191,7 @@ dtStatus dtNavMeshQuery::initSlicedFindPath(dtPolyRef startRef, dtPolyRef endRef
 	dtVcopy(startNode->pos, startPos);
 	startNode->pidx = 0;
 	startNode->cost = 0;
-	startNode->total = dtVdist(startPos, endPos) * H_SCALE;
+	startNode->total = getHeuristicCost(startRef, startPos, endRef, endPos);
 	startNode->id = startRef;
 	startNode->flags = DT_NODE_OPEN;
 	m_openList->push(startNode);
@@ -1366,7 +1365,7 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 			}
 			else
 			{
-				heuristic = dtVdist(neighbourNode->pos, m_query.endPos)*H_SCALE;
+				heuristic = getHeuristicCost(neighbourRef, neighbourNode->pos, m_query.endRef, m_query.endPos);
 			}
 			
 			const float total = cost + heuristic;
@@ -2236,6 +2235,14 @@ dtStatus dtNavMeshQuery::getPortalPoints(dtPolyRef from, const dtPoly* fromPoly,
 	return DT_SUCCESS;
 }
 
+// Returns the heuristic cost from a point on a polygon to the end of the path.
+float dtNavMeshQuery::getHeuristicCost(dtPolyRef ref, const float* pos, dtPolyRef endRef, const float* endPos) const
+{
+	if (m_heuristic)
+		return m_heuristic->getCost(ref, pos, endRef, endPos);
+	return dtVdist(pos, endPos) * DT_HEURISTIC_SCALE;
+}
+
 // Returns edge mid point between two polygons.
 dtStatus dtNavMeshQuery::getEdgeMidPoint(dtPolyRef from, dtPolyRef to, float* mid) const
 {
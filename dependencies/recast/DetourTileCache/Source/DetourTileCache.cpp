@@ -369,6 +369,7 @@ dtObstacleRef dtTileCache::addObstacle(const float* pos, const float radius, con
 	memset(ob, 0, sizeof(dtTileCacheObstacle));
 	ob->salt = salt;
 	ob->state = DT_OBSTACLE_PROCESSING;
+	ob->type = DT_OBSTACLE_CYLINDER;
 	dtVcopy(ob->pos, pos);
 	ob->radius = radius;
 	ob->height = height;
@@ -384,6 +385,40 @@ dtObstacleRef dtTileCache::addObstacle(const float* pos, const float radius, con
 	return DT_SUCCESS;
 }
 
+dtStatus dtTileCache::addBoxObstacle(const float* bmin, const float* bmax, dtObstacleRef* result)
+{
+	if (m_nreqs >= MAX_REQUESTS)
+		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+	
+	dtTileCacheObstacle* ob = 0;
+	if (m_nextFreeObstacle)
+	{
+		ob = m_nextFreeObstacle;
+		m_nextFreeObstacle = ob->next;
+		ob->next = 0;
+	}
+	if (!ob)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	
+	unsigned short salt = ob->salt;
+	memset(ob, 0, sizeof(dtTileCacheObstacle));
+	ob->salt = salt;
+	ob->state = DT_OBSTACLE_PROCESSING;
+	ob->type = DT_OBSTACLE_BOX;
+	dtVcopy(ob->bmin, bmin);
+	dtVcopy(ob->bmax, bmax);
+	
+	ObstacleRequest* req = &m_reqs[m_nreqs++];
+	memset(req, 0, sizeof(ObstacleRequest));
+	req->action = REQUEST_ADD;
+	req->ref = getObstacleRef(ob);
+	
+	if (result)
+		*result = req->ref;
+	
+	return DT_SUCCESS;
+}
+
 dtObstacleRef dtTileCache::removeObstacle(const dtObstacleRef ref)
 {
 	if (!ref)
@@ -440,7 +475,7 @@ dtStatus dtTileCache::queryTiles(const float* bmin, const float* bmax,
 	return DT_SUCCESS;
 }
 
-dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh)
+dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh, bool* upToDate)
 {
 	if (m_nupdate == 0)
 	{
@@ -549,9 +584,16 @@ dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh)
 		}
 			
 		if (dtStatusFailed(status))
+		{
+			if (upToDate)
+				*upToDate = m_nupdate == 0 && m_nreqs == 0;
 			return status;
+		}
 	}
 	
+	if (upToDate)
+		*upToDate = m_nupdate == 0 && m_nreqs == 0;
+	
 	return DT_SUCCESS;
 }
 
@@ -604,8 +646,16 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 			continue;
 		if (contains(ob->touched, ob->ntouched, ref))
 		{
-			dtMarkCylinderArea(*bc.layer, tile->header->bmin, m_params.cs, m_params.ch,
-							   ob->pos, ob->radius, ob->height, 0);
+			if (ob->type == DT_OBSTACLE_BOX)
+			{
+				dtMarkBoxArea(*bc.layer, tile->header->bmin, m_params.cs, m_params.ch,
+							  ob->bmin, ob->bmax, 0);
+			}
+			else
+			{
+				dtMarkCylinderArea(*bc.layer, tile->header->bmin, m_params.cs, m_params.ch,
+								   ob->pos, ob->radius, ob->height, 0);
+			}
 		}
 	}
 	
@@ -629,9 +679,13 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 	if (dtStatusFailed(status))
 		return status;
 	
-	// Early out if the mesh tile is empty.
+	// Early out if the mesh tile is empty, but don't leave the old tile
+	// behind: an obstacle could have covered the whole layer.
 	if (!bc.lmesh->npolys)
+	{
+		navmesh->removeTile(navmesh->getTileRefAt(tile->header->tx,tile->header->ty,tile->header->tlayer),0,0);
 		return DT_SUCCESS;
+	}
 	
 	dtNavMeshCreateParams params;
 	memset(&params, 0, sizeof(params));
@@ -695,6 +749,13 @@ void dtTileCache::calcTightTileBounds(const dtTileCacheLayerHeader* header, floa
 
 void dtTileCache::getObstacleBounds(const struct dtTileCacheObstacle* ob, float* bmin, float* bmax) const
 {
+	if (ob->type == DT_OBSTACLE_BOX)
+	{
+		dtVcopy(bmin, ob->bmin);
+		dtVcopy(bmax, ob->bmax);
+		return;
+	}
+	
 	bmin[0] = ob->pos[0] - ob->radius;
 	bmin[1] = ob->pos[1];
 	bmin[2] = ob->pos[2] - ob->radius;